@@ -0,0 +1,136 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "bench.h"
+#include "parallel.h"
+#include "types/container/string.h"
+#include "platforms/platform.h"
+#include "platforms/log.h"
+#include "platforms/ext/errorx.h"
+
+typedef struct BenchEntry {
+	const C8 *name, *usage;
+	BenchFunction func;
+} BenchEntry;
+
+static const BenchEntry Bench_entries[] = {
+	{ "bvh", "triangles=4000000 format=f32|f16 rays=1000000 rebuilds=8 policy=both|sah|lbvh", Bench_bvh },
+	{ "packets", "triangles=1000000 width=1024 height=width size=16 iterations=4", Bench_packets },
+	{ "tlas", "instances=50000 moving=10 frames=100 threshold=150", Bench_tlas },
+	{ "pathtracer", "triangles=250000 width=512 height=width bounces=1,4,8 wave=2048 iterations=2", Bench_pathTracer },
+	{ "atmosphere", "directions=4096 cache=atmosphere_lut.bin", Bench_atmosphere },
+	{ "skytemporal", "width=256 height=144 raySamples=4 lightSamples=2 frames=32 rotation=100", Bench_skyTemporal },
+	{ "sky", "size=64 frames=3600 secondsPerFrame=1 threshold=250 directions=4096", Bench_sky },
+	{ "skybake", "width=2048 height=1024 elevation=10", Bench_skyBake },
+	{ "skyupsample", "width=1280 height=720 factor=2,4,8 elevation=10 lut=1 iterations=2", Bench_skyUpsample },
+	{ "sun", "locations=64 steps=16384 secondsPerStep=600", Bench_sun },
+	{ "bc", "size=1024 iterations=4", Bench_bc },
+	{ "mips", "size=8192 height=size iterations=2 filter=all|box|kaiser|lanczos", Bench_mips }
+};
+
+static const C8 *Bench_matchKey(const C8 *arg, const C8 *key) {
+
+	U64 i = 0;
+
+	for(; key[i] && arg[i] == key[i]; ++i)
+		;
+
+	return !key[i] && arg[i] == '=' ? arg + i + 1 : NULL;
+}
+
+Bool Bench_equals(const C8 *a, const C8 *b) {
+
+	for(; *a && *a == *b; ++a, ++b)
+		;
+
+	return *a == *b;
+}
+
+const C8 *Bench_getArg(U64 argc, const C8 *const *argv, const C8 *key, const C8 *defaultValue) {
+
+	for(U64 i = 0; i < argc; ++i) {
+
+		const C8 *value = Bench_matchKey(argv[i], key);
+
+		if(value)
+			return value;
+	}
+
+	return defaultValue;
+}
+
+U64 Bench_getArgU64(U64 argc, const C8 *const *argv, const C8 *key, U64 defaultValue) {
+
+	const C8 *value = Bench_getArg(argc, argv, key, NULL);
+	U64 result = defaultValue;
+
+	if(value && !CharString_parseU64(CharString_createRefCStrConst(value), &result))
+		return defaultValue;
+
+	return result;
+}
+
+static void Bench_printUsage() {
+
+	Log_debugLnx("Usage: rt_core_bench <benchmark> [threads=0] [key=value...]");
+
+	for(U64 i = 0; i < sizeof(Bench_entries) / sizeof(Bench_entries[0]); ++i)
+		Log_debugLnx("\t%s %s", Bench_entries[i].name, Bench_entries[i].usage);
+}
+
+Platform_defineEntrypoint() {
+
+	Error err = Platform_create(Platform_argc, Platform_argv, Platform_getData(), NULL, true);
+
+	if(err.genericError) {
+		Error_printLnx(err);
+		Platform_return(-2);
+	}
+
+	Error *e_rr = &err;
+	Bool s_uccess = true;
+
+	const BenchEntry *entry = NULL;
+
+	for(U64 i = 0; Platform_argc >= 2 && i < sizeof(Bench_entries) / sizeof(Bench_entries[0]); ++i)
+		if(Bench_equals(Platform_argv[1], Bench_entries[i].name))
+			entry = &Bench_entries[i];
+
+	if(!entry) {
+		Bench_printUsage();
+		retError(clean, Error_invalidParameter(0, 0, "rt_core_bench expected a valid benchmark"))
+	}
+
+	const U64 benchArgc = (U64) Platform_argc - 2;
+	const C8 *const *benchArgv = (const C8 *const*) Platform_argv + 2;
+
+	Parallel_setThreadCount(Bench_getArgU64(benchArgc, benchArgv, "threads", 0));
+	Log_debugLnx("Running %s on %"PRIu64" thread(s)", entry->name, Parallel_getThreadCount());
+
+	gotoIfError3(clean, entry->func(benchArgc, benchArgv, e_rr))
+
+clean:
+	Error_printx(err, ELogLevel_Error, ELogOptions_Default);
+	Parallel_freex();
+	Platform_cleanup();
+	Platform_return(s_uccess ? 1 : -1);
+}
+
+void Program_exit() { }
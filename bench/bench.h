@@ -0,0 +1,97 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "types/base/error.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//rt_core_bench <benchmark> [key=value...]
+//Benchmarks get the arguments after the benchmark name and log their results.
+
+typedef Bool (*BenchFunction)(U64 argc, const C8 *const *argv, Error *e_rr);
+
+Bool Bench_equals(const C8 *a, const C8 *b);
+
+//Finds key=value in the arguments and returns value, or defaultValue if it's missing or not a number
+
+U64 Bench_getArgU64(U64 argc, const C8 *const *argv, const C8 *key, U64 defaultValue);
+
+//Finds key=value in the arguments and returns value (or defaultValue if it's missing)
+
+const C8 *Bench_getArg(U64 argc, const C8 *const *argv, const C8 *key, const C8 *defaultValue);
+
+//CPU BVH build: triangles=4000000 format=f32|f16 rays=1000000 rebuilds=8 policy=both|sah|lbvh
+
+Bool Bench_bvh(U64 argc, const C8 *const *argv, Error *e_rr);
+
+//CPU ray packets vs single rays (primary rays, test TLAS and a big mesh): triangles=1000000 width=1024 height=width
+//size=16 (packet width) iterations=4
+
+Bool Bench_packets(U64 argc, const C8 *const *argv, Error *e_rr);
+
+//CPU TLAS update: instances=50000 moving=10 (% per frame) frames=100 threshold=150 (% SAH cost before rebuild)
+
+Bool Bench_tlas(U64 argc, const C8 *const *argv, Error *e_rr);
+
+//CPU path tracing, megakernel vs wavefront: triangles=250000 width=512 height=width bounces=1,4,8 (default: all three)
+//wave=2048 (paths per wave) iterations=2
+
+Bool Bench_pathTracer(U64 argc, const C8 *const *argv, Error *e_rr);
+
+//Atmosphere LUTs vs ray marching (accuracy and cost): directions=4096 cache=atmosphere_lut.bin
+
+Bool Bench_atmosphere(U64 argc, const C8 *const *argv, Error *e_rr);
+
+//Jittered low sample ray march with temporal reuse vs midpoint sampling (time and error against 128x64 samples):
+//width=256 height=144 raySamples=4 lightSamples=2 frames=32 rotation=100 (millidegrees per frame) elevation=10
+
+Bool Bench_skyTemporal(U64 argc, const C8 *const *argv, Error *e_rr);
+
+//Sky cache over a simulated day: size=64 frames=3600 secondsPerFrame=1 threshold=250 (millidegrees) directions=4096
+
+Bool Bench_sky(U64 argc, const C8 *const *argv, Error *e_rr);
+
+//Equirectangular sky bake, 4 rays per call vs per ray (ms per megapixel, error): width=2048 height=width/2 elevation=10
+
+Bool Bench_skyBake(U64 argc, const C8 *const *argv, Error *e_rr);
+
+//Reduced resolution sky with a hit mask aware upsample vs full resolution (time and PSNR): width=1280 height=720
+//factor=2,4,8 (default: all three) elevation=10 lut=1 (0 = ray march) iterations=2
+
+Bool Bench_skyUpsample(U64 argc, const C8 *const *argv, Error *e_rr);
+
+//Batched vs scalar sun directions (accuracy and cost): locations=64 steps=16384 secondsPerStep=600
+
+Bool Bench_sun(U64 argc, const C8 *const *argv, Error *e_rr);
+
+//BC1/BC3/BC7 block compression (throughput and quality): size=1024 iterations=4
+
+Bool Bench_bc(U64 argc, const C8 *const *argv, Error *e_rr);
+
+//Mip chain generation (sRGB correct) per filter: size=8192 height=size iterations=2 filter=all|box|kaiser|lanczos
+
+Bool Bench_mips(U64 argc, const C8 *const *argv, Error *e_rr);
+
+#ifdef __cplusplus
+	}
+#endif
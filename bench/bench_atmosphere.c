@@ -0,0 +1,789 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "bench.h"
+#include "sky_cache.h"
+#include "sky_bake.h"
+#include "sky_upsample.h"
+#include "sky_temporal.h"
+#include "atmos_helper.h"
+#include "parallel.h"
+#include "platforms/log.h"
+#include "platforms/ext/bufferx.h"
+#include "types/base/time.h"
+#include "types/math/math.h"
+
+//Ground truth is the same ray march with a lot more samples (light samples are also used to isolate the LUT error).
+//Its samples are quadratic, which converges faster (see Atmosphere_getSampleT).
+
+#define Bench_atmosphereTruthRaySamples 128
+#define Bench_atmosphereTruthLightSamples 64
+
+static F32 Bench_luminance(F32x4 color) {
+	return F32x4_dot3(color, F32x4_create3(0.2126f, 0.7152f, 0.0722f));
+}
+
+//Directions in the upper hemisphere (a golden spiral), since rays that hit the planet only return its shading
+
+static RayDesc Bench_atmosphereRay(U64 i, U64 count) {
+
+	const F32 y = 0.01f + 0.99f * (i + 0.5f) / count;
+	const F32 phi = (F32) i * 2.39996323f;
+	const F32 xz = F32_sqrt(1 - y * y);
+
+	return RayDesc_create(F32x4_zero(), 0, F32x4_create3(xz * F32_cos(phi), y, xz * F32_sin(phi)), 1e38f);
+}
+
+Bool Bench_atmosphere(U64 argc, const C8 *const *argv, Error *e_rr) {
+
+	Bool s_uccess = true;
+	AtmosphereLUT lut = (AtmosphereLUT) { 0 };
+	Buffer results = Buffer_createNull();
+
+	const U64 directions = U64_max(Bench_getArgU64(argc, argv, "directions", 4096), 1);
+	const C8 *cachePath = Bench_getArg(argc, argv, "cache", "atmosphere_lut.bin");
+
+	Atmosphere atmos = Atmosphere_earth(F32x4_create3(0, -1, 0));
+
+	Ns start = Time_now();
+	gotoIfError3(clean, AtmosphereLUT_createx(&atmos, &lut, e_rr))
+
+	Log_debugLnx(
+		"Atmosphere LUT: transmittance %ux%u, multiple scattering %ux%u, created in %.3fms",
+		AtmosphereLUT_transmittanceW, AtmosphereLUT_transmittanceH,
+		AtmosphereLUT_multiScatteringW, AtmosphereLUT_multiScatteringH,
+		(Time_now() - start) / 1e6
+	);
+
+	AtmosphereLUT_freex(&lut);
+
+	start = Time_now();
+	gotoIfError3(clean, AtmosphereLUT_loadOrCreatex(&atmos, CharString_createRefCStrConst(cachePath), &lut, e_rr))
+	Log_debugLnx("Atmosphere LUT: loaded (or created and cached) from %s in %.3fms", cachePath, (Time_now() - start) / 1e6);
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(F32x4) * 3 * directions, &results))
+
+	F32x4 *march = (F32x4*) results.ptrNonConst;
+	F32x4 *single = march + directions;
+	F32x4 *multi = single + directions;
+
+	const F32 elevations[] = { 2, 5, 10, 20, 45, 90 };
+	Ns marchTime = 0, lutTime = 0, multiTime = 0;
+
+	for(U64 e = 0; e < sizeof(elevations) / sizeof(elevations[0]); ++e) {
+
+		const F32 elevation = elevations[e] * F32_DEG_TO_RAD;
+		atmos = Atmosphere_earth(F32x4_negate(F32x4_create3(F32_cos(elevation), F32_sin(elevation), 0)));
+
+		start = Time_now();
+
+		for(U64 i = 0; i < directions; ++i)
+			march[i] = Atmosphere_getContribution(&atmos, Bench_atmosphereRay(i, directions));
+
+		marchTime += Time_now() - start;
+		start = Time_now();
+
+		for(U64 i = 0; i < directions; ++i)
+			single[i] = Atmosphere_getContributionLUT(&atmos, &lut, Bench_atmosphereRay(i, directions), false);
+
+		lutTime += Time_now() - start;
+		start = Time_now();
+
+		for(U64 i = 0; i < directions; ++i)
+			multi[i] = Atmosphere_getContributionLUT(&atmos, &lut, Bench_atmosphereRay(i, directions), true);
+
+		multiTime += Time_now() - start;
+
+		//The LUT replaces the light ray march, so the light error is against the same view samples with exact light.
+		//The total error includes the view ray march, which both share.
+
+		Atmosphere exactLight = atmos;
+		exactLight.lightSamples = Bench_atmosphereTruthLightSamples;
+
+		Atmosphere truth = exactLight;
+		truth.raySamples = Bench_atmosphereTruthRaySamples;
+		truth.quadraticSamples = true;
+
+		F64 marchError = 0, lutError = 0, marchTotal = 0, lutTotal = 0, multiGain = 0;
+		F32 marchMax = 0, lutMax = 0;
+
+		for(U64 i = 0; i < directions; ++i) {
+
+			const RayDesc ray = Bench_atmosphereRay(i, directions);
+
+			const F32 light = F32_max(Bench_luminance(Atmosphere_getContribution(&exactLight, ray)), 1e-6f);
+			const F32 reference = F32_max(Bench_luminance(Atmosphere_getContribution(&truth, ray)), 1e-6f);
+
+			const F32 marchLum = Bench_luminance(march[i]), lutLum = Bench_luminance(single[i]);
+
+			const F32 marchDiff = F32_abs(marchLum - light) / light;
+			const F32 lutDiff = F32_abs(lutLum - light) / light;
+
+			marchError += marchDiff;
+			lutError += lutDiff;
+			marchMax = F32_max(marchMax, marchDiff);
+			lutMax = F32_max(lutMax, lutDiff);
+
+			marchTotal += F32_abs(marchLum - reference) / reference;
+			lutTotal += F32_abs(lutLum - reference) / reference;
+
+			multiGain += (Bench_luminance(multi[i]) - lutLum) / F32_max(lutLum, 1e-6f);
+		}
+
+		Log_debugLnx(
+			"Sun at %2.0f deg: light error ray march %.3f%% avg (%.3f%% max), LUT %.3f%% avg (%.3f%% max); "
+			"total error ray march %.3f%%, LUT %.3f%%; multiple scattering adds %.2f%%",
+			elevations[e],
+			marchError * 100 / directions, marchMax * 100.,
+			lutError * 100 / directions, lutMax * 100.,
+			marchTotal * 100 / directions, lutTotal * 100 / directions,
+			multiGain * 100 / directions
+		);
+	}
+
+	const U64 evaluations = directions * (sizeof(elevations) / sizeof(elevations[0]));
+
+	Log_debugLnx(
+		"Per ray: ray march %.1fns, LUT %.1fns (%.2fx), LUT with multiple scattering %.1fns (%.2fx)",
+		(F64) marchTime / evaluations,
+		(F64) lutTime / evaluations, (F64) marchTime / lutTime,
+		(F64) multiTime / evaluations, (F64) marchTime / multiTime
+	);
+
+clean:
+	Buffer_freex(&results);
+	AtmosphereLUT_freex(&lut);
+	return s_uccess;
+}
+
+Bool Bench_sky(U64 argc, const C8 *const *argv, Error *e_rr) {
+
+	Bool s_uccess = true;
+	AtmosphereLUT lut = (AtmosphereLUT) { 0 };
+	SkyCache cache = (SkyCache) { 0 };
+
+	const U64 size = U64_min(U64_max(Bench_getArgU64(argc, argv, "size", SkyCache_defaultSize), 1), 4096);
+	const U64 frames = Bench_getArgU64(argc, argv, "frames", 3600);
+	const U64 secondsPerFrame = Bench_getArgU64(argc, argv, "secondsPerFrame", 1);
+	const U64 directions = U64_max(Bench_getArgU64(argc, argv, "directions", 4096), 1);
+	const F32 threshold = Bench_getArgU64(argc, argv, "threshold", (U64)(SkyCache_defaultThresholdDeg * 1000)) / 1000.f;
+
+	const Atmosphere earth = Atmosphere_earth(F32x4_create3(0, -1, 0));
+	gotoIfError3(clean, AtmosphereLUT_loadOrCreatex(&earth, CharString_createRefCStrConst("atmosphere_lut.bin"), &lut, e_rr))
+	gotoIfError3(clean, SkyCache_createx((U32) size, threshold, &cache, e_rr))
+
+	//Simulate the sun over Amsterdam, starting in the afternoon
+
+	const F32x2 amsterdam = F32x2_create2(4.897070f, 52.377956f);
+	F64 JD = AtmosHelper_getJulianDate(0) + 14 / 24.;
+
+	F32x4 sunDir = F32x4_zero();
+	Ns updateTime = 0;
+
+	for(U64 i = 0; i < frames; ++i, JD += secondsPerFrame / 86400.) {
+
+		sunDir = F32x4_negate(AtmosHelper_getSunDir(JD, amsterdam));
+
+		const Ns start = Time_now();
+		gotoIfError3(clean, SkyCache_update(&cache, sunDir, &lut, NULL, e_rr))
+		updateTime += Time_now() - start;
+	}
+
+	Log_debugLnx(
+		"Sky cache %"PRIu64"x%"PRIu64"x6, %.3f deg threshold: %"PRIu64" frames (%"PRIu64"s each), "
+		"%"PRIu64" renders (avg %.3fms), %"PRIu64" skipped, avg update %.3fms",
+		size, size, threshold, frames, secondsPerFrame,
+		cache.renders, cache.renders ? cache.renderTime / 1e6 / cache.renders : 0., cache.skips,
+		frames ? updateTime / 1e6 / frames : 0.
+	);
+
+	if(!cache.isValid)
+		goto clean;
+
+	//Compare the cache against evaluating the LUTs directly, with the sun the cache was last rendered with
+	//(The difference with the current sun is bounded by the threshold)
+
+	const Atmosphere atmos = Atmosphere_earth(cache.sunDir);
+
+	Ns directTime = 0, cacheTime = 0;
+	F64 error = 0, currentError = 0;
+	F32 maxError = 0;
+
+	const Atmosphere current = Atmosphere_earth(sunDir);
+
+	for(U64 i = 0; i < directions; ++i) {
+
+		const RayDesc ray = Bench_atmosphereRay(i, directions);
+
+		Ns start = Time_now();
+		const F32 direct = F32_max(Bench_luminance(Atmosphere_getContributionLUT(&atmos, &lut, ray, true)), 1e-6f);
+		directTime += Time_now() - start;
+
+		start = Time_now();
+		const F32 cached = Bench_luminance(SkyCache_sample(&cache, ray.dir));
+		cacheTime += Time_now() - start;
+
+		const F32 diff = F32_abs(cached - direct) / direct;
+		error += diff;
+		maxError = F32_max(maxError, diff);
+
+		const F32 now = F32_max(Bench_luminance(Atmosphere_getContributionLUT(&current, &lut, ray, true)), 1e-6f);
+		currentError += F32_abs(cached - now) / now;
+	}
+
+	Log_debugLnx(
+		"Sky cache error %.3f%% avg (%.3f%% max), %.3f%% avg vs the current sun; "
+		"per miss: LUT %.1fns, cache %.1fns (%.1fx)",
+		error * 100 / directions, maxError * 100., currentError * 100 / directions,
+		(F64) directTime / directions, (F64) cacheTime / directions, (F64) directTime / F64_max((F64) cacheTime, 1)
+	);
+
+clean:
+	SkyCache_freex(&cache);
+	AtmosphereLUT_freex(&lut);
+	return s_uccess;
+}
+
+Bool Bench_skyBake(U64 argc, const C8 *const *argv, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Buffer reference = Buffer_createNull(), packets = Buffer_createNull();
+
+	const U32 width = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "width", 2048), 1), 16384);
+	const U32 height = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "height", width / 2), 1), 16384);
+	const F32 elevation = (F32) Bench_getArgU64(argc, argv, "elevation", 10) * F32_DEG_TO_RAD;
+
+	const Atmosphere atmos = Atmosphere_earth(F32x4_negate(F32x4_create3(F32_cos(elevation), F32_sin(elevation), 0)));
+	const F64 megapixels = (F64) width * height / 1e6;
+
+	//The single ray bake is the per pixel port of the shader's ray march, so that's the reference
+
+	Ns start = Time_now();
+	gotoIfError3(clean, SkyBake_equirectx(&atmos, width, height, false, &reference, e_rr))
+	const Ns referenceTime = Time_now() - start;
+
+	start = Time_now();
+	gotoIfError3(clean, SkyBake_equirectx(&atmos, width, height, true, &packets, e_rr))
+	const Ns packetTime = Time_now() - start;
+
+	const F32x4 *expected = (const F32x4*) reference.ptr;
+	const F32x4 *result = (const F32x4*) packets.ptr;
+
+	F64 error = 0;
+	F32 maxError = 0;
+
+	for(U64 i = 0; i < (U64) width * height; ++i) {
+
+		const F32 lum = Bench_luminance(expected[i]);
+		const F32 diff = F32_abs(Bench_luminance(result[i]) - lum) / F32_max(lum, 1e-6f);
+
+		error += diff;
+		maxError = F32_max(maxError, diff);
+	}
+
+	Log_debugLnx(
+		"Sky bake %"PRIu32"x%"PRIu32" (sun at %.0f deg) on %"PRIu64" thread(s): "
+		"per ray %.3fms/MP, 4 rays per call %.3fms/MP (%.2fx); error vs per ray %.5f%% avg (%.5f%% max)",
+		width, height, elevation / F32_DEG_TO_RAD, Parallel_getThreadCount(),
+		referenceTime / 1e6 / megapixels, packetTime / 1e6 / megapixels,
+		(F64) referenceTime / F64_max((F64) packetTime, 1),
+		error * 100 / ((F64) width * height), maxError * 100.
+	);
+
+clean:
+	Buffer_freex(&packets);
+	Buffer_freex(&reference);
+	return s_uccess;
+}
+
+//Full resolution (factor 1) vs low res + upsample.
+//Error is the PSNR of the miss pixels, with the brightest channel of the reference's sky as peak
+//(the shader's fixed exposure maps this sky to a small part of the 8-bit range, which would inflate it).
+
+static Bool Bench_skyUpsampleFactor(
+	SkyUpsampleInput input,
+	U64 iterations,
+	Buffer reference,
+	Buffer result,
+	Ns referenceTime,
+	Error *e_rr
+) {
+
+	Bool s_uccess = true;
+	Buffer lowRes = Buffer_createNull();
+
+	Ns renderTime = U64_MAX, compositeTime = U64_MAX;
+	U64 evaluated = 0;
+
+	for(U64 j = 0; j < iterations; ++j) {
+
+		Buffer_freex(&lowRes);
+
+		Ns start = Time_now();
+		gotoIfError3(clean, SkyUpsample_renderx(&input, &lowRes, &evaluated, e_rr))
+		renderTime = U64_min(renderTime, Time_now() - start);
+
+		start = Time_now();
+		gotoIfError3(clean, SkyUpsample_composite(&input, lowRes, result, e_rr))
+		compositeTime = U64_min(compositeTime, Time_now() - start);
+	}
+
+	const F32x4 *expected = (const F32x4*) reference.ptr;
+	const F32x4 *actual = (const F32x4*) result.ptr;
+	const F32 *hitT = (const F32*) input.hitT.ptr;
+
+	F64 squaredError = 0;
+	F32 peak = 0;
+	U64 misses = 0;
+
+	for(U64 i = 0; i < (U64) input.w * input.h; ++i) {
+
+		if(hitT[i] >= 0)
+			continue;
+
+		const F32x4 diff = F32x4_sub(expected[i], actual[i]);
+		squaredError += F32x4_dot3(diff, diff) / 3;
+
+		peak = F32_max(peak, F32_max(F32x4_x(expected[i]), F32_max(F32x4_y(expected[i]), F32x4_z(expected[i]))));
+		++misses;
+	}
+
+	const F64 mse = squaredError / (F64) U64_max(misses, 1);
+	const U64 lowCount = (U64) SkyUpsample_getLowResSize(input.w, input.factor) * SkyUpsample_getLowResSize(input.h, input.factor);
+	const Ns total = renderTime + compositeTime;
+
+	Log_debugLnx(
+		"1/%u: render %.3fms (%"PRIu64" of %"PRIu64" low res pixels evaluated), composite %.3fms, "
+		"total %.3fms (%.2fx), PSNR %.2fdB",
+		input.factor, renderTime / 1e6, evaluated, lowCount, compositeTime / 1e6,
+		total / 1e6, (F64) referenceTime / F64_max((F64) total, 1),
+		mse > 0 ? 10 * F64_log10((F64) peak * peak / mse) : F64_MAX
+	);
+
+clean:
+	Buffer_freex(&lowRes);
+	return s_uccess;
+}
+
+Bool Bench_skyUpsample(U64 argc, const C8 *const *argv, Error *e_rr) {
+
+	Bool s_uccess = true;
+	AtmosphereLUT lut = (AtmosphereLUT) { 0 };
+	Buffer hitT = Buffer_createNull(), images = Buffer_createNull(), lowRes = Buffer_createNull();
+
+	const U32 w = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "width", 1280), 1), 16384);
+	const U32 h = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "height", 720), 1), 16384);
+	const U64 factor = Bench_getArgU64(argc, argv, "factor", U64_MAX);
+	const F32 elevation = (F32) Bench_getArgU64(argc, argv, "elevation", 10) * F32_DEG_TO_RAD;
+	const Bool useLut = !!Bench_getArgU64(argc, argv, "lut", 1);
+	const U64 iterations = U64_max(Bench_getArgU64(argc, argv, "iterations", 2), 1);
+
+	const Atmosphere atmos = Atmosphere_earth(F32x4_negate(F32x4_create3(F32_cos(elevation), F32_sin(elevation), 0)));
+
+	if(useLut)
+		gotoIfError3(clean, AtmosphereLUT_loadOrCreatex(&atmos, CharString_createRefCStrConst("atmosphere_lut.bin"), &lut, e_rr))
+
+	//Looking at the horizon (sideways, so the sun is out of view) over a ground plane 10m below, with spheres in front
+
+	const Camera camera = (Camera) {
+		.pos = F32x4_create3(0, 10, 0),
+		.dir = F32x4_create3(0, 0.1f, 1),
+		.up = F32x4_create3(0, 1, 0),
+		.fovYDeg = 60,
+		.nearPlane = 0.1f,
+		.farPlane = 10000
+	};
+
+	const CameraMatrices matrices = Camera_getMatrices(&camera, (F32) w / h, 0);
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(F32) * w * h, &hitT))
+	gotoIfError2(clean, Buffer_createEmptyBytesx(sizeof(F32x4) * 2 * w * h, &images))
+
+	F32 *hits = (F32*) hitT.ptrNonConst;
+	U64 misses = 0;
+
+	for(U32 y = 0; y < h; ++y)
+		for(U32 x = 0; x < w; ++x) {
+
+			const F32 ndcX = (x + 0.5f) / w * 2 - 1, ndcY = 1 - (y + 0.5f) / h * 2;
+			const RayDesc ray = RayDesc_create(camera.pos, 0, Camera_getDir(&matrices, ndcX, ndcY), 1e38f);
+
+			F32 t = F32x4_y(ray.dir) < 0 ? -F32x4_y(ray.origin) / F32x4_y(ray.dir) : -1;
+
+			for(U32 i = 0; i < 12; ++i) {
+
+				const F32 dist = 60 + 25.f * i;
+				const Sphere sphere = Sphere_create(F32x4_create3(((I32) i - 6) * 9.f, 4 + (i % 3) * 6, dist), 4 + (i % 4) * 3);
+
+				F32x4 sphereT;
+				Bool isBackface;
+
+				if(Sphere_intersects(sphere, ray, &sphereT, &isBackface) && (t < 0 || F32x4_x(sphereT) < t))
+					t = F32x4_x(sphereT);
+			}
+
+			hits[(U64) y * w + x] = t;
+			misses += t < 0;
+		}
+
+	SkyUpsampleInput input = (SkyUpsampleInput) {
+		.atmos = &atmos,
+		.lut = useLut ? &lut : NULL,
+		.camera = &matrices,
+		.hitT = hitT,
+		.w = w,
+		.h = h,
+		.factor = 1
+	};
+
+	const Buffer reference = Buffer_createRef(images.ptrNonConst, sizeof(F32x4) * w * h);
+	const Buffer result = Buffer_createRef((F32x4*) images.ptrNonConst + (U64) w * h, sizeof(F32x4) * w * h);
+
+	Ns referenceTime = U64_MAX;
+
+	for(U64 j = 0; j < iterations; ++j) {
+
+		Buffer_freex(&lowRes);
+
+		const Ns start = Time_now();
+		gotoIfError3(clean, SkyUpsample_renderx(&input, &lowRes, NULL, e_rr))
+		gotoIfError3(clean, SkyUpsample_composite(&input, lowRes, reference, e_rr))
+		referenceTime = U64_min(referenceTime, Time_now() - start);
+	}
+
+	Log_debugLnx(
+		"Sky upsample %"PRIu32"x%"PRIu32" (%.1f%% sky, sun at %.0f deg, %s) on %"PRIu64" thread(s): full resolution %.3fms",
+		w, h, misses * 100. / ((F64) w * h), elevation / F32_DEG_TO_RAD, useLut ? "LUT" : "ray march",
+		Parallel_getThreadCount(), referenceTime / 1e6
+	);
+
+	const U32 factors[] = { 2, 4, 8 };
+
+	for(U8 i = 0; i < sizeof(factors) / sizeof(factors[0]); ++i) {
+
+		if(factor != U64_MAX && i)
+			break;
+
+		input.factor = factor != U64_MAX ? (U32) U64_min(U64_max(factor, 1), SkyUpsample_maxFactor) : factors[i];
+		gotoIfError3(clean, Bench_skyUpsampleFactor(input, iterations, reference, result, referenceTime, e_rr))
+	}
+
+clean:
+	Buffer_freex(&lowRes);
+	Buffer_freex(&images);
+	Buffer_freex(&hitT);
+	AtmosphereLUT_freex(&lut);
+	return s_uccess;
+}
+
+//Error of a sky image against the reference: average relative error of the luminance and the PSNR
+//(with the brightest channel of the reference as peak, like Bench_skyUpsampleFactor)
+
+static void Bench_skyError(const F32x4 *expected, const F32x4 *actual, U64 count, F64 *relError, F64 *psnr) {
+
+	F64 squaredError = 0, error = 0;
+	F32 peak = 0;
+
+	for(U64 i = 0; i < count; ++i) {
+
+		const F32x4 diff = F32x4_sub(expected[i], actual[i]);
+		squaredError += F32x4_dot3(diff, diff) / 3;
+
+		const F32 lum = F32_max(Bench_luminance(expected[i]), 1e-6f);
+		error += F32_abs(Bench_luminance(actual[i]) - lum) / lum;
+
+		peak = F32_max(peak, F32_max(F32x4_x(expected[i]), F32_max(F32x4_y(expected[i]), F32x4_z(expected[i]))));
+	}
+
+	const F64 mse = squaredError / (F64) U64_max(count, 1);
+
+	*relError = error / (F64) U64_max(count, 1);
+	*psnr = mse > 0 ? 10 * F64_log10((F64) peak * peak / mse) : F64_MAX;
+}
+
+//The sky seen by the camera at the last frame, with the yaw offset it had at frame i (ends at 0)
+
+static CameraMatrices Bench_atmosphereTemporalCamera(U64 i, U64 frames, F32 yawPerFrame, F32 aspect) {
+
+	const F32 yaw = (F32)(frames - 1 - i) * yawPerFrame;
+
+	const Camera camera = (Camera) {
+		.dir = F32x4_create3(F32_sin(yaw), 0.2f, F32_cos(yaw)),
+		.up = F32x4_create3(0, 1, 0),
+		.fovYDeg = 60,
+		.nearPlane = 0.1f,
+		.farPlane = 10000
+	};
+
+	return Camera_getMatrices(&camera, aspect, 0);
+}
+
+//One image with midpoint samples (a factor 1 SkyUpsample evaluates every pixel center)
+
+static Bool Bench_atmosphereMidpoint(
+	const Atmosphere *atmos, const CameraMatrices *camera, U32 w, U32 h, Buffer *image, Ns *time, Error *e_rr
+) {
+
+	Bool s_uccess = true;
+
+	const SkyUpsampleInput input = (SkyUpsampleInput) {
+		.atmos = atmos,
+		.camera = camera,
+		.w = w,
+		.h = h,
+		.factor = 1
+	};
+
+	const Ns start = Time_now();
+	gotoIfError3(clean, SkyUpsample_renderx(&input, image, NULL, e_rr))
+	*time = Time_now() - start;
+
+clean:
+	return s_uccess;
+}
+
+//Temporal reuse of a jittered ray march for frames frames, returns the average time per frame
+
+static Bool Bench_atmosphereTemporalRun(
+	const Atmosphere *atmos,
+	U32 w, U32 h,
+	U64 frames,
+	F32 yawPerFrame,
+	SkyTemporal *temporal,
+	Ns *time,
+	Error *e_rr
+) {
+
+	Bool s_uccess = true;
+
+	gotoIfError3(clean, SkyTemporal_createx(w, h, SkyTemporal_defaultMinWeight, SkyTemporal_defaultThresholdDeg, temporal, e_rr))
+
+	const Ns start = Time_now();
+
+	for(U64 i = 0; i < frames; ++i) {
+		const CameraMatrices camera = Bench_atmosphereTemporalCamera(i, frames, yawPerFrame, (F32) w / h);
+		gotoIfError3(clean, SkyTemporal_render(temporal, atmos, NULL, &camera, e_rr))
+	}
+
+	*time = (Time_now() - start) / frames;
+
+clean:
+	return s_uccess;
+}
+
+Bool Bench_skyTemporal(U64 argc, const C8 *const *argv, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Buffer truthImage = Buffer_createNull(), image = Buffer_createNull();
+	SkyTemporal temporal = (SkyTemporal) { 0 };
+
+	const U32 w = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "width", 256), 1), 16384);
+	const U32 h = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "height", 144), 1), 16384);
+	const U32 raySamples = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "raySamples", 4), 1), 1024);
+	const U32 lightSamples = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "lightSamples", 2), 1), 1024);
+	const U64 frames = U64_max(Bench_getArgU64(argc, argv, "frames", 32), 1);
+	const F32 yawPerFrame = Bench_getArgU64(argc, argv, "rotation", 100) / 1000.f * F32_DEG_TO_RAD;
+	const F32 elevation = (F32) Bench_getArgU64(argc, argv, "elevation", 10) * F32_DEG_TO_RAD;
+
+	//Sun to the side of the view, which is half ground and half sky
+
+	const Atmosphere earth = Atmosphere_earth(F32x4_negate(F32x4_create3(F32_cos(elevation), F32_sin(elevation), 0)));
+	const CameraMatrices camera = Bench_atmosphereTemporalCamera(frames - 1, frames, 0, (F32) w / h);
+	const U64 count = (U64) w * h;
+
+	Atmosphere truth = earth;
+	truth.raySamples = Bench_atmosphereTruthRaySamples;
+	truth.lightSamples = Bench_atmosphereTruthLightSamples;
+	truth.quadraticSamples = true;
+
+	Ns truthTime = 0;
+	gotoIfError3(clean, Bench_atmosphereMidpoint(&truth, &camera, w, h, &truthImage, &truthTime, e_rr))
+
+	const F32x4 *expected = (const F32x4*) truthImage.ptr;
+
+	Log_debugLnx(
+		"Sky temporal %"PRIu32"x%"PRIu32" (sun at %.0f deg) on %"PRIu64" thread(s), reference %"PRIu32"x%"PRIu32" "
+		"samples in %.3fms",
+		w, h, elevation / F32_DEG_TO_RAD, Parallel_getThreadCount(),
+		truth.raySamples, truth.lightSamples, truthTime / 1e6
+	);
+
+	Atmosphere low = earth;
+	low.raySamples = raySamples;
+	low.lightSamples = lightSamples;
+
+	Atmosphere earthQuadratic = earth, lowQuadratic = low;
+	earthQuadratic.quadraticSamples = lowQuadratic.quadraticSamples = true;
+
+	F64 relError = 0, psnr = 0;
+	Ns time = 0;
+
+	//Single frames with midpoint samples: the current default and the low sample count, uniform and quadratic
+
+	const Atmosphere *midpoints[] = { &earth, &low, &earthQuadratic, &lowQuadratic };
+
+	for(U8 i = 0; i < 4; ++i) {
+
+		Buffer_freex(&image);
+		gotoIfError3(clean, Bench_atmosphereMidpoint(midpoints[i], &camera, w, h, &image, &time, e_rr))
+		Bench_skyError(expected, (const F32x4*) image.ptr, count, &relError, &psnr);
+
+		Log_debugLnx(
+			"%"PRIu32"x%"PRIu32" midpoint (%s): %.3fms per frame, error %.3f%% avg, PSNR %.2fdB",
+			midpoints[i]->raySamples, midpoints[i]->lightSamples, midpoints[i]->quadraticSamples ? "quadratic" : "uniform",
+			time / 1e6, relError * 100, psnr
+		);
+	}
+
+	//Jittered quadratic samples: one frame (noise instead of bias), then accumulated while still and while turning.
+	//Jittered uniform ones would converge to a biased sky (see Atmosphere_getSampleT).
+
+	const U64 runs[] = { 1, frames, frames };
+	const F32 yaws[] = { 0, 0, yawPerFrame };
+	const C8 *names[] = { "jittered, 1 frame", "jittered + temporal, still", "jittered + temporal, turning" };
+
+	for(U8 i = 0; i < 3; ++i) {
+
+		SkyTemporal_freex(&temporal);
+		gotoIfError3(clean, Bench_atmosphereTemporalRun(&lowQuadratic, w, h, runs[i], yaws[i], &temporal, &time, e_rr))
+		Bench_skyError(expected, (const F32x4*) SkyTemporal_getResult(&temporal).ptr, count, &relError, &psnr);
+
+		Log_debugLnx(
+			"%"PRIu32"x%"PRIu32" %s (%"PRIu64" frames, %.2f deg per frame): %.3fms per frame, "
+			"error %.3f%% avg, PSNR %.2fdB",
+			raySamples, lightSamples, names[i], runs[i], yaws[i] / F32_DEG_TO_RAD, time / 1e6, relError * 100, psnr
+		);
+	}
+
+clean:
+	SkyTemporal_freex(&temporal);
+	Buffer_freex(&image);
+	Buffer_freex(&truthImage);
+	return s_uccess;
+}
+
+Bool Bench_sun(U64 argc, const C8 *const *argv, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Buffer data = Buffer_createNull();
+
+	const U64 locations = U64_max(Bench_getArgU64(argc, argv, "locations", 64), 1);
+	const U64 steps = U64_max(Bench_getArgU64(argc, argv, "steps", 16384), 1);
+	const U64 secondsPerStep = Bench_getArgU64(argc, argv, "secondsPerStep", 600);
+	const U64 count = locations * steps;
+
+	const U64 perElement = sizeof(Ns) + sizeof(F64) + sizeof(F32) * 5;
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(perElement * count, &data))
+
+	Ns *time = (Ns*) data.ptrNonConst;
+	F64 *JD = (F64*)(time + count);
+	F32 *longitude = (F32*)(JD + count);
+	F32 *latitude = longitude + count;
+	F32 *dirX = latitude + count, *dirY = dirX + count, *dirZ = dirY + count;
+
+	//A time-lapse for every location, spread over the globe
+
+	for(U64 i = 0; i < count; ++i) {
+
+		const U64 location = i / steps, step = i % steps;
+
+		time[i] = (Ns)(step * secondsPerStep) * SECOND + (Ns)(location * 7919) * SECOND;
+		longitude[i] = -180 + 360.f * (location + 0.5f) / locations;
+		latitude[i] = -80 + 160.f * (F32) F64_fract(location * 0.618034);
+	}
+
+	//Julian dates
+
+	Ns start = Time_now();
+
+	for(U64 i = 0; i < count; ++i)
+		JD[i] = AtmosHelper_getJulianDate(time[i]);
+
+	const Ns scalarJDTime = Time_now() - start;
+
+	F64 maxJDError = 0;
+
+	for(U64 i = 0; i < count; ++i) {
+		const F64 expected = JD[i];
+		JD[i] = 0;
+		AtmosHelper_getJulianDateBatch(time + i, JD + i, 1);
+		maxJDError = F64_max(maxJDError, F64_abs(JD[i] - expected));
+	}
+
+	start = Time_now();
+	AtmosHelper_getJulianDateBatch(time, JD, count);
+	const Ns batchJDTime = Time_now() - start;
+
+	//Sun directions
+
+	const AtmosHelperSunBatch batch = (AtmosHelperSunBatch) {
+		.JD = JD, .longitudeDeg = longitude, .latitudeDeg = latitude,
+		.dirX = dirX, .dirY = dirY, .dirZ = dirZ,
+		.count = count
+	};
+
+	start = Time_now();
+	gotoIfError3(clean, AtmosHelper_getSunDirBatch(batch, e_rr))
+	const Ns batchTime = Time_now() - start;
+
+	F64 error = 0;
+	F32 maxError = 0;
+	F32 checksum = 0;
+
+	start = Time_now();
+
+	for(U64 i = 0; i < count; ++i)
+		checksum += F32x4_x(AtmosHelper_getSunDir(JD[i], F32x2_create2(longitude[i], latitude[i])));
+
+	const Ns scalarTime = Time_now() - start;
+
+	for(U64 i = 0; i < count; ++i) {
+
+		const F32x4 expected = AtmosHelper_getSunDir(JD[i], F32x2_create2(longitude[i], latitude[i]));
+		const F32x4 dir = F32x4_create3(dirX[i], dirY[i], dirZ[i]);
+
+		const F32 cosAngle = F32_clamp(F32x4_dot3(expected, dir) / F32x4_len3(dir), -1, 1);
+		const F32 angle = F32_acos(cosAngle) * F32_RAD_TO_DEG;
+
+		error += angle;
+		maxError = F32_max(maxError, angle);
+	}
+
+	Log_debugLnx(
+		"Sun: %"PRIu64" locations x %"PRIu64" steps (%"PRIu64"s each), %"PRIu64" threads (checksum %f)",
+		locations, steps, secondsPerStep, Parallel_getThreadCount(), checksum
+	);
+
+	Log_debugLnx(
+		"Julian date: scalar %.1fns, batch %.1fns (%.1fx), max error %.3es",
+		(F64) scalarJDTime / count, (F64) batchJDTime / count,
+		(F64) scalarJDTime / F64_max((F64) batchJDTime, 1), maxJDError * 86400
+	);
+
+	Log_debugLnx(
+		"Sun direction: scalar %.1fns, batch %.1fns (%.1fx), error %.2e deg avg (%.2e max)",
+		(F64) scalarTime / count, (F64) batchTime / count,
+		(F64) scalarTime / F64_max((F64) batchTime, 1), error / count, maxError
+	);
+
+clean:
+	Buffer_freex(&data);
+	return s_uccess;
+}
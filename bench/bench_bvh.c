@@ -0,0 +1,428 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "bench.h"
+#include "bench_mesh.h"
+#include "cpu_as.h"
+#include "parallel.h"
+#include "platforms/log.h"
+#include "platforms/ext/bufferx.h"
+#include "types/base/time.h"
+#include "types/math/math.h"
+
+#define Bench_rayChunk 4096
+
+typedef struct BenchRays {
+	const CpuBLAS *blas;
+	F32x4 center;
+	F32 radius;
+	U64 rayCount;
+	U64 hits[Parallel_maxThreads];
+} BenchRays;
+
+//Rays start on the bounding sphere and go through a random point inside the bounds
+
+static void Bench_traceRays(void *userData, U64 jobId, U64 threadId) {
+
+	BenchRays *rays = (BenchRays*) userData;
+
+	const U64 first = jobId * Bench_rayChunk;
+	const U64 last = U64_min(first + Bench_rayChunk, rays->rayCount);
+
+	for(U64 i = first; i < last; ++i) {
+
+		const F32 u = (F32)((i * 0x9E3779B9u) & 0xFFFF) / 0xFFFF;
+		const F32 v = (F32)((i * 0x85EBCA6Bu) & 0xFFFF) / 0xFFFF;
+		const F32 w = (F32)((i * 0xC2B2AE35u) & 0xFFFF) / 0xFFFF;
+
+		const F32 theta = F32_acos(1 - 2 * u), phi = 2 * F32_PI * v;
+		const F32x4 dir = F32x4_create3(F32_sin(theta) * F32_cos(phi), F32_cos(theta), F32_sin(theta) * F32_sin(phi));
+
+		const F32x4 origin = F32x4_add(rays->center, F32x4_mul(dir, F32x4_xxxx4(rays->radius)));
+		const F32x4 target = F32x4_add(rays->center, F32x4_mul(F32x4_create3(u - 0.5f, v - 0.5f, w - 0.5f), F32x4_xxxx4(rays->radius)));
+
+		CpuHit hit;
+		const RayDesc ray = RayDesc_create(origin, 0, F32x4_normalize3(F32x4_sub(target, origin)), rays->radius * 2);
+
+		if(CpuBLAS_traceRay(rays->blas, ray, ECpuRayFlags_None, &hit))
+			++rays->hits[threadId];
+	}
+}
+
+static Bool Bench_bvhPolicy(
+	ECpuBVHPolicy policy,
+	ETextureFormatId positionFormat,
+	U16 positionStride,
+	Buffer positions,
+	Buffer indices,
+	U64 rayCount,
+	U64 rebuilds,
+	Error *e_rr
+) {
+
+	Bool s_uccess = true;
+	CpuBLAS blas = (CpuBLAS) { 0 };
+
+	const C8 *policyName = policy == ECpuBVHPolicy_LBVH ? "LBVH" : "SAH";
+
+	Ns start = Time_now();
+
+	gotoIfError3(clean, CpuBLAS_createx(
+		policy, positionFormat, 0, positionStride, ETextureFormatId_R32u, positions, indices, &blas, e_rr
+	))
+
+	const Ns totalTime = Time_now() - start;
+	const CpuBVHStats stats = blas.bvh.stats;
+
+	Log_debugLnx(
+		"%s BLAS: %"PRIu64" triangles (%s), total %.3fms (BVH build %.3fms, %.2f Mtris/s)",
+		policyName, blas.triangleCount, positionFormat == ETextureFormatId_RGBA16f ? "RGBA16f" : "RGB32f",
+		totalTime / 1e6, stats.buildTime / 1e6, blas.triangleCount / (stats.buildTime / 1e3)
+	);
+
+	Log_debugLnx(
+		"%s BVH: SAH cost %.3f, %"PRIu64" inner, %"PRIu64" leaves, max depth %"PRIu64", max leaf size %"PRIu64", %.3f MiB",
+		policyName, stats.sahCost, stats.innerCount, stats.leafCount, stats.maxDepth, stats.maxLeafSize,
+		stats.memory / (F64)(KIBI * KIBI)
+	);
+
+	//Rebuilds are what animated geometry would pay every frame (LBVH doesn't allocate here)
+
+	if(rebuilds) {
+
+		Ns minTime = U64_MAX, maxTime = 0, sumTime = 0;
+
+		for(U64 i = 0; i < rebuilds; ++i) {
+
+			start = Time_now();
+			gotoIfError3(clean, CpuBLAS_rebuildx(&blas, positions, indices, e_rr))
+
+			const Ns rebuildTime = Time_now() - start;
+			minTime = U64_min(minTime, rebuildTime);
+			maxTime = U64_max(maxTime, rebuildTime);
+			sumTime += rebuildTime;
+		}
+
+		Log_debugLnx(
+			"%s rebuild: %"PRIu64"x, min %.3fms, avg %.3fms, max %.3fms (BVH build %.3fms)",
+			policyName, rebuilds, minTime / 1e6, sumTime / 1e6 / rebuilds, maxTime / 1e6,
+			blas.bvh.stats.buildTime / 1e6
+		);
+	}
+
+	if(!rayCount)
+		goto clean;
+
+	F32x4 aabbMin, aabbMax;
+	CpuBVH_getBounds(&blas.bvh, &aabbMin, &aabbMax);
+
+	BenchRays rays = (BenchRays) {
+		.blas = &blas,
+		.center = F32x4_mul(F32x4_add(aabbMin, aabbMax), F32x4_xxxx4(0.5f)),
+		.radius = F32_sqrt(F32x4_dot3(F32x4_sub(aabbMax, aabbMin), F32x4_sub(aabbMax, aabbMin))) * 0.5f,
+		.rayCount = rayCount
+	};
+
+	start = Time_now();
+	gotoIfError3(clean, Parallel_for((rayCount + Bench_rayChunk - 1) / Bench_rayChunk, Bench_traceRays, &rays, e_rr))
+	const Ns traceTime = Time_now() - start;
+
+	U64 hits = 0;
+
+	for(U64 i = 0; i < Parallel_maxThreads; ++i)
+		hits += rays.hits[i];
+
+	Log_debugLnx(
+		"%s trace: %"PRIu64" rays in %.3fms (%.3f Mrays/s), %.2f%% hit",
+		policyName, rayCount, traceTime / 1e6, rayCount / (traceTime / 1e3), hits * 100. / rayCount
+	);
+
+clean:
+	CpuBLAS_freex(&blas);
+	return s_uccess;
+}
+
+Bool Bench_bvh(U64 argc, const C8 *const *argv, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	Buffer positions = Buffer_createNull();
+	Buffer indices = Buffer_createNull();
+
+	const U64 triangleCount = U64_max(Bench_getArgU64(argc, argv, "triangles", 4 * 1000 * 1000), 1);
+	const U64 rayCount = Bench_getArgU64(argc, argv, "rays", 1000 * 1000);
+	const U64 rebuilds = Bench_getArgU64(argc, argv, "rebuilds", 8);
+	const C8 *policy = Bench_getArg(argc, argv, "policy", "both");
+
+	const ETextureFormatId positionFormat =
+		Bench_equals(Bench_getArg(argc, argv, "format", "f32"), "f16") ? ETextureFormatId_RGBA16f :
+		ETextureFormatId_RGB32f;
+
+	U16 positionStride = 0;
+
+	gotoIfError3(clean, BenchMesh_createSpheresx(
+		triangleCount, 64, positionFormat, &positions, &indices, &positionStride, e_rr
+	))
+
+	if(!Bench_equals(policy, "lbvh"))
+		gotoIfError3(clean, Bench_bvhPolicy(
+			ECpuBVHPolicy_SAH, positionFormat, positionStride, positions, indices, rayCount, rebuilds, e_rr
+		))
+
+	if(!Bench_equals(policy, "sah"))
+		gotoIfError3(clean, Bench_bvhPolicy(
+			ECpuBVHPolicy_LBVH, positionFormat, positionStride, positions, indices, rayCount, rebuilds, e_rr
+		))
+
+clean:
+	Buffer_freex(&indices);
+	Buffer_freex(&positions);
+	return s_uccess;
+}
+
+//Ray packets vs single rays, on primary rays of an image split into size x size tiles (one packet per tile)
+
+typedef struct BenchPackets {
+
+	const CpuBLAS *blas;			//Either blas or tlas is traced
+	const CpuTLAS *tlas;
+
+	Bool isOrthographic;			//Rays of the CPU raytracer (see CpuRaytracer_getPrimaryRay), else a pinhole camera
+	Bool usePackets;
+	U16 size;
+
+	U32 w, h, tilesX;
+	F32 *hitT;						//[w * h], -1 for misses
+
+	U64 hits[Parallel_maxThreads];
+	U64 fallbacks[Parallel_maxThreads];
+
+} BenchPackets;
+
+static RayDesc Bench_getPrimaryRay(const BenchPackets *bench, U32 x, U32 y) {
+
+	const F32 u = (x + 0.5f) / bench->w;
+	const F32 v = 1 - (y + 0.5f) / bench->h;
+
+	if(bench->isOrthographic)
+		return RayDesc_create(F32x4_create3(u * 10 - 5, v * 10 - 5, 5), 0, F32x4_create3(0, 0, -1), 1e6f);
+
+	//60 degree fov looking at the spheres in [-8, 8] from +z
+
+	const F32 aspect = (F32) bench->w / bench->h, tanFov = 0.57735f;
+	const F32x4 dir = F32x4_create3((u * 2 - 1) * tanFov * aspect, (v * 2 - 1) * tanFov, -1);
+
+	return RayDesc_create(F32x4_create3(0, 0, 20), 0, F32x4_normalize3(dir), 1e6f);
+}
+
+static void Bench_tracePackets(void *userData, U64 tileId, U64 threadId) {
+
+	BenchPackets *bench = (BenchPackets*) userData;
+
+	const U32 x0 = (U32)(tileId % bench->tilesX) * bench->size;
+	const U32 y0 = (U32)(tileId / bench->tilesX) * bench->size;
+	const U32 x1 = U32_min(x0 + bench->size, bench->w);
+	const U32 y1 = U32_min(y0 + bench->size, bench->h);
+	const U32 tileW = x1 - x0;
+
+	CpuRayPacket packet;
+	packet.rayCount = tileW * (y1 - y0);
+
+	for(U32 y = y0; y < y1; ++y)
+		for(U32 x = x0; x < x1; ++x)
+			CpuRayPacket_set(&packet, (y - y0) * tileW + (x - x0), Bench_getPrimaryRay(bench, x, y));
+
+	CpuHit hits[CpuRayPacket_maxRays];
+	U64 hitMask[CpuRayPacket_maxRays / 64] = { 0 };
+
+	if(bench->usePackets) {
+
+		const Bool isCoherent = bench->tlas ?
+			CpuTLAS_tracePacket(bench->tlas, &packet, ECpuRayFlags_None, 0xFF, hits, hitMask) :
+			CpuBLAS_tracePacket(bench->blas, &packet, ECpuRayFlags_None, hits, hitMask);
+
+		bench->fallbacks[threadId] += !isCoherent;
+	}
+
+	else for(U32 i = 0; i < packet.rayCount; ++i) {
+
+		const RayDesc ray = CpuRayPacket_get(&packet, i);
+
+		const Bool hit = bench->tlas ?
+			CpuTLAS_traceRay(bench->tlas, ray, ECpuRayFlags_None, 0xFF, &hits[i]) :
+			CpuBLAS_traceRay(bench->blas, ray, ECpuRayFlags_None, &hits[i]);
+
+		hitMask[i >> 6] |= (U64) hit << (i & 63);
+	}
+
+	for(U32 i = 0; i < packet.rayCount; ++i) {
+
+		const Bool hit = (hitMask[i >> 6] >> (i & 63)) & 1;
+		bench->hits[threadId] += hit;
+		bench->hitT[(U64)(y0 + i / tileW) * bench->w + x0 + i % tileW] = hit ? hits[i].t : -1;
+	}
+}
+
+static Bool Bench_packetScene(const C8 *name, BenchPackets *bench, U64 iterations, Buffer hitT, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	F32 *singleT = (F32*) hitT.ptrNonConst;
+	F32 *packetT = singleT + (U64) bench->w * bench->h;
+
+	const U64 rays = (U64) bench->w * bench->h;
+	const U64 tiles = (U64) bench->tilesX * ((bench->h + bench->size - 1) / bench->size);
+
+	Ns bestTime[2] = { U64_MAX, U64_MAX };
+
+	for(U8 usePackets = 0; usePackets < 2; ++usePackets)
+		for(U64 i = 0; i < iterations; ++i) {
+
+			bench->usePackets = usePackets;
+			bench->hitT = usePackets ? packetT : singleT;
+
+			for(U64 j = 0; j < Parallel_maxThreads; ++j)
+				bench->hits[j] = bench->fallbacks[j] = 0;
+
+			const Ns start = Time_now();
+			gotoIfError3(clean, Parallel_for(tiles, Bench_tracePackets, bench, e_rr))
+			bestTime[usePackets] = U64_min(bestTime[usePackets], Time_now() - start);
+		}
+
+	U64 hits = 0, fallbacks = 0, mismatches = 0;
+	F32 maxError = 0;
+
+	for(U64 j = 0; j < Parallel_maxThreads; ++j) {
+		hits += bench->hits[j];
+		fallbacks += bench->fallbacks[j];
+	}
+
+	//Packets test the same triangles in a different order (and SIMD rounds a bit differently), so t can differ slightly
+
+	for(U64 i = 0; i < rays; ++i) {
+
+		if((singleT[i] < 0) != (packetT[i] < 0))
+			++mismatches;
+
+		else if(singleT[i] >= 0)
+			maxError = F32_max(maxError, F32_abs(singleT[i] - packetT[i]) / F32_max(singleT[i], 1e-6f));
+	}
+
+	Log_debugLnx(
+		"%s: %ux%u rays, %.2f%% hit, %ux%u packets (%"PRIu64" of %"PRIu64" traced per ray)",
+		name, bench->w, bench->h, hits * 100. / rays, bench->size, bench->size, fallbacks, tiles
+	);
+
+	Log_debugLnx(
+		"%s: single %.3f Mrays/s, packets %.3f Mrays/s (%.2fx), %"PRIu64" hit/miss mismatches, max t error %.5f%%",
+		name, rays / (bestTime[0] / 1e3), rays / (bestTime[1] / 1e3), (F64) bestTime[0] / bestTime[1],
+		mismatches, maxError * 100
+	);
+
+clean:
+	return s_uccess;
+}
+
+Bool Bench_packets(U64 argc, const C8 *const *argv, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	Buffer positions = Buffer_createNull();
+	Buffer indices = Buffer_createNull();
+	Buffer hitT = Buffer_createNull();
+	CpuBLAS quadBlas = (CpuBLAS) { 0 };
+	CpuTLAS quadTlas = (CpuTLAS) { 0 };
+	CpuBLAS meshBlas = (CpuBLAS) { 0 };
+
+	const U64 triangleCount = U64_max(Bench_getArgU64(argc, argv, "triangles", 1000 * 1000), 1);
+	const U32 w = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "width", 1024), 1), 16384);
+	const U32 h = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "height", w), 1), 16384);
+	const U16 size = (U16) U64_min(U64_max(Bench_getArgU64(argc, argv, "size", 16), 1), CpuRayPacket_maxWidth);
+	const U64 iterations = U64_max(Bench_getArgU64(argc, argv, "iterations", 4), 1);
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(F32) * 2 * w * h, &hitT))
+
+	//Same quad and instance as the CPU raytracer's scene in test.c
+
+	const F32 quadPos[] = { -0.5f, -0.5f,	-0.25f, -0.5f,	-0.25f, -0.25f,		-0.5f, -0.25f };
+	const U16 quadIndices[] = { 0, 1, 2, 2, 3, 0 };
+
+	gotoIfError3(clean, CpuBLAS_createx(
+		ECpuBVHPolicy_SAH, ETextureFormatId_RG32f, 0, sizeof(F32) * 2, ETextureFormatId_R16u,
+		Buffer_createRefConst(quadPos, sizeof(quadPos)), Buffer_createRefConst(quadIndices, sizeof(quadIndices)),
+		&quadBlas, e_rr
+	))
+
+	const TLASInstanceStatic quadInstance = (TLASInstanceStatic) {
+		.transform = {
+			{ 10, 0, 0, 0 },
+			{ 0, 10, 0, 0 },
+			{ 0, 0, 10, 0 }
+		},
+		.data = (TLASInstanceData) { .instanceId24_mask8 = (U32)0xFF << 24 }
+	};
+
+	ListTLASInstanceStatic instanceList = (ListTLASInstanceStatic) { 0 };
+	gotoIfError2(clean, ListTLASInstanceStatic_createRefConst(&quadInstance, 1, &instanceList))
+
+	const CpuBLAS *quadBlases[] = { &quadBlas };
+	gotoIfError3(clean, CpuTLAS_createx(instanceList, quadBlases, &quadTlas, e_rr))
+
+	BenchPackets bench = (BenchPackets) {
+		.tlas = &quadTlas,
+		.isOrthographic = true,
+		.size = size,
+		.w = w,
+		.h = h,
+		.tilesX = (w + size - 1) / size
+	};
+
+	gotoIfError3(clean, Bench_packetScene("Test TLAS", &bench, iterations, hitT, e_rr))
+
+	U16 positionStride = 0;
+
+	gotoIfError3(clean, BenchMesh_createSpheresx(
+		triangleCount, 64, ETextureFormatId_RGB32f, &positions, &indices, &positionStride, e_rr
+	))
+
+	gotoIfError3(clean, CpuBLAS_createx(
+		ECpuBVHPolicy_SAH, ETextureFormatId_RGB32f, 0, positionStride, ETextureFormatId_R32u, positions, indices,
+		&meshBlas, e_rr
+	))
+
+	bench = (BenchPackets) {
+		.blas = &meshBlas,
+		.size = size,
+		.w = w,
+		.h = h,
+		.tilesX = (w + size - 1) / size
+	};
+
+	gotoIfError3(clean, Bench_packetScene("Spheres BLAS", &bench, iterations, hitT, e_rr))
+
+clean:
+	CpuBLAS_freex(&meshBlas);
+	CpuTLAS_freex(&quadTlas);
+	CpuBLAS_freex(&quadBlas);
+	Buffer_freex(&hitT);
+	Buffer_freex(&indices);
+	Buffer_freex(&positions);
+	return s_uccess;
+}
@@ -0,0 +1,152 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "bench_mesh.h"
+#include "platforms/ext/bufferx.h"
+#include "types/math/flp.h"
+#include "types/math/math.h"
+#include "types/math/vec.h"
+
+//Deterministic so results can be compared between runs
+
+static U32 BenchMesh_hash(U32 x) {
+	x ^= x >> 16;
+	x *= 0x7FEB352D;
+	x ^= x >> 15;
+	x *= 0x846CA68B;
+	x ^= x >> 16;
+	return x;
+}
+
+static F32 BenchMesh_random(U32 *seed) {
+	*seed = BenchMesh_hash(*seed + 0x9E3779B9);
+	return (F32)(*seed >> 8) / (1 << 24);
+}
+
+static void BenchMesh_storePosition(ETextureFormatId format, U8 *ptr, F32x4 pos) {
+
+	if(format == ETextureFormatId_RGBA16f) {
+
+		F16 *f16 = (F16*) ptr;
+
+		for(U8 i = 0; i < 3; ++i)
+			f16[i] = F32_castF16(F32x4_get(pos, i));
+
+		f16[3] = 0;
+		return;
+	}
+
+	F32 *f32 = (F32*) ptr;
+
+	for(U8 i = 0; i < 3; ++i)
+		f32[i] = F32x4_get(pos, i);
+}
+
+Bool BenchMesh_createSpheresx(
+	U64 triangleCount,
+	U32 sphereCount,
+	ETextureFormatId positionFormat,
+	Buffer *positions,
+	Buffer *indices,
+	U16 *positionStride,
+	Error *e_rr
+) {
+
+	Bool s_uccess = true;
+	Bool ownsBuffers = false;
+
+	if(!positions || !indices || !positionStride)
+		retError(clean, Error_nullPointer(!positions ? 3 : (!indices ? 4 : 5), "BenchMesh_createSpheresx()::positions, indices and positionStride are required"))
+
+	if(positions->ptr || indices->ptr)
+		retError(clean, Error_invalidParameter(positions->ptr ? 3 : 4, 0, "BenchMesh_createSpheresx()::positions and indices should be empty"))
+
+	if(positionFormat != ETextureFormatId_RGB32f && positionFormat != ETextureFormatId_RGBA16f)
+		retError(clean, Error_invalidParameter(2, 0, "BenchMesh_createSpheresx()::positionFormat should be RGB32f or RGBA16f"))
+
+	if(!sphereCount || !triangleCount || triangleCount >> 31)
+		retError(clean, Error_invalidParameter(!sphereCount ? 1 : 0, 0, "BenchMesh_createSpheresx()::triangleCount and sphereCount are out of bounds"))
+
+	ownsBuffers = true;
+
+	//Every sphere has rings x (rings * 2) quads, where the two poles are also kept as quads (with a degenerate edge)
+
+	const U32 rings = (U32) U64_max(F32_sqrt((F32)(triangleCount / sphereCount) / 4), 2);
+	const U32 sectors = rings * 2;
+
+	const U64 verticesPerSphere = (U64)(rings + 1) * (sectors + 1);
+	const U64 indicesPerSphere = (U64) rings * sectors * 6;
+
+	*positionStride = positionFormat == ETextureFormatId_RGBA16f ? sizeof(F16) * 4 : sizeof(F32) * 3;
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(verticesPerSphere * sphereCount * *positionStride, positions))
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(indicesPerSphere * sphereCount * sizeof(U32), indices))
+
+	U8 *vertexPtr = positions->ptrNonConst;
+	U32 *indexPtr = (U32*) indices->ptrNonConst;
+	U32 seed = 0;
+
+	for(U32 i = 0; i < sphereCount; ++i) {
+
+		const F32x4 center = F32x4_create3(
+			BenchMesh_random(&seed) * 16 - 8, BenchMesh_random(&seed) * 16 - 8, BenchMesh_random(&seed) * 16 - 8
+		);
+
+		const F32 radius = 0.25f + BenchMesh_random(&seed) * BenchMesh_random(&seed) * 1.75f;
+		const U32 vertexStart = (U32)(verticesPerSphere * i);
+
+		for(U32 y = 0; y <= rings; ++y)
+			for(U32 x = 0; x <= sectors; ++x) {
+
+				const F32 theta = (F32) y / rings * F32_PI;
+				const F32 phi = (F32) x / sectors * 2 * F32_PI;
+
+				const F32x4 dir = F32x4_create3(F32_sin(theta) * F32_cos(phi), F32_cos(theta), F32_sin(theta) * F32_sin(phi));
+				const F32 bumps = 1 + 0.1f * F32_sin(theta * 8) * F32_sin(phi * 8);
+
+				BenchMesh_storePosition(
+					positionFormat, vertexPtr, F32x4_add(center, F32x4_mul(dir, F32x4_xxxx4(radius * bumps)))
+				);
+
+				vertexPtr += *positionStride;
+			}
+
+		for(U32 y = 0; y < rings; ++y)
+			for(U32 x = 0; x < sectors; ++x) {
+
+				const U32 i00 = vertexStart + y * (sectors + 1) + x;
+				const U32 i10 = i00 + 1;
+				const U32 i01 = i00 + sectors + 1;
+				const U32 i11 = i01 + 1;
+
+				*(indexPtr++) = i00;	*(indexPtr++) = i01;	*(indexPtr++) = i10;
+				*(indexPtr++) = i10;	*(indexPtr++) = i01;	*(indexPtr++) = i11;
+			}
+	}
+
+clean:
+
+	if(!s_uccess && ownsBuffers) {
+		Buffer_freex(positions);
+		Buffer_freex(indices);
+	}
+
+	return s_uccess;
+}
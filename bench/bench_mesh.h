@@ -0,0 +1,46 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "types/container/buffer.h"
+#include "types/container/texture_format.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Procedural meshes to benchmark with, since the test scene is far too small.
+//Spheres of varying size are scattered in [-8, 8], so triangle density isn't uniform (which a SAH build should exploit).
+//Positions are tightly packed RGB32f or RGBA16f (16-bit floats don't have enough precision for big meshes,
+//so small triangles may become degenerate), indices are R32u.
+
+Bool BenchMesh_createSpheresx(
+	U64 triangleCount,
+	U32 sphereCount,
+	ETextureFormatId positionFormat,
+	Buffer *positions,
+	Buffer *indices,
+	U16 *positionStride,
+	Error *e_rr
+);
+
+#ifdef __cplusplus
+	}
+#endif
@@ -0,0 +1,205 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "bench.h"
+#include "bench_mesh.h"
+#include "cpu_path_tracer.h"
+#include "platforms/log.h"
+#include "platforms/ext/bufferx.h"
+#include "types/math/math.h"
+
+//Megakernel vs wavefront path tracing of the sphere mesh in an open room, per bounce count
+
+static Bool Bench_pathTracerBounces(
+	const CpuPathTracer *tracer, CpuPathTracerInput *input, U32 w, U32 h, U64 iterations, Buffer radiance, Error *e_rr
+) {
+
+	Bool s_uccess = true;
+
+	const F32x4 *megakernel = (const F32x4*) radiance.ptr;
+	const F32x4 *wavefront = megakernel + (U64) w * h;
+
+	Ns bestTime[2] = { U64_MAX, U64_MAX };
+	U64 rays[2] = { 0 };
+
+	for(U8 mode = 0; mode < 2; ++mode)
+		for(U64 i = 0; i < iterations; ++i) {
+
+			CpuPathTracerStats stats = (CpuPathTracerStats) { 0 };
+			input->mode = (ECpuPathTracerMode) mode;
+
+			gotoIfError3(clean, CpuPathTracer_render(
+				tracer, input, w, h,
+				Buffer_createRef((U8*) radiance.ptrNonConst + sizeof(F32x4) * w * h * mode, sizeof(F32x4) * w * h),
+				&stats, e_rr
+			))
+
+			bestTime[mode] = U64_min(bestTime[mode], stats.time);
+			rays[mode] = stats.rays + stats.shadowRays;
+		}
+
+	//The same random numbers are used for every path, so only the order of the work is different
+
+	F64 maxError = 0;
+
+	for(U64 i = 0; i < (U64) w * h; ++i) {
+
+		const F32x4 diff = F32x4_abs(F32x4_sub(megakernel[i], wavefront[i]));
+		const F32 ref = F32_max(F32x4_x(megakernel[i]) + F32x4_y(megakernel[i]) + F32x4_z(megakernel[i]), 1e-6f);
+
+		maxError = F64_max(maxError, (F32x4_x(diff) + F32x4_y(diff) + F32x4_z(diff)) / ref);
+	}
+
+	Log_debugLnx(
+		"%u bounces: megakernel %.3fms (%.3f Mrays/s), wavefront %.3fms (%.3f Mrays/s), %.2fx, %.1f rays/path, "
+		"max error %.5f%%",
+		input->maxBounces,
+		bestTime[0] / 1e6, rays[0] / (bestTime[0] / 1e3),
+		bestTime[1] / 1e6, rays[1] / (bestTime[1] / 1e3),
+		(F64) bestTime[0] / bestTime[1], rays[1] / ((F64) w * h), maxError * 100
+	);
+
+clean:
+	return s_uccess;
+}
+
+Bool Bench_pathTracer(U64 argc, const C8 *const *argv, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	Buffer positions = Buffer_createNull();
+	Buffer indices = Buffer_createNull();
+	Buffer radiance = Buffer_createNull();
+	CpuBLAS spheres = (CpuBLAS) { 0 };
+	CpuBLAS room = (CpuBLAS) { 0 };
+	CpuTLAS tlas = (CpuTLAS) { 0 };
+	CpuPathTracer tracer = (CpuPathTracer) { 0 };
+
+	const U64 triangleCount = U64_max(Bench_getArgU64(argc, argv, "triangles", 250 * 1000), 1);
+	const U32 w = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "width", 512), 1), 8192);
+	const U32 h = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "height", w), 1), 8192);
+	const U64 bounces = Bench_getArgU64(argc, argv, "bounces", U64_MAX);
+	const U64 waveSize = Bench_getArgU64(argc, argv, "wave", CpuPathTracer_defaultWaveSize);
+	const U64 iterations = U64_max(Bench_getArgU64(argc, argv, "iterations", 2), 1);
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(F32x4) * 2 * w * h, &radiance))
+	gotoIfError3(clean, CpuPathTracer_createx((U32) U64_min(waveSize, U32_MAX), &tracer, e_rr))
+
+	U16 positionStride = 0;
+
+	gotoIfError3(clean, BenchMesh_createSpheresx(
+		triangleCount, 64, ETextureFormatId_RGB32f, &positions, &indices, &positionStride, e_rr
+	))
+
+	gotoIfError3(clean, CpuBLAS_createx(
+		ECpuBVHPolicy_SAH, ETextureFormatId_RGB32f, 0, positionStride, ETextureFormatId_R32u, positions, indices,
+		&spheres, e_rr
+	))
+
+	//Open room around the spheres (which are in [-8, 8]): floor, back and side walls
+
+	const F32 roomPos[] = {
+		-12, -8.5f, -12,	12, -8.5f, -12,		12, -8.5f, 40,		-12, -8.5f, 40,
+		-12, -8.5f, -12,	-12, 16, -12,		12, 16, -12,		12, -8.5f, -12,
+		-12, -8.5f, -12,	-12, -8.5f, 40,		-12, 16, 40,		-12, 16, -12,
+		12, -8.5f, -12,		12, 16, -12,		12, 16, 40,			12, -8.5f, 40
+	};
+
+	U16 roomIndices[4 * 6];
+
+	for(U16 i = 0; i < 4; ++i) {
+		const U16 quad[] = { 0, 1, 2, 2, 3, 0 };
+		for(U16 j = 0; j < 6; ++j)
+			roomIndices[i * 6 + j] = i * 4 + quad[j];
+	}
+
+	gotoIfError3(clean, CpuBLAS_createx(
+		ECpuBVHPolicy_SAH, ETextureFormatId_RGB32f, 0, sizeof(F32) * 3, ETextureFormatId_R16u,
+		Buffer_createRefConst(roomPos, sizeof(roomPos)), Buffer_createRefConst(roomIndices, sizeof(roomIndices)),
+		&room, e_rr
+	))
+
+	//Hit group = material
+
+	TLASInstanceStatic instances[2] = { 0 };
+
+	for(U8 i = 0; i < 2; ++i) {
+
+		for(U8 j = 0; j < 3; ++j)
+			instances[i].transform[j][j] = 1;
+
+		instances[i].data.instanceId24_mask8 = i | (0xFFu << 24);
+		instances[i].data.sbtOffset24_flags8 = i;
+	}
+
+	ListTLASInstanceStatic instanceList = (ListTLASInstanceStatic) { 0 };
+	gotoIfError2(clean, ListTLASInstanceStatic_createRefConst(instances, 2, &instanceList))
+
+	const CpuBLAS *blases[] = { &spheres, &room };
+	gotoIfError3(clean, CpuTLAS_createx(instanceList, blases, &tlas, e_rr))
+
+	const CpuPathMaterial materials[] = {
+		(CpuPathMaterial) { .albedo = F32x4_create3(0.8f, 0.6f, 0.4f) },
+		(CpuPathMaterial) { .albedo = F32x4_create3(0.5f, 0.5f, 0.5f) }
+	};
+
+	CpuPathTracerInput input = (CpuPathTracerInput) {
+		.tlas = &tlas,
+		.materials = materials,
+		.materialCount = sizeof(materials) / sizeof(materials[0]),
+		.camera = (Camera) {
+			.pos = F32x4_create3(0, 4, 30),
+			.dir = F32x4_create3(0, -0.25f, -1),
+			.up = F32x4_create3(0, 1, 0),
+			.fovYDeg = 60,
+			.nearPlane = 0.1f,
+			.farPlane = 1000
+		},
+		.sunDir = F32x4_normalize3(F32x4_create3(0.3f, 1, 0.4f)),
+		.sunColor = F32x4_create3(3, 2.8f, 2.5f),
+		.skyColor = F32x4_create3(0.3f, 0.5f, 1)
+	};
+
+	Log_debugLnx(
+		"Path tracer: %ux%u, %"PRIu64" triangles, waves of %u paths on %"PRIu64" thread(s)",
+		w, h, spheres.triangleCount + room.triangleCount, tracer.waveSize, tracer.threadCount
+	);
+
+	const U32 bounceCounts[] = { 1, 4, 8 };
+
+	for(U8 i = 0; i < sizeof(bounceCounts) / sizeof(bounceCounts[0]); ++i) {
+
+		if(bounces != U64_MAX && i)
+			break;
+
+		input.maxBounces = bounces != U64_MAX ? (U32) U64_min(bounces, 64) : bounceCounts[i];
+		gotoIfError3(clean, Bench_pathTracerBounces(&tracer, &input, w, h, iterations, radiance, e_rr))
+	}
+
+clean:
+	CpuPathTracer_freex(&tracer);
+	CpuTLAS_freex(&tlas);
+	CpuBLAS_freex(&room);
+	CpuBLAS_freex(&spheres);
+	Buffer_freex(&radiance);
+	Buffer_freex(&indices);
+	Buffer_freex(&positions);
+	return s_uccess;
+}
@@ -0,0 +1,155 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#include "bench.h"
+#include "bc_encoder.h"
+#include "mip_generator.h"
+#include "parallel.h"
+#include "platforms/log.h"
+#include "platforms/ext/bufferx.h"
+#include "types/base/time.h"
+#include "types/math/math.h"
+
+//Synthetic RGBA8 image with what blocks have to deal with: gradients, hard edges, fine noise and a separate alpha ramp
+
+static void Bench_createTextureImage(U8 *dst, U32 w, U32 h) {
+
+	U64 seed = 0x9E3779B97F4A7C15;
+
+	for(U32 y = 0; y < h; ++y)
+		for(U32 x = 0; x < w; ++x) {
+
+			const F32 fx = (F32) x / w, fy = (F32) y / h;
+
+			seed ^= seed << 13;
+			seed ^= seed >> 7;
+			seed ^= seed << 17;
+
+			U8 *p = dst + ((U64) y * w + x) * 4;
+			p[0] = (U8)(255 * (0.5f + 0.5f * F32_sin(fx * 20 + fy * 3)) + 0.5f) ^ (U8)(seed & 7);
+			p[1] = (U8)(255 * fy);
+			p[2] = ((x / 37 + y / 23) & 1) ? 200 : 30;
+			p[3] = (U8)(255 * fx);
+		}
+}
+
+Bool Bench_bc(U64 argc, const C8 *const *argv, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Buffer image = Buffer_createNull(), blocks = Buffer_createNull(), decoded = Buffer_createNull();
+
+	const U32 size = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "size", 1024), 4), 16384);
+	const U64 iterations = U64_max(Bench_getArgU64(argc, argv, "iterations", 4), 1);
+	const U64 pixels = (U64) size * size;
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(pixels * 4, &image))
+	Bench_createTextureImage(image.ptrNonConst, size, size);
+
+	Log_debugLnx("BC: %"PRIu32"x%"PRIu32", %"PRIu64" iterations, %"PRIu64" threads", size, size, iterations, Parallel_getThreadCount());
+
+	for(U64 format = 0; format < EBCFormat_Count; ++format) {
+
+		Ns best = U64_MAX;
+
+		for(U64 i = 0; i < iterations; ++i) {
+
+			Buffer_freex(&blocks);
+
+			const Ns start = Time_now();
+			gotoIfError3(clean, BCEncoder_encodex((EBCFormat) format, image, size, size, false, &blocks, e_rr))
+			best = U64_min(best, Time_now() - start);
+		}
+
+		Buffer_freex(&decoded);
+		gotoIfError3(clean, BCEncoder_decodex((EBCFormat) format, blocks, size, size, &decoded, e_rr))
+
+		//BC1 has no alpha, so only RGB is meaningful there
+
+		const F64 mpixels = (F64) pixels / ((F64) best / SECOND) / 1e6;
+		const F64 psnrRGB = BCEncoder_getPSNR(image, decoded, pixels, 3);
+
+		if(format == EBCFormat_BC1)
+			Log_debugLnx("%s: %.2f MPixels/s, PSNR RGB %.2fdB", EBCFormat_names[format], mpixels, psnrRGB);
+
+		else Log_debugLnx(
+			"%s: %.2f MPixels/s, PSNR RGB %.2fdB, RGBA %.2fdB",
+			EBCFormat_names[format], mpixels, psnrRGB, BCEncoder_getPSNR(image, decoded, pixels, 4)
+		);
+	}
+
+clean:
+	Buffer_freex(&decoded);
+	Buffer_freex(&blocks);
+	Buffer_freex(&image);
+	return s_uccess;
+}
+
+static const C8 *Bench_mipFilters[EMipFilter_Count] = { "box", "kaiser", "lanczos" };
+
+Bool Bench_mips(U64 argc, const C8 *const *argv, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Buffer image = Buffer_createNull(), chain = Buffer_createNull();
+
+	const U32 w = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "size", 8192), 1), 16384);
+	const U32 h = (U32) U64_min(U64_max(Bench_getArgU64(argc, argv, "height", w), 1), 16384);
+	const U64 iterations = U64_max(Bench_getArgU64(argc, argv, "iterations", 2), 1);
+	const C8 *filterName = Bench_getArg(argc, argv, "filter", "all");
+	const U64 pixels = (U64) w * h;
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(pixels * 4, &image))
+	Bench_createTextureImage(image.ptrNonConst, w, h);
+
+	Log_debugLnx(
+		"Mips: %"PRIu32"x%"PRIu32" (%"PRIu32" levels), %"PRIu64" iterations, %"PRIu64" threads",
+		w, h, MipGenerator_getLevels(w, h), iterations, Parallel_getThreadCount()
+	);
+
+	for(U64 filter = 0; filter < EMipFilter_Count; ++filter) {
+
+		if(!Bench_equals(filterName, "all") && !Bench_equals(filterName, Bench_mipFilters[filter]))
+			continue;
+
+		Ns best = U64_MAX;
+
+		for(U64 i = 0; i < iterations; ++i) {
+
+			Buffer_freex(&chain);
+
+			const Ns start = Time_now();
+			gotoIfError3(clean, MipGenerator_generatex(image, w, h, 0, (EMipFilter) filter, true, &chain, e_rr))
+			best = U64_min(best, Time_now() - start);
+		}
+
+		//The 1x1 level is the (linear) average of the image, so it should barely depend on the filter
+
+		const U8 *last = chain.ptr + Buffer_length(chain) - 4;
+
+		Log_debugLnx(
+			"%s: %.3fms, %.2f MPixels/s (source), 1x1: %"PRIu8" %"PRIu8" %"PRIu8" %"PRIu8,
+			EMipFilter_names[filter], (F64) best / 1e6, (F64) pixels / ((F64) best / SECOND) / 1e6,
+			last[0], last[1], last[2], last[3]
+		);
+	}
+
+clean:
+	Buffer_freex(&chain);
+	Buffer_freex(&image);
+	return s_uccess;
+}
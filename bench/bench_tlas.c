@@ -0,0 +1,159 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "bench.h"
+#include "bench_mesh.h"
+#include "cpu_as.h"
+#include "platforms/log.h"
+#include "platforms/ext/bufferx.h"
+#include "types/base/time.h"
+#include "types/math/math.h"
+
+static F32 Bench_random(U64 i, U32 seed) {
+	const U32 hash = (U32)((i + 1) * 0x9E3779B9u) ^ (seed * 0x85EBCA6Bu);
+	return (F32)((hash ^ (hash >> 15)) * 0xC2B2AE35u >> 8) / (1 << 24);
+}
+
+Bool Bench_tlas(U64 argc, const C8 *const *argv, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	Buffer positions = Buffer_createNull();
+	Buffer indices = Buffer_createNull();
+	Buffer instanceData = Buffer_createNull();
+	Buffer blasData = Buffer_createNull();
+	CpuBLAS blas = (CpuBLAS) { 0 };
+	CpuTLAS tlas = (CpuTLAS) { 0 };
+	CpuTLAS reference = (CpuTLAS) { 0 };
+
+	const U64 instanceCount = U64_max(Bench_getArgU64(argc, argv, "instances", 50 * 1000), 1);
+	const U64 moving = U64_min(Bench_getArgU64(argc, argv, "moving", 10), 100);
+	const U64 frames = Bench_getArgU64(argc, argv, "frames", 100);
+	const U64 threshold = Bench_getArgU64(argc, argv, "threshold", 150);
+
+	U16 positionStride = 0;
+
+	gotoIfError3(clean, BenchMesh_createSpheresx(
+		256, 1, ETextureFormatId_RGB32f, &positions, &indices, &positionStride, e_rr
+	))
+
+	gotoIfError3(clean, CpuBLAS_createx(
+		ECpuBVHPolicy_SAH, ETextureFormatId_RGB32f, 0, positionStride, ETextureFormatId_R32u, positions, indices, &blas, e_rr
+	))
+
+	gotoIfError2(clean, Buffer_createEmptyBytesx(sizeof(TLASInstanceStatic) * instanceCount, &instanceData))
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(const CpuBLAS*) * instanceCount, &blasData))
+
+	TLASInstanceStatic *instances = (TLASInstanceStatic*) instanceData.ptrNonConst;
+	const CpuBLAS **blases = (const CpuBLAS**) blasData.ptrNonConst;
+
+	//Instances are scattered in a cube that holds roughly 1 instance per 8^3 units
+
+	const F32 extent = F32_max(F32_pow(instanceCount * 512.f, 1 / 3.f), 16) * 0.5f;
+
+	for(U64 i = 0; i < instanceCount; ++i) {
+
+		TLASInstanceStatic *instance = &instances[i];
+		instance->data.instanceId24_mask8 = (U32)(i & 0xFFFFFF) | (0xFFu << 24);
+
+		for(U8 j = 0; j < 3; ++j) {
+			instance->transform[j][j] = 1;
+			instance->transform[j][3] = (Bench_random(i, j) * 2 - 1) * extent;
+		}
+
+		blases[i] = &blas;
+	}
+
+	ListTLASInstanceStatic instanceList = (ListTLASInstanceStatic) { 0 };
+	gotoIfError2(clean, ListTLASInstanceStatic_createRefConst(instances, instanceCount, &instanceList))
+
+	Ns start = Time_now();
+	gotoIfError3(clean, CpuTLAS_createx(instanceList, blases, &tlas, e_rr))
+	const Ns createTime = Time_now() - start;
+
+	tlas.rebuildThreshold = threshold / 100.f;
+
+	Log_debugLnx(
+		"TLAS: %"PRIu64" instances, created in %.3fms, SAH cost %.3f",
+		instanceCount, createTime / 1e6, tlas.bvh.stats.sahCost
+	);
+
+	//The same instances move every frame, each in its own direction, so the tree degrades over time
+
+	const U64 movingCount = (instanceCount * moving + 99) / 100;
+	Ns minTime = U64_MAX, maxTime = 0, sumTime = 0;
+
+	for(U64 frame = 0; frame < frames; ++frame) {
+
+		for(U64 i = 0; i < movingCount; ++i) {
+
+			const U64 id = i * instanceCount / movingCount;
+
+			for(U8 j = 0; j < 3; ++j)
+				instances[id].transform[j][3] += (Bench_random(id, 3 + j) * 2 - 1) * extent * 0.01f;
+		}
+
+		start = Time_now();
+		gotoIfError3(clean, CpuTLAS_updatex(instanceList, blases, &tlas, e_rr))
+
+		const Ns updateTime = Time_now() - start;
+		minTime = U64_min(minTime, updateTime);
+		maxTime = U64_max(maxTime, updateTime);
+		sumTime += updateTime;
+	}
+
+	const CpuTLASStats stats = tlas.stats;
+
+	Log_debugLnx(
+		"TLAS update: %"PRIu64"x (%"PRIu64" unchanged, %"PRIu64" refit, %"PRIu64" rebuilt at %.2fx SAH cost), "
+		"%"PRIu64" instances moved per frame",
+		stats.updates, stats.unchanged, stats.refits, stats.rebuilds, threshold / 100., movingCount
+	);
+
+	if(stats.updates)
+		Log_debugLnx(
+			"TLAS update: min %.3fms, avg %.3fms, max %.3fms, refit avg %.3fms (%.1f nodes), final SAH cost %.2fx",
+			minTime / 1e6, sumTime / 1e6 / stats.updates, maxTime / 1e6,
+			stats.refits ? stats.refitTime / 1e6 / stats.refits : 0.,
+			stats.refits ? stats.refitNodes / (F64) stats.refits : 0.,
+			stats.costRatio
+		);
+
+	//What it'd cost to rebuild from scratch every frame instead
+
+	start = Time_now();
+	gotoIfError3(clean, CpuTLAS_createx(instanceList, blases, &reference, e_rr))
+
+	Log_debugLnx(
+		"TLAS rebuild every frame: %.3fms (BVH build %.3fms), SAH cost %.3f vs refit %.3f",
+		(Time_now() - start) / 1e6, reference.bvh.stats.buildTime / 1e6,
+		reference.bvh.stats.sahCost, tlas.bvh.stats.sahCost
+	);
+
+clean:
+	CpuTLAS_freex(&reference);
+	CpuTLAS_freex(&tlas);
+	CpuBLAS_freex(&blas);
+	Buffer_freex(&blasData);
+	Buffer_freex(&instanceData);
+	Buffer_freex(&indices);
+	Buffer_freex(&positions);
+	return s_uccess;
+}
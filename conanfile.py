@@ -24,13 +24,15 @@ class rt_core(ConanFile):
 	options = {
 		"forceVulkan": [ True, False ],
 		"enableSIMD": [ True, False ],
-		"dynamicLinkingGraphics": [ True, False ]
+		"dynamicLinkingGraphics": [ True, False ],
+		"enableBenchmarks": [ True, False ]
 	}
 
 	default_options = {
 		"forceVulkan": False,
 		"enableSIMD": True,
-		"dynamicLinkingGraphics": False
+		"dynamicLinkingGraphics": False,
+		"enableBenchmarks": False
 	}
 
 	exports_sources = [ "inc/*", "cmake/*" ]
@@ -51,6 +53,7 @@ class rt_core(ConanFile):
 		tc.cache_variables["ForceVulkan"] = self.options.forceVulkan
 		tc.cache_variables["DynamicLinkingGraphics"] = self.options.dynamicLinkingGraphics
 		tc.cache_variables["EnableSIMD"] = self.options.enableSIMD
+		tc.cache_variables["EnableBenchmarks"] = self.options.enableBenchmarks
 		tc.cache_variables["CMAKE_CONFIGURATION_TYPES"] = str(self.settings.build_type)
 		tc.generate()
 
@@ -57,6 +57,56 @@ static const U32x3 test20 = 1.f.xxx;
 
 static const F32 test = 1;
 
+//Precomputed LUT sizes, has to be kept in sync with tst/atmosphere_lut.h
+
+static const F32x2 AtmosphereLUT_transmittanceSize = F32x2(256, 64);
+static const F32x2 AtmosphereLUT_multiScatteringSize = F32x2(32, 32);
+
+//Sky cache (see tst/sky_cache.h); cube faces +X, -X, +Y, -Y, +Z, -Z next to each other in a (6 * size) x size texture
+
+F32x3 sampleSkyCache(Texture2D cache, SamplerState s, F32x3 dir) {
+
+	F32x3 a = abs(dir);
+	F32x2 uv;
+	U32 face;
+
+	if(a.x >= a.y && a.x >= a.z) {
+		face = dir.x > 0 ? 0 : 1;
+		uv = F32x2(dir.x > 0 ? -dir.z : dir.z, -dir.y) / a.x;
+	}
+
+	else if(a.y >= a.z) {
+		face = dir.y > 0 ? 2 : 3;
+		uv = F32x2(dir.x, dir.y > 0 ? dir.z : -dir.z) / a.y;
+	}
+
+	else {
+		face = dir.z > 0 ? 4 : 5;
+		uv = F32x2(dir.z > 0 ? dir.x : -dir.x, -dir.y) / a.z;
+	}
+
+	U32 w, h;
+	cache.GetDimensions(w, h);
+
+	uv = clamp(uv * 0.5 + 0.5, 0.5 / h, 1 - 0.5 / h);		//Don't filter with the neighboring faces
+	return cache.SampleLevel(s, F32x2((face + uv.x) / 6, uv.y), 0).rgb;
+}
+
+//Per pixel rayOffset (x) and lightOffset (y) for jittered ray marching (see tst/atmosphere.h).
+//Interleaved gradient noise (Jimenez 2014) spreads them like blue noise and every frame shifts them along R2.
+
+F32 interleavedGradientNoise(F32x2 p) {
+	return frac(52.9829189 * frac(dot(p, F32x2(0.06711056, 0.00583715))));
+}
+
+F32x2 getSampleOffsets(U32x2 pixel, U32 frameId) {
+	F32 frame = frameId & 1023;
+	return frac(F32x2(
+		interleavedGradientNoise(F32x2(pixel)) + frame * 0.7548776662,
+		interleavedGradientNoise(F32x2(pixel) + F32x2(47, 17)) + frame * 0.5698402910
+	));
+}
+
 //Generating camera rays using a vInv and vpInv
 
 struct Atmosphere {
@@ -82,6 +132,10 @@ struct Atmosphere {
 	F32x3 sunDir;
 	F32 atmosphereRadius;
 
+	F32 rayOffset;			//Where samples are within their interval, in [0, 1>; 0.5 = midpoint (see getSampleT)
+	F32 lightOffset;
+	Bool quadraticSamples;	//Space samples quadratically instead of uniformly
+
 	//Scattering density and phase functions
 
 	F32 getDensity(F32x3 pos, F32 rayLen, ScatteringType type) {
@@ -111,6 +165,8 @@ struct Atmosphere {
 
 		a.raySamples = 16;
 		a.lightSamples = 8;
+		a.rayOffset = a.lightOffset = 0.5;
+		a.quadraticSamples = false;
 		a.planetRadius = 6371000;
 		a.atmosphereRadius = a.planetRadius + 80000;
 
@@ -134,6 +190,21 @@ struct Atmosphere {
 
 	//Ray marching
 
+	//Uniform samples (the midpoint rule at offset 0.5) or quadratic ones, denser at the start of the ray.
+	//See Atmosphere_getSampleT in tst/atmosphere.h.
+
+	static F32 getSampleT(F32 start, F32 len, U32 i, U32 samples, F32 offset, Bool quadratic, out F32 step) {
+
+		if(!quadratic) {
+			step = len / samples;
+			return start + step * (i + offset);
+		}
+
+		F32 s = (i + offset) / samples;
+		step = len * (2 * s / samples);
+		return start + len * (s * s);
+	}
+
 	Bool getOpticalDepthLight(
 		F32x3 pos,
 		ScatteringType rayleigh, ScatteringType mie,
@@ -154,13 +225,14 @@ struct Atmosphere {
 		//Step through only the atmos (nothing before or after)
 
 		F32 start = intersections.y;
-		F32 step = (intersections.z - start) / lightSamples;
+		F32 diff = intersections.z - start;
 
 		U32 i = 0;
 
 		for(; i < lightSamples; ++i) {
 
-			F32x3 pos = posOnRay(ray, start + step * (i + 0.5));
+			F32 step;
+			F32x3 pos = posOnRay(ray, getSampleT(start, diff, i, lightSamples, lightOffset, quadraticSamples, step));
 
 			F32 dist = length(pos) - planetRadius;
 
@@ -226,19 +298,36 @@ struct Atmosphere {
 		F32 diff = intersections.z - start;
 
 		//Raymarch through the start + end regions
-		F32 step = diff / raySamples;
 
 		F32x4 sumRayleigh = 0.xxxx, sumMie = 0.xxxx;
+		F32x3 prev = F32x3(start, 0, 0);		//quadraticSamples: t, rayleigh and mie density per meter of the previous sample
 
 		for(U32 i = 0; i < raySamples; ++i) {
 
-			F32x3 pos = posOnRay(ray, start + step * (0.5 + i));
+			F32 step;
+			F32 t = getSampleT(start, diff, i, raySamples, rayOffset, quadraticSamples, step);
+			F32x3 pos = posOnRay(ray, t);
 
-			F32 densityRayleigh = getDensity(pos, step, rayleigh);
-			F32 densityMie = getDensity(pos, step, mie);
+			F32x2 density = F32x2(getDensity(pos, 1, rayleigh), getDensity(pos, 1, mie));		//Per meter
 
-			sumRayleigh.w += densityRayleigh;
-			sumMie.w += densityMie;
+			F32 densityRayleigh = density.x * step;
+			F32 densityMie = density.y * step;
+
+			//Optical depth to the sample: its whole step, or a trapezoid from the previous sample (or the start)
+
+			F32x2 depth = F32x2(densityRayleigh, densityMie);
+
+			if(quadraticSamples) {
+
+				if(!i)
+					prev.yz = density;
+
+				depth = (density + prev.yz) * 0.5 * (t - prev.x);
+				prev = F32x3(t, density);
+			}
+
+			sumRayleigh.w += depth.x;
+			sumMie.w += depth.y;
 
 			F32 depthLightRayleigh, depthLightMie;
 
@@ -260,4 +349,116 @@ struct Atmosphere {
 
 		return (rayleighContrib + mieContrib) * sunRadianceLux / F32_pi;
 	}
+
+	//Precomputed transmittance and multiple scattering (see tst/atmosphere_lut.c).
+	//The LUTs are RGBA16f and the uvs always stay within the texel centers, so any linear sampler works.
+
+	static F32x2 toTexelCenter(F32x2 v, F32x2 size) {
+		return 0.5 / size + v * (1 - 1 / size);
+	}
+
+	F32x3 sampleTransmittance(Texture2D lut, SamplerState s, F32 r, F32 mu) {
+
+		F32 Rg = planetRadius, Rt = atmosphereRadius;
+
+		if(mu < 0 && (Rg - r) * (Rg + r) + r * r * mu * mu >= 0)		//Planet is in the way
+			return 0.xxx;
+
+		F32 H = sqrt((Rt - Rg) * (Rt + Rg));
+		F32 rho = sqrt(max((r - Rg) * (r + Rg), 0));
+
+		F32 d = max(-r * mu + sqrt(max((Rt - r) * (Rt + r) + r * r * mu * mu, 0)), 0);
+		F32 dMin = Rt - r, dMax = rho + H;
+
+		F32x2 uv = F32x2(dMax > dMin ? (d - dMin) / (dMax - dMin) : 0, rho / H);
+		return lut.SampleLevel(s, toTexelCenter(uv, AtmosphereLUT_transmittanceSize), 0).rgb;
+	}
+
+	F32x3 sampleMultiScattering(Texture2D lut, SamplerState s, F32 r, F32 muS) {
+		F32x2 uv = saturate(F32x2(muS * 0.5 + 0.5, (r - planetRadius) / (atmosphereRadius - planetRadius)));
+		return lut.SampleLevel(s, toTexelCenter(uv, AtmosphereLUT_multiScatteringSize), 0).rgb;
+	}
+
+	//Same as getContribution, but the light isn't ray marched (and includes multiple scattering)
+
+	F32x3 getContributionLUT(RayDesc ray, Texture2D transmittanceLUT, Texture2D multiScatteringLUT, SamplerState s) {
+
+		ray.Origin += float3(0, planetRadius + 10, 0);
+
+		//Get start and end intersection
+
+		{
+			Sphere earth = Sphere::create(0.xxx, planetRadius);
+
+			F32x3 intersections; Bool isBackside;
+			if(earth.intersects(ray, intersections, isBackside))
+				ray.TMax = intersections.x;
+		}
+
+		F32x3 earthNrm = normalize(posOnRay(ray, ray.TMax));
+		F32x3 earthShading = getSunContribution(earthNrm);
+
+		Sphere atmos = Sphere::create(0.xxx, atmosphereRadius);
+
+		F32x3 intersections; Bool isBackside;
+		if(!atmos.intersects(ray, intersections, isBackside))
+			return earthShading;
+
+		F32 start = intersections.y;
+		F32 diff = intersections.z - start;
+
+		//Raymarch through the start + end regions (same samples as getContribution)
+
+		F32x4 sumRayleigh = 0.xxxx, sumMie = 0.xxxx;
+		F32x3 sumMulti = 0.xxx;
+		F32x3 prev = F32x3(start, 0, 0);
+
+		for(U32 i = 0; i < raySamples; ++i) {
+
+			F32 step;
+			F32 t = getSampleT(start, diff, i, raySamples, rayOffset, quadraticSamples, step);
+			F32x3 pos = posOnRay(ray, t);
+
+			F32x2 density = F32x2(getDensity(pos, 1, rayleigh), getDensity(pos, 1, mie));
+
+			F32 densityRayleigh = density.x * step;
+			F32 densityMie = density.y * step;
+
+			F32x2 depth = F32x2(densityRayleigh, densityMie);
+
+			if(quadraticSamples) {
+
+				if(!i)
+					prev.yz = density;
+
+				depth = (density + prev.yz) * 0.5 * (t - prev.x);
+				prev = F32x3(t, density);
+			}
+
+			sumRayleigh.w += depth.x;
+			sumMie.w += depth.y;
+
+			F32x3 tauRayleighOzone = (rayleigh.coefficient + ozoneCoefficient) * sumRayleigh.w;
+			F32x3 tauMie = mie.coefficient * 1.11 * sumMie.w;
+
+			F32x3 viewTransmittance = exp(-(tauRayleighOzone + tauMie));
+
+			F32 r = length(pos);
+			F32 muS = dot(pos, -sunDir) / r;
+
+			F32x3 atten = viewTransmittance * sampleTransmittance(transmittanceLUT, s, r, muS);
+
+			sumRayleigh.xyz += atten * densityRayleigh;
+			sumMie.xyz += atten * densityMie;
+
+			F32x3 scattering = rayleigh.coefficient * densityRayleigh + mie.coefficient * densityMie;
+			sumMulti += viewTransmittance * scattering * sampleMultiScattering(multiScatteringLUT, s, r, muS);
+		}
+
+		float LoV = saturate(dot(ray.Direction, -sunDir));
+		F32x3 rayleighContrib = sumRayleigh.xyz * rayleigh.coefficient * rayleighPhaseFunction(LoV);
+		F32x3 mieContrib = sumMie.xyz * mie.coefficient * miePhaseFunction(LoV);
+
+		return (rayleighContrib + mieContrib + sumMulti) * sunRadianceLux / F32_pi;
+	}
 };
@@ -18,7 +18,7 @@
 *  This is called dual licensing.
 */
 
-#include "@resources.hlsli"
+#include "resource_bindings.hlsli"
 #include "ray_basics.hlsli"
 
 //Generating camera rays using a vInv and vpInv
@@ -28,6 +28,17 @@ struct Camera {
 	F32x4x4 v, p, vp;
 	F32x4x4 vInv, pInv, vpInv;
 
+	static Camera fromMatrices(ViewProjMatrices mats) {
+		Camera cam;
+		cam.v = mats.view;
+		cam.p = mats.proj;
+		cam.vp = mats.viewProj;
+		cam.vInv = mats.viewInv;
+		cam.pInv = mats.projInv;
+		cam.vpInv = mats.viewProjInv;
+		return cam;
+	}
+
 	RayDesc getRay(U32x2 id, U32x2 dims) {
 
 		//Generate primaries
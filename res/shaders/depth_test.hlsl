@@ -25,6 +25,7 @@
 struct VSOutput {
 	F32x4 pos : SV_POSITION;
 	F32x2 uv : TEXCOORD0;
+	F32x4 viewClip : SV_ClipDistance0;		//Keeps a view inside its tile, the viewport covers every view
 };
 
 static const U32 quadIndices[] = {
@@ -58,17 +59,32 @@ VSOutput mainVS(U32 id : SV_VertexID, U32 instanceId : SV_InstanceID) {
 	F32x3 scale = 0.25.xxx;
 	F32x3 pos = F32x3(0, (sin(_time) * 0.5 + 0.5) * 5, 0);
 
-	pos += F32x3((instanceId.xxx >> uint3(0, 2, 4)) & 3) / 3.0 * 2 - 1;
+	U32 view = instanceId / 64;		//64 cubes per view
+	U32 cube = instanceId % 64;
+
+	pos += F32x3((cube.xxx >> uint3(0, 2, 4)) & 3) / 3.0 * 2 - 1;
 
 	F32x4x4 m = F32x4x4_transform(pos, rot, scale);		//pos, rot, scale
 	F32x3 wpos = mul(F32x4(mpos, 1), m).xyz;
 
-	U32 viewProjMatBuf = getAppData1u(EResourceBinding_ViewProjMatrices);
-	ViewProjMatrices viewProjMat = getAtUniform<ViewProjMatrices>(viewProjMatBuf, 0);
+	ViewProjMatrices viewProjMat = getViewProjMatrices(view);
 
 	F32x4 cpos = mul(F32x4(wpos, 1), viewProjMat.viewProj);
 
+	//Move the view's clip space into its tile (x right, y up, so row 0 is the top one).
+	//Clip distances are against the view's own frustum, so nothing leaks into the neighbouring tiles.
+
+	U32 viewCount = getViewCount();
+	U32 columns = getAppData1u(EResourceBinding_Views) >> 16;
+	U32x2 grid = U32x2(columns, (viewCount + columns - 1) / columns);
+	F32x2 tile = F32x2(view % columns, view / columns);
+
 	VSOutput output = (VSOutput) 0;
+	output.viewClip = F32x4(cpos.w + cpos.x, cpos.w - cpos.x, cpos.w + cpos.y, cpos.w - cpos.y);
+
+	cpos.x = (cpos.x + cpos.w * (1 + 2 * tile.x)) / grid.x - cpos.w;
+	cpos.y = cpos.w - (cpos.w - cpos.y + 2 * tile.y * cpos.w) / grid.y;
+
 	output.pos = cpos;
 	output.uv = uv;
 	return output;
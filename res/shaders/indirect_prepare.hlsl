@@ -27,47 +27,6 @@ void main(U32 i : SV_DispatchThreadID) {
 	if(i >= 2)			//As a test, we always draw 2 objects from the same buffer
 		return;
 
-	//View projection matrices
-
-	if(i == 0) {
-
-		F32x3 camPos = F32x3(0, 0, 2);
-
-		F32 aspect = 1;
-
-		if(_swapchainCount) {
-
-			U32 readSwapchain = getReadSwapchain(0);
-
-			if(readSwapchain != U32_MAX) {
-
-				U32x3 dims;
-				texture2DUniform(readSwapchain).GetDimensions(0, dims.x, dims.y, dims.z);
-
-				aspect = (float)dims.x / dims.y;
-			}
-		}
-
-		U32 orientation = getAppData1u(EResourceBinding_Orientation);
-
-		F32x4x4 v = F32x4x4_lookAt(camPos, 0.xxx, F32x3(0, 1, 0));
-		v = mul(v, F32x4x4_rotateZ(orientation * F32_degToRad));
-
-		F32x4x4 p = F32x4x4_perspective(120 * F32_degToRad, aspect, 0.1, 100);
-
-		ViewProjMatrices vp;
-		vp.view = v;
-		vp.proj = p;
-		vp.viewProj = mul(v, p);
-
-		vp.viewInv = inverseSlow(vp.view);
-		vp.projInv = inverseSlow(vp.proj);
-		vp.viewProjInv = inverseSlow(vp.viewProj);
-
-		U32 viewProjMatRW = getAppData1u(EResourceBinding_ViewProjMatricesRW);
-		setAtUniform<ViewProjMatrices>(viewProjMatRW, 0, vp);
-	}
-
 	//Indirect dispatch
 
 	if (i == 0) {
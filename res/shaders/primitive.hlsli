@@ -58,8 +58,10 @@ struct Sphere {
 		F32 q = b + sign(b) * sqrt(D);
 		F32 c = dot(dif, dif) - rad2;
 
-		F32 hitT1 = c / q;
-		F32 hitT2 = q;
+		//c / q and q are both roots, but which is nearest depends on the sign of b
+
+		F32 hitT1 = min(c / q, q);
+		F32 hitT2 = max(c / q, q);
 		isBackface = hitT1 < ray.TMin;
 
 		F32 hitT = isBackface ? hitT2 : hitT1;
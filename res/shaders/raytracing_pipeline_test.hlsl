@@ -37,8 +37,48 @@ void mainMiss(inout ColorPayload payload) {
 	RayDesc ray = createRay(WorldRayOrigin(), 0, WorldRayDirection(), 1e38);
 
 	F32x3 sunDir = getAppData3f(EResourceBinding_SunDirXYZ);
+	U32 skyCacheId = getAppData1u(EResourceBinding_SkyCache);
+	U32 transmittanceId = getAppData1u(EResourceBinding_TransmittanceLUT);
 
-	F32x3 color = Atmosphere::earth(sunDir).getContribution(ray);
+	Atmosphere atmos = Atmosphere::earth(sunDir);
+	F32x3 color;
+
+	//Fewer samples are jittered per pixel, so the error is noise that moves every frame instead of banding
+
+	U32 samples = getAppData1u(EResourceBinding_AtmosphereSamples);
+
+	if(samples) {
+
+		if(samples & 0x7FFF)
+			atmos.raySamples = samples & 0x7FFF;
+
+		atmos.quadraticSamples = ((samples >> 15) & 1) != 0;
+
+		if(samples >> 16)
+			atmos.lightSamples = samples >> 16;
+
+		F32x2 offsets = getSampleOffsets(DispatchRaysIndex().xy, getAppData1u(EResourceBinding_FrameId));
+		atmos.rayOffset = offsets.x;
+		atmos.lightOffset = offsets.y;
+	}
+
+	//The sky cache is opt in (skyCache=1) and replaces the LUTs, which are the default.
+	//It's baked with Atmosphere::earth's samples, so jittered samples skip it.
+
+	if(skyCacheId && !samples)
+		color = sampleSkyCache(
+			texture2DUniform(skyCacheId), samplerUniform(getAppData1u(EResourceBinding_Sampler)), ray.Direction
+		);
+
+	else if(transmittanceId)
+		color = atmos.getContributionLUT(
+			ray,
+			texture2DUniform(transmittanceId),
+			texture2DUniform(getAppData1u(EResourceBinding_MultiScatteringLUT)),
+			samplerUniform(getAppData1u(EResourceBinding_Sampler))
+		);
+
+	else color = atmos.getContribution(ray);		//Ray march if the LUTs aren't available
 
 	payload.color = color;
 	payload.hitT = -1;
@@ -65,6 +105,8 @@ void mainRaygen() {
 
 	U32x2 id = DispatchRaysIndex().xy;
 	U32x2 dims = DispatchRaysDimensions().xy;
+	U32 view = DispatchRaysIndex().z;		//Every view is a tile of dims in the render target
+	U32x2 viewOffset = getViewOffset(view, dims);
 	
 	U32 orientation = getAppData1u(EResourceBinding_Orientation);
 
@@ -89,25 +131,7 @@ void mainRaygen() {
 			break;
 	}
 
-	//Generate matrices
-
-	F32 aspect = (F32) dims.x / dims.y;
-
-	F32 localTime = _time * 0.5;
-
-	F32x3 camPos = getAppData3f(EResourceBinding_CamPosXYZ);
-
-	Camera cam;
-	cam.v = F32x4x4_lookDir(camPos, F32x3(0, 0, -1), F32x3(0, 1, 0));
-	cam.p = F32x4x4_perspective(45 * F32_degToRad, aspect, 0.1, 100);
-
-	cam.vp = mul(cam.v, cam.p);
-
-	cam.vInv = inverseSlow(cam.v);
-	cam.pInv = inverseSlow(cam.p);
-	cam.vpInv = inverseSlow(cam.vp);
-
-	//RayDesc ray = cam.getRay(id, dims);
+	//The ray is orthographic, so it doesn't use the view's camera (getViewProjMatrices) yet
 
 	F32x2 uv = (id + 0.5) / dims;
     uv.y = 1 - uv.y;		//Flip to avoid overlap with inline RT
@@ -149,7 +173,34 @@ void mainRaygen() {
 	}*/
 
 	F32 exposure = exp2(-14);
+	F32x3 color = payload.color * exposure;
+
+	//Jittered misses (raySamples= or lightSamples=) are averaged over frames in the sky history, like SkyTemporal:
+	//a running mean that turns into an exponential moving average after 32 frames.
+	//The ray is orthographic and doesn't depend on the camera, so a pixel's direction never changes and reprojecting
+	//its history is the identity. Hits start over, as does everything when the CPU resets it (sun moved, new target).
+
+	U32 historyId = getAppData1u(EResourceBinding_SkyHistoryRW);
+
+	if(historyId) {
+
+		RWTexture2D<F32x4> history = rwTexture2DfUniform(historyId);
+
+		if(payload.hitT >= 0)
+			history[viewOffset + ogId] = 0.xxxx;
+
+		else {
+
+			F32x4 prev = getAppData1u(EResourceBinding_ResetSkyHistory) ? 0.xxxx : history[viewOffset + ogId];
+			F32 frames = min(prev.w + 1, 32);
+
+			color = lerp(prev.rgb, color, 1 / frames);
+			history[viewOffset + ogId] = F32x4(color, frames);
+		}
+	}
+
+	//Misses are only written if they have a history, otherwise the clear color stays
 
-	if (payload.hitT >= 0)
-		tex[ogId] = F32x4(payload.color * exposure, 1);
+	if (payload.hitT >= 0 || historyId)
+		tex[viewOffset + ogId] = F32x4(color, 1);
 }
@@ -30,16 +30,21 @@
 )]]
 [shader("compute")]
 [numthreads(16, 8, 1)]
-void main(U32x2 id : SV_DispatchThreadID) {
+void main(U32x3 dispatchId : SV_DispatchThreadID) {
 
 	RWTexture2D<unorm F32x4> tex = rwTexture2DUniform(getAppData1u(EResourceBinding_RenderTargetRW));
 
-	U32x2 dims;
-	tex.GetDimensions(dims.x, dims.y);
+	U32 packedDims = getAppData1u(EResourceBinding_RenderTargetSize);
+	U32x2 dims = U32x2(packedDims & 0xFFFF, packedDims >> 16);
+
+	U32x2 id = dispatchId.xy;
+	U32 view = dispatchId.z;		//Every view is a tile of dims in the render target
 
 	if(any(id >= dims))
 		return;
 
+	U32x2 viewOffset = getViewOffset(view, dims);
+
 	U32 orientation = getAppData1u(EResourceBinding_Orientation);
 	
 	U32x2 ogId = id;
@@ -65,8 +70,7 @@ void main(U32x2 id : SV_DispatchThreadID) {
 
 	//Generate primaries
 
-	U32 viewProjMat = getAppData1u(EResourceBinding_ViewProjMatrices);
-	ViewProjMatrices mats = getAtUniform<ViewProjMatrices>(viewProjMat, 0);
+	ViewProjMatrices mats = getViewProjMatrices(view);
 
 	F32x2 uv = (F32x2(id) + 0.5) / F32x2(dims);
 
@@ -104,5 +108,5 @@ void main(U32x2 id : SV_DispatchThreadID) {
 		else color = F32x3(0.25, 0.5, 1);
 	}
 
-	tex[ogId] = F32x4(color, 1);
+	tex[viewOffset + ogId] = F32x4(color, 1);
 }
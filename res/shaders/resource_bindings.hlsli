@@ -21,6 +21,9 @@
 #pragma once
 #include "@resources.hlsli"
 
+//Mirrors RuntimeData in test.c: every value is the index of a U32 in the runtime data (see getAppData1u),
+//so the F32x3s (read with getAppData3f) take three. Values after those are explicit to keep both in sync.
+
 enum EResourceBinding {
 
 	EResourceBinding_ConstantColorBuffer,
@@ -28,7 +31,7 @@ enum EResourceBinding {
 	EResourceBinding_IndirectDrawRW,
 	EResourceBinding_IndirectDispatchRW,
 
-	EResourceBinding_ViewProjMatricesRW,
+	EResourceBinding_ViewProjMatricesOffset,		//Byte offset of this frame's ViewProjMatrices (uploaded by the CPU)
 	EResourceBinding_ViewProjMatrices,
 	EResourceBinding_Crabbage2049x,
 	EResourceBinding_CrabbageCompressed,
@@ -38,11 +41,22 @@ enum EResourceBinding {
 	EResourceBinding_RenderTargetRW,
 	EResourceBinding_Orientation,
 
-	EResourceBinding_SunDirXYZ,
-	EResourceBinding_Padding1,
+	EResourceBinding_SunDirXYZ				= 12,
+	EResourceBinding_RenderTargetSize		= 15,	//x | (y << 16); RenderTargetRW can be bigger, only this part is visible
+
+	EResourceBinding_CamPosXYZ				= 16,
+	EResourceBinding_Views					= 19,	//viewCount | (viewColumns << 16); views are tiles of RenderTargetSize
+
+	EResourceBinding_TransmittanceLUT		= 20,
+	EResourceBinding_MultiScatteringLUT		= 21,
+	EResourceBinding_SkyCache				= 22,	//0 unless skyCache=1, replaces the LUTs for misses
 
-	EResourceBinding_CamPosXYZ,
-	EResourceBinding_Padding2
+	EResourceBinding_AtmosphereSamples		= 23,	//raySamples | (quadraticSamples << 15) | (lightSamples << 16);
+													//0 = Atmosphere::earth's (uniform, at the midpoint)
+	EResourceBinding_FrameId				= 24,	//Increments every frame, moves the jitter of the atmosphere's samples
+
+	EResourceBinding_SkyHistoryRW			= 25,	//0 unless AtmosphereSamples is set, average of the jittered misses
+	EResourceBinding_ResetSkyHistory		= 26	//1 if the sky history has to start over (sun moved, new target)
 };
 
 struct ViewProjMatrices {
@@ -50,6 +64,26 @@ struct ViewProjMatrices {
 	F32x4x4 viewInv, projInv, viewProjInv;
 };
 
+//Views are consecutive in the buffer, view 0 is at ViewProjMatricesOffset
+
+ViewProjMatrices getViewProjMatrices(U32 view) {
+	return getAtUniform<ViewProjMatrices>(
+		getAppData1u(EResourceBinding_ViewProjMatrices),
+		getAppData1u(EResourceBinding_ViewProjMatricesOffset) + view * sizeof(ViewProjMatrices)
+	);
+}
+
+ViewProjMatrices getViewProjMatrices() { return getViewProjMatrices(0); }
+
+U32 getViewCount() { return getAppData1u(EResourceBinding_Views) & 0xFFFF; }
+
+//Top left pixel of a view in the render target; views are tiled in rows of viewColumns
+
+U32x2 getViewOffset(U32 view, U32x2 viewSize) {
+	U32 columns = getAppData1u(EResourceBinding_Views) >> 16;
+	return U32x2(view % columns, view / columns) * viewSize;
+}
+
 #ifdef __OXC_EXT_I64
 	struct TransformPreciseFixed {		//Stride 4, Length 16
 		//U32x4 pos;		//fixedPointUnpack
@@ -0,0 +1,157 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#include "accumulation.h"
+#include "platforms/ext/bufferx.h"
+#include "types/math/math.h"
+
+Bool Accumulation_createx(
+	U32 width,
+	U32 height,
+	U32 targetSamples,
+	F32 maxError,
+	F32 thresholdDeg,
+	Accumulation *acc,
+	Error *e_rr
+) {
+
+	Bool s_uccess = true;
+	Bool ownsAcc = false;
+
+	if(!acc)
+		retError(clean, Error_nullPointer(5, "Accumulation_createx()::acc is required"))
+
+	if(acc->mean.ptr)
+		retError(clean, Error_invalidParameter(5, 0, "Accumulation_createx()::acc wasn't empty, might indicate memleak"))
+
+	if(!width || !height)
+		retError(clean, Error_invalidParameter(!width ? 0 : 1, 0, "Accumulation_createx()::width and height are required"))
+
+	if(!(maxError >= 0))
+		retError(clean, Error_invalidParameter(3, 0, "Accumulation_createx()::maxError should be >= 0"))
+
+	if(!(thresholdDeg >= 0 && thresholdDeg <= 180))
+		retError(clean, Error_invalidParameter(4, 0, "Accumulation_createx()::thresholdDeg should be in [0, 180]"))
+
+	ownsAcc = true;
+
+	*acc = (Accumulation) {
+		.width = width,
+		.height = height,
+		.targetSamples = targetSamples,
+		.maxError = maxError,
+		.thresholdCos = F32_cos(thresholdDeg * F32_DEG_TO_RAD)
+	};
+
+	gotoIfError2(clean, Buffer_createEmptyBytesx(sizeof(F32x4) * width * height, &acc->mean))
+
+clean:
+
+	if(!s_uccess && ownsAcc)
+		Accumulation_freex(acc);
+
+	return s_uccess;
+}
+
+void Accumulation_freex(Accumulation *acc) {
+
+	if(!acc)
+		return;
+
+	Buffer_freex(&acc->mean);
+	*acc = (Accumulation) { 0 };
+}
+
+Bool Accumulation_begin(Accumulation *acc, F32x4 camPos, F32x4 sunDir) {
+
+	if(!acc || !acc->mean.ptr)
+		return false;
+
+	//The first sample overwrites the mean, so resetting doesn't have to clear it
+
+	const Bool moved = F32x4_any(F32x4_neq(camPos, acc->camPos));
+
+	if(acc->sampleCount && (moved || F32x4_dot3(acc->sunDir, sunDir) < acc->thresholdCos)) {
+		acc->sampleCount = 0;
+		acc->isConverged = false;
+		++acc->resets;
+	}
+
+	if(!acc->sampleCount) {
+		acc->camPos = camPos;
+		acc->sunDir = sunDir;
+	}
+
+	if(acc->isConverged) {
+		++acc->skips;
+		return false;
+	}
+
+	return true;
+}
+
+F32x4 Accumulation_add(Accumulation *acc, U64 pixel, F32x4 color, F32 *error) {
+
+	F32x4 *mean = (F32x4*) acc->mean.ptrNonConst + pixel;
+
+	if(!acc->sampleCount)
+		return *mean = color;
+
+	//Running mean: m += (x - m) / n, so precision doesn't degrade as the sum grows
+
+	const F32x4 prev = *mean;
+	const F32x4 delta = F32x4_div(F32x4_sub(color, prev), F32x4_xxxx4((F32)(acc->sampleCount + 1)));
+	*mean = F32x4_add(prev, delta);
+
+	//Only what's visible counts, so overexposed channels don't keep it from converging
+
+	const F32x4 change = F32x4_abs(F32x4_sub(F32x4_saturate(*mean), F32x4_saturate(prev)));
+	*error = F32_max(*error, F32_max(F32x4_x(change), F32_max(F32x4_y(change), F32_max(F32x4_z(change), F32x4_w(change)))));
+
+	return *mean;
+}
+
+void Accumulation_end(Accumulation *acc, F32 error) {
+
+	if(!acc || !acc->mean.ptr)
+		return;
+
+	//The first sample has nothing to compare against, so it never converges on error
+
+	acc->lastError = acc->sampleCount ? error : F32_MAX;
+	++acc->sampleCount;
+
+	acc->isConverged =
+		(acc->targetSamples && acc->sampleCount >= acc->targetSamples) ||
+		(acc->maxError && acc->sampleCount >= Accumulation_minErrorSamples && acc->lastError <= acc->maxError);
+}
+
+F32x2 Accumulation_getJitter(U32 i) {
+
+	if(!i)
+		return F32x2_create2(0, 0);
+
+	//R2 in 0.32 fixed point: fract(i / plastic number), fract(i / plastic number^2).
+	//Only the top 24 bits are used, so the conversion to F32 can't round up to 1.
+
+	const U32 x = i * 0xC13FA9A9u, y = i * 0x91E10DA5u;
+	const F32 scale = 1.f / (1 << 24);
+
+	return F32x2_create2((x >> 8) * scale - 0.5f, (y >> 8) * scale - 0.5f);
+}
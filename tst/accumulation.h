@@ -0,0 +1,97 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#pragma once
+#include "types/container/buffer.h"
+#include "types/base/error.h"
+#include "types/math/vec.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Progressive accumulation: while the camera and sun stay the same, every frame adds one (jittered) sample per pixel
+//to a running mean in an F32x4 buffer, so a still image keeps converging instead of being retraced from scratch.
+//It resets once the camera moved or the sun moved more than the threshold (same test as the SkyCache).
+//
+//Once it has targetSamples, or the last sample changed no pixel by more than maxError, it's converged:
+//the image can't visibly change anymore, so nothing has to be traced until something moves.
+//A few samples can all miss the same edge, so the error is only trusted after minErrorSamples.
+
+#define Accumulation_defaultTargetSamples 64
+#define Accumulation_defaultMaxError (0.5f / 255)		//Half a step of an 8-bit target
+#define Accumulation_minErrorSamples 8
+
+typedef struct Accumulation {
+
+	Buffer mean;				//F32x4[width * height], average of all samples so far
+
+	F32x4 camPos;				//What the samples were traced with
+	F32x4 sunDir;
+
+	U32 width, height;
+
+	U32 sampleCount;			//Frame index since the last reset, so also the index of the next sample
+	U32 targetSamples;			//0 = no limit
+
+	F32 maxError;				//0 = only stop at targetSamples
+	F32 lastError;				//Largest change of a pixel's mean (any channel, clamped to [0, 1]) by the last sample
+
+	F32 thresholdCos;			//Reset once dot(sunDir, newSunDir) < thresholdCos
+
+	Bool isConverged;
+	U8 padding[3];
+
+	U64 resets, skips;			//Statistics: how often it restarted and how many frames didn't need a new sample
+
+} Accumulation;
+
+Bool Accumulation_createx(
+	U32 width,
+	U32 height,
+	U32 targetSamples,
+	F32 maxError,
+	F32 thresholdDeg,
+	Accumulation *acc,
+	Error *e_rr
+);
+
+void Accumulation_freex(Accumulation *acc);
+
+//Call before tracing a frame; resets if camPos or sunDir changed.
+//Returns false if it's converged, in which case the frame shouldn't be traced (the mean is still valid).
+
+Bool Accumulation_begin(Accumulation *acc, F32x4 camPos, F32x4 sunDir);
+
+//Adds sample sampleCount of a pixel and returns the new mean; error is maxed with how much the mean changed.
+//Safe to call from multiple threads, as long as they write different pixels.
+
+F32x4 Accumulation_add(Accumulation *acc, U64 pixel, F32x4 color, F32 *error);
+
+//Call after all pixels got their sample; error is the max of the errors returned by add
+
+void Accumulation_end(Accumulation *acc, F32 error);
+
+//Sub pixel offset in [-0.5, 0.5> of sample i (R2 sequence), sample 0 is the pixel center
+
+F32x2 Accumulation_getJitter(U32 i);
+
+#ifdef __cplusplus
+	}
+#endif
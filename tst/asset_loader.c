@@ -0,0 +1,326 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#include "asset_loader.h"
+#include "platforms/ext/threadx.h"
+#include "platforms/ext/bufferx.h"
+#include "platforms/ext/stringx.h"
+#include "platforms/file.h"
+#include "types/base/time.h"
+#include "types/math/math.h"
+#include "bc_encoder.h"
+
+Bool AssetLoader_add(AssetLoader *loader, CharString path, EAssetType type, CharString writePath, U64 *id, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!loader)
+		retError(clean, Error_nullPointer(0, "AssetLoader_add()::loader is required"))
+
+	if(loader->threadCount)
+		retError(clean, Error_invalidState(0, "AssetLoader_add() can't be called after AssetLoader_startx"))
+
+	if(loader->assetCount >= AssetLoader_maxAssets)
+		retError(clean, Error_outOfBounds(0, loader->assetCount, AssetLoader_maxAssets, "AssetLoader_add() too many assets"))
+
+	if(type > EAssetType_BMPAsBC7)
+		retError(clean, Error_invalidParameter(2, 0, "AssetLoader_add()::type is invalid"))
+
+	if(id)
+		*id = loader->assetCount;
+
+	loader->assets[loader->assetCount++] = (Asset) { .path = path, .writePath = writePath, .type = type };
+
+clean:
+	return s_uccess;
+}
+
+//Compressed BMPs are cached as a DDS next to the executable; the name includes a hash of the BMP and the mip filter,
+//so edits (or another filter) invalidate it
+
+static Bool Asset_loadCachedBC7(Asset *asset, EMipFilter mipFilter) {
+
+	if(!CharString_length(asset->writePath))
+		return false;
+
+	U64 hash = 0xCBF29CE484222325;		//FNV-1a
+
+	for(U64 i = 0; i < Buffer_length(asset->file); ++i)
+		hash = (hash ^ asset->file.ptr[i]) * 0x100000001B3;
+
+	hash = (hash ^ mipFilter) * 0x100000001B3;
+
+	if(CharString_formatx(
+		&asset->cachePath,
+		"%.*s.%016"PRIX64".dds",
+		(int) CharString_length(asset->writePath), asset->writePath.ptr, hash
+	).genericError)
+		return false;
+
+	if(!File_readx(asset->cachePath, U64_MAX, 0, 0, &asset->cacheFile, NULL))
+		return false;
+
+	const BMPInfo bmp = asset->bmpInfo;
+	const U32 levels = MipGenerator_getLevels(bmp.w, bmp.h);
+
+	Bool valid =
+		!DDS_readx(asset->cacheFile, &asset->ddsInfo, &asset->ddsData).genericError &&
+		asset->ddsInfo.w == bmp.w && asset->ddsInfo.h == bmp.h &&
+		asset->ddsInfo.mips == levels && asset->ddsData.length == levels;
+
+	for(U32 i = 0; valid && i < levels; ++i)
+		valid = Buffer_length(asset->ddsData.ptr[i].data) ==
+			BCEncoder_getSize(EBCFormat_BC7, U32_max(bmp.w >> i, 1), U32_max(bmp.h >> i, 1));
+
+	if(!valid) {
+		ListSubResourceData_freeAllx(&asset->ddsData);
+		Buffer_freex(&asset->cacheFile);
+		return false;
+	}
+
+	return true;
+}
+
+static Bool Asset_loadx(Asset *asset, EMipFilter mipFilter, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Buffer written = Buffer_createNull();
+	Buffer blocks = Buffer_createNull();
+
+	gotoIfError3(clean, File_readx(asset->path, U64_MAX, 0, 0, &asset->file, e_rr))
+
+	if(asset->type != EAssetType_DDS) {
+
+		gotoIfError2(clean, BMP_readx(asset->file, &asset->bmpInfo, &asset->bmpData))
+
+		const BMPInfo bmp = asset->bmpInfo;
+
+		if(bmp.w >> 16 || bmp.h >> 16)
+			retError(clean, Error_invalidState(0, "Asset_loadx() bmpInfo resolution out of bounds"))
+
+		const U32 levels = MipGenerator_getLevels(bmp.w, bmp.h);
+
+		//Compressed mips are written to the cache, unless the cache already has them
+
+		if(asset->type == EAssetType_BMP || !Asset_loadCachedBC7(asset, mipFilter)) {
+
+			//BMP pixels are sRGB
+
+			gotoIfError3(clean, MipGenerator_generatex(asset->bmpData, bmp.w, bmp.h, 0, mipFilter, true, &asset->mips, e_rr))
+			Buffer_freex(&asset->bmpData);
+
+			asset->ddsInfo = (DDSInfo) {
+				.w = bmp.w, .h = bmp.h, .l = 1, .mips = levels,
+				.type = ETextureType_2D,
+				.textureFormatId = asset->type == EAssetType_BMP ? bmp.textureFormatId : ETextureFormatId_BC7
+			};
+
+			const Bool isBGRA = (ETextureFormatId) bmp.textureFormatId == ETextureFormatId_BGRA8;
+
+			for(U32 i = 0; i < levels; ++i) {
+
+				const U64 offset = MipGenerator_getOffset(bmp.w, bmp.h, i);
+				const U64 size = MipGenerator_getOffset(bmp.w, bmp.h, i + 1) - offset;
+				const U32 w = U32_max(bmp.w >> i, 1), h = U32_max(bmp.h >> i, 1);
+
+				Buffer level = Buffer_createRefConst(asset->mips.ptr + offset, size);
+
+				if(asset->type == EAssetType_BMPAsBC7) {
+					gotoIfError3(clean, BCEncoder_encodex(EBCFormat_BC7, level, w, h, isBGRA, &blocks, e_rr))
+					level = blocks;
+				}
+
+				gotoIfError2(clean, ListSubResourceData_pushBackx(&asset->ddsData, (SubResourceData) { .data = level }))
+				blocks = Buffer_createNull();
+			}
+
+			//The uncompressed mips aren't needed anymore after compression
+
+			if(asset->type == EAssetType_BMPAsBC7) {
+
+				Buffer_freex(&asset->mips);
+
+				if(CharString_length(asset->cachePath) && !DDS_writex(asset->ddsData, asset->ddsInfo, &written).genericError)
+					File_writex(written, asset->cachePath, 0, 0, U64_MAX, false, NULL);
+			}
+		}
+
+		Buffer_freex(&asset->bmpData);
+	}
+
+	else gotoIfError2(clean, DDS_readx(asset->file, &asset->ddsInfo, &asset->ddsData))
+
+	if(asset->type == EAssetType_DDS && CharString_length(asset->writePath)) {
+		gotoIfError2(clean, DDS_writex(asset->ddsData, asset->ddsInfo, &written))
+		gotoIfError3(clean, File_writex(written, asset->writePath, 0, 0, U64_MAX, false, e_rr))
+	}
+
+	asset->stagingSize = Buffer_length(asset->mips);
+
+	for(U64 i = 0; i < asset->ddsData.length; ++i)
+		if(!Buffer_isRef(asset->ddsData.ptr[i].data))
+			asset->stagingSize += Buffer_length(asset->ddsData.ptr[i].data);
+
+clean:
+	Buffer_freex(&blocks);
+	Buffer_freex(&written);
+	return s_uccess;
+}
+
+static void AssetLoader_addStaged(AssetLoader *loader, I64 bytes) {
+
+	const I64 staged = AtomicI64_add(&loader->stagedBytes, bytes) + bytes;
+
+	for(I64 peak = AtomicI64_load(&loader->peakStaged); staged > peak; )
+		peak = AtomicI64_cmpStore(&loader->peakStaged, peak, staged);
+}
+
+static void AssetLoader_work(void *userData) {
+
+	AssetLoader *loader = (AssetLoader*) userData;
+
+	while(!AtomicI64_load(&loader->stop)) {
+
+		//Wait for the main thread to release staging memory; but always allow progress if nothing is staged
+
+		const I64 staged = AtomicI64_load(&loader->stagedBytes);
+
+		if(staged && (U64) staged >= loader->stagingBudget) {
+			Thread_sleep(MS);
+			continue;
+		}
+
+		const I64 id = AtomicI64_inc(&loader->nextAsset) - 1;
+
+		if((U64) id >= loader->assetCount)
+			return;
+
+		Asset *asset = &loader->assets[id];
+		AtomicI64_store(&asset->state, EAssetState_Loading);
+
+		Error err = Error_none();
+		const Bool loaded = Asset_loadx(asset, loader->mipFilter, &err);
+
+		//A BC7 cache hit keeps the cache file alive too, its mips reference it
+
+		const U64 fileSize = Buffer_length(asset->file) + Buffer_length(asset->cacheFile);
+
+		asset->error = err;
+		AtomicI64_add(&loader->bytesRead, (I64) fileSize);
+		AtomicI64_add(&loader->bytesDecoded, (I64) asset->stagingSize);
+
+		asset->stagingSize += fileSize;
+		AssetLoader_addStaged(loader, (I64) asset->stagingSize);
+		AtomicI64_store(&asset->state, loaded ? EAssetState_Ready : EAssetState_Failed);
+	}
+}
+
+Bool AssetLoader_startx(AssetLoader *loader, U64 threadCount, U64 stagingBudget, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!loader)
+		retError(clean, Error_nullPointer(0, "AssetLoader_startx()::loader is required"))
+
+	if(loader->threadCount)
+		retError(clean, Error_invalidState(0, "AssetLoader_startx() was already called"))
+
+	loader->stagingBudget = stagingBudget;
+	threadCount = U64_min(U64_max(threadCount, 1), U64_min(AssetLoader_maxThreads, U64_max(loader->assetCount, 1)));
+
+	for(U64 i = 0; i < threadCount; ++i) {
+		gotoIfError2(clean, Thread_createx(AssetLoader_work, loader, &loader->threads[i]))
+		++loader->threadCount;
+	}
+
+clean:
+	return s_uccess;
+}
+
+Asset *AssetLoader_poll(AssetLoader *loader) {
+
+	if(!loader || loader->nextPoll >= loader->assetCount)
+		return NULL;
+
+	Asset *asset = &loader->assets[loader->nextPoll];
+	const I64 state = AtomicI64_load(&asset->state);
+
+	if(state != EAssetState_Ready && state != EAssetState_Failed)
+		return NULL;
+
+	++loader->nextPoll;
+	return asset;
+}
+
+static void Asset_freex(Asset *asset) {
+	ListSubResourceData_freeAllx(&asset->ddsData);
+	Buffer_freex(&asset->mips);
+	Buffer_freex(&asset->bmpData);
+	Buffer_freex(&asset->cacheFile);
+	Buffer_freex(&asset->file);
+	CharString_freex(&asset->cachePath);
+}
+
+void AssetLoader_releasex(AssetLoader *loader, Asset *asset) {
+
+	if(!loader || !asset || AtomicI64_load(&asset->state) == EAssetState_Released)
+		return;
+
+	Asset_freex(asset);
+	AssetLoader_addStaged(loader, -(I64) asset->stagingSize);
+	AtomicI64_store(&asset->state, EAssetState_Released);
+}
+
+Bool AssetLoader_isDone(const AssetLoader *loader) {
+	return !loader || loader->nextPoll >= loader->assetCount;
+}
+
+void AssetLoader_addUploaded(AssetLoader *loader, U64 bytes) {
+	if(loader)
+		loader->bytesUploaded += bytes;
+}
+
+AssetLoaderStats AssetLoader_getStats(AssetLoader *loader) {
+
+	if(!loader)
+		return (AssetLoaderStats) { 0 };
+
+	return (AssetLoaderStats) {
+		.bytesRead = (U64) AtomicI64_load(&loader->bytesRead),
+		.bytesDecoded = (U64) AtomicI64_load(&loader->bytesDecoded),
+		.bytesUploaded = loader->bytesUploaded,
+		.peakStaged = (U64) AtomicI64_load(&loader->peakStaged)
+	};
+}
+
+void AssetLoader_freex(AssetLoader *loader) {
+
+	if(!loader)
+		return;
+
+	AtomicI64_store(&loader->stop, 1);
+
+	for(U64 i = 0; i < loader->threadCount; ++i)
+		Thread_waitAndCleanupx(&loader->threads[i]);
+
+	for(U64 i = 0; i < loader->assetCount; ++i)
+		Asset_freex(&loader->assets[i]);
+
+	*loader = (AssetLoader) { 0 };
+}
@@ -0,0 +1,136 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#pragma once
+#include "types/base/atomic.h"
+#include "platforms/thread.h"
+#include "types/container/buffer.h"
+#include "types/container/string.h"
+#include "formats/bmp/bmp.h"
+#include "formats/dds/dds.h"
+#include "mip_generator.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Loads and decodes assets on worker threads, so startup doesn't wait for file I/O and decoding.
+//Assets are queued before AssetLoader_startx; the main thread then polls for finished assets each frame,
+//uploads them and releases their staging memory.
+//The staging budget is soft: workers don't start a new asset while the decoded (but not released) assets exceed it,
+//so at most one asset per worker can overshoot it.
+
+//BMPs don't have mips, so they're generated on load (see MipGenerator) and output like a DDS with a full mip chain.
+
+typedef enum EAssetType {
+	EAssetType_BMP,
+	EAssetType_DDS,
+	EAssetType_BMPAsBC7				//Every mip is compressed on load (see BCEncoder); writePath is the cache
+} EAssetType;
+
+typedef enum EAssetState {
+	EAssetState_Queued,
+	EAssetState_Loading,
+	EAssetState_Ready,				//Decoded, waiting for the main thread
+	EAssetState_Failed,
+	EAssetState_Released
+} EAssetState;
+
+typedef struct Asset {
+
+	CharString path;
+	CharString writePath;			//DDS: if not null, written back here after decoding (to test the writer)
+									//BMPAsBC7: if not null, cache path (without extension) of the compressed DDS
+	CharString cachePath;
+
+	EAssetType type;
+	AtomicI64 state;				//EAssetState
+
+	U64 stagingSize;				//Files and any decoded data that had to be copied out of them
+
+	Buffer file;					//Kept until released, decoded data might reference it
+	Buffer cacheFile;				//BMPAsBC7 cache hit: kept until released, ddsData references it
+
+	BMPInfo bmpInfo;
+	Buffer bmpData;					//Freed once the mips are generated
+	Buffer mips;					//BMP: generated mip chain, ddsData references it
+
+	DDSInfo ddsInfo;
+	ListSubResourceData ddsData;
+
+	Error error;					//If state is Failed
+
+} Asset;
+
+//Bytes copied while ingesting assets, to see where memory and bandwidth go
+
+typedef struct AssetLoaderStats {
+	U64 bytesRead;					//Copied out of the files (including the BC7 cache)
+	U64 bytesDecoded;				//Copied by the decoders (decoded data that doesn't reference the file)
+	U64 bytesUploaded;				//Copied into staging by the main thread (see AssetLoader_addUploaded)
+	U64 peakStaged;					//High water mark of the staging memory held by the loader
+} AssetLoaderStats;
+
+#define AssetLoader_maxAssets 16
+#define AssetLoader_maxThreads 4
+
+typedef struct AssetLoader {
+
+	Asset assets[AssetLoader_maxAssets];
+	U64 assetCount;
+
+	U64 stagingBudget;
+	EMipFilter mipFilter;			//Used to generate the mips of BMPs; set before AssetLoader_startx
+	AtomicI64 nextAsset, stagedBytes, stop;
+	AtomicI64 bytesRead, bytesDecoded, peakStaged;
+	U64 bytesUploaded;
+
+	Thread *threads[AssetLoader_maxThreads];
+	U64 threadCount;
+
+	U64 nextPoll;					//Assets are handed to the main thread in order
+
+} AssetLoader;
+
+//path (and writePath) have to stay alive until the loader is freed
+
+Bool AssetLoader_add(AssetLoader *loader, CharString path, EAssetType type, CharString writePath, U64 *id, Error *e_rr);
+
+//Spawns up to threadCount workers (clamped to [1, AssetLoader_maxThreads])
+
+Bool AssetLoader_startx(AssetLoader *loader, U64 threadCount, U64 stagingBudget, Error *e_rr);
+
+//Returns the next asset that's ready or failed (in queue order) or NULL if it's still loading.
+//Has to be released after use.
+
+Asset *AssetLoader_poll(AssetLoader *loader);
+void AssetLoader_releasex(AssetLoader *loader, Asset *asset);
+
+Bool AssetLoader_isDone(const AssetLoader *loader);		//All assets have been polled
+
+void AssetLoader_addUploaded(AssetLoader *loader, U64 bytes);
+AssetLoaderStats AssetLoader_getStats(AssetLoader *loader);
+
+//Stops and joins the workers (the asset being decoded is finished first) and frees all staging memory
+
+void AssetLoader_freex(AssetLoader *loader);
+
+#ifdef __cplusplus
+	}
+#endif
@@ -20,6 +20,7 @@
 */
 
 #include "atmos_helper.h"
+#include "parallel.h"
 #include "types/base/time.h"
 #include "types/math/math.h"
 
@@ -106,3 +107,151 @@ F32x4 AtmosHelper_getSunDir(F64 JD, F32x2 longitudeLatitudeDeg) {
 F32x4 AtmosHelper_getSunPos(F64 JD, F32x2 longitudeLatitudeDeg) {
 	return AtmosHelper_getSunPosInternal(JD, longitudeLatitudeDeg, AtmosHelper_au);
 }
+
+//Batched
+
+void AtmosHelper_getJulianDateBatch(const Ns *time, F64 *JD, U64 count) {
+
+	//1970-01-01 is JD 2440587.5, +65s like the scalar version
+
+	for(U64 i = 0; i < count; ++i)
+		JD[i] = 2440587.5 + (time[i] / SECOND + 65 + (time[i] % SECOND) / (F64)SECOND) / 86400;
+}
+
+//sin(2pi * turns); folded to [-1/4, 1/4] turns and then approximated by an 11th order polynomial
+
+static F32x4 AtmosHelper_sinTurns(F32x4 turns) {
+
+	const F32x4 t = F32x4_sub(turns, F32x4_round(turns));											//[-1/2, 1/2]
+	const F32x4 a = F32x4_abs(t);
+	const F32x4 folded = F32x4_mul(F32x4_min(a, F32x4_sub(F32x4_xxxx4(0.5f), a)), F32x4_sign(t));	//[-1/4, 1/4]
+
+	const F32x4 x = F32x4_mul(folded, F32x4_xxxx4(2 * F32_PI));
+	const F32x4 x2 = F32x4_mul(x, x);
+
+	F32x4 poly = F32x4_xxxx4(-1 / 39916800.f);
+	poly = F32x4_add(F32x4_mul(poly, x2), F32x4_xxxx4(1 / 362880.f));
+	poly = F32x4_add(F32x4_mul(poly, x2), F32x4_xxxx4(-1 / 5040.f));
+	poly = F32x4_add(F32x4_mul(poly, x2), F32x4_xxxx4(1 / 120.f));
+	poly = F32x4_add(F32x4_mul(poly, x2), F32x4_xxxx4(-1 / 6.f));
+	poly = F32x4_add(F32x4_mul(poly, x2), F32x4_one());
+
+	return F32x4_mul(poly, x);
+}
+
+static F32x4 AtmosHelper_cosTurns(F32x4 turns) {
+	return AtmosHelper_sinTurns(F32x4_add(turns, F32x4_xxxx4(0.25f)));
+}
+
+static F32 AtmosHelper_fractF64(F64 v) {
+	return (F32) F64_fract(v);
+}
+
+//Same math as AtmosHelper_getSunPosInternal, but using:
+//sin(pi/2 - asin(x)) = sqrt(1 - x^2), cos(pi/2 - asin(x)) = x,
+//cos(atan(n / d)) = |d| / sqrt(n^2 + d^2), sin(atan(n / d)) = n * sign(d) / sqrt(n^2 + d^2)
+
+static void AtmosHelper_getSunDir4(const AtmosHelperSunBatch *batch, U64 i, U64 count) {
+
+	F32 dayTurns[4] = { 0 }, eqTurns0[4] = { 0 }, eqTurns1[4] = { 0 }, declinationTurns[4] = { 0 };
+	F32 longitude[4] = { 0 }, latitude[4] = { 0 };
+
+	//Reduce JD to turns while it's still F64; F32 can't even represent the time of day at this magnitude
+
+	for(U64 j = 0; j < count; ++j) {
+
+		const F64 JD = batch->JD[i + j];
+
+		dayTurns[j] = AtmosHelper_fractF64(JD - .5);
+		eqTurns0[j] = AtmosHelper_fractF64(2 * (JD - 80) / 373);
+		eqTurns1[j] = AtmosHelper_fractF64((JD - 8) / 355);
+		declinationTurns[j] = AtmosHelper_fractF64((JD - 81) / 368);
+
+		longitude[j] = batch->longitudeDeg[i + j];
+		latitude[j] = batch->latitudeDeg[i + j];
+	}
+
+	const F32x4 longitudeRad = F32x4_mul(F32x4_load4(longitude), F32x4_xxxx4(F32_DEG_TO_RAD));
+	const F32x4 latitudeTurns = F32x4_mul(F32x4_load4(latitude), F32x4_xxxx4(1 / 360.f));
+
+	//Solar time in hours
+
+	F32x4 solarTime = F32x4_mul(F32x4_load4(dayTurns), F32x4_xxxx4(24));
+	solarTime = F32x4_add(solarTime, F32x4_mul(AtmosHelper_sinTurns(F32x4_load4(eqTurns0)), F32x4_xxxx4(0.17f)));
+	solarTime = F32x4_add(solarTime, F32x4_mul(AtmosHelper_sinTurns(F32x4_load4(eqTurns1)), F32x4_xxxx4(-0.129f)));
+	solarTime = F32x4_sub(solarTime, F32x4_mul(longitudeRad, F32x4_xxxx4(12 / F32_PI)));
+
+	const F32x4 hourTurns = F32x4_mul(solarTime, F32x4_xxxx4(1 / 24.f));
+
+	const F32x4 declination = F32x4_mul(AtmosHelper_sinTurns(F32x4_load4(declinationTurns)), F32x4_xxxx4(0.4093f));
+	const F32x4 declinationTurns4 = F32x4_mul(declination, F32x4_xxxx4(1 / (2 * F32_PI)));
+
+	const F32x4 sinLat = AtmosHelper_sinTurns(latitudeTurns), cosLat = AtmosHelper_cosTurns(latitudeTurns);
+	const F32x4 sinDec = AtmosHelper_sinTurns(declinationTurns4), cosDec = AtmosHelper_cosTurns(declinationTurns4);
+	const F32x4 sinHour = AtmosHelper_sinTurns(hourTurns), cosHour = AtmosHelper_cosTurns(hourTurns);
+
+	const F32x4 cosDecCosHour = F32x4_mul(cosDec, cosHour);
+
+	//Azimuth = pi/2 - asin(x)
+
+	const F32x4 x = F32x4_clamp(
+		F32x4_sub(F32x4_mul(sinLat, sinDec), F32x4_mul(cosLat, cosDecCosHour)), F32x4_xxxx4(-1), F32x4_one()
+	);
+
+	const F32x4 sinAzimuth = F32x4_sqrt(F32x4_mul(F32x4_sub(F32x4_one(), x), F32x4_add(F32x4_one(), x)));
+	const F32x4 cosAzimuth = x;
+
+	//Altitude = atan(n / d)
+
+	const F32x4 n = F32x4_negate(F32x4_mul(cosDec, sinHour));
+	const F32x4 d = F32x4_sub(F32x4_mul(cosLat, sinDec), F32x4_mul(sinLat, cosDecCosHour));
+
+	const F32x4 invLen = F32x4_div(F32x4_one(), F32x4_sqrt(F32x4_add(F32x4_mul(n, n), F32x4_mul(d, d))));
+	const F32x4 dSign = F32x4_sub(F32x4_one(), F32x4_mul(F32x4_lt(d, F32x4_zero()), F32x4_xxxx4(2)));
+
+	const F32x4 cosAltitude = F32x4_mul(F32x4_abs(d), invLen);
+	const F32x4 sinAltitude = F32x4_mul(F32x4_mul(n, dSign), invLen);
+
+	const F32x4 dirX = F32x4_mul(cosAltitude, sinAzimuth);
+	const F32x4 dirY = F32x4_mul(cosAltitude, cosAzimuth);
+
+	for(U64 j = 0; j < count; ++j) {
+		batch->dirX[i + j] = F32x4_get(dirX, (U8) j);
+		batch->dirY[i + j] = F32x4_get(dirY, (U8) j);
+		batch->dirZ[i + j] = F32x4_get(sinAltitude, (U8) j);
+	}
+}
+
+static void AtmosHelper_getSunDirChunk(void *userData, U64 jobId, U64 threadId) {
+
+	(void) threadId;
+
+	const AtmosHelperSunBatch *batch = (const AtmosHelperSunBatch*) userData;
+
+	const U64 first = jobId * AtmosHelper_batchChunk;
+	const U64 last = U64_min(first + AtmosHelper_batchChunk, batch->count);
+
+	for(U64 i = first; i < last; i += 4)
+		AtmosHelper_getSunDir4(batch, i, U64_min(last - i, 4));
+}
+
+Bool AtmosHelper_getSunDirBatch(AtmosHelperSunBatch batch, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!batch.count)
+		goto clean;
+
+	if(
+		!batch.JD || !batch.longitudeDeg || !batch.latitudeDeg ||
+		!batch.dirX || !batch.dirY || !batch.dirZ
+	)
+		retError(clean, Error_nullPointer(0, "AtmosHelper_getSunDirBatch()::batch inputs and outputs are required"))
+
+	gotoIfError3(clean, Parallel_for(
+		(batch.count + AtmosHelper_batchChunk - 1) / AtmosHelper_batchChunk, AtmosHelper_getSunDirChunk, &batch, e_rr
+	))
+
+clean:
+	return s_uccess;
+}
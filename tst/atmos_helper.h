@@ -20,6 +20,7 @@
 
 #pragma once
 #include "types/math/vec.h"
+#include "types/base/error.h"
 
 #ifdef __cplusplus
 	extern "C" {
@@ -37,6 +38,30 @@ F32 AtmosHelper_getSolarTime(F64 JD, F32 hoursGmt, F32 longitudeRad);
 F32x4 AtmosHelper_getSunDir(F64 JD, F32x2 longitudeLatitudeDeg);
 F32x4 AtmosHelper_getSunPos(F64 JD, F32x2 longitudeLatitudeDeg);
 
+//Batched versions for sun tracks over many timestamps and locations (SoA, every element has its own JD and location).
+//Evaluated 4 at a time with F32x4 and split across threads. Only JD needs F64 (to get the time of day),
+//asin and atan are replaced by identities, so the only transcendental left is a polynomial sin.
+//Directions are within a few hundredths of a degree of AtmosHelper_getSunDir; both are limited by F32 where the azimuth's asin is steep.
+
+#define AtmosHelper_batchChunk (16 * 1024)
+
+typedef struct AtmosHelperSunBatch {
+
+	const F64 *JD;
+	const F32 *longitudeDeg, *latitudeDeg;
+
+	F32 *dirX, *dirY, *dirZ;
+
+	U64 count;
+
+} AtmosHelperSunBatch;
+
+Bool AtmosHelper_getSunDirBatch(AtmosHelperSunBatch batch, Error *e_rr);
+
+//Same as AtmosHelper_getJulianDate, but straight from the timestamp instead of going through Time_getDate
+
+void AtmosHelper_getJulianDateBatch(const Ns *time, F64 *JD, U64 count);
+
 #ifdef __cplusplus
 	}
 #endif
@@ -0,0 +1,495 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "atmosphere.h"
+#include "types/math/math.h"
+
+Atmosphere Atmosphere_earth(F32x4 sunDir) {
+
+	Atmosphere a = (Atmosphere) { 0 };
+
+	a.raySamples = 16;
+	a.lightSamples = 8;
+	a.rayOffset = a.lightOffset = 0.5f;
+	a.planetRadius = 6371000;
+	a.atmosphereRadius = a.planetRadius + 80000;
+
+	const F32 sunSolidAngle = 0.0000711f;												//In steradian
+
+	a.sunRadianceLux = F32x4_mul(F32x4_create3(255, 244, 234), F32x4_xxxx4(120000.f / 255));	//5900K at 120k lux
+	a.sunRadianceNits = F32x4_div(a.sunRadianceLux, F32x4_xxxx4(sunSolidAngle));
+
+	a.sunDir = sunDir;
+
+	a.ozoneCoefficient = F32x4_mul(F32x4_create3(3.426f, 8.298f, 0.356f), F32x4_xxxx4(6e-7f));
+
+	a.rayleigh.scaleHeight = 8000;
+	a.rayleigh.coefficient = F32x4_create3(5.8e-6f, 1.35e-5f, 3.31e-5f);
+
+	a.mie.scaleHeight = 1200;
+	a.mie.coefficient = F32x4_create3(2.1e-6f, 2.1e-6f, 2.1e-6f);
+
+	return a;
+}
+
+static F64 Atmosphere_interleavedGradientNoise(F64 x, F64 y) {
+	return F64_fract(52.9829189 * F64_fract(0.06711056 * x + 0.00583715 * y));
+}
+
+F32x2 Atmosphere_getSampleOffsets(U32 x, U32 y, U32 frameId) {
+
+	//Light offsets use the noise of a pixel further away, so they aren't correlated with the ray offsets
+
+	const F64 frame = frameId & 1023;
+
+	return F32x2_create2(
+		(F32) F64_fract(Atmosphere_interleavedGradientNoise(x, y) + frame * 0.7548776662),
+		(F32) F64_fract(Atmosphere_interleavedGradientNoise(x + 47., y + 17.) + frame * 0.5698402910)
+	);
+}
+
+F32 Atmosphere_getDensity(const Atmosphere *atmos, F32x4 pos, F32 rayLen, AtmosphereScatteringType type) {
+
+	const F32 dist = F32_sqrt(F32x4_dot3(pos, pos)) - atmos->planetRadius;
+
+	if(dist <= 0)
+		return 0;
+
+	return rayLen * F32_expe(-dist / type.scaleHeight);
+}
+
+F32 Atmosphere_rayleighPhaseFunction(F32 LoV) {
+	return 3.f / (16 * F32_PI) * (1 + LoV * LoV);
+}
+
+F32 Atmosphere_miePhaseFunction(F32 LoV) {
+	const F32 g = 0.76f, g2 = g * g;		//Anisotropy
+	return 3.f / (8 * F32_PI) * (1 - g2) * (1 + LoV * LoV) / ((2 + g2) * F32_pow(1 + g2 - 2 * g * LoV, 1.5f));
+}
+
+F32 Atmosphere_getSampleT(F32 start, F32 length, U32 i, U32 samples, F32 offset, Bool quadraticSamples, F32 *step) {
+
+	if(!quadraticSamples) {
+		*step = length / samples;
+		return start + *step * (i + offset);
+	}
+
+	const F32 s = (i + offset) / samples;
+	*step = length * (2 * s / samples);
+	return start + length * (s * s);
+}
+
+Bool Atmosphere_getOpticalDepthLight(const Atmosphere *atmos, F32x4 pos, F32 *rayleighDepth, F32 *mieDepth) {
+
+	*rayleighDepth = *mieDepth = 0;
+
+	//Intersect atmos
+
+	const RayDesc ray = RayDesc_create(pos, 0, F32x4_negate(atmos->sunDir), 1e38f);
+	const Sphere sphere = Sphere_create(F32x4_zero(), atmos->atmosphereRadius);
+
+	F32x4 intersections; Bool isBackside;
+	if(!Sphere_intersects(sphere, ray, &intersections, &isBackside))
+		return false;
+
+	//Step through only the atmos (nothing before or after)
+
+	const F32 start = F32x4_y(intersections);
+	const F32 diff = F32x4_z(intersections) - start;
+
+	U32 i = 0;
+
+	for(; i < atmos->lightSamples; ++i) {
+
+		F32 step;
+		const F32 t = Atmosphere_getSampleT(
+			start, diff, i, atmos->lightSamples, atmos->lightOffset, atmos->quadraticSamples, &step
+		);
+
+		const F32x4 samplePos = RayDesc_posOnRay(ray, t);
+
+		*rayleighDepth += Atmosphere_getDensity(atmos, samplePos, step, atmos->rayleigh);
+		*mieDepth += Atmosphere_getDensity(atmos, samplePos, step, atmos->mie);
+	}
+
+	return i == atmos->lightSamples;
+}
+
+F32x4 Atmosphere_getSunContribution(const Atmosphere *atmos, F32x4 nrm) {
+	const F32 NoL = F32_saturate(-F32x4_dot3(nrm, atmos->sunDir));
+	return F32x4_mul(atmos->sunRadianceLux, F32x4_xxxx4(NoL / F32_PI));
+}
+
+F32x4 Atmosphere_getContribution(const Atmosphere *atmos, RayDesc ray) {
+
+	//Same as the shader; place the camera 10m above the planet's surface
+
+	ray.origin = F32x4_add(ray.origin, F32x4_create3(0, atmos->planetRadius + 10, 0));
+
+	//Get start and end intersection
+
+	F32x4 intersections; Bool isBackside;
+
+	if(Sphere_intersects(Sphere_create(F32x4_zero(), atmos->planetRadius), ray, &intersections, &isBackside))
+		ray.maxT = F32x4_x(intersections);
+
+	const F32x4 earthNrm = F32x4_normalize3(RayDesc_posOnRay(ray, ray.maxT));
+	const F32x4 earthShading = Atmosphere_getSunContribution(atmos, earthNrm);
+
+	if(!Sphere_intersects(Sphere_create(F32x4_zero(), atmos->atmosphereRadius), ray, &intersections, &isBackside))
+		return earthShading;
+
+	const F32 start = F32x4_y(intersections);
+	const F32 diff = F32x4_z(intersections) - start;
+
+	//Raymarch through the start + end regions
+
+	F32x4 sumRayleigh = F32x4_zero(), sumMie = F32x4_zero();
+	F32 depthRayleigh = 0, depthMie = 0;
+	F32 prevT = start, prevRayleigh = 0, prevMie = 0;
+
+	const F32x4 rayleighOzone = F32x4_add(atmos->rayleigh.coefficient, atmos->ozoneCoefficient);
+	const F32x4 mieExtinction = F32x4_mul(atmos->mie.coefficient, F32x4_xxxx4(1.11f));
+
+	for(U32 i = 0; i < atmos->raySamples; ++i) {
+
+		F32 step;
+		const F32 t = Atmosphere_getSampleT(
+			start, diff, i, atmos->raySamples, atmos->rayOffset, atmos->quadraticSamples, &step
+		);
+
+		const F32x4 pos = RayDesc_posOnRay(ray, t);
+
+		const F32 rayleigh = Atmosphere_getDensity(atmos, pos, 1, atmos->rayleigh);		//Per meter
+		const F32 mie = Atmosphere_getDensity(atmos, pos, 1, atmos->mie);
+
+		const F32 densityRayleigh = rayleigh * step;
+		const F32 densityMie = mie * step;
+
+		//Optical depth to the sample: its whole step, or a trapezoid from the previous sample (or the start)
+
+		if(!atmos->quadraticSamples) {
+			depthRayleigh += densityRayleigh;
+			depthMie += densityMie;
+		}
+
+		else {
+
+			depthRayleigh += (rayleigh + (i ? prevRayleigh : rayleigh)) * 0.5f * (t - prevT);
+			depthMie += (mie + (i ? prevMie : mie)) * 0.5f * (t - prevT);
+
+			prevT = t;
+			prevRayleigh = rayleigh;
+			prevMie = mie;
+		}
+
+		F32 depthLightRayleigh, depthLightMie;
+
+		if(!Atmosphere_getOpticalDepthLight(atmos, pos, &depthLightRayleigh, &depthLightMie))
+			continue;
+
+		const F32x4 tau = F32x4_add(
+			F32x4_mul(rayleighOzone, F32x4_xxxx4(depthLightRayleigh + depthRayleigh)),
+			F32x4_mul(mieExtinction, F32x4_xxxx4(depthLightMie + depthMie))
+		);
+
+		const F32x4 atten = F32x4_create3(
+			F32_expe(-F32x4_x(tau)), F32_expe(-F32x4_y(tau)), F32_expe(-F32x4_z(tau))
+		);
+
+		sumRayleigh = F32x4_add(sumRayleigh, F32x4_mul(atten, F32x4_xxxx4(densityRayleigh)));
+		sumMie = F32x4_add(sumMie, F32x4_mul(atten, F32x4_xxxx4(densityMie)));
+	}
+
+	const F32 LoV = F32_saturate(-F32x4_dot3(ray.dir, atmos->sunDir));
+
+	const F32x4 rayleighContrib = F32x4_mul(
+		F32x4_mul(sumRayleigh, atmos->rayleigh.coefficient), F32x4_xxxx4(Atmosphere_rayleighPhaseFunction(LoV))
+	);
+
+	const F32x4 mieContrib = F32x4_mul(
+		F32x4_mul(sumMie, atmos->mie.coefficient), F32x4_xxxx4(Atmosphere_miePhaseFunction(LoV))
+	);
+
+	return F32x4_mul(F32x4_mul(F32x4_add(rayleighContrib, mieContrib), atmos->sunRadianceLux), F32x4_xxxx4(1 / F32_PI));
+}
+
+//Packet version; every F32x4 below holds one value for each of the 4 rays
+
+//e^x for x <= 0 (larger x is clamped): 2^round(x / ln(2)) is built from the exponent bits and the remainder is a Taylor
+//series, relative error < 2e-7. Below e^-87 (2^-126) it returns ~1e-38 instead of a denormal like F32_expe.
+
+static F32x4 Atmosphere_exp4(F32x4 x) {
+
+	const F32x4 t = F32x4_clamp(F32x4_mul(x, F32x4_xxxx4(1.44269504f)), F32x4_xxxx4(-126), F32x4_zero());
+	const F32x4 n = F32x4_round(t);
+	const F32x4 f = F32x4_mul(F32x4_sub(t, n), F32x4_xxxx4(0.693147181f));		//In [-ln(2) / 2, ln(2) / 2]
+
+	F32x4 p = F32x4_xxxx4(1 / 720.f);
+	p = F32x4_add(F32x4_mul(p, f), F32x4_xxxx4(1 / 120.f));
+	p = F32x4_add(F32x4_mul(p, f), F32x4_xxxx4(1 / 24.f));
+	p = F32x4_add(F32x4_mul(p, f), F32x4_xxxx4(1 / 6.f));
+	p = F32x4_add(F32x4_mul(p, f), F32x4_xxxx4(0.5f));
+	p = F32x4_add(F32x4_mul(p, f), F32x4_one());
+	p = F32x4_add(F32x4_mul(p, f), F32x4_one());
+
+	F32x4 scale = F32x4_zero();
+
+	for(U8 i = 0; i < 4; ++i) {
+		const union { U32 bits; F32 value; } pow2 = { .bits = (U32)(127 + (I32) F32x4_get(n, i)) << 23 };
+		F32x4_set(&scale, i, pow2.value);
+	}
+
+	return F32x4_mul(p, scale);
+}
+
+//1 if x > 0, otherwise 0 (without branching per lane)
+
+static F32x4 Atmosphere_isPositive4(F32x4 x) {
+	return F32x4_clamp(F32x4_mul(x, F32x4_xxxx4(1e30f)), F32x4_zero(), F32x4_one());
+}
+
+//Atmosphere_getDensity for 4 positions
+
+static F32x4 Atmosphere_getDensity4(
+	const Atmosphere *atmos, F32x4 len, F32x4 rayLen, AtmosphereScatteringType type
+) {
+	const F32x4 dist = F32x4_sub(len, F32x4_xxxx4(atmos->planetRadius));
+	const F32x4 density = Atmosphere_exp4(F32x4_div(F32x4_negate(dist), F32x4_xxxx4(type.scaleHeight)));
+	return F32x4_mul(F32x4_mul(rayLen, density), Atmosphere_isPositive4(dist));
+}
+
+static F32x4 Atmosphere_length4(F32x4 x, F32x4 y, F32x4 z) {
+	return F32x4_sqrt(F32x4_add(F32x4_add(F32x4_mul(x, x), F32x4_mul(y, y)), F32x4_mul(z, z)));
+}
+
+//Atmosphere_getSampleT for 4 rays
+
+static F32x4 Atmosphere_getSampleT4(
+	F32x4 start, F32x4 length, U32 i, U32 samples, F32 offset, Bool quadraticSamples, F32x4 *step
+) {
+
+	if(!quadraticSamples) {
+		*step = F32x4_div(length, F32x4_xxxx4((F32) samples));
+		return F32x4_add(start, F32x4_mul(*step, F32x4_xxxx4(i + offset)));
+	}
+
+	const F32 s = (i + offset) / samples;
+	*step = F32x4_mul(length, F32x4_xxxx4(2 * s / samples));
+	return F32x4_add(start, F32x4_mul(length, F32x4_xxxx4(s * s)));
+}
+
+//Atmosphere_getOpticalDepthLight for 4 positions; lanes that don't intersect the atmosphere are 0 in the mask
+
+static U8 Atmosphere_getOpticalDepthLight4(
+	const Atmosphere *atmos, F32x4 posX, F32x4 posY, F32x4 posZ, F32x4 *rayleighDepth, F32x4 *mieDepth
+) {
+
+	const F32x4 lightDir = F32x4_negate(atmos->sunDir);
+
+	const RayDesc4 rays = (RayDesc4) {
+		.originX = posX, .originY = posY, .originZ = posZ,
+		.dirX = F32x4_xxxx4(F32x4_x(lightDir)),
+		.dirY = F32x4_xxxx4(F32x4_y(lightDir)),
+		.dirZ = F32x4_xxxx4(F32x4_z(lightDir)),
+		.minT = F32x4_zero(),
+		.maxT = F32x4_xxxx4(1e38f)
+	};
+
+	*rayleighDepth = *mieDepth = F32x4_zero();
+
+	F32x4 intersections[3]; U8 isBackface;
+	const U8 mask = Sphere_intersects4(Sphere_create(F32x4_zero(), atmos->atmosphereRadius), &rays, intersections, &isBackface);
+
+	if(!mask)
+		return 0;
+
+	const F32x4 start = intersections[1];
+	const F32x4 diff = F32x4_sub(intersections[2], start);
+
+	for(U32 i = 0; i < atmos->lightSamples; ++i) {
+
+		F32x4 step;
+		const F32x4 t = Atmosphere_getSampleT4(
+			start, diff, i, atmos->lightSamples, atmos->lightOffset, atmos->quadraticSamples, &step
+		);
+
+		const F32x4 len = Atmosphere_length4(
+			F32x4_add(posX, F32x4_mul(rays.dirX, t)),
+			F32x4_add(posY, F32x4_mul(rays.dirY, t)),
+			F32x4_add(posZ, F32x4_mul(rays.dirZ, t))
+		);
+
+		*rayleighDepth = F32x4_add(*rayleighDepth, Atmosphere_getDensity4(atmos, len, step, atmos->rayleigh));
+		*mieDepth = F32x4_add(*mieDepth, Atmosphere_getDensity4(atmos, len, step, atmos->mie));
+	}
+
+	return mask;
+}
+
+//1 for lanes that are set in the mask, otherwise 0
+
+static F32x4 Atmosphere_maskToF32x4(U8 mask) {
+	return F32x4_create4(mask & 1 ? 1.f : 0, mask & 2 ? 1.f : 0, mask & 4 ? 1.f : 0, mask & 8 ? 1.f : 0);
+}
+
+void Atmosphere_getContribution4(const Atmosphere *atmos, const RayDesc4 *rays, F32x4 result[4]) {
+
+	RayDesc4 ray = *rays;
+	ray.originY = F32x4_add(ray.originY, F32x4_xxxx4(atmos->planetRadius + 10));
+
+	//Get start and end intersection; rays that hit the planet stop there
+
+	F32x4 intersections[3]; U8 isBackface;
+
+	const U8 planetMask = Sphere_intersects4(
+		Sphere_create(F32x4_zero(), atmos->planetRadius), &ray, intersections, &isBackface
+	);
+
+	for(U8 i = 0; i < 4; ++i)
+		if(planetMask & (1 << i))
+			F32x4_set(&ray.maxT, i, F32x4_get(intersections[0], i));
+
+	const U8 mask = Sphere_intersects4(
+		Sphere_create(F32x4_zero(), atmos->atmosphereRadius), &ray, intersections, &isBackface
+	);
+
+	//Lanes that don't go through the atmosphere only see the planet's shading
+
+	for(U8 i = 0; i < 4; ++i)
+		if(!(mask & (1 << i))) {
+			const RayDesc lane = RayDesc4_get(&ray, i);
+			result[i] = Atmosphere_getSunContribution(atmos, F32x4_normalize3(RayDesc_posOnRay(lane, lane.maxT)));
+		}
+
+	if(!mask)
+		return;
+
+	//Raymarch through the start + end regions; lanes that missed march an empty range and are ignored
+
+	const F32x4 active = Atmosphere_maskToF32x4(mask);
+	const F32x4 start = F32x4_mul(intersections[1], active);
+	const F32x4 diff = F32x4_mul(F32x4_sub(intersections[2], intersections[1]), active);
+
+	F32x4 sumRayleigh[3] = { 0 }, sumMie[3] = { 0 };
+	F32x4 depthRayleigh = F32x4_zero(), depthMie = F32x4_zero();
+	F32x4 prevT = start, prevRayleigh = F32x4_zero(), prevMie = F32x4_zero();
+
+	const F32x4 rayleighOzone = F32x4_add(atmos->rayleigh.coefficient, atmos->ozoneCoefficient);
+	const F32x4 mieExtinction = F32x4_mul(atmos->mie.coefficient, F32x4_xxxx4(1.11f));
+
+	for(U32 i = 0; i < atmos->raySamples; ++i) {
+
+		F32x4 step;
+		const F32x4 t = Atmosphere_getSampleT4(
+			start, diff, i, atmos->raySamples, atmos->rayOffset, atmos->quadraticSamples, &step
+		);
+
+		const F32x4 posX = F32x4_add(ray.originX, F32x4_mul(ray.dirX, t));
+		const F32x4 posY = F32x4_add(ray.originY, F32x4_mul(ray.dirY, t));
+		const F32x4 posZ = F32x4_add(ray.originZ, F32x4_mul(ray.dirZ, t));
+		const F32x4 len = Atmosphere_length4(posX, posY, posZ);
+
+		const F32x4 densityRayleigh = Atmosphere_getDensity4(atmos, len, step, atmos->rayleigh);
+		const F32x4 densityMie = Atmosphere_getDensity4(atmos, len, step, atmos->mie);
+
+		//Same optical depth as Atmosphere_getContribution
+
+		if(!atmos->quadraticSamples) {
+			depthRayleigh = F32x4_add(depthRayleigh, densityRayleigh);
+			depthMie = F32x4_add(depthMie, densityMie);
+		}
+
+		else {
+
+			const F32x4 rayleigh = Atmosphere_getDensity4(atmos, len, F32x4_one(), atmos->rayleigh);
+			const F32x4 mie = Atmosphere_getDensity4(atmos, len, F32x4_one(), atmos->mie);
+
+			const F32x4 half = F32x4_mul(F32x4_sub(t, prevT), F32x4_xxxx4(0.5f));
+
+			depthRayleigh = F32x4_add(depthRayleigh, F32x4_mul(F32x4_add(rayleigh, i ? prevRayleigh : rayleigh), half));
+			depthMie = F32x4_add(depthMie, F32x4_mul(F32x4_add(mie, i ? prevMie : mie), half));
+
+			prevT = t;
+			prevRayleigh = rayleigh;
+			prevMie = mie;
+		}
+
+		F32x4 depthLightRayleigh, depthLightMie;
+		const U8 lightMask = Atmosphere_getOpticalDepthLight4(atmos, posX, posY, posZ, &depthLightRayleigh, &depthLightMie);
+
+		if(!(lightMask & mask))
+			continue;
+
+		const F32x4 lit = Atmosphere_maskToF32x4(lightMask);
+		const F32x4 rayleighDepth = F32x4_add(depthLightRayleigh, depthRayleigh);
+		const F32x4 mieDepth = F32x4_add(depthLightMie, depthMie);
+
+		for(U8 c = 0; c < 3; ++c) {
+
+			const F32x4 tau = F32x4_add(
+				F32x4_mul(F32x4_xxxx4(F32x4_get(rayleighOzone, c)), rayleighDepth),
+				F32x4_mul(F32x4_xxxx4(F32x4_get(mieExtinction, c)), mieDepth)
+			);
+
+			const F32x4 atten = F32x4_mul(Atmosphere_exp4(F32x4_negate(tau)), lit);
+
+			sumRayleigh[c] = F32x4_add(sumRayleigh[c], F32x4_mul(atten, densityRayleigh));
+			sumMie[c] = F32x4_add(sumMie[c], F32x4_mul(atten, densityMie));
+		}
+	}
+
+	//Phase functions
+
+	const F32x4 LoV = F32x4_clamp(
+		F32x4_negate(F32x4_add(F32x4_add(
+			F32x4_mul(ray.dirX, F32x4_xxxx4(F32x4_x(atmos->sunDir))),
+			F32x4_mul(ray.dirY, F32x4_xxxx4(F32x4_y(atmos->sunDir)))),
+			F32x4_mul(ray.dirZ, F32x4_xxxx4(F32x4_z(atmos->sunDir)))
+		)),
+		F32x4_zero(), F32x4_one()
+	);
+
+	const F32x4 LoV2 = F32x4_add(F32x4_one(), F32x4_mul(LoV, LoV));
+	const F32x4 rayleighPhase = F32x4_mul(LoV2, F32x4_xxxx4(3.f / (16 * F32_PI)));
+
+	const F32 g = 0.76f, g2 = g * g;
+	const F32x4 mieBase = F32x4_sub(F32x4_xxxx4(1 + g2), F32x4_mul(LoV, F32x4_xxxx4(2 * g)));
+
+	const F32x4 miePhase = F32x4_div(
+		F32x4_mul(LoV2, F32x4_xxxx4(3.f / (8 * F32_PI) * (1 - g2))),
+		F32x4_mul(F32x4_xxxx4(2 + g2), F32x4_mul(mieBase, F32x4_sqrt(mieBase)))		//pow(x, 1.5)
+	);
+
+	F32x4 color[3];
+
+	for(U8 c = 0; c < 3; ++c)
+		color[c] = F32x4_mul(
+			F32x4_add(
+				F32x4_mul(F32x4_mul(sumRayleigh[c], F32x4_xxxx4(F32x4_get(atmos->rayleigh.coefficient, c))), rayleighPhase),
+				F32x4_mul(F32x4_mul(sumMie[c], F32x4_xxxx4(F32x4_get(atmos->mie.coefficient, c))), miePhase)
+			),
+			F32x4_xxxx4(F32x4_get(atmos->sunRadianceLux, c) / F32_PI)
+		);
+
+	for(U8 i = 0; i < 4; ++i)
+		if(mask & (1 << i))
+			result[i] = F32x4_create3(F32x4_get(color[0], i), F32x4_get(color[1], i), F32x4_get(color[2], i));
+}
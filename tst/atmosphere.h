@@ -0,0 +1,100 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "primitive.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//CPU port of atmosphere.hlsli, this has to be kept in sync with the shader
+
+typedef struct AtmosphereScatteringType {
+	F32x4 coefficient;
+	F32 scaleHeight;
+} AtmosphereScatteringType;
+
+typedef struct Atmosphere {
+
+	F32x4 sunRadianceNits;
+	F32x4 ozoneCoefficient;
+	F32x4 sunRadianceLux;
+	F32x4 sunDir;
+
+	AtmosphereScatteringType rayleigh;
+	AtmosphereScatteringType mie;
+
+	U32 raySamples, lightSamples;
+	F32 rayOffset, lightOffset;		//Where samples are within their interval, in [0, 1>; 0.5 = midpoint (see below)
+	Bool quadraticSamples;			//Space samples quadratically instead of uniformly (see Atmosphere_getSampleT)
+
+	F32 planetRadius;
+	F32 atmosphereRadius;
+
+} Atmosphere;
+
+//Properties of earth
+
+Atmosphere Atmosphere_earth(F32x4 sunDir);
+
+//Per pixel rayOffset (x) and lightOffset (y) for jittered ray marching.
+//Interleaved gradient noise (Jimenez 2014) spreads the offsets like blue noise, so low sample counts show up as fine
+//noise rather than banding. Every frame shifts them along the R2 sequence (repeating after 1024 frames),
+//so a pixel that's accumulated over time sees well distributed offsets (see sky_temporal.h).
+
+F32x2 Atmosphere_getSampleOffsets(U32 x, U32 y, U32 frameId);
+
+//Scattering density and phase functions
+
+F32 Atmosphere_getDensity(const Atmosphere *atmos, F32x4 pos, F32 rayLen, AtmosphereScatteringType type);
+
+F32 Atmosphere_rayleighPhaseFunction(F32 LoV);
+F32 Atmosphere_miePhaseFunction(F32 LoV);
+
+//Ray marching
+
+//Returns where sample i of samples is on a ray through the atmosphere from start to start + length,
+//and the step (length of the ray) it stands for.
+//
+//By default samples are uniform: step = length / samples and t = start + step * (i + offset), so offset 0.5 is the
+//midpoint rule. The view ray's optical depth to a sample then includes the sample's whole step.
+//
+//With quadraticSamples they're at start + length * s^2 with s = (i + offset) / samples, denser at the start of a ray:
+//that's where the density changes fastest, since view and light rays usually start low in the atmosphere
+//(Hillaire 2020 does the same for its sky view LUT). The step is the derivative, so the samples integrate the whole ray
+//for any offset, and the view ray's optical depth is a trapezoid between samples. Jittered offsets with few uniform
+//samples converge to a biased result (one step of a horizontal ray spans hundreds of km), so they need this.
+
+F32 Atmosphere_getSampleT(F32 start, F32 length, U32 i, U32 samples, F32 offset, Bool quadraticSamples, F32 *step);
+
+Bool Atmosphere_getOpticalDepthLight(const Atmosphere *atmos, F32x4 pos, F32 *rayleighDepth, F32 *mieDepth);
+
+F32x4 Atmosphere_getSunContribution(const Atmosphere *atmos, F32x4 nrm);
+F32x4 Atmosphere_getContribution(const Atmosphere *atmos, RayDesc ray);
+
+//Same as Atmosphere_getContribution for 4 rays at once (result[i] is ray i).
+//The ray march runs on all lanes at once, only the intersections with the planet and atmosphere are per lane.
+
+void Atmosphere_getContribution4(const Atmosphere *atmos, const RayDesc4 *rays, F32x4 result[4]);
+
+#ifdef __cplusplus
+	}
+#endif
@@ -0,0 +1,609 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "atmosphere_lut.h"
+#include "parallel.h"
+#include "platforms/file.h"
+#include "platforms/ext/bufferx.h"
+#include "types/math/flp.h"
+#include "types/math/math.h"
+
+#define AtmosphereLUT_magic 0x54554C41		//ALUT
+
+typedef struct AtmosphereLUTHeader {
+	U32 magic;
+	U32 version;
+	U64 key;
+	F32 planetRadius, atmosphereRadius;
+} AtmosphereLUTHeader;
+
+static const U64 AtmosphereLUT_transmittanceCount = AtmosphereLUT_transmittanceW * AtmosphereLUT_transmittanceH;
+static const U64 AtmosphereLUT_multiScatteringCount = AtmosphereLUT_multiScatteringW * AtmosphereLUT_multiScatteringH;
+
+U64 AtmosphereLUT_getKey(const Atmosphere *atmos) {
+
+	if(!atmos)
+		return 0;
+
+	const F32 params[] = {
+
+		atmos->planetRadius, atmos->atmosphereRadius,
+
+		F32x4_x(atmos->rayleigh.coefficient), F32x4_y(atmos->rayleigh.coefficient), F32x4_z(atmos->rayleigh.coefficient),
+		atmos->rayleigh.scaleHeight,
+
+		F32x4_x(atmos->mie.coefficient), F32x4_y(atmos->mie.coefficient), F32x4_z(atmos->mie.coefficient),
+		atmos->mie.scaleHeight,
+
+		F32x4_x(atmos->ozoneCoefficient), F32x4_y(atmos->ozoneCoefficient), F32x4_z(atmos->ozoneCoefficient)
+	};
+
+	const U32 layout[] = {
+		AtmosphereLUT_version,
+		AtmosphereLUT_transmittanceW, AtmosphereLUT_transmittanceH, AtmosphereLUT_transmittanceSamples,
+		AtmosphereLUT_multiScatteringW, AtmosphereLUT_multiScatteringH,
+		AtmosphereLUT_multiScatteringDirs, AtmosphereLUT_multiScatteringSamples
+	};
+
+	//FNV-1a
+
+	U64 hash = 0xCBF29CE484222325;
+
+	for(U64 i = 0; i < sizeof(params); ++i)
+		hash = (hash ^ ((const U8*) params)[i]) * 0x100000001B3;
+
+	for(U64 i = 0; i < sizeof(layout); ++i)
+		hash = (hash ^ ((const U8*) layout)[i]) * 0x100000001B3;
+
+	return hash;
+}
+
+const F32x4 *AtmosphereLUT_getTransmittance(const AtmosphereLUT *lut) {
+	return lut && lut->data.ptr ? (const F32x4*) lut->data.ptr : NULL;
+}
+
+const F32x4 *AtmosphereLUT_getMultiScattering(const AtmosphereLUT *lut) {
+	return lut && lut->data.ptr ? (const F32x4*) lut->data.ptr + AtmosphereLUT_transmittanceCount : NULL;
+}
+
+static F32x4 AtmosphereLUT_exp(F32x4 v) {
+	return F32x4_create3(F32_expe(F32x4_x(v)), F32_expe(F32x4_y(v)), F32_expe(F32x4_z(v)));
+}
+
+//Bilinear with clamp to edge, same as a linear sampler
+
+static F32x4 AtmosphereLUT_sample(const F32x4 *texels, U32 w, U32 h, F32 u, F32 v) {
+
+	const F32 x = F32_clamp(u * w - 0.5f, 0, (F32)(w - 1));
+	const F32 y = F32_clamp(v * h - 0.5f, 0, (F32)(h - 1));
+
+	const U32 x0 = (U32) x, y0 = (U32) y;
+	const U32 x1 = U32_min(x0 + 1, w - 1), y1 = U32_min(y0 + 1, h - 1);
+
+	const F32 fx = x - x0;
+
+	const F32x4 top = F32x4_lerp(texels[y0 * w + x0], texels[y0 * w + x1], fx);
+	const F32x4 bottom = F32x4_lerp(texels[y1 * w + x0], texels[y1 * w + x1], fx);
+
+	return F32x4_lerp(top, bottom, y - y0);
+}
+
+//Maps [0, 1] to the texel centers, so the edges aren't filtered with the wrong side
+
+static F32 AtmosphereLUT_toTexelCenter(F32 v, U32 size) {
+	return 0.5f / size + v * (1 - 1.f / size);
+}
+
+//Bruneton's parameterization; more precision near the horizon and the ground
+
+static void AtmosphereLUT_getTransmittanceUv(const AtmosphereLUT *lut, F32 r, F32 mu, F32 *u, F32 *v) {
+
+	const F32 Rg = lut->planetRadius, Rt = lut->atmosphereRadius;
+
+	const F32 H = F32_sqrt((Rt - Rg) * (Rt + Rg));
+	const F32 rho = F32_sqrt(F32_max((r - Rg) * (r + Rg), 0));
+
+	const F32 discriminant = (Rt - r) * (Rt + r) + r * r * mu * mu;
+	const F32 d = F32_max(-r * mu + F32_sqrt(F32_max(discriminant, 0)), 0);
+	const F32 dMin = Rt - r, dMax = rho + H;
+
+	*u = AtmosphereLUT_toTexelCenter(dMax > dMin ? (d - dMin) / (dMax - dMin) : 0, AtmosphereLUT_transmittanceW);
+	*v = AtmosphereLUT_toTexelCenter(rho / H, AtmosphereLUT_transmittanceH);
+}
+
+static void AtmosphereLUT_getTransmittanceRMu(const AtmosphereLUT *lut, F32 xMu, F32 xR, F32 *r, F32 *mu) {
+
+	const F32 Rg = lut->planetRadius, Rt = lut->atmosphereRadius;
+
+	const F32 H = F32_sqrt((Rt - Rg) * (Rt + Rg));
+	const F32 rho = H * xR;
+
+	*r = F32_sqrt(rho * rho + Rg * Rg);
+
+	const F32 dMin = Rt - *r, dMax = rho + H;
+	const F32 d = dMin + xMu * (dMax - dMin);
+
+	*mu = d <= 0 ? 1 : F32_clamp((H * H - rho * rho - d * d) / (2 * *r * d), -1, 1);
+}
+
+F32x4 AtmosphereLUT_sampleTransmittance(const AtmosphereLUT *lut, F32 r, F32 mu) {
+
+	const F32 Rg = lut->planetRadius;
+
+	if(mu < 0 && (Rg - r) * (Rg + r) + r * r * mu * mu >= 0)		//Planet is in the way
+		return F32x4_zero();
+
+	F32 u, v;
+	AtmosphereLUT_getTransmittanceUv(lut, r, mu, &u, &v);
+
+	return AtmosphereLUT_sample(
+		AtmosphereLUT_getTransmittance(lut), AtmosphereLUT_transmittanceW, AtmosphereLUT_transmittanceH, u, v
+	);
+}
+
+F32x4 AtmosphereLUT_sampleMultiScattering(const AtmosphereLUT *lut, F32 r, F32 muS) {
+
+	const F32 height = (r - lut->planetRadius) / (lut->atmosphereRadius - lut->planetRadius);
+
+	return AtmosphereLUT_sample(
+		AtmosphereLUT_getMultiScattering(lut),
+		AtmosphereLUT_multiScatteringW, AtmosphereLUT_multiScatteringH,
+		AtmosphereLUT_toTexelCenter(F32_saturate(muS * 0.5f + 0.5f), AtmosphereLUT_multiScatteringW),
+		AtmosphereLUT_toTexelCenter(F32_saturate(height), AtmosphereLUT_multiScatteringH)
+	);
+}
+
+//Generation
+
+typedef struct AtmosphereLUTJob {
+	const Atmosphere *atmos;
+	AtmosphereLUT *lut;
+} AtmosphereLUTJob;
+
+static F32 AtmosphereLUT_getDensity(const Atmosphere *atmos, F32 r, F32 scaleHeight) {
+	const F32 height = r - atmos->planetRadius;
+	return height <= 0 ? 0 : F32_expe(-height / scaleHeight);
+}
+
+static void AtmosphereLUT_generateTransmittance(void *userData, U64 y, U64 threadId) {
+
+	(void) threadId;
+
+	const AtmosphereLUTJob *job = (const AtmosphereLUTJob*) userData;
+	const Atmosphere *atmos = job->atmos;
+	AtmosphereLUT *lut = job->lut;
+
+	F32x4 *row = (F32x4*) AtmosphereLUT_getTransmittance(lut) + y * AtmosphereLUT_transmittanceW;
+
+	const F32x4 rayleighOzone = F32x4_add(atmos->rayleigh.coefficient, atmos->ozoneCoefficient);
+	const F32x4 mieExtinction = F32x4_mul(atmos->mie.coefficient, F32x4_xxxx4(1.11f));
+
+	for(U32 x = 0; x < AtmosphereLUT_transmittanceW; ++x) {
+
+		F32 r, mu;
+		AtmosphereLUT_getTransmittanceRMu(
+			lut,
+			(F32) x / (AtmosphereLUT_transmittanceW - 1), (F32) y / (AtmosphereLUT_transmittanceH - 1),
+			&r, &mu
+		);
+
+		const F32 Rt = lut->atmosphereRadius;
+		const F32 d = F32_max(-r * mu + F32_sqrt(F32_max((Rt - r) * (Rt + r) + r * r * mu * mu, 0)), 0);
+		const F32 step = d / AtmosphereLUT_transmittanceSamples;
+
+		F32 depthRayleigh = 0, depthMie = 0;
+
+		for(U32 i = 0; i < AtmosphereLUT_transmittanceSamples; ++i) {
+
+			const F32 t = step * (i + 0.5f);
+			const F32 rt = F32_sqrt(t * t + 2 * r * mu * t + r * r);
+
+			depthRayleigh += AtmosphereLUT_getDensity(atmos, rt, atmos->rayleigh.scaleHeight) * step;
+			depthMie += AtmosphereLUT_getDensity(atmos, rt, atmos->mie.scaleHeight) * step;
+		}
+
+		row[x] = AtmosphereLUT_exp(F32x4_negate(F32x4_add(
+			F32x4_mul(rayleighOzone, F32x4_xxxx4(depthRayleigh)),
+			F32x4_mul(mieExtinction, F32x4_xxxx4(depthMie))
+		)));
+	}
+}
+
+//Integrates second order scattering (with an isotropic phase function) and the transfer factor f_ms over the sphere.
+//Psi_ms = L_2nd / (1 - f_ms) approximates the infinite series of higher orders. Ground albedo is ignored,
+//since the sky doesn't include light bounced off the planet either.
+
+static void AtmosphereLUT_generateMultiScattering(void *userData, U64 y, U64 threadId) {
+
+	(void) threadId;
+
+	const AtmosphereLUTJob *job = (const AtmosphereLUTJob*) userData;
+	const Atmosphere *atmos = job->atmos;
+	const AtmosphereLUT *lut = job->lut;
+
+	F32x4 *row = (F32x4*) AtmosphereLUT_getMultiScattering(lut) + y * AtmosphereLUT_multiScatteringW;
+
+	const F32 Rg = lut->planetRadius, Rt = lut->atmosphereRadius;
+	const F32 r = Rg + (Rt - Rg) * y / (AtmosphereLUT_multiScatteringH - 1);
+	const F32x4 pos = F32x4_create3(0, r, 0);
+
+	const F32x4 rayleighOzone = F32x4_add(atmos->rayleigh.coefficient, atmos->ozoneCoefficient);
+	const F32x4 mieExtinction = F32x4_mul(atmos->mie.coefficient, F32x4_xxxx4(1.11f));
+
+	const U32 dirCount = AtmosphereLUT_multiScatteringDirs * AtmosphereLUT_multiScatteringDirs;
+	const F32 isotropicPhase = 1 / (4 * F32_PI);
+
+	for(U32 x = 0; x < AtmosphereLUT_multiScatteringW; ++x) {
+
+		const F32 muS = (F32) x / (AtmosphereLUT_multiScatteringW - 1) * 2 - 1;
+		const F32x4 sunL = F32x4_create3(F32_sqrt(F32_max(1 - muS * muS, 0)), muS, 0);
+
+		F32x4 secondOrder = F32x4_zero(), transfer = F32x4_zero();
+
+		for(U32 i = 0; i < dirCount; ++i) {
+
+			const F32 cosTheta = 1 - 2 * ((i / AtmosphereLUT_multiScatteringDirs) + 0.5f) / AtmosphereLUT_multiScatteringDirs;
+			const F32 phi = 2 * F32_PI * ((i % AtmosphereLUT_multiScatteringDirs) + 0.5f) / AtmosphereLUT_multiScatteringDirs;
+			const F32 sinTheta = F32_sqrt(F32_max(1 - cosTheta * cosTheta, 0));
+
+			const F32x4 dir = F32x4_create3(sinTheta * F32_cos(phi), cosTheta, sinTheta * F32_sin(phi));
+
+			//March until the ground or the top of the atmosphere
+
+			const F32 b = r * cosTheta;
+			const F32 groundDiscriminant = b * b - (r - Rg) * (r + Rg);
+
+			const F32 maxT = b < 0 && groundDiscriminant >= 0 ?
+				F32_max(-b - F32_sqrt(groundDiscriminant), 0) :
+				F32_max(-b + F32_sqrt(F32_max(b * b + (Rt - r) * (Rt + r), 0)), 0);
+
+			const F32 step = maxT / AtmosphereLUT_multiScatteringSamples;
+
+			F32x4 throughput = F32x4_one();
+
+			for(U32 j = 0; j < AtmosphereLUT_multiScatteringSamples; ++j) {
+
+				const F32x4 samplePos = F32x4_add(pos, F32x4_mul(dir, F32x4_xxxx4(step * (j + 0.5f))));
+				const F32 sampleR = F32_sqrt(F32x4_dot3(samplePos, samplePos));
+
+				const F32 densityRayleigh = AtmosphereLUT_getDensity(atmos, sampleR, atmos->rayleigh.scaleHeight);
+				const F32 densityMie = AtmosphereLUT_getDensity(atmos, sampleR, atmos->mie.scaleHeight);
+
+				const F32x4 scattering = F32x4_add(
+					F32x4_mul(atmos->rayleigh.coefficient, F32x4_xxxx4(densityRayleigh)),
+					F32x4_mul(atmos->mie.coefficient, F32x4_xxxx4(densityMie))
+				);
+
+				const F32x4 extinction = F32x4_add(
+					F32x4_mul(rayleighOzone, F32x4_xxxx4(densityRayleigh)),
+					F32x4_mul(mieExtinction, F32x4_xxxx4(densityMie))
+				);
+
+				const F32x4 segment = AtmosphereLUT_exp(F32x4_mul(extinction, F32x4_xxxx4(-step)));
+
+				//Analytical integration of the scattering over the segment (falls back to step for thin air)
+
+				F32x4 integral = F32x4_zero();
+
+				for(U8 k = 0; k < 3; ++k) {
+					const F32 sigma = F32x4_get(extinction, k);
+					F32x4_set(&integral, k, sigma > 1e-12f ? (1 - F32x4_get(segment, k)) / sigma : step);
+				}
+
+				const F32x4 scatteringIntegral = F32x4_mul(F32x4_mul(throughput, scattering), integral);
+
+				const F32x4 sunTransmittance = AtmosphereLUT_sampleTransmittance(
+					lut, sampleR, F32x4_dot3(samplePos, sunL) / sampleR
+				);
+
+				secondOrder = F32x4_add(
+					secondOrder, F32x4_mul(scatteringIntegral, F32x4_mul(sunTransmittance, F32x4_xxxx4(isotropicPhase)))
+				);
+
+				transfer = F32x4_add(transfer, scatteringIntegral);
+				throughput = F32x4_mul(throughput, segment);
+			}
+		}
+
+		//Uniform sphere samples with isotropic phase: 4pi / N * 1 / (4pi)
+
+		secondOrder = F32x4_div(secondOrder, F32x4_xxxx4((F32) dirCount));
+		transfer = F32x4_div(transfer, F32x4_xxxx4((F32) dirCount));
+
+		row[x] = F32x4_div(secondOrder, F32x4_sub(F32x4_one(), transfer));
+		F32x4_setW(&row[x], 0);
+	}
+}
+
+Bool AtmosphereLUT_createx(const Atmosphere *atmos, AtmosphereLUT *lut, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Bool ownsLut = false;
+
+	if(!atmos || !lut)
+		retError(clean, Error_nullPointer(!atmos ? 0 : 1, "AtmosphereLUT_createx()::atmos and lut are required"))
+
+	if(lut->data.ptr)
+		retError(clean, Error_invalidParameter(1, 0, "AtmosphereLUT_createx()::lut wasn't empty, might indicate memleak"))
+
+	if(!(atmos->planetRadius > 0) || !(atmos->atmosphereRadius > atmos->planetRadius))
+		retError(clean, Error_invalidParameter(0, 0, "AtmosphereLUT_createx()::atmos has an invalid planet or atmosphere radius"))
+
+	ownsLut = true;
+	*lut = (AtmosphereLUT) {
+		.key = AtmosphereLUT_getKey(atmos),
+		.planetRadius = atmos->planetRadius,
+		.atmosphereRadius = atmos->atmosphereRadius
+	};
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(
+		sizeof(F32x4) * (AtmosphereLUT_transmittanceCount + AtmosphereLUT_multiScatteringCount), &lut->data
+	))
+
+	AtmosphereLUTJob job = (AtmosphereLUTJob) { .atmos = atmos, .lut = lut };
+
+	//Multiple scattering samples the transmittance, so it has to wait for it
+
+	gotoIfError3(clean, Parallel_for(AtmosphereLUT_transmittanceH, AtmosphereLUT_generateTransmittance, &job, e_rr))
+	gotoIfError3(clean, Parallel_for(AtmosphereLUT_multiScatteringH, AtmosphereLUT_generateMultiScattering, &job, e_rr))
+
+clean:
+
+	if(!s_uccess && ownsLut)
+		AtmosphereLUT_freex(lut);
+
+	return s_uccess;
+}
+
+Bool AtmosphereLUT_writex(const AtmosphereLUT *lut, CharString path, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Buffer file = Buffer_createNull();
+
+	if(!lut || !lut->data.ptr)
+		retError(clean, Error_nullPointer(0, "AtmosphereLUT_writex()::lut is required"))
+
+	const AtmosphereLUTHeader header = (AtmosphereLUTHeader) {
+		.magic = AtmosphereLUT_magic,
+		.version = AtmosphereLUT_version,
+		.key = lut->key,
+		.planetRadius = lut->planetRadius,
+		.atmosphereRadius = lut->atmosphereRadius
+	};
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(header) + Buffer_length(lut->data), &file))
+
+	*(AtmosphereLUTHeader*) file.ptrNonConst = header;
+	gotoIfError2(clean, Buffer_copy(Buffer_createRef(file.ptrNonConst + sizeof(header), Buffer_length(lut->data)), lut->data))
+
+	gotoIfError3(clean, File_writex(file, path, 0, 0, U64_MAX, false, e_rr))
+
+clean:
+	Buffer_freex(&file);
+	return s_uccess;
+}
+
+static Bool AtmosphereLUT_readx(const Atmosphere *atmos, CharString cachePath, AtmosphereLUT *lut) {
+
+	Bool s_uccess = true;
+	Error *e_rr = NULL;			//Missing or outdated cache isn't an error
+	Buffer file = Buffer_createNull();
+
+	gotoIfError3(clean, File_readx(cachePath, U64_MAX, 0, 0, &file, e_rr))
+
+	const U64 dataLength = sizeof(F32x4) * (AtmosphereLUT_transmittanceCount + AtmosphereLUT_multiScatteringCount);
+
+	if(Buffer_length(file) != sizeof(AtmosphereLUTHeader) + dataLength)
+		retError(clean, Error_invalidState(0, "AtmosphereLUT_readx() cache has an unexpected size"))
+
+	const AtmosphereLUTHeader header = *(const AtmosphereLUTHeader*) file.ptr;
+
+	if(
+		header.magic != AtmosphereLUT_magic || header.version != AtmosphereLUT_version ||
+		header.key != AtmosphereLUT_getKey(atmos)
+	)
+		retError(clean, Error_invalidState(0, "AtmosphereLUT_readx() cache is outdated"))
+
+	*lut = (AtmosphereLUT) {
+		.key = header.key,
+		.planetRadius = header.planetRadius,
+		.atmosphereRadius = header.atmosphereRadius
+	};
+
+	gotoIfError2(clean, Buffer_createCopyx(Buffer_createRefConst(file.ptr + sizeof(header), dataLength), &lut->data))
+
+clean:
+	Buffer_freex(&file);
+	return s_uccess;
+}
+
+Bool AtmosphereLUT_loadOrCreatex(const Atmosphere *atmos, CharString cachePath, AtmosphereLUT *lut, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!atmos || !lut)
+		retError(clean, Error_nullPointer(!atmos ? 0 : 2, "AtmosphereLUT_loadOrCreatex()::atmos and lut are required"))
+
+	if(lut->data.ptr)
+		retError(clean, Error_invalidParameter(2, 0, "AtmosphereLUT_loadOrCreatex()::lut wasn't empty, might indicate memleak"))
+
+	if(AtmosphereLUT_readx(atmos, cachePath, lut))
+		goto clean;
+
+	gotoIfError3(clean, AtmosphereLUT_createx(atmos, lut, e_rr))
+	AtmosphereLUT_writex(lut, cachePath, NULL);
+
+clean:
+	return s_uccess;
+}
+
+void AtmosphereLUT_freex(AtmosphereLUT *lut) {
+
+	if(!lut)
+		return;
+
+	Buffer_freex(&lut->data);
+	*lut = (AtmosphereLUT) { 0 };
+}
+
+Bool AtmosphereLUT_toF16x(const AtmosphereLUT *lut, Buffer *transmittance, Buffer *multiScattering, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!lut || !lut->data.ptr || !transmittance || !multiScattering)
+		retError(clean, Error_nullPointer(!lut ? 0 : 1, "AtmosphereLUT_toF16x()::lut, transmittance and multiScattering are required"))
+
+	if(transmittance->ptr || multiScattering->ptr)
+		retError(clean, Error_invalidParameter(
+			transmittance->ptr ? 1 : 2, 0, "AtmosphereLUT_toF16x()::transmittance and multiScattering should be empty"
+		))
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(F16) * 4 * AtmosphereLUT_transmittanceCount, transmittance))
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(F16) * 4 * AtmosphereLUT_multiScatteringCount, multiScattering))
+
+	const F32x4 *src = (const F32x4*) lut->data.ptr;
+	F16 *dst = (F16*) transmittance->ptrNonConst;
+
+	for(U64 i = 0; i < AtmosphereLUT_transmittanceCount + AtmosphereLUT_multiScatteringCount; ++i) {
+
+		if(i == AtmosphereLUT_transmittanceCount)
+			dst = (F16*) multiScattering->ptrNonConst;
+
+		const U64 j = i < AtmosphereLUT_transmittanceCount ? i : i - AtmosphereLUT_transmittanceCount;
+
+		for(U8 k = 0; k < 4; ++k)
+			dst[j * 4 + k] = F32_castF16(F32x4_get(src[i], k));
+	}
+
+clean:
+
+	if(!s_uccess && transmittance && multiScattering && lut && lut->data.ptr) {
+		Buffer_freex(transmittance);
+		Buffer_freex(multiScattering);
+	}
+
+	return s_uccess;
+}
+
+//Evaluation
+
+F32x4 Atmosphere_getContributionLUT(const Atmosphere *atmos, const AtmosphereLUT *lut, RayDesc ray, Bool multiScattering) {
+
+	//Same as the shader; place the camera 10m above the planet's surface
+
+	ray.origin = F32x4_add(ray.origin, F32x4_create3(0, atmos->planetRadius + 10, 0));
+
+	//Get start and end intersection
+
+	F32x4 intersections; Bool isBackside;
+
+	if(Sphere_intersects(Sphere_create(F32x4_zero(), atmos->planetRadius), ray, &intersections, &isBackside))
+		ray.maxT = F32x4_x(intersections);
+
+	const F32x4 earthNrm = F32x4_normalize3(RayDesc_posOnRay(ray, ray.maxT));
+	const F32x4 earthShading = Atmosphere_getSunContribution(atmos, earthNrm);
+
+	if(!Sphere_intersects(Sphere_create(F32x4_zero(), atmos->atmosphereRadius), ray, &intersections, &isBackside))
+		return earthShading;
+
+	const F32 start = F32x4_y(intersections);
+	const F32 diff = F32x4_z(intersections) - start;
+
+	//Raymarch through the start + end regions, but the light comes from the LUTs rather than another ray march
+
+	F32x4 sumRayleigh = F32x4_zero(), sumMie = F32x4_zero(), sumMulti = F32x4_zero();
+	F32 depthRayleigh = 0, depthMie = 0;
+	F32 prevT = start, prevRayleigh = 0, prevMie = 0;
+
+	const F32x4 rayleighOzone = F32x4_add(atmos->rayleigh.coefficient, atmos->ozoneCoefficient);
+	const F32x4 mieExtinction = F32x4_mul(atmos->mie.coefficient, F32x4_xxxx4(1.11f));
+	const F32x4 sunL = F32x4_negate(atmos->sunDir);
+
+	for(U32 i = 0; i < atmos->raySamples; ++i) {
+
+		F32 step;
+		const F32 t = Atmosphere_getSampleT(
+			start, diff, i, atmos->raySamples, atmos->rayOffset, atmos->quadraticSamples, &step
+		);
+
+		const F32x4 pos = RayDesc_posOnRay(ray, t);
+
+		//Same sample placement and optical depth as Atmosphere_getContribution
+
+		const F32 rayleigh = Atmosphere_getDensity(atmos, pos, 1, atmos->rayleigh);
+		const F32 mie = Atmosphere_getDensity(atmos, pos, 1, atmos->mie);
+
+		const F32 densityRayleigh = rayleigh * step;
+		const F32 densityMie = mie * step;
+
+		if(!atmos->quadraticSamples) {
+			depthRayleigh += densityRayleigh;
+			depthMie += densityMie;
+		}
+
+		else {
+
+			depthRayleigh += (rayleigh + (i ? prevRayleigh : rayleigh)) * 0.5f * (t - prevT);
+			depthMie += (mie + (i ? prevMie : mie)) * 0.5f * (t - prevT);
+
+			prevT = t;
+			prevRayleigh = rayleigh;
+			prevMie = mie;
+		}
+
+		const F32x4 viewTransmittance = AtmosphereLUT_exp(F32x4_negate(F32x4_add(
+			F32x4_mul(rayleighOzone, F32x4_xxxx4(depthRayleigh)),
+			F32x4_mul(mieExtinction, F32x4_xxxx4(depthMie))
+		)));
+
+		const F32 r = F32_sqrt(F32x4_dot3(pos, pos));
+		const F32 muS = F32x4_dot3(pos, sunL) / r;
+
+		const F32x4 atten = F32x4_mul(viewTransmittance, AtmosphereLUT_sampleTransmittance(lut, r, muS));
+
+		sumRayleigh = F32x4_add(sumRayleigh, F32x4_mul(atten, F32x4_xxxx4(densityRayleigh)));
+		sumMie = F32x4_add(sumMie, F32x4_mul(atten, F32x4_xxxx4(densityMie)));
+
+		if(!multiScattering)
+			continue;
+
+		const F32x4 scattering = F32x4_add(
+			F32x4_mul(atmos->rayleigh.coefficient, F32x4_xxxx4(densityRayleigh)),
+			F32x4_mul(atmos->mie.coefficient, F32x4_xxxx4(densityMie))
+		);
+
+		sumMulti = F32x4_add(sumMulti, F32x4_mul(
+			F32x4_mul(viewTransmittance, scattering), AtmosphereLUT_sampleMultiScattering(lut, r, muS)
+		));
+	}
+
+	const F32 LoV = F32_saturate(-F32x4_dot3(ray.dir, atmos->sunDir));
+
+	const F32x4 rayleighContrib = F32x4_mul(
+		F32x4_mul(sumRayleigh, atmos->rayleigh.coefficient), F32x4_xxxx4(Atmosphere_rayleighPhaseFunction(LoV))
+	);
+
+	const F32x4 mieContrib = F32x4_mul(
+		F32x4_mul(sumMie, atmos->mie.coefficient), F32x4_xxxx4(Atmosphere_miePhaseFunction(LoV))
+	);
+
+	const F32x4 contrib = F32x4_add(F32x4_add(rayleighContrib, mieContrib), sumMulti);
+	return F32x4_mul(F32x4_mul(contrib, atmos->sunRadianceLux), F32x4_xxxx4(1 / F32_PI));
+}
@@ -0,0 +1,92 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "atmosphere.h"
+#include "types/container/buffer.h"
+#include "types/container/string.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Precomputed transmittance and multiple scattering (Hillaire 2020, "A Scalable and Production Ready Sky and Atmosphere
+//Rendering Technique"). Both only depend on the planet and its atmosphere, not on the sun, so they're computed once per
+//Atmosphere_earth parameter set. The layout and parameterization has to be kept in sync with atmosphere.hlsli.
+//
+//Transmittance: optical depth from a point to the top of the atmosphere, indexed by height and view zenith (Bruneton).
+//Multiple scattering: isotropic multiple scattering contribution (Psi_ms) indexed by height and sun zenith.
+
+#define AtmosphereLUT_transmittanceW 256
+#define AtmosphereLUT_transmittanceH 64
+#define AtmosphereLUT_transmittanceSamples 40
+
+#define AtmosphereLUT_multiScatteringW 32
+#define AtmosphereLUT_multiScatteringH 32
+#define AtmosphereLUT_multiScatteringDirs 8			//Sqrt of directions that are integrated per texel
+#define AtmosphereLUT_multiScatteringSamples 20
+
+#define AtmosphereLUT_version 1
+
+typedef struct AtmosphereLUT {
+
+	Buffer data;			//F32x4[transmittanceW * transmittanceH] followed by F32x4[multiScatteringW * multiScatteringH]
+
+	U64 key;				//AtmosphereLUT_getKey of the parameters it was generated with
+
+	F32 planetRadius, atmosphereRadius;
+
+} AtmosphereLUT;
+
+//Hash of all parameters the LUTs depend on (so excluding the sun and sample counts)
+
+U64 AtmosphereLUT_getKey(const Atmosphere *atmos);
+
+Bool AtmosphereLUT_createx(const Atmosphere *atmos, AtmosphereLUT *lut, Error *e_rr);
+
+//Reads the LUTs from cachePath if they were generated with the same parameters, otherwise creates and writes them.
+//Failing to read or write the cache isn't an error, it just means the LUTs have to be generated.
+
+Bool AtmosphereLUT_loadOrCreatex(const Atmosphere *atmos, CharString cachePath, AtmosphereLUT *lut, Error *e_rr);
+
+Bool AtmosphereLUT_writex(const AtmosphereLUT *lut, CharString path, Error *e_rr);
+void AtmosphereLUT_freex(AtmosphereLUT *lut);
+
+//RGBA16f copies for upload to the GPU
+
+Bool AtmosphereLUT_toF16x(const AtmosphereLUT *lut, Buffer *transmittance, Buffer *multiScattering, Error *e_rr);
+
+const F32x4 *AtmosphereLUT_getTransmittance(const AtmosphereLUT *lut);
+const F32x4 *AtmosphereLUT_getMultiScattering(const AtmosphereLUT *lut);
+
+//r is the distance to the planet center, mu the cosine of the angle between the direction and the zenith.
+//Transmittance is 0 if the direction hits the planet (the shader doesn't handle this when ray marching).
+
+F32x4 AtmosphereLUT_sampleTransmittance(const AtmosphereLUT *lut, F32 r, F32 mu);
+F32x4 AtmosphereLUT_sampleMultiScattering(const AtmosphereLUT *lut, F32 r, F32 muS);
+
+//Same as Atmosphere_getContribution, but the light is sampled from the LUTs rather than ray marched.
+//multiScattering can be turned off to compare against the single scattering that's ray marched.
+
+F32x4 Atmosphere_getContributionLUT(const Atmosphere *atmos, const AtmosphereLUT *lut, RayDesc ray, Bool multiScattering);
+
+#ifdef __cplusplus
+	}
+#endif
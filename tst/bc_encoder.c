@@ -0,0 +1,694 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#include "bc_encoder.h"
+#include "parallel.h"
+#include "formats/dds/dds.h"
+#include "platforms/ext/bufferx.h"
+#include "types/math/vec.h"
+#include "types/math/math.h"
+
+const C8 *EBCFormat_names[EBCFormat_Count] = { "BC1", "BC3", "BC7" };
+
+static const U8 BCEncoder_bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+U64 BCEncoder_getSize(EBCFormat format, U32 w, U32 h) {
+	const U64 blocks = (U64)((w + 3) >> 2) * ((h + 3) >> 2);
+	return blocks * (format == EBCFormat_BC1 ? 8 : 16);
+}
+
+//Block helpers
+
+static void BCEncoder_loadBlock(const U8 *src, U32 w, U32 h, U32 bx, U32 by, Bool isBGRA, F32x4 px[16]) {
+
+	for(U32 i = 0; i < 16; ++i) {
+
+		const U32 x = U32_min(bx * 4 + (i & 3), w - 1);
+		const U32 y = U32_min(by * 4 + (i >> 2), h - 1);
+		const U8 *p = src + ((U64)y * w + x) * 4;
+
+		px[i] = F32x4_create4(p[isBGRA ? 2 : 0], p[1], p[isBGRA ? 0 : 2], p[3]);
+	}
+}
+
+//Principal axis of the block through power iteration (without building the covariance matrix: C * v = sum(d * dot(d, v))).
+//mask zeroes channels that shouldn't be considered (alpha for the color endpoints of BC1/BC3).
+//Returns false if the block is (close to) a single color.
+
+static Bool BCEncoder_getAxis(const F32x4 px[16], F32x4 mask, F32x4 *mean, F32x4 *axis) {
+
+	F32x4 sum = F32x4_zero(), mini = px[0], maxi = px[0];
+
+	for(U32 i = 0; i < 16; ++i) {
+		sum = F32x4_add(sum, px[i]);
+		mini = F32x4_min(mini, px[i]);
+		maxi = F32x4_max(maxi, px[i]);
+	}
+
+	*mean = F32x4_mul(sum, F32x4_xxxx4(1 / 16.f));
+
+	F32x4 v = F32x4_mul(F32x4_sub(maxi, mini), mask);
+
+	if(F32x4_dot4(v, v) < 1e-4f)
+		return false;
+
+	for(U32 j = 0; j < 4; ++j) {
+
+		F32x4 next = F32x4_zero();
+
+		for(U32 i = 0; i < 16; ++i) {
+			const F32x4 d = F32x4_mul(F32x4_sub(px[i], *mean), mask);
+			next = F32x4_add(next, F32x4_mul(d, F32x4_xxxx4(F32x4_dot4(d, v))));
+		}
+
+		const F32 len2 = F32x4_dot4(next, next);
+
+		if(len2 < 1e-8f)
+			break;
+
+		v = F32x4_mul(next, F32x4_xxxx4(1 / F32_sqrt(len2)));
+	}
+
+	*axis = v;
+	return true;
+}
+
+//Extremes of the block along the axis
+
+static void BCEncoder_getEndpoints(
+	const F32x4 px[16], F32x4 mask, F32x4 mean, F32x4 axis, F32x4 *e0, F32x4 *e1
+) {
+
+	F32 tMin = F32_MAX, tMax = -F32_MAX;
+
+	for(U32 i = 0; i < 16; ++i) {
+		const F32 t = F32x4_dot4(F32x4_mul(F32x4_sub(px[i], mean), mask), axis);
+		tMin = F32_min(tMin, t);
+		tMax = F32_max(tMax, t);
+	}
+
+	const F32x4 lo = F32x4_zero(), hi = F32x4_xxxx4(255);
+	*e0 = F32x4_clamp(F32x4_add(mean, F32x4_mul(axis, F32x4_xxxx4(tMin))), lo, hi);
+	*e1 = F32x4_clamp(F32x4_add(mean, F32x4_mul(axis, F32x4_xxxx4(tMax))), lo, hi);
+}
+
+//BC1 color block (also used by BC3, which always uses 4 colors)
+
+static U16 BCEncoder_to565(F32x4 c) {
+	const U16 r = (U16) F32_round(F32x4_x(c) * (31 / 255.f));
+	const U16 g = (U16) F32_round(F32x4_y(c) * (63 / 255.f));
+	const U16 b = (U16) F32_round(F32x4_z(c) * (31 / 255.f));
+	return (U16)((r << 11) | (g << 5) | b);
+}
+
+static F32x4 BCEncoder_from565(U16 c) {
+	const U32 r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+	return F32x4_create4((F32)((r << 3) | (r >> 2)), (F32)((g << 2) | (g >> 4)), (F32)((b << 3) | (b >> 2)), 255);
+}
+
+static void BCEncoder_encodeColor(const F32x4 px[16], U8 *dst) {
+
+	const F32x4 rgb = F32x4_create4(1, 1, 1, 0);
+	F32x4 mean, axis, e0, e1;
+
+	U16 c0, c1;
+	U32 indices = 0;
+
+	if(!BCEncoder_getAxis(px, rgb, &mean, &axis))
+		c0 = c1 = BCEncoder_to565(mean);
+
+	else {
+
+		BCEncoder_getEndpoints(px, rgb, mean, axis, &e1, &e0);
+		c0 = BCEncoder_to565(e0);
+		c1 = BCEncoder_to565(e1);
+
+		//4 color mode requires c0 > c1
+
+		if(c0 < c1) {
+			const U16 tmp = c0;
+			c0 = c1;
+			c1 = tmp;
+		}
+	}
+
+	if(c0 != c1) {
+
+		//Project on the quantized endpoints; palette order is c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+
+		static const U8 remap[4] = { 0, 2, 3, 1 };
+
+		const F32x4 q0 = F32x4_mul(BCEncoder_from565(c0), rgb);
+		const F32x4 dir = F32x4_sub(F32x4_mul(BCEncoder_from565(c1), rgb), q0);
+		const F32 scale = 3 / F32x4_dot4(dir, dir);
+
+		for(U32 i = 0; i < 16; ++i) {
+			const F32 t = F32x4_dot4(F32x4_sub(F32x4_mul(px[i], rgb), q0), dir) * scale;
+			indices |= (U32) remap[(U32) F32_clamp(F32_round(t), 0, 3)] << (i * 2);
+		}
+	}
+
+	dst[0] = (U8) c0;
+	dst[1] = (U8)(c0 >> 8);
+	dst[2] = (U8) c1;
+	dst[3] = (U8)(c1 >> 8);
+
+	for(U32 i = 0; i < 4; ++i)
+		dst[4 + i] = (U8)(indices >> (i * 8));
+}
+
+//BC3 alpha block (a0 > a1: 8 values)
+
+static void BCEncoder_encodeAlpha(const F32x4 px[16], U8 *dst) {
+
+	F32 aMin = 255, aMax = 0;
+
+	for(U32 i = 0; i < 16; ++i) {
+		aMin = F32_min(aMin, F32x4_w(px[i]));
+		aMax = F32_max(aMax, F32x4_w(px[i]));
+	}
+
+	const U8 a0 = (U8) F32_round(aMax), a1 = (U8) F32_round(aMin);
+	U64 indices = 0;
+
+	if(a0 != a1) {
+
+		//Palette order is a0, a1, then 6 steps from a0 to a1
+
+		static const U8 remap[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+		const F32 scale = 7.f / (a0 - a1);
+
+		for(U32 i = 0; i < 16; ++i) {
+			const F32 t = (a0 - F32x4_w(px[i])) * scale;
+			indices |= (U64) remap[(U32) F32_clamp(F32_round(t), 0, 7)] << (i * 3);
+		}
+	}
+
+	dst[0] = a0;
+	dst[1] = a1;
+
+	for(U32 i = 0; i < 6; ++i)
+		dst[2 + i] = (U8)(indices >> (i * 8));
+}
+
+//BC7 mode 6
+
+typedef struct BC7Endpoints {
+	U8 c[2][4];				//7 bits per channel
+	U8 p[2];
+} BC7Endpoints;
+
+static F32x4 BCEncoder_bc7Unpack(const BC7Endpoints *e, U32 i) {
+	return F32x4_create4(
+		(F32)((e->c[i][0] << 1) | e->p[i]), (F32)((e->c[i][1] << 1) | e->p[i]),
+		(F32)((e->c[i][2] << 1) | e->p[i]), (F32)((e->c[i][3] << 1) | e->p[i])
+	);
+}
+
+//Pick the p-bit that has the lowest error for the endpoint
+
+static void BCEncoder_bc7Quantize(F32x4 e, BC7Endpoints *out, U32 i) {
+
+	F32 bestError = F32_MAX;
+
+	for(U8 p = 0; p < 2; ++p) {
+
+		U8 c[4];
+		F32 error = 0;
+
+		for(U8 j = 0; j < 4; ++j) {
+			const F32 v = F32x4_get(e, j);
+			c[j] = (U8) F32_clamp(F32_round((v - p) * 0.5f), 0, 127);
+			const F32 d = (F32)((c[j] << 1) | p) - v;
+			error += d * d;
+		}
+
+		if(error < bestError) {
+			bestError = error;
+			out->p[i] = p;
+			for(U8 j = 0; j < 4; ++j)
+				out->c[i][j] = c[j];
+		}
+	}
+}
+
+//Picks the best index per pixel for the quantized endpoints (projection, then the neighbors are checked)
+
+static F32 BCEncoder_bc7Indices(const F32x4 px[16], const BC7Endpoints *e, U8 indices[16]) {
+
+	const F32x4 q0 = BCEncoder_bc7Unpack(e, 0), q1 = BCEncoder_bc7Unpack(e, 1);
+	const F32x4 dir = F32x4_sub(q1, q0);
+	const F32 len2 = F32x4_dot4(dir, dir);
+	const F32 scale = len2 > 0 ? 15 / len2 : 0;
+
+	F32 total = 0;
+
+	for(U32 i = 0; i < 16; ++i) {
+
+		const I32 guess = (I32) F32_clamp(F32_round(F32x4_dot4(F32x4_sub(px[i], q0), dir) * scale), 0, 15);
+		F32 best = F32_MAX;
+
+		for(I32 j = I32_max(guess - 1, 0); j <= I32_min(guess + 1, 15); ++j) {
+
+			const F32x4 w1 = F32x4_xxxx4((F32) BCEncoder_bc7Weights[j]);
+			const F32x4 w0 = F32x4_xxxx4((F32)(64 - BCEncoder_bc7Weights[j]));
+
+			//Same as the decoder: (e0 * (64 - w) + e1 * w + 32) >> 6
+
+			const F32x4 c = F32x4_floor(F32x4_mul(
+				F32x4_add(F32x4_add(F32x4_mul(q0, w0), F32x4_mul(q1, w1)), F32x4_xxxx4(32)), F32x4_xxxx4(1 / 64.f)
+			));
+
+			const F32x4 d = F32x4_sub(c, px[i]);
+			const F32 error = F32x4_dot4(d, d);
+
+			if(error < best) {
+				best = error;
+				indices[i] = (U8) j;
+			}
+		}
+
+		total += best;
+	}
+
+	return total;
+}
+
+//Least squares endpoints for the given indices: minimizes sum |(1 - w) e0 + w e1 - px|^2
+
+static Bool BCEncoder_bc7Refit(const F32x4 px[16], const U8 indices[16], F32x4 *e0, F32x4 *e1) {
+
+	F32 aa = 0, ab = 0, bb = 0;
+	F32x4 ax = F32x4_zero(), bx = F32x4_zero();
+
+	for(U32 i = 0; i < 16; ++i) {
+
+		const F32 b = BCEncoder_bc7Weights[indices[i]] / 64.f, a = 1 - b;
+
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+
+		ax = F32x4_add(ax, F32x4_mul(px[i], F32x4_xxxx4(a)));
+		bx = F32x4_add(bx, F32x4_mul(px[i], F32x4_xxxx4(b)));
+	}
+
+	const F32 det = aa * bb - ab * ab;
+
+	if(F32_abs(det) < 1e-6f)
+		return false;
+
+	const F32 invDet = 1 / det;
+	const F32x4 lo = F32x4_zero(), hi = F32x4_xxxx4(255);
+
+	*e0 = F32x4_clamp(F32x4_mul(F32x4_sub(F32x4_mul(ax, F32x4_xxxx4(bb)), F32x4_mul(bx, F32x4_xxxx4(ab))), F32x4_xxxx4(invDet)), lo, hi);
+	*e1 = F32x4_clamp(F32x4_mul(F32x4_sub(F32x4_mul(bx, F32x4_xxxx4(aa)), F32x4_mul(ax, F32x4_xxxx4(ab))), F32x4_xxxx4(invDet)), lo, hi);
+	return true;
+}
+
+typedef struct BCBits {
+	U64 v[2];
+	U32 offset;
+} BCBits;
+
+static void BCBits_write(BCBits *bits, U32 value, U32 count) {
+
+	for(U32 i = 0; i < count; ++i, ++bits->offset)
+		bits->v[bits->offset >> 6] |= (U64)((value >> i) & 1) << (bits->offset & 63);
+}
+
+static U32 BCBits_read(BCBits *bits, U32 count) {
+
+	U32 value = 0;
+
+	for(U32 i = 0; i < count; ++i, ++bits->offset)
+		value |= (U32)((bits->v[bits->offset >> 6] >> (bits->offset & 63)) & 1) << i;
+
+	return value;
+}
+
+static void BCEncoder_encodeBC7(const F32x4 px[16], U8 *dst) {
+
+	const F32x4 rgba = F32x4_one();
+	F32x4 mean, axis, e0, e1;
+
+	BC7Endpoints best = (BC7Endpoints) { 0 };
+	U8 bestIndices[16] = { 0 };
+	F32 bestError;
+
+	if(!BCEncoder_getAxis(px, rgba, &mean, &axis))
+		e0 = e1 = mean;
+
+	else BCEncoder_getEndpoints(px, rgba, mean, axis, &e0, &e1);
+
+	BCEncoder_bc7Quantize(e0, &best, 0);
+	BCEncoder_bc7Quantize(e1, &best, 1);
+	bestError = BCEncoder_bc7Indices(px, &best, bestIndices);
+
+	//Refine endpoints for the chosen indices; only keep it if it's actually better after quantization
+
+	for(U32 j = 0; j < 2 && bestError > 0; ++j) {
+
+		if(!BCEncoder_bc7Refit(px, bestIndices, &e0, &e1))
+			break;
+
+		BC7Endpoints refined = (BC7Endpoints) { 0 };
+		U8 indices[16];
+
+		BCEncoder_bc7Quantize(e0, &refined, 0);
+		BCEncoder_bc7Quantize(e1, &refined, 1);
+		const F32 error = BCEncoder_bc7Indices(px, &refined, indices);
+
+		if(error >= bestError)
+			break;
+
+		bestError = error;
+		best = refined;
+
+		for(U32 i = 0; i < 16; ++i)
+			bestIndices[i] = indices[i];
+	}
+
+	//The MSB of the first index is implicitly 0; swap endpoints if it isn't
+
+	if(bestIndices[0] >= 8) {
+
+		const BC7Endpoints tmp = best;
+
+		for(U32 i = 0; i < 2; ++i) {
+			best.p[i] = tmp.p[1 - i];
+			for(U32 j = 0; j < 4; ++j)
+				best.c[i][j] = tmp.c[1 - i][j];
+		}
+
+		for(U32 i = 0; i < 16; ++i)
+			bestIndices[i] = 15 - bestIndices[i];
+	}
+
+	BCBits bits = (BCBits) { 0 };
+	BCBits_write(&bits, 1 << 6, 7);
+
+	for(U32 j = 0; j < 4; ++j)
+		for(U32 i = 0; i < 2; ++i)
+			BCBits_write(&bits, best.c[i][j], 7);
+
+	BCBits_write(&bits, best.p[0], 1);
+	BCBits_write(&bits, best.p[1], 1);
+
+	for(U32 i = 0; i < 16; ++i)
+		BCBits_write(&bits, bestIndices[i], i ? 4 : 3);
+
+	for(U32 i = 0; i < 16; ++i)
+		dst[i] = (U8)(bits.v[i >> 3] >> ((i & 7) * 8));
+}
+
+//Encoding jobs, one row of blocks each
+
+typedef struct BCEncodeJob {
+	EBCFormat format;
+	Bool isBGRA;
+	U32 w, h;
+	const U8 *src;
+	U8 *dst;
+} BCEncodeJob;
+
+static void BCEncoder_encodeRow(void *userData, U64 jobId, U64 threadId) {
+
+	(void) threadId;
+
+	const BCEncodeJob *job = (const BCEncodeJob*) userData;
+	const U32 blocksX = (job->w + 3) >> 2;
+	const U32 blockSize = job->format == EBCFormat_BC1 ? 8 : 16;
+
+	U8 *dst = job->dst + jobId * blocksX * blockSize;
+	F32x4 px[16];
+
+	for(U32 bx = 0; bx < blocksX; ++bx, dst += blockSize) {
+
+		BCEncoder_loadBlock(job->src, job->w, job->h, bx, (U32) jobId, job->isBGRA, px);
+
+		switch (job->format) {
+
+			case EBCFormat_BC1:
+				BCEncoder_encodeColor(px, dst);
+				break;
+
+			case EBCFormat_BC3:
+				BCEncoder_encodeAlpha(px, dst);
+				BCEncoder_encodeColor(px, dst + 8);
+				break;
+
+			default:
+				BCEncoder_encodeBC7(px, dst);
+				break;
+		}
+	}
+}
+
+Bool BCEncoder_encodex(EBCFormat format, Buffer src, U32 w, U32 h, Bool isBGRA, Buffer *output, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!output)
+		retError(clean, Error_nullPointer(5, "BCEncoder_encodex()::output is required"))
+
+	if(output->ptr)
+		retError(clean, Error_invalidParameter(5, 0, "BCEncoder_encodex()::output wasn't empty, might indicate memleak"))
+
+	if(format >= EBCFormat_Count)
+		retError(clean, Error_invalidParameter(0, 0, "BCEncoder_encodex()::format is invalid"))
+
+	if(!w || !h || Buffer_length(src) < (U64) w * h * 4)
+		retError(clean, Error_invalidParameter(1, 0, "BCEncoder_encodex()::src should contain w * h RGBA8 pixels"))
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(BCEncoder_getSize(format, w, h), output))
+
+	BCEncodeJob job = (BCEncodeJob) {
+		.format = format, .isBGRA = isBGRA, .w = w, .h = h, .src = src.ptr, .dst = output->ptrNonConst
+	};
+
+	gotoIfError3(clean, Parallel_for((h + 3) >> 2, BCEncoder_encodeRow, &job, e_rr))
+
+clean:
+
+	if(!s_uccess && output)
+		Buffer_freex(output);
+
+	return s_uccess;
+}
+
+//Decoding
+
+static void BCEncoder_decodeColor(const U8 *src, Bool allowAlpha, U8 out[16][4]) {
+
+	const U16 c0 = (U16)(src[0] | (src[1] << 8)), c1 = (U16)(src[2] | (src[3] << 8));
+	const U32 indices = (U32) src[4] | ((U32) src[5] << 8) | ((U32) src[6] << 16) | ((U32) src[7] << 24);
+
+	U8 palette[4][4];
+	const F32x4 p0 = BCEncoder_from565(c0), p1 = BCEncoder_from565(c1);
+
+	for(U32 j = 0; j < 4; ++j) {
+
+		const U32 a = (U32) F32x4_get(p0, (U8) j), b = (U32) F32x4_get(p1, (U8) j);
+
+		palette[0][j] = (U8) a;
+		palette[1][j] = (U8) b;
+
+		if(c0 > c1 || !allowAlpha) {
+			palette[2][j] = (U8)((2 * a + b) / 3);
+			palette[3][j] = (U8)((a + 2 * b) / 3);
+		}
+
+		else {
+			palette[2][j] = (U8)((a + b) / 2);
+			palette[3][j] = 0;				//Transparent black
+		}
+	}
+
+	for(U32 i = 0; i < 16; ++i)
+		for(U32 j = 0; j < 4; ++j)
+			out[i][j] = palette[(indices >> (i * 2)) & 3][j];
+}
+
+static void BCEncoder_decodeAlpha(const U8 *src, U8 out[16][4]) {
+
+	const U32 a0 = src[0], a1 = src[1];
+	U64 indices = 0;
+
+	for(U32 i = 0; i < 6; ++i)
+		indices |= (U64) src[2 + i] << (i * 8);
+
+	U8 palette[8] = { (U8) a0, (U8) a1 };
+
+	for(U32 i = 1; i < 7; ++i)
+		palette[i + 1] = a0 > a1 ?
+			(U8)(((7 - i) * a0 + i * a1) / 7) :
+			(i < 5 ? (U8)(((5 - i) * a0 + i * a1) / 5) : (i == 5 ? 0 : 255));
+
+	for(U32 i = 0; i < 16; ++i)
+		out[i][3] = palette[(indices >> (i * 3)) & 7];
+}
+
+static Bool BCEncoder_decodeBC7(const U8 *src, U8 out[16][4]) {
+
+	BCBits bits = (BCBits) { 0 };
+
+	for(U32 i = 0; i < 16; ++i)
+		bits.v[i >> 3] |= (U64) src[i] << ((i & 7) * 8);
+
+	if(BCBits_read(&bits, 7) != 1 << 6)
+		return false;
+
+	U32 c[2][4];
+
+	for(U32 j = 0; j < 4; ++j)
+		for(U32 i = 0; i < 2; ++i)
+			c[i][j] = BCBits_read(&bits, 7) << 1;
+
+	const U32 p0 = BCBits_read(&bits, 1), p1 = BCBits_read(&bits, 1);
+
+	for(U32 j = 0; j < 4; ++j) {
+		c[0][j] |= p0;
+		c[1][j] |= p1;
+	}
+
+	for(U32 i = 0; i < 16; ++i) {
+
+		const U32 w = BCEncoder_bc7Weights[BCBits_read(&bits, i ? 4 : 3)];
+
+		for(U32 j = 0; j < 4; ++j)
+			out[i][j] = (U8)((c[0][j] * (64 - w) + c[1][j] * w + 32) >> 6);
+	}
+
+	return true;
+}
+
+Bool BCEncoder_decodex(EBCFormat format, Buffer blocks, U32 w, U32 h, Buffer *output, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!output)
+		retError(clean, Error_nullPointer(4, "BCEncoder_decodex()::output is required"))
+
+	if(output->ptr)
+		retError(clean, Error_invalidParameter(4, 0, "BCEncoder_decodex()::output wasn't empty, might indicate memleak"))
+
+	if(format >= EBCFormat_Count)
+		retError(clean, Error_invalidParameter(0, 0, "BCEncoder_decodex()::format is invalid"))
+
+	if(!w || !h || Buffer_length(blocks) < BCEncoder_getSize(format, w, h))
+		retError(clean, Error_invalidParameter(1, 0, "BCEncoder_decodex()::blocks is too small"))
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx((U64) w * h * 4, output))
+
+	const U32 blocksX = (w + 3) >> 2, blocksY = (h + 3) >> 2;
+	const U32 blockSize = format == EBCFormat_BC1 ? 8 : 16;
+
+	for(U32 by = 0; by < blocksY; ++by)
+		for(U32 bx = 0; bx < blocksX; ++bx) {
+
+			const U8 *src = blocks.ptr + ((U64) by * blocksX + bx) * blockSize;
+			U8 block[16][4];
+
+			switch (format) {
+
+				case EBCFormat_BC1:
+					BCEncoder_decodeColor(src, true, block);
+					break;
+
+				case EBCFormat_BC3:
+					BCEncoder_decodeColor(src + 8, false, block);
+					BCEncoder_decodeAlpha(src, block);
+					break;
+
+				default:
+
+					if(!BCEncoder_decodeBC7(src, block))
+						retError(clean, Error_unsupportedOperation(0, "BCEncoder_decodex() only supports BC7 mode 6"))
+
+					break;
+			}
+
+			for(U32 i = 0; i < 16; ++i) {
+
+				const U32 x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+
+				if(x >= w || y >= h)
+					continue;
+
+				U8 *dst = output->ptrNonConst + ((U64) y * w + x) * 4;
+
+				for(U32 j = 0; j < 4; ++j)
+					dst[j] = block[i][j];
+			}
+		}
+
+clean:
+
+	if(!s_uccess && output)
+		Buffer_freex(output);
+
+	return s_uccess;
+}
+
+F64 BCEncoder_getPSNR(Buffer a, Buffer b, U64 pixels, U8 channels) {
+
+	pixels = U64_min(pixels, U64_min(Buffer_length(a), Buffer_length(b)) / 4);
+	channels = (U8) U64_min(U64_max(channels, 1), 4);
+
+	U64 error = 0;
+
+	for(U64 i = 0; i < pixels; ++i)
+		for(U8 j = 0; j < channels; ++j) {
+			const I32 d = (I32) a.ptr[i * 4 + j] - (I32) b.ptr[i * 4 + j];
+			error += (U64)(d * d);
+		}
+
+	if(!error || !pixels)
+		return F64_MAX;
+
+	const F64 mse = (F64) error / (F64)(pixels * channels);
+	return 10 * F64_log10(255 * 255 / mse);
+}
+
+Bool BCEncoder_writeDDSx(EBCFormat format, Buffer blocks, U32 w, U32 h, Buffer *output, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(format != EBCFormat_BC7)
+		retError(clean, Error_invalidParameter(0, 0, "BCEncoder_writeDDSx() only supports BC7"))
+
+	if(w >> 16 || h >> 16 || Buffer_length(blocks) != BCEncoder_getSize(format, w, h))
+		retError(clean, Error_invalidParameter(1, 0, "BCEncoder_writeDDSx() blocks or resolution is invalid"))
+
+	SubResourceData sub = (SubResourceData) { .data = blocks };
+	ListSubResourceData subResources = (ListSubResourceData) { 0 };
+	gotoIfError2(clean, ListSubResourceData_createRefConst(&sub, 1, &subResources))
+
+	const DDSInfo info = (DDSInfo) {
+		.w = w, .h = h, .l = 1, .mips = 1,
+		.type = ETextureType_2D,
+		.textureFormatId = ETextureFormatId_BC7
+	};
+
+	gotoIfError2(clean, DDS_writex(subResources, info, output))
+
+clean:
+	return s_uccess;
+}
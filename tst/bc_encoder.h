@@ -0,0 +1,68 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#pragma once
+#include "types/container/buffer.h"
+#include "types/base/error.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Block compression of 8-bit images into BCn, so images that are only available uncompressed (e.g. BMP)
+//don't have to be uploaded as RGBA8. Blocks are encoded on all threads (see Parallel_for), one row of blocks per job.
+//
+//BC1 and BC3 are the fast modes: endpoints are the extremes along the principal axis of the block.
+//BC7 is the quality mode: it only uses mode 6 (one subset, RGBA 7.7.7.7 + p-bit, 4-bit indices), but the endpoints
+//are refined with a least squares fit and the indices are picked by the actual interpolated colors.
+//
+//Blocks on the edge of an image that isn't a multiple of 4 repeat the last row/column.
+
+typedef enum EBCFormat {
+	EBCFormat_BC1,				//RGB, 8 bytes per block, alpha is ignored
+	EBCFormat_BC3,				//RGBA, 16 bytes per block
+	EBCFormat_BC7,				//RGBA, 16 bytes per block
+	EBCFormat_Count
+} EBCFormat;
+
+extern const C8 *EBCFormat_names[EBCFormat_Count];
+
+U64 BCEncoder_getSize(EBCFormat format, U32 w, U32 h);
+
+//src is RGBA8 (or BGRA8 if isBGRA) w * h * 4, output is allocated
+
+Bool BCEncoder_encodex(EBCFormat format, Buffer src, U32 w, U32 h, Bool isBGRA, Buffer *output, Error *e_rr);
+
+//Decodes into RGBA8 to verify the encoder; BC7 only supports mode 6 (what the encoder outputs)
+
+Bool BCEncoder_decodex(EBCFormat format, Buffer blocks, U32 w, U32 h, Buffer *output, Error *e_rr);
+
+//Peak signal to noise ratio in dB of two RGBA8 images over the first channels (3 = RGB, 4 = RGBA).
+//Identical images return F64_MAX.
+
+F64 BCEncoder_getPSNR(Buffer a, Buffer b, U64 pixels, U8 channels);
+
+//Writes BC7 blocks as a DDS (through DDS_writex) so they can be cached.
+//OxC3 only has texture formats for BC4-BC7, so BC1 and BC3 can't be written.
+
+Bool BCEncoder_writeDDSx(EBCFormat format, Buffer blocks, U32 w, U32 h, Buffer *output, Error *e_rr);
+
+#ifdef __cplusplus
+	}
+#endif
@@ -0,0 +1,138 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#include "camera.h"
+#include "types/math/math.h"
+
+void Camera_mul(F32x4 dst[4], const F32x4 a[4], const F32x4 b[4]) {
+
+	for(U8 i = 0; i < 4; ++i) {
+
+		const F32x4 row = a[i];
+
+		F32x4 res = F32x4_mul(F32x4_xxxx4(F32x4_x(row)), b[0]);
+		res = F32x4_add(res, F32x4_mul(F32x4_xxxx4(F32x4_y(row)), b[1]));
+		res = F32x4_add(res, F32x4_mul(F32x4_xxxx4(F32x4_z(row)), b[2]));
+		dst[i] = F32x4_add(res, F32x4_mul(F32x4_xxxx4(F32x4_w(row)), b[3]));
+	}
+}
+
+//lookDir is [ right, up, back, pos ]^-1, so the inverse is simply the camera's frame
+
+static void Camera_lookDir(const Camera *camera, F32x4 view[4], F32x4 viewInv[4]) {
+
+	const F32x4 back = F32x4_normalize3(F32x4_negate(camera->dir));
+	const F32x4 right = F32x4_normalize3(F32x4_cross3(camera->up, back));
+	const F32x4 up = F32x4_cross3(back, right);
+	const F32x4 pos = camera->pos;
+
+	viewInv[0] = right;
+	viewInv[1] = up;
+	viewInv[2] = back;
+	viewInv[3] = F32x4_create4(F32x4_x(pos), F32x4_y(pos), F32x4_z(pos), 1);
+
+	view[0] = F32x4_create4(F32x4_x(right), F32x4_x(up), F32x4_x(back), 0);
+	view[1] = F32x4_create4(F32x4_y(right), F32x4_y(up), F32x4_y(back), 0);
+	view[2] = F32x4_create4(F32x4_z(right), F32x4_z(up), F32x4_z(back), 0);
+	view[3] = F32x4_create4(-F32x4_dot3(right, pos), -F32x4_dot3(up, pos), -F32x4_dot3(back, pos), 1);
+}
+
+//Right handed perspective with depth in [0, 1] (F32x4x4_perspective)
+
+static void Camera_perspective(const Camera *camera, F32 aspect, F32x4 proj[4], F32x4 projInv[4]) {
+
+	const F32 yScale = 1 / F32_tan(camera->fovYDeg * F32_DEG_TO_RAD * 0.5f);
+	const F32 xScale = yScale / aspect;
+
+	const F32 n = camera->nearPlane, f = camera->farPlane;
+	const F32 a = f / (n - f), b = n * f / (n - f);
+
+	proj[0] = F32x4_create4(xScale, 0, 0, 0);
+	proj[1] = F32x4_create4(0, yScale, 0, 0);
+	proj[2] = F32x4_create4(0, 0, a, -1);
+	proj[3] = F32x4_create4(0, 0, b, 0);
+
+	//clip = (x * xScale, y * yScale, z * a + b, -z) -> z = -clip.w, w = (clip.z + a * clip.w) / b
+
+	projInv[0] = F32x4_create4(1 / xScale, 0, 0, 0);
+	projInv[1] = F32x4_create4(0, 1 / yScale, 0, 0);
+	projInv[2] = F32x4_create4(0, 0, 0, 1 / b);
+	projInv[3] = F32x4_create4(0, 0, -1, a / b);
+}
+
+CameraMatrices Camera_getMatrices(const Camera *camera, F32 aspect, U32 orientation) {
+
+	CameraMatrices res;
+
+	F32x4 view[4], viewInv[4];
+	Camera_lookDir(camera, view, viewInv);
+
+	//Rotation around Z (F32x4x4_rotateZ) applied after the view, its inverse is the transpose
+
+	if(orientation % 360) {
+
+		const F32 rad = (F32) orientation * F32_DEG_TO_RAD;
+		const F32 c = F32_cos(rad), s = F32_sin(rad);
+
+		const F32x4 rot[4] = {
+			F32x4_create4(c, s, 0, 0),
+			F32x4_create4(-s, c, 0, 0),
+			F32x4_create4(0, 0, 1, 0),
+			F32x4_create4(0, 0, 0, 1)
+		};
+
+		const F32x4 rotInv[4] = {
+			F32x4_create4(c, -s, 0, 0),
+			F32x4_create4(s, c, 0, 0),
+			F32x4_create4(0, 0, 1, 0),
+			F32x4_create4(0, 0, 0, 1)
+		};
+
+		Camera_mul(res.view, view, rot);
+		Camera_mul(res.viewInv, rotInv, viewInv);
+	}
+
+	else for(U8 i = 0; i < 4; ++i) {
+		res.view[i] = view[i];
+		res.viewInv[i] = viewInv[i];
+	}
+
+	Camera_perspective(camera, aspect, res.proj, res.projInv);
+
+	Camera_mul(res.viewProj, res.view, res.proj);
+	Camera_mul(res.viewProjInv, res.projInv, res.viewInv);
+	return res;
+}
+
+F32x4 Camera_getDir(const CameraMatrices *matrices, F32 ndcX, F32 ndcY) {
+
+	//Point on the far plane (depth = 1)
+
+	const F32x4 *m = matrices->viewProjInv;
+
+	F32x4 p = F32x4_add(
+		F32x4_add(F32x4_mul(F32x4_xxxx4(ndcX), m[0]), F32x4_mul(F32x4_xxxx4(ndcY), m[1])),
+		F32x4_add(m[2], m[3])
+	);
+
+	p = F32x4_div(p, F32x4_xxxx4(F32x4_w(p)));
+
+	const F32x4 eye = matrices->viewInv[3];
+	return F32x4_normalize3(F32x4_create3(F32x4_x(p) - F32x4_x(eye), F32x4_y(p) - F32x4_y(eye), F32x4_z(p) - F32x4_z(eye)));
+}
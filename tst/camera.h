@@ -0,0 +1,60 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#pragma once
+#include "types/math/vec.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//CPU side of camera.hlsli; matrices are built (and inverted) once per frame instead of for every pixel.
+//Matrices are row major and used as row vectors (mul(F32x4(pos, 1), m) in HLSL), same as F32x4x4 in the shaders.
+
+typedef struct CameraMatrices {		//Same layout as ViewProjMatrices in resource_bindings.hlsli
+	F32x4 view[4], proj[4], viewProj[4];
+	F32x4 viewInv[4], projInv[4], viewProjInv[4];
+} CameraMatrices;
+
+typedef struct Camera {
+
+	F32x4 pos, dir, up;			//Right handed, looking towards dir
+
+	F32 fovYDeg;
+	F32 nearPlane, farPlane;
+
+} Camera;
+
+//aspect is width / height, orientation (0, 90, 180 or 270) rotates the view around Z like the swapchain does.
+//Inverses are closed form (a view is a rigid transform, a projection only has 6 non zero elements),
+//so there's no generic 4x4 inverse.
+
+CameraMatrices Camera_getMatrices(const Camera *camera, F32 aspect, U32 orientation);
+
+//Normalized world space direction from the camera through a point in NDC (x right, y up, both in [-1, 1])
+
+F32x4 Camera_getDir(const CameraMatrices *matrices, F32 ndcX, F32 ndcY);
+
+//dst = a * b for row major 4x4 matrices; dst may not alias a or b
+
+void Camera_mul(F32x4 dst[4], const F32x4 a[4], const F32x4 b[4]);
+
+#ifdef __cplusplus
+	}
+#endif
@@ -0,0 +1,824 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "cpu_as.h"
+#include "parallel.h"
+#include "platforms/ext/bufferx.h"
+#include "types/base/time.h"
+#include "types/math/flp.h"
+#include "types/math/math.h"
+
+//BLAS
+
+static Bool CpuBLAS_loadPosition(ETextureFormatId format, const U8 *ptr, F32x4 *pos) {
+
+	const F16 *f16 = (const F16*) ptr;
+	const F32 *f32 = (const F32*) ptr;
+
+	switch(format) {
+
+		case ETextureFormatId_RG16f:
+			*pos = F32x4_create3(F16_castF32(f16[0]), F16_castF32(f16[1]), 0);
+			return true;
+
+		case ETextureFormatId_RGBA16f:
+			*pos = F32x4_create3(F16_castF32(f16[0]), F16_castF32(f16[1]), F16_castF32(f16[2]));
+			return true;
+
+		case ETextureFormatId_RG32f:
+			*pos = F32x4_create3(f32[0], f32[1], 0);
+			return true;
+
+		case ETextureFormatId_RGB32f:
+		case ETextureFormatId_RGBA32f:
+			*pos = F32x4_create3(f32[0], f32[1], f32[2]);
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+static U64 CpuBLAS_getPositionSize(ETextureFormatId format) {
+	switch(format) {
+		case ETextureFormatId_RG16f:	return sizeof(F16) * 2;
+		case ETextureFormatId_RGBA16f:	return sizeof(F16) * 4;
+		case ETextureFormatId_RG32f:	return sizeof(F32) * 2;
+		case ETextureFormatId_RGB32f:	return sizeof(F32) * 3;
+		case ETextureFormatId_RGBA32f:	return sizeof(F32) * 4;
+		default:						return 0;
+	}
+}
+
+//Decoding the vertices is done in chunks on all threads, since it's a significant part of the build for big meshes
+
+#define CpuBLAS_loadChunk (16 * 1024)
+
+typedef struct CpuBLASLoadJob {
+
+	ETextureFormatId positionFormat;
+	U16 positionOffset, positionStride;
+	U8 indexSize, padding[3];
+
+	Buffer positions, indices;
+	U64 vertexCount, triangleCount;
+
+	F32x4 *primMin, *primMax;
+	CpuTriangle *triangles;
+
+	const U32 *primIds;
+	CpuTriangle *sorted;
+
+	U64 invalidIndex[Parallel_maxThreads];		//Index + 1 of an out of bounds index found by the thread
+
+} CpuBLASLoadJob;
+
+static void CpuBLAS_loadTriangles(void *userData, U64 jobId, U64 threadId) {
+
+	CpuBLASLoadJob *job = (CpuBLASLoadJob*) userData;
+
+	const U64 first = jobId * CpuBLAS_loadChunk;
+	const U64 last = U64_min(first + CpuBLAS_loadChunk, job->triangleCount);
+
+	for(U64 i = first; i < last; ++i) {
+
+		F32x4 v[3];
+
+		for(U8 j = 0; j < 3; ++j) {
+
+			U64 index = i * 3 + j;
+
+			if(job->indexSize == sizeof(U16))
+				index = ((const U16*) job->indices.ptr)[index];
+
+			else if(job->indexSize == sizeof(U32))
+				index = ((const U32*) job->indices.ptr)[index];
+
+			if(index >= job->vertexCount) {
+				job->invalidIndex[threadId] = index + 1;
+				return;
+			}
+
+			CpuBLAS_loadPosition(
+				job->positionFormat, job->positions.ptr + index * job->positionStride + job->positionOffset, &v[j]
+			);
+		}
+
+		job->triangles[i] = (CpuTriangle) { .v0 = v[0], .e1 = F32x4_sub(v[1], v[0]), .e2 = F32x4_sub(v[2], v[0]) };
+		job->primMin[i] = F32x4_min(v[0], F32x4_min(v[1], v[2]));
+		job->primMax[i] = F32x4_max(v[0], F32x4_max(v[1], v[2]));
+	}
+}
+
+//Reorder triangles to match the leaves, so traversal reads them linearly
+
+static void CpuBLAS_sortTriangles(void *userData, U64 jobId, U64 threadId) {
+
+	(void) threadId;
+	CpuBLASLoadJob *job = (CpuBLASLoadJob*) userData;
+
+	const U64 first = jobId * CpuBLAS_loadChunk;
+	const U64 last = U64_min(first + CpuBLAS_loadChunk, job->triangleCount);
+
+	for(U64 i = first; i < last; ++i)
+		job->sorted[i] = job->triangles[job->primIds[i]];
+}
+
+//Shared by create and rebuild, the input layout is stored in the blas.
+//A rebuild only decodes into buildData (scratch) until the BVH is rebuilt, which keeps the old one if it fails.
+//So a rebuild that fails (e.g. on out of bounds indices) leaves the blas as it was.
+
+static Bool CpuBLAS_build(CpuBLAS *blas, Buffer positions, Buffer indices, Bool isRebuild, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	const U64 vertexCount = Buffer_length(positions) / blas->positionStride;
+	const U64 indexSize =
+		blas->indexFormat == ETextureFormatId_R16u ? sizeof(U16) :
+		(blas->indexFormat == ETextureFormatId_R32u ? sizeof(U32) : 0);
+
+	const U64 triangleCount = (indexSize ? Buffer_length(indices) / indexSize : vertexCount) / 3;
+
+	if(!triangleCount)
+		retError(clean, Error_invalidParameter(1, 0, "CpuBLAS_build()::positions and indices should contain triangles"))
+
+	if(isRebuild && triangleCount != blas->triangleCount)
+		retError(clean, Error_invalidParameter(1, 0, "CpuBLAS_build()::rebuild requires the same triangle count"))
+
+	const U64 buildDataSize = (sizeof(F32x4) * 2 + sizeof(CpuTriangle)) * triangleCount;
+
+	if(!blas->buildData.ptr)
+		gotoIfError2(clean, Buffer_createUninitializedBytesx(buildDataSize, &blas->buildData))
+
+	CpuBLASLoadJob job = (CpuBLASLoadJob) {
+		.positionFormat = blas->positionFormat,
+		.positionOffset = blas->positionOffset,
+		.positionStride = blas->positionStride,
+		.indexSize = (U8) indexSize,
+		.positions = positions,
+		.indices = indices,
+		.vertexCount = vertexCount,
+		.triangleCount = triangleCount,
+		.triangles = (CpuTriangle*) blas->buildData.ptrNonConst
+	};
+
+	job.primMin = (F32x4*)(job.triangles + triangleCount);
+	job.primMax = job.primMin + triangleCount;
+
+	const U64 jobs = (triangleCount + CpuBLAS_loadChunk - 1) / CpuBLAS_loadChunk;
+	gotoIfError3(clean, Parallel_for(jobs, CpuBLAS_loadTriangles, &job, e_rr))
+
+	for(U64 i = 0; i < Parallel_getThreadCount(); ++i)
+		if(job.invalidIndex[i])
+			retError(clean, Error_outOfBounds(2, job.invalidIndex[i] - 1, vertexCount, "CpuBLAS_build()::indices out of bounds"))
+
+	if(isRebuild)
+		gotoIfError3(clean, CpuBVH_rebuildx(job.primMin, job.primMax, &blas->bvh, e_rr))
+
+	else gotoIfError3(clean, CpuBVH_buildx(job.primMin, job.primMax, triangleCount, blas->policy, &blas->bvh, e_rr))
+
+	if(!blas->triangleData.ptr)
+		gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(CpuTriangle) * triangleCount, &blas->triangleData))
+
+	job.primIds = CpuBVH_getPrimIds(&blas->bvh);
+	job.sorted = (CpuTriangle*) blas->triangleData.ptrNonConst;
+
+	gotoIfError3(clean, Parallel_for(jobs, CpuBLAS_sortTriangles, &job, e_rr))
+
+	blas->triangleCount = triangleCount;
+	++blas->generation;
+
+clean:
+
+	//Only LBVH is expected to be rebuilt often, so SAH doesn't keep the decoded triangles around
+
+	if(blas->policy == ECpuBVHPolicy_SAH)
+		Buffer_freex(&blas->buildData);
+
+	return s_uccess;
+}
+
+Bool CpuBLAS_createx(
+	ECpuBVHPolicy policy,
+	ETextureFormatId positionFormat,
+	U16 positionOffset,
+	U16 positionStride,
+	ETextureFormatId indexFormat,
+	Buffer positions,
+	Buffer indices,
+	CpuBLAS *blas,
+	Error *e_rr
+) {
+
+	Bool s_uccess = true;
+	Bool ownsBlas = false;
+
+	if(!blas)
+		retError(clean, Error_nullPointer(7, "CpuBLAS_createx()::blas is required"))
+
+	if(blas->triangleData.ptr)
+		retError(clean, Error_invalidParameter(7, 0, "CpuBLAS_createx()::blas wasn't empty, might indicate memleak"))
+
+	if(policy != ECpuBVHPolicy_SAH && policy != ECpuBVHPolicy_LBVH)
+		retError(clean, Error_invalidParameter(0, 0, "CpuBLAS_createx()::policy is invalid"))
+
+	const U64 positionSize = CpuBLAS_getPositionSize(positionFormat);
+
+	if(!positionSize)
+		retError(clean, Error_invalidParameter(1, 0, "CpuBLAS_createx()::positionFormat is unsupported"))
+
+	if(positionOffset + positionSize > positionStride)
+		retError(clean, Error_invalidParameter(3, 0, "CpuBLAS_createx()::positionStride is too small"))
+
+	if(
+		indexFormat != ETextureFormatId_R16u && indexFormat != ETextureFormatId_R32u &&
+		indexFormat != ETextureFormatId_Undefined
+	)
+		retError(clean, Error_invalidParameter(4, 0, "CpuBLAS_createx()::indexFormat should be R16u, R32u or Undefined"))
+
+	ownsBlas = true;
+
+	*blas = (CpuBLAS) {
+		.policy = policy,
+		.positionFormat = positionFormat,
+		.indexFormat = indexFormat,
+		.positionOffset = positionOffset,
+		.positionStride = positionStride
+	};
+
+	gotoIfError3(clean, CpuBLAS_build(blas, positions, indices, false, e_rr))
+
+clean:
+
+	if(!s_uccess && ownsBlas)
+		CpuBLAS_freex(blas);
+
+	return s_uccess;
+}
+
+Bool CpuBLAS_rebuildx(CpuBLAS *blas, Buffer positions, Buffer indices, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!blas)
+		retError(clean, Error_nullPointer(0, "CpuBLAS_rebuildx()::blas is required"))
+
+	if(!blas->triangleData.ptr)
+		retError(clean, Error_invalidParameter(0, 0, "CpuBLAS_rebuildx()::blas should've been created before"))
+
+	//The blas is still the caller's (and valid) if this fails, so it's not freed
+
+	gotoIfError3(clean, CpuBLAS_build(blas, positions, indices, true, e_rr))
+
+clean:
+	return s_uccess;
+}
+
+void CpuBLAS_freex(CpuBLAS *blas) {
+
+	if(!blas)
+		return;
+
+	CpuBVH_freex(&blas->bvh);
+	Buffer_freex(&blas->triangleData);
+	Buffer_freex(&blas->buildData);
+	*blas = (CpuBLAS) { 0 };
+}
+
+//Möller-Trumbore. Front facing = clockwise when seen from the ray origin (D3D12's default)
+
+static Bool CpuTriangle_intersect(const CpuTriangle *tri, RayDesc ray, ECpuRayFlags flags, F32 *t, F32 *u, F32 *v) {
+
+	const F32x4 pvec = F32x4_cross3(ray.dir, tri->e2);
+	const F32 det = F32x4_dot3(tri->e1, pvec);
+
+	if(det == 0)
+		return false;
+
+	if((flags & ECpuRayFlags_CullBackFacingTriangles) && det > 0)
+		return false;
+
+	if((flags & ECpuRayFlags_CullFrontFacingTriangles) && det < 0)
+		return false;
+
+	const F32 invDet = 1 / det;
+	const F32x4 tvec = F32x4_sub(ray.origin, tri->v0);
+
+	const F32 baryU = F32x4_dot3(tvec, pvec) * invDet;
+
+	if(baryU < 0 || baryU > 1)
+		return false;
+
+	const F32x4 qvec = F32x4_cross3(tvec, tri->e1);
+	const F32 baryV = F32x4_dot3(ray.dir, qvec) * invDet;
+
+	if(baryV < 0 || baryU + baryV > 1)
+		return false;
+
+	const F32 hitT = F32x4_dot3(tri->e2, qvec) * invDet;
+
+	if(hitT < ray.minT || hitT >= ray.maxT)
+		return false;
+
+	*t = hitT;
+	*u = baryU;
+	*v = baryV;
+	return true;
+}
+
+static F32x4 CpuAS_invDir(F32x4 dir) {
+	return F32x4_div(F32x4_one(), dir);
+}
+
+//Shrinks ray.maxT as closer hits are found
+
+static Bool CpuBLAS_traverse(const CpuBLAS *blas, RayDesc *ray, ECpuRayFlags flags, CpuHit *hit) {
+
+	const CpuBVHNode *nodes = CpuBVH_getNodes(&blas->bvh);
+	const U32 *primIds = CpuBVH_getPrimIds(&blas->bvh);
+	const CpuTriangle *triangles = (const CpuTriangle*) blas->triangleData.ptr;
+
+	const F32x4 invDir = CpuAS_invDir(ray->dir);
+
+	U32 stack[CpuBVH_maxStack];
+	U64 stackSize = 0;
+
+	Bool anyHit = false;
+	F32 tNear;
+
+	if(!CpuBVHNode_intersect(nodes, ray->origin, invDir, ray->minT, ray->maxT, &tNear))
+		return false;
+
+	stack[stackSize++] = 0;
+
+	while(stackSize) {
+
+		const CpuBVHNode *node = &nodes[stack[--stackSize]];
+
+		if(node->primCount) {
+
+			for(U32 i = node->leftFirst; i < node->leftFirst + node->primCount; ++i) {
+
+				F32 t, u, v;
+
+				if(!CpuTriangle_intersect(&triangles[i], *ray, flags, &t, &u, &v))
+					continue;
+
+				ray->maxT = t;
+				hit->t = t;
+				hit->baryU = u;
+				hit->baryV = v;
+				hit->primitiveId = primIds[i];
+				hit->triangleIndex = i;
+				anyHit = true;
+
+				if(flags & ECpuRayFlags_AcceptFirstHitAndEndSearch)
+					return true;
+			}
+
+			continue;
+		}
+
+		//Visit the nearest child first, so the far one can get culled by a closer hit
+
+		F32 tLeft, tRight;
+		const Bool hitLeft = CpuBVHNode_intersect(&nodes[node->leftFirst], ray->origin, invDir, ray->minT, ray->maxT, &tLeft);
+		const Bool hitRight = CpuBVHNode_intersect(&nodes[node->leftFirst + 1], ray->origin, invDir, ray->minT, ray->maxT, &tRight);
+
+		if(hitLeft && hitRight) {
+			const Bool leftIsNearer = tLeft <= tRight;
+			stack[stackSize++] = node->leftFirst + leftIsNearer;
+			stack[stackSize++] = node->leftFirst + !leftIsNearer;
+		}
+
+		else if(hitLeft)
+			stack[stackSize++] = node->leftFirst;
+
+		else if(hitRight)
+			stack[stackSize++] = node->leftFirst + 1;
+	}
+
+	return anyHit;
+}
+
+Bool CpuBLAS_traceRay(const CpuBLAS *blas, RayDesc ray, ECpuRayFlags flags, CpuHit *hit) {
+
+	if(!blas || !hit || !blas->triangleCount || (flags & ECpuRayFlags_SkipTriangles) || !(ray.maxT > ray.minT))
+		return false;
+
+	CpuHit tmp = (CpuHit) { 0 };
+
+	if(!CpuBLAS_traverse(blas, &ray, flags, &tmp))
+		return false;
+
+	*hit = tmp;
+	return true;
+}
+
+//TLAS
+
+static F32x4 CpuTLAS_transformPoint(const F32x4 m[3], F32x4 p) {
+	const F32x4 p1 = F32x4_create4(F32x4_x(p), F32x4_y(p), F32x4_z(p), 1);
+	return F32x4_create3(F32x4_dot4(m[0], p1), F32x4_dot4(m[1], p1), F32x4_dot4(m[2], p1));
+}
+
+static F32x4 CpuTLAS_transformDir(const F32x4 m[3], F32x4 d) {
+	return F32x4_create3(F32x4_dot3(m[0], d), F32x4_dot3(m[1], d), F32x4_dot3(m[2], d));
+}
+
+//Inverse of an affine 3x4; returns false if the 3x3 part is singular
+
+static Bool CpuTLAS_invert(const F32x4 m[3], F32x4 inv[3]) {
+
+	const F32 a = F32x4_x(m[0]), b = F32x4_y(m[0]), c = F32x4_z(m[0]);
+	const F32 d = F32x4_x(m[1]), e = F32x4_y(m[1]), f = F32x4_z(m[1]);
+	const F32 g = F32x4_x(m[2]), h = F32x4_y(m[2]), i = F32x4_z(m[2]);
+
+	const F32 A = e * i - f * h, B = f * g - d * i, C = d * h - e * g;
+	const F32 det = a * A + b * B + c * C;
+
+	if(det == 0)
+		return false;
+
+	const F32 id = 1 / det;
+
+	inv[0] = F32x4_create3(A * id, (c * h - b * i) * id, (b * f - c * e) * id);
+	inv[1] = F32x4_create3(B * id, (a * i - c * g) * id, (c * d - a * f) * id);
+	inv[2] = F32x4_create3(C * id, (b * g - a * h) * id, (a * e - b * d) * id);
+
+	const F32x4 t = F32x4_create3(F32x4_w(m[0]), F32x4_w(m[1]), F32x4_w(m[2]));
+	const F32x4 it = F32x4_negate(CpuTLAS_transformDir(inv, t));
+
+	for(U8 j = 0; j < 3; ++j)
+		F32x4_setW(&inv[j], F32x4_get(it, j));
+
+	return true;
+}
+
+static void CpuTLAS_getInstanceBounds(const CpuTLASInstance *inst, F32x4 *aabbMin, F32x4 *aabbMax) {
+
+	F32x4 bMin, bMax;
+	CpuBVH_getBounds(&inst->blas->bvh, &bMin, &bMax);
+
+	*aabbMin = F32x4_xxxx4(F32_MAX);
+	*aabbMax = F32x4_xxxx4(-F32_MAX);
+
+	for(U8 corner = 0; corner < 8; ++corner) {
+
+		const F32x4 p = CpuTLAS_transformPoint(inst->transform, F32x4_create3(
+			corner & 1 ? F32x4_x(bMax) : F32x4_x(bMin),
+			corner & 2 ? F32x4_y(bMax) : F32x4_y(bMin),
+			corner & 4 ? F32x4_z(bMax) : F32x4_z(bMin)
+		));
+
+		*aabbMin = F32x4_min(*aabbMin, p);
+		*aabbMax = F32x4_max(*aabbMax, p);
+	}
+}
+
+//An instance changed if its transform or BLAS changed, a BLAS that was rebuilt in place counts too (new bounds)
+
+static Bool CpuTLAS_hasChanged(const CpuTLASInstance *dst, const TLASInstanceStatic *src, const CpuBLAS *blas) {
+
+	if(dst->blas != blas || dst->blasGeneration != blas->generation)
+		return true;
+
+	for(U8 j = 0; j < 3; ++j)
+		for(U8 k = 0; k < 4; ++k)
+			if(F32x4_get(dst->transform[j], k) != src->transform[j][k])
+				return true;
+
+	return false;
+}
+
+static Bool CpuTLAS_getTransform(const TLASInstanceStatic *src, F32x4 transform[3], F32x4 invTransform[3], Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	for(U8 j = 0; j < 3; ++j)
+		transform[j] = F32x4_create4(
+			src->transform[j][0], src->transform[j][1], src->transform[j][2], src->transform[j][3]
+		);
+
+	if(!CpuTLAS_invert(transform, invTransform))
+		retError(clean, Error_invalidParameter(0, 1, "CpuTLAS_getTransform()::instances[i].transform isn't invertible"))
+
+clean:
+	return s_uccess;
+}
+
+//transform and invTransform are only copied if the instance changed
+
+static void CpuTLAS_setInstance(
+	CpuTLASInstance *dst,
+	const TLASInstanceStatic *src,
+	const CpuBLAS *blas,
+	const F32x4 transform[3],
+	const F32x4 invTransform[3]
+) {
+
+	dst->blas = blas;
+	dst->blasGeneration = blas->generation;
+	dst->instanceId24_mask8 = src->data.instanceId24_mask8;
+	dst->sbtOffset24_flags8 = src->data.sbtOffset24_flags8;
+
+	if(!transform)
+		return;
+
+	for(U8 j = 0; j < 3; ++j) {
+		dst->transform[j] = transform[j];
+		dst->invTransform[j] = invTransform[j];
+	}
+}
+
+//Builds into a new BVH, so the current one stays intact if it fails.
+//The refit data is prepared right away, that way refits can't fail (or allocate).
+
+static Bool CpuTLAS_rebuild(CpuTLAS *tlas, Error *e_rr) {
+
+	Bool s_uccess = true;
+	CpuBVH bvh = (CpuBVH) { 0 };
+
+	const F32x4 *primMin = (const F32x4*) tlas->boundsData.ptr;
+	const F32x4 *primMax = primMin + tlas->instanceCount;
+	const U32 *noDirtyPrims = (const U32*) tlas->dirtyData.ptr;
+
+	gotoIfError3(clean, CpuBVH_buildx(primMin, primMax, tlas->instanceCount, ECpuBVHPolicy_SAH, &bvh, e_rr))
+	gotoIfError3(clean, CpuBVH_refitx(&bvh, primMin, primMax, noDirtyPrims, 0, NULL, e_rr))
+
+	CpuBVH_freex(&tlas->bvh);
+	tlas->bvh = bvh;
+	bvh = (CpuBVH) { 0 };
+
+	tlas->buildCost = tlas->bvh.stats.sahCost;
+	tlas->stats.costRatio = 1;
+	tlas->stats.rebuildTime += tlas->bvh.stats.buildTime;
+
+clean:
+	CpuBVH_freex(&bvh);
+	return s_uccess;
+}
+
+Bool CpuTLAS_createx(ListTLASInstanceStatic instances, const CpuBLAS *const *blases, CpuTLAS *tlas, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Bool ownsTlas = false;
+
+	if(!tlas || !blases)
+		retError(clean, Error_nullPointer(!tlas ? 2 : 1, "CpuTLAS_createx()::blases and tlas are required"))
+
+	if(tlas->instanceData.ptr)
+		retError(clean, Error_invalidParameter(2, 0, "CpuTLAS_createx()::tlas wasn't empty, might indicate memleak"))
+
+	if(!instances.length)
+		retError(clean, Error_invalidParameter(0, 0, "CpuTLAS_createx()::instances is required"))
+
+	ownsTlas = true;
+	*tlas = (CpuTLAS) { .instanceCount = instances.length, .rebuildThreshold = CpuTLAS_defaultRebuildThreshold };
+
+	gotoIfError2(clean, Buffer_createEmptyBytesx(sizeof(CpuTLASInstance) * instances.length, &tlas->instanceData))
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(F32x4) * 2 * instances.length, &tlas->boundsData))
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(U32) * instances.length, &tlas->dirtyData))
+
+	CpuTLASInstance *dst = (CpuTLASInstance*) tlas->instanceData.ptrNonConst;
+	F32x4 *primMin = (F32x4*) tlas->boundsData.ptrNonConst;
+	F32x4 *primMax = primMin + instances.length;
+
+	for(U64 i = 0; i < instances.length; ++i) {
+
+		if(!blases[i] || !blases[i]->triangleCount)
+			retError(clean, Error_nullPointer(1, "CpuTLAS_createx()::blases[i] is required"))
+
+		F32x4 transform[3], invTransform[3];
+		gotoIfError3(clean, CpuTLAS_getTransform(&instances.ptr[i], transform, invTransform, e_rr))
+
+		CpuTLAS_setInstance(&dst[i], &instances.ptr[i], blases[i], transform, invTransform);
+		CpuTLAS_getInstanceBounds(&dst[i], &primMin[i], &primMax[i]);
+	}
+
+	gotoIfError3(clean, CpuTLAS_rebuild(tlas, e_rr))
+
+clean:
+
+	if(!s_uccess && ownsTlas)
+		CpuTLAS_freex(tlas);
+
+	return s_uccess;
+}
+
+Bool CpuTLAS_updatex(ListTLASInstanceStatic instances, const CpuBLAS *const *blases, CpuTLAS *tlas, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!tlas || !blases)
+		retError(clean, Error_nullPointer(!tlas ? 2 : 1, "CpuTLAS_updatex()::blases and tlas are required"))
+
+	if(!tlas->instanceData.ptr)
+		retError(clean, Error_invalidParameter(2, 0, "CpuTLAS_updatex()::tlas should've been created before"))
+
+	if(instances.length != tlas->instanceCount)
+		retError(clean, Error_invalidParameter(0, 0, "CpuTLAS_updatex()::instances should have the same length as before"))
+
+	CpuTLASInstance *dst = (CpuTLASInstance*) tlas->instanceData.ptrNonConst;
+	F32x4 *primMin = (F32x4*) tlas->boundsData.ptrNonConst;
+	F32x4 *primMax = primMin + instances.length;
+	U32 *dirty = (U32*) tlas->dirtyData.ptrNonConst;
+	U64 dirtyCount = 0;
+
+	//Everything is validated before the TLAS is touched, so it's left as it was if the input is invalid
+
+	for(U64 i = 0; i < instances.length; ++i) {
+
+		if(!blases[i] || !blases[i]->triangleCount)
+			retError(clean, Error_nullPointer(1, "CpuTLAS_updatex()::blases[i] is required"))
+
+		if(!CpuTLAS_hasChanged(&dst[i], &instances.ptr[i], blases[i]))
+			continue;
+
+		F32x4 transform[3], invTransform[3];
+		gotoIfError3(clean, CpuTLAS_getTransform(&instances.ptr[i], transform, invTransform, e_rr))
+
+		dirty[dirtyCount++] = (U32) i;
+	}
+
+	//Can't fail anymore; dirty is sorted, so it can be walked alongside the instances
+
+	for(U64 i = 0, j = 0; i < instances.length; ++i) {
+
+		if(j == dirtyCount || dirty[j] != i) {
+			CpuTLAS_setInstance(&dst[i], &instances.ptr[i], blases[i], NULL, NULL);
+			continue;
+		}
+
+		F32x4 transform[3], invTransform[3];
+		CpuTLAS_getTransform(&instances.ptr[i], transform, invTransform, NULL);
+
+		CpuTLAS_setInstance(&dst[i], &instances.ptr[i], blases[i], transform, invTransform);
+		CpuTLAS_getInstanceBounds(&dst[i], &primMin[i], &primMax[i]);
+		++j;
+	}
+
+	++tlas->stats.updates;
+	tlas->stats.dirtyInstances += dirtyCount;
+
+	if(!dirtyCount) {
+		++tlas->stats.unchanged;
+		goto clean;
+	}
+
+	const Ns start = Time_now();
+	U64 refitNodes = 0;
+
+	gotoIfError3(clean, CpuBVH_refitx(&tlas->bvh, primMin, primMax, dirty, dirtyCount, &refitNodes, e_rr))
+
+	++tlas->stats.refits;
+	tlas->stats.refitNodes += refitNodes;
+	tlas->stats.refitTime += Time_now() - start;
+	tlas->stats.costRatio = tlas->buildCost > 0 ? tlas->bvh.stats.sahCost / tlas->buildCost : 1;
+
+	//The refit tree is already valid for the new instances, so if the rebuild fails that's what is kept
+
+	if(tlas->stats.costRatio > tlas->rebuildThreshold) {
+		gotoIfError3(clean, CpuTLAS_rebuild(tlas, e_rr))
+		++tlas->stats.rebuilds;
+	}
+
+clean:
+	return s_uccess;
+}
+
+void CpuTLAS_freex(CpuTLAS *tlas) {
+
+	if(!tlas)
+		return;
+
+	CpuBVH_freex(&tlas->bvh);
+	Buffer_freex(&tlas->instanceData);
+	Buffer_freex(&tlas->boundsData);
+	Buffer_freex(&tlas->dirtyData);
+	*tlas = (CpuTLAS) { 0 };
+}
+
+Bool CpuTLAS_traceRay(const CpuTLAS *tlas, RayDesc ray, ECpuRayFlags flags, U8 instanceMask, CpuHit *hit) {
+
+	if(!tlas || !hit || !tlas->instanceCount || (flags & ECpuRayFlags_SkipTriangles) || !(ray.maxT > ray.minT))
+		return false;
+
+	const CpuBVHNode *nodes = CpuBVH_getNodes(&tlas->bvh);
+	const U32 *primIds = CpuBVH_getPrimIds(&tlas->bvh);
+	const CpuTLASInstance *instances = (const CpuTLASInstance*) tlas->instanceData.ptr;
+
+	const F32x4 invDir = CpuAS_invDir(ray.dir);
+
+	U32 stack[CpuBVH_maxStack];
+	U64 stackSize = 0;
+
+	Bool anyHit = false;
+	F32 tNear;
+
+	if(!CpuBVHNode_intersect(nodes, ray.origin, invDir, ray.minT, ray.maxT, &tNear))
+		return false;
+
+	stack[stackSize++] = 0;
+
+	while(stackSize) {
+
+		const CpuBVHNode *node = &nodes[stack[--stackSize]];
+
+		if(node->primCount) {
+
+			for(U32 i = node->leftFirst; i < node->leftFirst + node->primCount; ++i) {
+
+				const U32 instanceIndex = primIds[i];
+				const CpuTLASInstance *inst = &instances[instanceIndex];
+
+				if(!((inst->instanceId24_mask8 >> 24) & instanceMask))
+					continue;
+
+				//Object space ray keeps the same t, since the direction isn't normalized
+
+				RayDesc local = ray;
+				local.origin = CpuTLAS_transformPoint(inst->invTransform, ray.origin);
+				local.dir = CpuTLAS_transformDir(inst->invTransform, ray.dir);
+
+				CpuHit tmp;
+
+				if(!CpuBLAS_traverse(inst->blas, &local, flags, &tmp))
+					continue;
+
+				ray.maxT = local.maxT;
+
+				*hit = tmp;
+				hit->instanceIndex = instanceIndex;
+				hit->instanceId = inst->instanceId24_mask8 & ((1 << 24) - 1);
+				hit->hitGroup = inst->sbtOffset24_flags8 & ((1 << 24) - 1);
+				anyHit = true;
+
+				if(flags & ECpuRayFlags_AcceptFirstHitAndEndSearch)
+					return true;
+			}
+
+			continue;
+		}
+
+		F32 tLeft, tRight;
+		const Bool hitLeft = CpuBVHNode_intersect(&nodes[node->leftFirst], ray.origin, invDir, ray.minT, ray.maxT, &tLeft);
+		const Bool hitRight = CpuBVHNode_intersect(&nodes[node->leftFirst + 1], ray.origin, invDir, ray.minT, ray.maxT, &tRight);
+
+		if(hitLeft && hitRight) {
+			const Bool leftIsNearer = tLeft <= tRight;
+			stack[stackSize++] = node->leftFirst + leftIsNearer;
+			stack[stackSize++] = node->leftFirst + !leftIsNearer;
+		}
+
+		else if(hitLeft)
+			stack[stackSize++] = node->leftFirst;
+
+		else if(hitRight)
+			stack[stackSize++] = node->leftFirst + 1;
+	}
+
+	return anyHit;
+}
+
+F32x4 CpuTLAS_getNormal(const CpuTLAS *tlas, const CpuHit *hit) {
+
+	if(!tlas || !hit || hit->instanceIndex >= tlas->instanceCount)
+		return F32x4_zero();
+
+	const CpuTLASInstance *inst = &((const CpuTLASInstance*) tlas->instanceData.ptr)[hit->instanceIndex];
+
+	if(hit->triangleIndex >= inst->blas->bvh.primCount)
+		return F32x4_zero();
+
+	const CpuTriangle *tri = &((const CpuTriangle*) inst->blas->triangleData.ptr)[hit->triangleIndex];
+	const F32x4 n = F32x4_cross3(tri->e1, tri->e2);
+
+	//Normals transform with the inverse transpose (transpose of the rows of invTransform)
+
+	const F32x4 *m = inst->invTransform;
+
+	const F32x4 world = F32x4_add(
+		F32x4_add(F32x4_mul(F32x4_xxxx4(F32x4_x(n)), m[0]), F32x4_mul(F32x4_xxxx4(F32x4_y(n)), m[1])),
+		F32x4_mul(F32x4_xxxx4(F32x4_z(n)), m[2])
+	);
+
+	return F32x4_normalize3(F32x4_create3(F32x4_x(world), F32x4_y(world), F32x4_z(world)));
+}
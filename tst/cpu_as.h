@@ -0,0 +1,212 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "graphics/generic/blas.h"
+#include "graphics/generic/tlas.h"
+#include "cpu_bvh.h"
+#include "primitive.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//CPU counterparts of BLASRef and TLASRef.
+//These take the same inputs as GraphicsDeviceRef_createBLASExt and GraphicsDeviceRef_createTLASExt,
+//so the CPU path can trace exactly the scene that is uploaded to the GPU.
+
+//Same values as HLSL's RAY_FLAG_*, only the ones listed as supported are handled (others are ignored).
+
+typedef enum ECpuRayFlags {
+	ECpuRayFlags_None							= 0,
+	ECpuRayFlags_ForceOpaque					= 1 << 0,		//Supported (all CPU geometry is opaque)
+	ECpuRayFlags_AcceptFirstHitAndEndSearch		= 1 << 2,		//Supported
+	ECpuRayFlags_CullBackFacingTriangles		= 1 << 4,		//Supported
+	ECpuRayFlags_CullFrontFacingTriangles		= 1 << 5,		//Supported
+	ECpuRayFlags_CullNonOpaque					= 1 << 7,		//Supported (all CPU geometry is opaque)
+	ECpuRayFlags_SkipTriangles					= 1 << 8,		//Supported
+	ECpuRayFlags_SkipProceduralPrimitives		= 1 << 9		//Supported (CPU doesn't have procedural geometry)
+} ECpuRayFlags;
+
+typedef struct CpuTriangle {
+	F32x4 v0, e1, e2;				//v1 = v0 + e1, v2 = v0 + e2
+} CpuTriangle;
+
+typedef struct CpuBLAS {
+
+	CpuBVH bvh;
+	Buffer triangleData;			//CpuTriangle[bvh.primCount] ordered by the leaves of the BVH
+	Buffer buildData;				//LBVH only: decoded triangles and bounds, kept to make rebuilds allocation free
+
+	U64 triangleCount;
+	U64 generation;					//Incremented by every (re)build, so TLASes know to refit instances of it
+
+	ECpuBVHPolicy policy;
+	ETextureFormatId positionFormat, indexFormat;
+	U16 positionOffset, positionStride;
+
+} CpuBLAS;
+
+//Same as GPU: positions and indices are the raw buffers (vertex buffer and index buffer).
+//Supported positions: RG16f (z = 0), RGBA16f, RG32f (z = 0), RGB32f, RGBA32f.
+//Supported indices: Undefined (non indexed), R16u, R32u.
+//Policy picks the BVH builder; LBVH should be used for geometry that's rebuilt every frame.
+
+Bool CpuBLAS_createx(
+	ECpuBVHPolicy policy,
+	ETextureFormatId positionFormat,
+	U16 positionOffset,
+	U16 positionStride,
+	ETextureFormatId indexFormat,
+	Buffer positions,
+	Buffer indices,
+	CpuBLAS *blas,
+	Error *e_rr
+);
+
+//Rebuild with new positions (and/or indices) that have the same layout and triangle count (e.g. animated geometry).
+//With LBVH this only allocates the first time (see CpuBVH_rebuildx). If it fails, blas is left as it was.
+
+Bool CpuBLAS_rebuildx(CpuBLAS *blas, Buffer positions, Buffer indices, Error *e_rr);
+
+void CpuBLAS_freex(CpuBLAS *blas);
+
+typedef struct CpuTLASInstance {
+
+	F32x4 transform[3];				//Row major 3x4 (object to world), same as TLASInstanceStatic
+	F32x4 invTransform[3];			//World to object
+
+	const CpuBLAS *blas;
+	U64 blasGeneration;				//blas->generation when the instance's bounds were computed
+
+	U32 instanceId24_mask8;
+	U32 sbtOffset24_flags8;
+
+} CpuTLASInstance;
+
+typedef struct CpuTLASStats {
+
+	U64 updates;					//CpuTLAS_updatex calls, each one is handled as one of the following:
+	U64 unchanged, refits, rebuilds;
+
+	U64 dirtyInstances;				//Total instances that moved
+	U64 refitNodes;					//Total nodes that were changed by refits
+
+	Ns refitTime, rebuildTime;		//Total time spent
+
+	F64 costRatio;					//SAH cost relative to the cost right after the last (re)build
+
+} CpuTLASStats;
+
+typedef struct CpuTLAS {
+
+	CpuBVH bvh;
+	Buffer instanceData;			//CpuTLASInstance[instanceCount], in the same order as the input
+	Buffer boundsData;				//F32x4[instanceCount * 2]: world space min of every instance, then max
+	Buffer dirtyData;				//U32[instanceCount], scratch for updates
+
+	U64 instanceCount;
+
+	F64 buildCost;					//SAH cost right after the last (re)build
+	F32 rebuildThreshold;			//Rebuild once SAH cost > buildCost * rebuildThreshold
+	U32 padding;
+
+	CpuTLASStats stats;
+
+} CpuTLAS;
+
+#define CpuTLAS_defaultRebuildThreshold 1.5f
+
+//blases contains the CpuBLAS to use for each instance (since TLASInstanceStatic references the GPU BLAS)
+
+Bool CpuTLAS_createx(ListTLASInstanceStatic instances, const CpuBLAS *const *blases, CpuTLAS *tlas, Error *e_rr);
+
+//Update with the same number of instances (e.g. moved instances).
+//Only the subtrees above instances with a new transform or (rebuilt) BLAS are refit, the other properties are just copied.
+//Refitting makes the tree worse over time; once the SAH cost grows beyond rebuildThreshold it's rebuilt instead.
+//Invalid instances leave the TLAS untouched; if only the rebuild fails, the refit (which is valid) is kept.
+
+Bool CpuTLAS_updatex(ListTLASInstanceStatic instances, const CpuBLAS *const *blases, CpuTLAS *tlas, Error *e_rr);
+void CpuTLAS_freex(CpuTLAS *tlas);
+
+typedef struct CpuHit {
+
+	F32 t;
+	F32 baryU, baryV;				//BuiltInTriangleIntersectionAttributes::barycentrics
+
+	U32 primitiveId;				//PrimitiveIndex(), same index as the input triangles
+	U32 instanceIndex;				//InstanceIndex()
+	U32 instanceId;					//InstanceID(), from instanceId24_mask8
+	U32 hitGroup;					//From sbtOffset24_flags8
+	U32 triangleIndex;				//Index into the BLAS's triangleData (BVH order)
+
+} CpuHit;
+
+//Returns true if anything was hit, hit is the closest hit (or the first one with AcceptFirstHitAndEndSearch)
+
+Bool CpuBLAS_traceRay(const CpuBLAS *blas, RayDesc ray, ECpuRayFlags flags, CpuHit *hit);
+Bool CpuTLAS_traceRay(const CpuTLAS *tlas, RayDesc ray, ECpuRayFlags flags, U8 instanceMask, CpuHit *hit);
+
+//Normalized world space geometric normal of a hit (cross(e1, e2), so it's not flipped towards the ray)
+
+F32x4 CpuTLAS_getNormal(const CpuTLAS *tlas, const CpuHit *hit);
+
+//Ray packets (see cpu_packet.c): up to 16x16 coherent rays, such as the primary rays of a tile, traced together.
+//A node is first tested against the bounds of the whole packet, so nodes that no ray can reach cost a single test.
+//Nodes that pass are tested 4 rays at a time (from the first ray that could hit its parent onwards),
+//as are the triangles in the leaves.
+//Packets whose rays don't go the same way on every axis are too divergent to share nodes well; those are traced per ray.
+
+#define CpuRayPacket_maxWidth 16
+#define CpuRayPacket_maxRays (CpuRayPacket_maxWidth * CpuRayPacket_maxWidth)
+#define CpuRayPacket_maxGroups (CpuRayPacket_maxRays / 4)
+
+typedef struct CpuRayPacket {
+	RayDesc4 rays[CpuRayPacket_maxGroups];		//Ray i is lane i % 4 of rays[i / 4]
+	U32 rayCount;
+	U32 padding[3];
+} CpuRayPacket;
+
+void CpuRayPacket_set(CpuRayPacket *packet, U32 i, RayDesc ray);
+RayDesc CpuRayPacket_get(const CpuRayPacket *packet, U32 i);
+
+//Same as traceRay for every ray in the packet: if ray i hit, bit i % 64 of hitMask[i / 64] is set and hits[i] is valid.
+//Returns false if the packet was too divergent and was traced per ray instead.
+
+Bool CpuBLAS_tracePacket(
+	const CpuBLAS *blas,
+	const CpuRayPacket *packet,
+	ECpuRayFlags flags,
+	CpuHit hits[CpuRayPacket_maxRays],
+	U64 hitMask[CpuRayPacket_maxRays / 64]
+);
+
+Bool CpuTLAS_tracePacket(
+	const CpuTLAS *tlas,
+	const CpuRayPacket *packet,
+	ECpuRayFlags flags,
+	U8 instanceMask,
+	CpuHit hits[CpuRayPacket_maxRays],
+	U64 hitMask[CpuRayPacket_maxRays / 64]
+);
+
+#ifdef __cplusplus
+	}
+#endif
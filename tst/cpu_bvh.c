@@ -0,0 +1,953 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "cpu_bvh.h"
+#include "parallel.h"
+#include "platforms/ext/bufferx.h"
+#include "types/base/time.h"
+#include "types/math/math.h"
+
+//Nodes with at least this many primitives bin and bound their primitives with all threads
+
+#define CpuBVH_parallelThreshold (64 * 1024)
+
+//Once there are enough subtrees (or they're small enough), they're handed out to threads to build serially
+
+#define CpuBVH_subtreesPerThread 4
+#define CpuBVH_subtreeMinPrims 4096
+#define CpuBVH_maxSubtrees (Parallel_maxThreads * CpuBVH_subtreesPerThread + 1)
+
+typedef struct CpuBVHBuildTask {
+	U32 node, first, count, depth;
+} CpuBVHBuildTask;
+
+typedef struct CpuBVHRange {
+	F32x4 min, max;
+	F32x4 centroidMin, centroidMax;
+} CpuBVHRange;
+
+typedef struct CpuBVHBin {
+	F32x4 min, max;
+	U32 count;
+} CpuBVHBin;
+
+typedef CpuBVHBin CpuBVHBins[3][CpuBVH_binCount];
+
+typedef struct CpuBVHBuilder {
+
+	const F32x4 *primMin, *primMax;
+	const F32x4 *centroids;				//2x the centroid (min + max)
+
+	U32 *primIds;
+	CpuBVHNode *nodes;					//Temporary nodes, contains holes until CpuBVH_compact
+
+	CpuBVHRange *threadRanges;			//[Parallel_getThreadCount()]
+	CpuBVHBins *threadBins;				//[Parallel_getThreadCount()]
+
+	CpuBVHBuildTask subtrees[CpuBVH_maxSubtrees];
+	U32 subtreeNodes[CpuBVH_maxSubtrees];
+	U32 subtreeCount;
+
+} CpuBVHBuilder;
+
+//Bounds
+
+static CpuBVHRange CpuBVHRange_empty() {
+	return (CpuBVHRange) {
+		.min = F32x4_xxxx4(F32_MAX), .max = F32x4_xxxx4(-F32_MAX),
+		.centroidMin = F32x4_xxxx4(F32_MAX), .centroidMax = F32x4_xxxx4(-F32_MAX)
+	};
+}
+
+static void CpuBVHRange_merge(CpuBVHRange *a, const CpuBVHRange *b) {
+	a->min = F32x4_min(a->min, b->min);
+	a->max = F32x4_max(a->max, b->max);
+	a->centroidMin = F32x4_min(a->centroidMin, b->centroidMin);
+	a->centroidMax = F32x4_max(a->centroidMax, b->centroidMax);
+}
+
+static F32 CpuBVH_getSurfaceArea(F32x4 aabbMin, F32x4 aabbMax) {
+	const F32x4 d = F32x4_max(F32x4_sub(aabbMax, aabbMin), F32x4_zero());
+	return 2 * (F32x4_x(d) * F32x4_y(d) + F32x4_y(d) * F32x4_z(d) + F32x4_z(d) * F32x4_x(d));
+}
+
+F32 CpuBVHNode_getSurfaceArea(const CpuBVHNode *node) {
+	return CpuBVH_getSurfaceArea(
+		F32x4_create3(node->min[0], node->min[1], node->min[2]),
+		F32x4_create3(node->max[0], node->max[1], node->max[2])
+	);
+}
+
+static void CpuBVH_boundRange(const CpuBVHBuilder *b, U32 first, U32 count, CpuBVHRange *range) {
+
+	CpuBVHRange r = CpuBVHRange_empty();
+
+	for(U32 i = first; i < first + count; ++i) {
+		const U32 prim = b->primIds[i];
+		r.min = F32x4_min(r.min, b->primMin[prim]);
+		r.max = F32x4_max(r.max, b->primMax[prim]);
+		r.centroidMin = F32x4_min(r.centroidMin, b->centroids[prim]);
+		r.centroidMax = F32x4_max(r.centroidMax, b->centroids[prim]);
+	}
+
+	CpuBVHRange_merge(range, &r);
+}
+
+//Binning
+
+static F32x4 CpuBVH_getBinScale(const CpuBVHRange *range) {
+
+	const F32x4 extent = F32x4_sub(range->centroidMax, range->centroidMin);
+	F32x4 scale = F32x4_zero();
+
+	for(U8 axis = 0; axis < 3; ++axis) {
+		const F32 e = F32x4_get(extent, axis);
+		F32x4_set(&scale, axis, e > 0 ? CpuBVH_binCount * 0.9999f / e : 0);
+	}
+
+	return scale;
+}
+
+static U32 CpuBVH_getBin(F32x4 centroid, const CpuBVHRange *range, F32x4 scale, U8 axis) {
+	const F32 t = (F32x4_get(centroid, axis) - F32x4_get(range->centroidMin, axis)) * F32x4_get(scale, axis);
+	return U32_min((U32) F32_max(t, 0), CpuBVH_binCount - 1);
+}
+
+static void CpuBVH_clearBins(CpuBVHBins bins) {
+	for(U8 axis = 0; axis < 3; ++axis)
+		for(U32 i = 0; i < CpuBVH_binCount; ++i)
+			bins[axis][i] = (CpuBVHBin) { .min = F32x4_xxxx4(F32_MAX), .max = F32x4_xxxx4(-F32_MAX) };
+}
+
+static void CpuBVH_binRange(const CpuBVHBuilder *b, U32 first, U32 count, const CpuBVHRange *range, CpuBVHBins bins) {
+
+	const F32x4 scale = CpuBVH_getBinScale(range);
+
+	for(U32 i = first; i < first + count; ++i) {
+
+		const U32 prim = b->primIds[i];
+
+		for(U8 axis = 0; axis < 3; ++axis) {
+			CpuBVHBin *bin = &bins[axis][CpuBVH_getBin(b->centroids[prim], range, scale, axis)];
+			bin->min = F32x4_min(bin->min, b->primMin[prim]);
+			bin->max = F32x4_max(bin->max, b->primMax[prim]);
+			++bin->count;
+		}
+	}
+}
+
+//Sweep the bins of each axis and find the cheapest split (split is after bin splitBin)
+
+static Bool CpuBVH_findSplit(CpuBVHBins bins, F32 parentArea, U8 *bestAxis, U32 *bestBin, F32 *bestCost) {
+
+	F32 rightArea[CpuBVH_binCount];
+	U32 rightCount[CpuBVH_binCount];
+
+	Bool found = false;
+	*bestCost = F32_MAX;
+
+	const F32 invParentArea = parentArea > 0 ? 1 / parentArea : 1;
+
+	for(U8 axis = 0; axis < 3; ++axis) {
+
+		//Sweep right to left to get the area & count of everything right of the split.
+		//Empty bins don't change anything, so only recompute area for filled bins (most bins are empty for small nodes)
+
+		F32x4 rMin = F32x4_xxxx4(F32_MAX), rMax = F32x4_xxxx4(-F32_MAX);
+		U32 rCount = 0;
+		F32 rArea = 0;
+
+		for(U32 i = CpuBVH_binCount - 1; i > 0; --i) {
+
+			if(bins[axis][i].count) {
+				rMin = F32x4_min(rMin, bins[axis][i].min);
+				rMax = F32x4_max(rMax, bins[axis][i].max);
+				rCount += bins[axis][i].count;
+				rArea = CpuBVH_getSurfaceArea(rMin, rMax);
+			}
+
+			rightArea[i - 1] = rArea;
+			rightCount[i - 1] = rCount;
+		}
+
+		//Sweep left to right and evaluate (splitting after an empty bin is the same as splitting before it)
+
+		F32x4 lMin = F32x4_xxxx4(F32_MAX), lMax = F32x4_xxxx4(-F32_MAX);
+		U32 lCount = 0;
+
+		for(U32 i = 0; i + 1 < CpuBVH_binCount; ++i) {
+
+			if(!bins[axis][i].count)
+				continue;
+
+			if(!rightCount[i])
+				break;
+
+			lMin = F32x4_min(lMin, bins[axis][i].min);
+			lMax = F32x4_max(lMax, bins[axis][i].max);
+			lCount += bins[axis][i].count;
+
+			const F32 cost =
+				CpuBVH_traversalCost +
+				CpuBVH_intersectionCost * invParentArea *
+				(CpuBVH_getSurfaceArea(lMin, lMax) * lCount + rightArea[i] * rightCount[i]);
+
+			if(cost < *bestCost) {
+				*bestCost = cost;
+				*bestAxis = axis;
+				*bestBin = i;
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
+
+static U32 CpuBVH_partition(
+	const CpuBVHBuilder *b, U32 first, U32 count, const CpuBVHRange *range, U8 axis, U32 splitBin
+) {
+
+	const F32x4 scale = CpuBVH_getBinScale(range);
+	U32 i = first, j = first + count;
+
+	while(i < j) {
+
+		const U32 prim = b->primIds[i];
+
+		if(CpuBVH_getBin(b->centroids[prim], range, scale, axis) <= splitBin)
+			++i;
+
+		else {
+			b->primIds[i] = b->primIds[--j];
+			b->primIds[j] = prim;
+		}
+	}
+
+	return i;
+}
+
+//Turns the node into a leaf or an inner node; if it's an inner node, mid is where the right child's prims start
+
+static Bool CpuBVH_split(const CpuBVHBuilder *b, CpuBVHBuildTask task, const CpuBVHRange *range, CpuBVHBins bins, U32 *mid) {
+
+	CpuBVHNode *node = &b->nodes[task.node];
+
+	for(U8 i = 0; i < 3; ++i) {
+		node->min[i] = F32x4_get(range->min, i);
+		node->max[i] = F32x4_get(range->max, i);
+	}
+
+	node->leftFirst = task.first;
+	node->primCount = task.count;
+
+	if(task.count == 1 || task.depth + 1 >= CpuBVH_maxDepth)
+		return false;
+
+	U8 axis = 0;
+	U32 splitBin = 0;
+	F32 cost = 0;
+
+	//All centroids overlap, SAH can't help, so split in the middle if the leaf would be too big
+
+	if(!CpuBVH_findSplit(bins, CpuBVH_getSurfaceArea(range->min, range->max), &axis, &splitBin, &cost)) {
+
+		if(task.count <= CpuBVH_maxLeafSize)
+			return false;
+
+		*mid = task.first + task.count / 2;
+		return true;
+	}
+
+	if(cost >= task.count * CpuBVH_intersectionCost && task.count <= CpuBVH_maxLeafSize)
+		return false;
+
+	*mid = CpuBVH_partition(b, task.first, task.count, range, axis, splitBin);
+	return true;
+}
+
+//Serial build of a subtree; nodes are allocated from *nextNode
+
+static void CpuBVH_buildSubtree(const CpuBVHBuilder *b, CpuBVHBuildTask root, U32 *nextNode) {
+
+	CpuBVHBuildTask stack[CpuBVH_maxStack + 1];
+	U64 stackSize = 0;
+
+	stack[stackSize++] = root;
+
+	CpuBVHBins bins;
+
+	while(stackSize) {
+
+		const CpuBVHBuildTask task = stack[--stackSize];
+
+		CpuBVHRange range = CpuBVHRange_empty();
+		CpuBVH_boundRange(b, task.first, task.count, &range);
+
+		CpuBVH_clearBins(bins);
+
+		if(task.count > 1)
+			CpuBVH_binRange(b, task.first, task.count, &range, bins);
+
+		U32 mid = 0;
+
+		if(!CpuBVH_split(b, task, &range, bins, &mid))
+			continue;
+
+		const U32 left = *nextNode;
+		*nextNode += 2;
+
+		b->nodes[task.node].leftFirst = left;
+		b->nodes[task.node].primCount = 0;
+
+		stack[stackSize++] = (CpuBVHBuildTask) {
+			.node = left + 1, .first = mid, .count = task.first + task.count - mid, .depth = task.depth + 1
+		};
+
+		stack[stackSize++] = (CpuBVHBuildTask) {
+			.node = left, .first = task.first, .count = mid - task.first, .depth = task.depth + 1
+		};
+	}
+}
+
+//Parallel bounds & binning passes for big nodes
+
+typedef struct CpuBVHParallelPass {
+	CpuBVHBuilder *builder;
+	CpuBVHBuildTask task;
+	const CpuBVHRange *range;			//NULL for the bounds pass
+} CpuBVHParallelPass;
+
+#define CpuBVH_parallelChunk (16 * 1024)
+
+static void CpuBVH_parallelPass(void *userData, U64 jobId, U64 threadId) {
+
+	const CpuBVHParallelPass *pass = (const CpuBVHParallelPass*) userData;
+	CpuBVHBuilder *b = pass->builder;
+
+	const U32 first = pass->task.first + (U32)(jobId * CpuBVH_parallelChunk);
+	const U32 count = U32_min(CpuBVH_parallelChunk, pass->task.first + pass->task.count - first);
+
+	if(pass->range)
+		CpuBVH_binRange(b, first, count, pass->range, b->threadBins[threadId]);
+
+	else CpuBVH_boundRange(b, first, count, &b->threadRanges[threadId]);
+}
+
+//Same as CpuBVH_split, but bounds and bins are computed by all threads; mid is U32_MAX if the node became a leaf
+
+static Bool CpuBVH_splitParallel(CpuBVHBuilder *b, CpuBVHBuildTask task, U32 *mid, Error *e_rr) {
+
+	Bool s_uccess = true;
+	const U64 threads = Parallel_getThreadCount();
+	const U64 jobs = (task.count + CpuBVH_parallelChunk - 1) / CpuBVH_parallelChunk;
+
+	CpuBVHParallelPass pass = (CpuBVHParallelPass) { .builder = b, .task = task };
+
+	for(U64 i = 0; i < threads; ++i) {
+		b->threadRanges[i] = CpuBVHRange_empty();
+		CpuBVH_clearBins(b->threadBins[i]);
+	}
+
+	gotoIfError3(clean, Parallel_for(jobs, CpuBVH_parallelPass, &pass, e_rr))
+
+	CpuBVHRange range = CpuBVHRange_empty();
+
+	for(U64 i = 0; i < threads; ++i)
+		CpuBVHRange_merge(&range, &b->threadRanges[i]);
+
+	pass.range = &range;
+	gotoIfError3(clean, Parallel_for(jobs, CpuBVH_parallelPass, &pass, e_rr))
+
+	CpuBVHBins bins;
+	CpuBVH_clearBins(bins);
+
+	for(U64 i = 0; i < threads; ++i)
+		for(U8 axis = 0; axis < 3; ++axis)
+			for(U32 j = 0; j < CpuBVH_binCount; ++j) {
+				const CpuBVHBin *src = &b->threadBins[i][axis][j];
+				bins[axis][j].min = F32x4_min(bins[axis][j].min, src->min);
+				bins[axis][j].max = F32x4_max(bins[axis][j].max, src->max);
+				bins[axis][j].count += src->count;
+			}
+
+	if(!CpuBVH_split(b, task, &range, bins, mid))
+		*mid = U32_MAX;
+
+clean:
+	return s_uccess;
+}
+
+static void CpuBVH_buildSubtreeJob(void *userData, U64 jobId, U64 threadId) {
+	(void) threadId;
+	CpuBVHBuilder *b = (CpuBVHBuilder*) userData;
+	CpuBVH_buildSubtree(b, b->subtrees[jobId], &b->subtreeNodes[jobId]);
+}
+
+//Temporary nodes contain unused reservations, so walk the tree to find how many are in use
+
+static U32 CpuBVH_countInner(const CpuBVHNode *nodes) {
+
+	U32 stack[CpuBVH_maxStack + 1];
+	U64 stackSize = 0;
+	U32 innerCount = 0;
+
+	stack[stackSize++] = 0;
+
+	while(stackSize) {
+
+		const CpuBVHNode *node = &nodes[stack[--stackSize]];
+
+		if(node->primCount)
+			continue;
+
+		++innerCount;
+		stack[stackSize++] = node->leftFirst + 1;
+		stack[stackSize++] = node->leftFirst;
+	}
+
+	return innerCount;
+}
+
+//Copy the nodes depth first into the final (aligned) buffer, which removes holes left by subtree reservations
+
+static Bool CpuBVH_compact(const CpuBVHNode *src, U32 innerCount, CpuBVH *bvh, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	bvh->nodeCount = 2 + (U64) innerCount * 2;
+	gotoIfError2(clean, Buffer_createEmptyBytesx(sizeof(CpuBVHNode) * bvh->nodeCount + CpuBVH_nodeAlignment, &bvh->nodeData))
+
+	CpuBVHNode *dst = (CpuBVHNode*) CpuBVH_getNodes(bvh);
+
+	U32 stack[CpuBVH_maxStack + 1][2];
+	U64 stackSize = 0;
+	U32 next = 2;
+
+	stack[stackSize][0] = 0;
+	stack[stackSize++][1] = 0;
+
+	while(stackSize) {
+
+		--stackSize;
+		const U32 from = stack[stackSize][0], to = stack[stackSize][1];
+
+		dst[to] = src[from];
+
+		if(src[from].primCount)
+			continue;
+
+		dst[to].leftFirst = next;
+
+		stack[stackSize][0] = src[from].leftFirst + 1;
+		stack[stackSize++][1] = next + 1;
+
+		stack[stackSize][0] = src[from].leftFirst;
+		stack[stackSize++][1] = next;
+
+		next += 2;
+	}
+
+clean:
+	return s_uccess;
+}
+
+static Bool CpuBVH_buildSAHx(const F32x4 *primMin, const F32x4 *primMax, U64 primCount, CpuBVH *bvh, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	Buffer centroidData = Buffer_createNull();
+	Buffer tempNodeData = Buffer_createNull();
+	Buffer threadData = Buffer_createNull();
+	Buffer builderData = Buffer_createNull();
+
+	const U64 threads = Parallel_getThreadCount();
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(U32) * primCount, &bvh->primIdData))
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(F32x4) * primCount, &centroidData))
+	gotoIfError2(clean, Buffer_createEmptyBytesx(sizeof(CpuBVHNode) * (primCount * 2 + 2), &tempNodeData))
+	gotoIfError2(clean, Buffer_createUninitializedBytesx((sizeof(CpuBVHRange) + sizeof(CpuBVHBins)) * threads, &threadData))
+	gotoIfError2(clean, Buffer_createEmptyBytesx(sizeof(CpuBVHBuilder), &builderData))
+
+	CpuBVHBuilder *b = (CpuBVHBuilder*) builderData.ptrNonConst;
+	F32x4 *centroids = (F32x4*) centroidData.ptrNonConst;
+	U32 *primIds = (U32*) bvh->primIdData.ptrNonConst;
+
+	for(U32 i = 0; i < (U32) primCount; ++i) {
+		primIds[i] = i;
+		centroids[i] = F32x4_add(primMin[i], primMax[i]);
+	}
+
+	b->primMin = primMin;
+	b->primMax = primMax;
+	b->centroids = centroids;
+	b->primIds = primIds;
+	b->nodes = (CpuBVHNode*) tempNodeData.ptrNonConst;
+	b->threadBins = (CpuBVHBins*) threadData.ptrNonConst;
+	b->threadRanges = (CpuBVHRange*)(b->threadBins + threads);
+
+	bvh->primCount = primCount;
+
+	//Split the biggest node until there's enough work for every thread
+
+	U32 nextNode = 2;
+	const U32 maxSubtrees = (U32) U64_min(threads * CpuBVH_subtreesPerThread, CpuBVH_maxSubtrees - 1);
+
+	b->subtrees[b->subtreeCount++] = (CpuBVHBuildTask) { .node = 0, .first = 0, .count = (U32) primCount };
+
+	while(b->subtreeCount && b->subtreeCount < maxSubtrees) {
+
+		U32 biggest = 0;
+
+		for(U32 i = 1; i < b->subtreeCount; ++i)
+			if(b->subtrees[i].count > b->subtrees[biggest].count)
+				biggest = i;
+
+		const CpuBVHBuildTask task = b->subtrees[biggest];
+
+		if(task.count < CpuBVH_subtreeMinPrims)
+			break;
+
+		b->subtrees[biggest] = b->subtrees[--b->subtreeCount];
+
+		U32 mid = U32_MAX;
+
+		if(task.count >= CpuBVH_parallelThreshold)
+			gotoIfError3(clean, CpuBVH_splitParallel(b, task, &mid, e_rr))
+
+		else {
+
+			CpuBVHRange range = CpuBVHRange_empty();
+			CpuBVH_boundRange(b, task.first, task.count, &range);
+
+			CpuBVH_clearBins(b->threadBins[0]);
+			CpuBVH_binRange(b, task.first, task.count, &range, b->threadBins[0]);
+
+			if(!CpuBVH_split(b, task, &range, b->threadBins[0], &mid))
+				mid = U32_MAX;
+		}
+
+		if(mid == U32_MAX)		//Leaf
+			continue;
+
+		const U32 left = nextNode;
+		nextNode += 2;
+
+		b->nodes[task.node].leftFirst = left;
+		b->nodes[task.node].primCount = 0;
+
+		b->subtrees[b->subtreeCount++] = (CpuBVHBuildTask) {
+			.node = left, .first = task.first, .count = mid - task.first, .depth = task.depth + 1
+		};
+
+		b->subtrees[b->subtreeCount++] = (CpuBVHBuildTask) {
+			.node = left + 1, .first = mid, .count = task.first + task.count - mid, .depth = task.depth + 1
+		};
+	}
+
+	//Every subtree of n prims needs at most 2 * (n - 1) more nodes, so reserve that for each of them
+
+	for(U32 i = 0; i < b->subtreeCount; ++i) {
+		b->subtreeNodes[i] = nextNode;
+		nextNode += 2 * (b->subtrees[i].count - 1);
+	}
+
+	gotoIfError3(clean, Parallel_for(b->subtreeCount, CpuBVH_buildSubtreeJob, b, e_rr))
+
+	gotoIfError3(clean, CpuBVH_compact(b->nodes, CpuBVH_countInner(b->nodes), bvh, e_rr))
+
+clean:
+	Buffer_freex(&builderData);
+	Buffer_freex(&threadData);
+	Buffer_freex(&tempNodeData);
+	Buffer_freex(&centroidData);
+	return s_uccess;
+}
+
+Bool CpuBVH_buildx(
+	const F32x4 *primMin, const F32x4 *primMax, U64 primCount, ECpuBVHPolicy policy, CpuBVH *bvh, Error *e_rr
+) {
+
+	Bool s_uccess = true;
+	Bool ownsBvh = false;
+
+	const Ns start = Time_now();
+
+	if(!bvh || !primMin || !primMax)
+		retError(clean, Error_nullPointer(!bvh ? 4 : 0, "CpuBVH_buildx()::primMin, primMax and bvh are required"))
+
+	if(bvh->nodeData.ptr)
+		retError(clean, Error_invalidParameter(4, 0, "CpuBVH_buildx()::bvh wasn't empty, might indicate memleak"))
+
+	if(!primCount || primCount >> 31)
+		retError(clean, Error_invalidParameter(2, 0, "CpuBVH_buildx()::primCount should be in [1, 2^31>"))
+
+	if(policy != ECpuBVHPolicy_SAH && policy != ECpuBVHPolicy_LBVH)
+		retError(clean, Error_invalidParameter(3, 0, "CpuBVH_buildx()::policy is invalid"))
+
+	ownsBvh = true;
+	bvh->policy = policy;
+
+	if(policy == ECpuBVHPolicy_LBVH)
+		gotoIfError3(clean, CpuBVH_buildLBVHx(primMin, primMax, primCount, bvh, e_rr))
+
+	else gotoIfError3(clean, CpuBVH_buildSAHx(primMin, primMax, primCount, bvh, e_rr))
+
+	CpuBVH_computeStats(bvh, &bvh->stats);
+	bvh->stats.buildTime = Time_now() - start;
+
+clean:
+
+	if(!s_uccess && ownsBvh)
+		CpuBVH_freex(bvh);
+
+	return s_uccess;
+}
+
+Bool CpuBVH_rebuildx(const F32x4 *primMin, const F32x4 *primMax, CpuBVH *bvh, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Bool lentBuffers = false;
+	CpuBVH rebuilt = (CpuBVH) { 0 };
+
+	const Ns start = Time_now();
+
+	if(!bvh || !primMin || !primMax)
+		retError(clean, Error_nullPointer(!bvh ? 2 : 0, "CpuBVH_rebuildx()::primMin, primMax and bvh are required"))
+
+	if(!bvh->nodeData.ptr)
+		retError(clean, Error_invalidParameter(2, 0, "CpuBVH_rebuildx()::bvh should've been built before"))
+
+	//The old tree stays untouched until the new one is done, so it's still there if the build fails.
+	//SAH can't reuse anything, so it's just a new build.
+
+	if(bvh->policy == ECpuBVHPolicy_SAH)
+		gotoIfError3(clean, CpuBVH_buildx(primMin, primMax, bvh->primCount, ECpuBVHPolicy_SAH, &rebuilt, e_rr))
+
+	else {
+
+		//LBVH builds into the buffers of the previous build, the old tree becomes the spare for the next rebuild
+
+		rebuilt = (CpuBVH) {
+			.nodeData = bvh->spareNodeData,
+			.primIdData = bvh->sparePrimIdData,
+			.scratchData = bvh->scratchData,
+			.primCount = bvh->primCount,
+			.policy = ECpuBVHPolicy_LBVH,
+			.stats = bvh->stats
+		};
+
+		bvh->spareNodeData = bvh->sparePrimIdData = bvh->scratchData = Buffer_createNull();
+		lentBuffers = true;
+
+		gotoIfError3(clean, CpuBVH_buildLBVHx(primMin, primMax, rebuilt.primCount, &rebuilt, e_rr))
+
+		rebuilt.stats.buildTime = Time_now() - start;
+		rebuilt.spareNodeData = bvh->nodeData;
+		rebuilt.sparePrimIdData = bvh->primIdData;
+
+		bvh->nodeData = bvh->primIdData = Buffer_createNull();
+		lentBuffers = false;
+	}
+
+	CpuBVH_freex(bvh);		//Topology changed, so the refit data goes too
+	*bvh = rebuilt;
+
+clean:
+
+	if(lentBuffers) {		//Failed LBVH build, the old tree never used these
+		bvh->spareNodeData = rebuilt.nodeData;
+		bvh->sparePrimIdData = rebuilt.primIdData;
+		bvh->scratchData = rebuilt.scratchData;
+	}
+
+	return s_uccess;
+}
+
+void CpuBVH_freex(CpuBVH *bvh) {
+
+	if(!bvh)
+		return;
+
+	Buffer_freex(&bvh->nodeData);
+	Buffer_freex(&bvh->primIdData);
+	Buffer_freex(&bvh->scratchData);
+	Buffer_freex(&bvh->spareNodeData);
+	Buffer_freex(&bvh->sparePrimIdData);
+	Buffer_freex(&bvh->refitData);
+	*bvh = (CpuBVH) { 0 };
+}
+
+const CpuBVHNode *CpuBVH_getNodes(const CpuBVH *bvh) {
+
+	if(!bvh || !bvh->nodeData.ptr)
+		return NULL;
+
+	const U64 ptr = (U64) bvh->nodeData.ptr;
+	return (const CpuBVHNode*)(bvh->nodeData.ptr + ((CpuBVH_nodeAlignment - ptr % CpuBVH_nodeAlignment) % CpuBVH_nodeAlignment));
+}
+
+const U32 *CpuBVH_getPrimIds(const CpuBVH *bvh) {
+	return bvh ? (const U32*) bvh->primIdData.ptr : NULL;
+}
+
+void CpuBVH_getBounds(const CpuBVH *bvh, F32x4 *aabbMin, F32x4 *aabbMax) {
+
+	const CpuBVHNode *root = CpuBVH_getNodes(bvh);
+
+	if(!root || !bvh->nodeCount) {
+		*aabbMin = *aabbMax = F32x4_zero();
+		return;
+	}
+
+	*aabbMin = F32x4_create3(root->min[0], root->min[1], root->min[2]);
+	*aabbMax = F32x4_create3(root->max[0], root->max[1], root->max[2]);
+}
+
+static F64 CpuBVHStats_getSAHCost(const CpuBVHStats *stats, F32 rootArea) {
+	return (stats->innerArea * CpuBVH_traversalCost + stats->leafArea * CpuBVH_intersectionCost) / (rootArea > 0 ? rootArea : 1);
+}
+
+void CpuBVH_computeStats(const CpuBVH *bvh, CpuBVHStats *stats) {
+
+	const Ns buildTime = stats->buildTime;
+	*stats = (CpuBVHStats) { .buildTime = buildTime };
+
+	const CpuBVHNode *nodes = CpuBVH_getNodes(bvh);
+
+	if(!nodes || !bvh->nodeCount)
+		return;
+
+	stats->memory = sizeof(CpuBVHNode) * bvh->nodeCount + sizeof(U32) * bvh->primCount;
+
+	U32 stack[CpuBVH_maxStack + 1][2];		//node, depth
+	U64 stackSize = 0;
+
+	stack[stackSize][0] = 0;
+	stack[stackSize++][1] = 1;
+
+	while(stackSize) {
+
+		--stackSize;
+		const CpuBVHNode *node = &nodes[stack[stackSize][0]];
+		const U32 depth = stack[stackSize][1];
+
+		const F64 area = CpuBVHNode_getSurfaceArea(node);
+		stats->maxDepth = U64_max(stats->maxDepth, depth);
+
+		if(node->primCount) {
+			++stats->leafCount;
+			stats->maxLeafSize = U64_max(stats->maxLeafSize, node->primCount);
+			stats->leafArea += area * node->primCount;
+			continue;
+		}
+
+		++stats->innerCount;
+		stats->innerArea += area;
+
+		stack[stackSize][0] = node->leftFirst + 1;
+		stack[stackSize++][1] = depth + 1;
+
+		stack[stackSize][0] = node->leftFirst;
+		stack[stackSize++][1] = depth + 1;
+	}
+
+	stats->sahCost = CpuBVHStats_getSAHCost(stats, CpuBVHNode_getSurfaceArea(nodes));
+}
+
+//Refit
+
+static Bool CpuBVH_fitNode(CpuBVHNode *node, const CpuBVHNode *nodes, const U32 *primIds, const F32x4 *primMin, const F32x4 *primMax) {
+
+	F32x4 aabbMin = F32x4_xxxx4(F32_MAX), aabbMax = F32x4_xxxx4(-F32_MAX);
+
+	if(node->primCount)
+		for(U32 i = node->leftFirst; i < node->leftFirst + node->primCount; ++i) {
+			aabbMin = F32x4_min(aabbMin, primMin[primIds[i]]);
+			aabbMax = F32x4_max(aabbMax, primMax[primIds[i]]);
+		}
+
+	else for(U32 i = node->leftFirst; i < node->leftFirst + 2; ++i) {
+		aabbMin = F32x4_min(aabbMin, F32x4_create3(nodes[i].min[0], nodes[i].min[1], nodes[i].min[2]));
+		aabbMax = F32x4_max(aabbMax, F32x4_create3(nodes[i].max[0], nodes[i].max[1], nodes[i].max[2]));
+	}
+
+	Bool changed = false;
+
+	for(U8 i = 0; i < 3; ++i) {
+
+		const F32 newMin = F32x4_get(aabbMin, i), newMax = F32x4_get(aabbMax, i);
+		changed |= node->min[i] != newMin || node->max[i] != newMax;
+
+		node->min[i] = newMin;
+		node->max[i] = newMax;
+	}
+
+	return changed;
+}
+
+//Parent of every node, leaf of every prim and the nodes in depth first order (so it can be walked backwards)
+
+static Bool CpuBVH_prepareRefit(CpuBVH *bvh, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(bvh->refitData.ptr)
+		goto clean;
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(
+		sizeof(U32) * (bvh->nodeCount * 2 + bvh->primCount), &bvh->refitData
+	))
+
+	const CpuBVHNode *nodes = CpuBVH_getNodes(bvh);
+	U32 *parents = (U32*) bvh->refitData.ptrNonConst;
+	U32 *leaves = parents + bvh->nodeCount;
+	U32 *order = leaves + bvh->primCount;
+
+	U32 stack[CpuBVH_maxStack + 1];
+	U64 stackSize = 0, orderCount = 0;
+
+	parents[0] = U32_MAX;
+	stack[stackSize++] = 0;
+
+	while(stackSize) {
+
+		const U32 nodeId = stack[--stackSize];
+		const CpuBVHNode *node = &nodes[nodeId];
+
+		order[orderCount++] = nodeId;
+
+		if(node->primCount) {
+
+			for(U32 i = node->leftFirst; i < node->leftFirst + node->primCount; ++i)
+				leaves[CpuBVH_getPrimIds(bvh)[i]] = nodeId;
+
+			continue;
+		}
+
+		parents[node->leftFirst] = parents[node->leftFirst + 1] = nodeId;
+		stack[stackSize++] = node->leftFirst + 1;
+		stack[stackSize++] = node->leftFirst;
+	}
+
+	bvh->refitOrderCount = orderCount;
+	CpuBVH_computeStats(bvh, &bvh->stats);			//Refits update the areas incrementally, so make sure they're current
+
+clean:
+	return s_uccess;
+}
+
+static void CpuBVH_updateArea(CpuBVHStats *stats, const CpuBVHNode *node, F32 oldArea) {
+
+	const F64 delta = (F64) CpuBVHNode_getSurfaceArea(node) - oldArea;
+
+	if(node->primCount)
+		stats->leafArea += delta * node->primCount;
+
+	else stats->innerArea += delta;
+}
+
+Bool CpuBVH_refitx(
+	CpuBVH *bvh,
+	const F32x4 *primMin,
+	const F32x4 *primMax,
+	const U32 *dirtyPrims,
+	U64 dirtyCount,
+	U64 *nodesUpdated,
+	Error *e_rr
+) {
+
+	Bool s_uccess = true;
+	U64 updated = 0;
+
+	if(!bvh || !primMin || !primMax)
+		retError(clean, Error_nullPointer(!bvh ? 0 : 1, "CpuBVH_refitx()::bvh, primMin and primMax are required"))
+
+	if(!bvh->nodeData.ptr)
+		retError(clean, Error_invalidParameter(0, 0, "CpuBVH_refitx()::bvh should've been built before"))
+
+	gotoIfError3(clean, CpuBVH_prepareRefit(bvh, e_rr))
+
+	CpuBVHNode *nodes = (CpuBVHNode*) CpuBVH_getNodes(bvh);
+	const U32 *primIds = CpuBVH_getPrimIds(bvh);
+	const U32 *parents = (const U32*) bvh->refitData.ptr;
+	const U32 *leaves = parents + bvh->nodeCount;
+	const U32 *order = leaves + bvh->primCount;
+
+	//Everything changed, so walk backwards through depth first order (children always come after their parent)
+
+	if(!dirtyPrims) {
+
+		for(U64 i = bvh->refitOrderCount; i-- > 0; ) {
+
+			CpuBVHNode *node = &nodes[order[i]];
+			const F32 oldArea = CpuBVHNode_getSurfaceArea(node);
+
+			if(CpuBVH_fitNode(node, nodes, primIds, primMin, primMax)) {
+				CpuBVH_updateArea(&bvh->stats, node, oldArea);
+				++updated;
+			}
+		}
+	}
+
+	//Walk up from every dirty leaf until a node's bounds don't change anymore
+
+	else for(U64 i = 0; i < dirtyCount; ++i) {
+
+		if(dirtyPrims[i] >= bvh->primCount)
+			retError(clean, Error_outOfBounds(3, dirtyPrims[i], bvh->primCount, "CpuBVH_refitx()::dirtyPrims[i] out of bounds"))
+
+		for(U32 nodeId = leaves[dirtyPrims[i]]; nodeId != U32_MAX; nodeId = parents[nodeId]) {
+
+			CpuBVHNode *node = &nodes[nodeId];
+			const F32 oldArea = CpuBVHNode_getSurfaceArea(node);
+
+			if(!CpuBVH_fitNode(node, nodes, primIds, primMin, primMax))
+				break;
+
+			CpuBVH_updateArea(&bvh->stats, node, oldArea);
+			++updated;
+		}
+	}
+
+	bvh->stats.sahCost = CpuBVHStats_getSAHCost(&bvh->stats, CpuBVHNode_getSurfaceArea(nodes));
+
+clean:
+
+	if(nodesUpdated)
+		*nodesUpdated = updated;
+
+	return s_uccess;
+}
+
+Bool CpuBVHNode_intersect(const CpuBVHNode *node, F32x4 origin, F32x4 invDir, F32 minT, F32 maxT, F32 *tNear) {
+
+	const F32x4 t0 = F32x4_mul(F32x4_sub(F32x4_create3(node->min[0], node->min[1], node->min[2]), origin), invDir);
+	const F32x4 t1 = F32x4_mul(F32x4_sub(F32x4_create3(node->max[0], node->max[1], node->max[2]), origin), invDir);
+
+	const F32x4 tMin = F32x4_min(t0, t1);
+	const F32x4 tMax = F32x4_max(t0, t1);
+
+	const F32 entry = F32_max(F32_max(F32x4_x(tMin), F32x4_y(tMin)), F32_max(F32x4_z(tMin), minT));
+	const F32 exit = F32_min(F32_min(F32x4_x(tMax), F32x4_y(tMax)), F32_min(F32x4_z(tMax), maxT));
+
+	*tNear = entry;
+	return entry <= exit;
+}
@@ -0,0 +1,146 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "types/container/buffer.h"
+#include "types/math/vec.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Bounding volume hierarchy used by the CPU acceleration structures.
+//The builder only sees primitive bounds, so the same tree is used for triangles (BLAS) and instances (TLAS).
+//Trees are built with either a binned SAH (top levels are split with all threads, then subtrees are built in parallel)
+//or as an LBVH (Morton codes, radix sort and bottom-up fitting; all parallel) for geometry that changes every frame.
+
+//Nodes are 32 bytes and siblings are always stored next to each other starting at an even index.
+//Since the node array is 64-byte aligned, a node's children always share a single cache line.
+//Node 0 is the root and node 1 is padding.
+
+typedef struct CpuBVHNode {
+
+	F32 min[3];
+	U32 leftFirst;			//Leaf: first index into primIds, inner: left child (right child is always leftFirst + 1)
+
+	F32 max[3];
+	U32 primCount;			//0 for inner nodes
+
+} CpuBVHNode;
+
+typedef struct CpuBVHStats {
+
+	Ns buildTime;
+
+	F64 sahCost;			//Expected cost of a random ray relative to the root: sum of SA(n) / SA(root) * cost(n)
+	F64 innerArea;			//Sum of SA(n) of inner nodes
+	F64 leafArea;			//Sum of SA(n) * primCount of leaves
+
+	U64 innerCount, leafCount;
+	U64 maxDepth, maxLeafSize;
+
+	U64 memory;				//Bytes used by nodes and primIds
+
+} CpuBVHStats;
+
+typedef enum ECpuBVHPolicy {
+	ECpuBVHPolicy_SAH,		//Best traversal performance, for static geometry
+	ECpuBVHPolicy_LBVH		//Builds many times faster but traces slower, for geometry that's rebuilt every frame
+} ECpuBVHPolicy;
+
+typedef struct CpuBVH {
+
+	Buffer nodeData;		//CpuBVHNode[nodeCount] + alignment, use CpuBVH_getNodes
+	Buffer primIdData;		//U32[primCount], leaves reference ranges of this
+	Buffer scratchData;		//LBVH only: kept to make rebuilds allocation free
+	Buffer spareNodeData;	//LBVH only: nodeData and primIdData of the previous build, the next rebuild builds into them
+	Buffer sparePrimIdData;
+	Buffer refitData;		//Created by the first refit: parent per node, leaf per prim and depth first node order
+
+	U64 nodeCount, primCount, refitOrderCount;
+
+	ECpuBVHPolicy policy;
+	U32 padding;
+
+	CpuBVHStats stats;
+
+} CpuBVH;
+
+#define CpuBVH_maxDepth 96		//LBVH can be 63 (Morton code) + 32 (index) levels deep
+#define CpuBVH_maxStack (CpuBVH_maxDepth + 1)
+#define CpuBVH_maxLeafSize 8
+#define CpuBVH_binCount 16
+#define CpuBVH_nodeAlignment 64
+#define CpuBVH_lbvhLeafSize 4
+
+//SAH constants, relative cost of visiting a node vs intersecting a primitive
+
+#define CpuBVH_traversalCost 1.f
+#define CpuBVH_intersectionCost 1.f
+
+//primMin and primMax are the primitive bounds (xyz, w is ignored)
+
+Bool CpuBVH_buildx(
+	const F32x4 *primMin, const F32x4 *primMax, U64 primCount, ECpuBVHPolicy policy, CpuBVH *bvh, Error *e_rr
+);
+
+//Build again with new bounds for the same number of primitives and the same policy.
+//The new tree is built next to the old one and only replaces it if the build succeeded, so a failure keeps bvh intact.
+//LBVH builds into the buffers of the previous build, so only the first rebuild allocates (nodes and primIds are kept
+//twice); stats are only partially updated (buildTime), call CpuBVH_computeStats for the rest.
+
+Bool CpuBVH_rebuildx(const F32x4 *primMin, const F32x4 *primMax, CpuBVH *bvh, Error *e_rr);
+
+//Update the bounds of dirtyPrims (or all prims if dirtyPrims is NULL) and their ancestors without changing the tree.
+//This is much cheaper than a rebuild, but the tree gets worse as prims move; stats.sahCost is kept up to date to track that.
+//nodesUpdated (optional) returns how many nodes actually changed.
+
+Bool CpuBVH_refitx(
+	CpuBVH *bvh,
+	const F32x4 *primMin,
+	const F32x4 *primMax,
+	const U32 *dirtyPrims,
+	U64 dirtyCount,
+	U64 *nodesUpdated,
+	Error *e_rr
+);
+
+//Used by CpuBVH_buildx and CpuBVH_rebuildx; reuses the buffers bvh already has for primCount
+
+Bool CpuBVH_buildLBVHx(const F32x4 *primMin, const F32x4 *primMax, U64 primCount, CpuBVH *bvh, Error *e_rr);
+void CpuBVH_freex(CpuBVH *bvh);
+
+const CpuBVHNode *CpuBVH_getNodes(const CpuBVH *bvh);
+const U32 *CpuBVH_getPrimIds(const CpuBVH *bvh);
+
+void CpuBVH_getBounds(const CpuBVH *bvh, F32x4 *aabbMin, F32x4 *aabbMax);
+
+//Walks the tree and fills in everything except buildTime
+
+void CpuBVH_computeStats(const CpuBVH *bvh, CpuBVHStats *stats);
+F32 CpuBVHNode_getSurfaceArea(const CpuBVHNode *node);
+
+//Slab test, returns if the ray overlaps the node in [minT, maxT> and the entry distance
+
+Bool CpuBVHNode_intersect(const CpuBVHNode *node, F32x4 origin, F32x4 invDir, F32 minT, F32 maxT, F32 *tNear);
+
+#ifdef __cplusplus
+	}
+#endif
@@ -0,0 +1,471 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "cpu_bvh.h"
+#include "parallel.h"
+#include "platforms/ext/bufferx.h"
+#include "types/base/atomic.h"
+#include "types/math/math.h"
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+//Linear BVH (Karras 2012, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d Trees").
+//Every pass is a Parallel_for: centroid bounds, Morton codes, radix sort (11 bits per pass), hierarchy and fitting.
+//Internal node i stores its children at node 2 + 2 * i, so the final (paired) layout is written directly.
+//Subtrees of up to CpuBVH_lbvhLeafSize prims are turned into leaves, which leaves some unused pairs in the node array.
+
+//Small meshes use 30-bit codes (3 sort passes), big ones need 63 bits to avoid duplicates in dense regions (6 passes)
+
+#define CpuLBVH_smallMesh (64 * 1024)
+#define CpuLBVH_radixBits 11
+#define CpuLBVH_radixSize (1 << CpuLBVH_radixBits)
+#define CpuLBVH_chunk (16 * 1024)
+#define CpuLBVH_maxSortJobs 256
+
+typedef struct CpuLBVH {
+
+	const F32x4 *primMin, *primMax;
+	U64 primCount;
+
+	U64 *keys[2];
+	U32 *ids[2];
+
+	U32 *first, *last;				//[primCount - 1] prim range of internal nodes
+	U32 *internalSlot;				//[primCount - 1] where the internal node is stored in the final node array
+	U32 *internalParent;			//[primCount - 1]
+	U32 *leafSlot, *leafParent;		//[primCount]
+	AtomicI64 *visits;				//[primCount - 1] bottom-up fitting; the second visitor fits the node
+
+	CpuBVHNode *nodes;
+	U32 *primIds;
+
+	U32 (*histograms)[CpuLBVH_radixSize];	//[sortJobs]
+
+	F32x4 centroidMin[Parallel_maxThreads], centroidMax[Parallel_maxThreads];
+	F32x4 offset, scale;
+
+	U64 sortJobs, sortChunk;
+	U8 mortonBits, pass, padding[6];
+
+} CpuLBVH;
+
+static U32 CpuLBVH_clz64(U64 v) {
+
+	#ifdef _MSC_VER
+		unsigned long i;
+		return _BitScanReverse64(&i, v) ? 63 - (U32) i : 64;
+	#else
+		return v ? (U32) __builtin_clzll(v) : 64;
+	#endif
+}
+
+//Spread the low 10 or 21 bits so there are 2 zero bits between each of them
+
+static U64 CpuLBVH_expandBits(U64 v) {
+	v &= 0x1FFFFF;
+	v = (v | (v << 32)) & 0x1F00000000FFFF;
+	v = (v | (v << 16)) & 0x1F0000FF0000FF;
+	v = (v | (v <<  8)) & 0x100F00F00F00F00F;
+	v = (v | (v <<  4)) & 0x10C30C30C30C30C3;
+	v = (v | (v <<  2)) & 0x1249249249249249;
+	return v;
+}
+
+static void CpuLBVH_boundCentroids(void *userData, U64 jobId, U64 threadId) {
+
+	CpuLBVH *b = (CpuLBVH*) userData;
+
+	const U64 first = jobId * CpuLBVH_chunk;
+	const U64 last = U64_min(first + CpuLBVH_chunk, b->primCount);
+
+	F32x4 cMin = b->centroidMin[threadId], cMax = b->centroidMax[threadId];
+
+	for(U64 i = first; i < last; ++i) {
+		const F32x4 centroid = F32x4_add(b->primMin[i], b->primMax[i]);
+		cMin = F32x4_min(cMin, centroid);
+		cMax = F32x4_max(cMax, centroid);
+	}
+
+	b->centroidMin[threadId] = cMin;
+	b->centroidMax[threadId] = cMax;
+}
+
+static void CpuLBVH_computeKeys(void *userData, U64 jobId, U64 threadId) {
+
+	(void) threadId;
+	CpuLBVH *b = (CpuLBVH*) userData;
+
+	const U64 first = jobId * CpuLBVH_chunk;
+	const U64 last = U64_min(first + CpuLBVH_chunk, b->primCount);
+
+	for(U64 i = first; i < last; ++i) {
+
+		const F32x4 centroid = F32x4_add(b->primMin[i], b->primMax[i]);
+		const F32x4 cell = F32x4_mul(F32x4_sub(centroid, b->offset), b->scale);
+
+		b->keys[0][i] =
+			(CpuLBVH_expandBits((U64) F32x4_x(cell)) << 2) |
+			(CpuLBVH_expandBits((U64) F32x4_y(cell)) << 1) |
+			CpuLBVH_expandBits((U64) F32x4_z(cell));
+
+		b->ids[0][i] = (U32) i;
+	}
+}
+
+//Radix sort; every job owns a contiguous range, so the sort stays stable
+
+static void CpuLBVH_histogram(void *userData, U64 jobId, U64 threadId) {
+
+	(void) threadId;
+	CpuLBVH *b = (CpuLBVH*) userData;
+
+	const U64 first = jobId * b->sortChunk;
+	const U64 last = U64_min(first + b->sortChunk, b->primCount);
+
+	const U64 *keys = b->keys[0];
+	const U8 shift = b->pass * CpuLBVH_radixBits;
+
+	U32 *histogram = b->histograms[jobId];
+
+	for(U64 i = 0; i < CpuLBVH_radixSize; ++i)
+		histogram[i] = 0;
+
+	for(U64 i = first; i < last; ++i)
+		++histogram[(keys[i] >> shift) & (CpuLBVH_radixSize - 1)];
+}
+
+static void CpuLBVH_scatter(void *userData, U64 jobId, U64 threadId) {
+
+	(void) threadId;
+	CpuLBVH *b = (CpuLBVH*) userData;
+
+	const U64 first = jobId * b->sortChunk;
+	const U64 last = U64_min(first + b->sortChunk, b->primCount);
+
+	const U64 *keys = b->keys[0];
+	const U32 *ids = b->ids[0];
+	U64 *dstKeys = b->keys[1];
+	U32 *dstIds = b->ids[1];
+
+	const U8 shift = b->pass * CpuLBVH_radixBits;
+	U32 *offsets = b->histograms[jobId];
+
+	for(U64 i = first; i < last; ++i) {
+		const U32 j = offsets[(keys[i] >> shift) & (CpuLBVH_radixSize - 1)]++;
+		dstKeys[j] = keys[i];
+		dstIds[j] = ids[i];
+	}
+}
+
+static Bool CpuLBVH_sort(CpuLBVH *b, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	const U8 passes = (b->mortonBits + CpuLBVH_radixBits - 1) / CpuLBVH_radixBits;
+
+	for(b->pass = 0; b->pass < passes; ++b->pass) {
+
+		gotoIfError3(clean, Parallel_for(b->sortJobs, CpuLBVH_histogram, b, e_rr))
+
+		//If everything is in one bucket, this pass wouldn't change anything
+
+		Bool isSorted = false;
+
+		for(U64 digit = 0; digit < CpuLBVH_radixSize && !isSorted; ++digit) {
+
+			U64 count = 0;
+
+			for(U64 job = 0; job < b->sortJobs; ++job)
+				count += b->histograms[job][digit];
+
+			isSorted = count == b->primCount;
+		}
+
+		if(isSorted)
+			continue;
+
+		//Turn the histograms into the offsets of each job (digit major, job minor)
+
+		U32 offset = 0;
+
+		for(U64 digit = 0; digit < CpuLBVH_radixSize; ++digit)
+			for(U64 job = 0; job < b->sortJobs; ++job) {
+				const U32 count = b->histograms[job][digit];
+				b->histograms[job][digit] = offset;
+				offset += count;
+			}
+
+		gotoIfError3(clean, Parallel_for(b->sortJobs, CpuLBVH_scatter, b, e_rr))
+
+		//Sorted data is now in [1], so swap to make sure [0] is always the input of the next pass
+
+		U64 *keys = b->keys[0];
+		b->keys[0] = b->keys[1];
+		b->keys[1] = keys;
+
+		U32 *ids = b->ids[0];
+		b->ids[0] = b->ids[1];
+		b->ids[1] = ids;
+	}
+
+clean:
+	return s_uccess;
+}
+
+//Hierarchy
+
+static I32 CpuLBVH_delta(const CpuLBVH *b, I64 i, I64 j) {
+
+	if(j < 0 || j >= (I64) b->primCount)
+		return -1;
+
+	const U64 ki = b->keys[0][i], kj = b->keys[0][j];
+
+	//Duplicate codes use the index as tie breaker, so every key is unique
+
+	return ki == kj ? 64 + (I32) CpuLBVH_clz64((U64)(i ^ j)) : (I32) CpuLBVH_clz64(ki ^ kj);
+}
+
+static void CpuLBVH_setChild(CpuLBVH *b, U32 parent, U32 child, Bool isLeaf, U32 slot) {
+
+	if(isLeaf) {
+		b->leafSlot[child] = slot;
+		b->leafParent[child] = parent;
+	}
+
+	else {
+		b->internalSlot[child] = slot;
+		b->internalParent[child] = parent;
+	}
+}
+
+static void CpuLBVH_buildHierarchy(void *userData, U64 jobId, U64 threadId) {
+
+	(void) threadId;
+	CpuLBVH *b = (CpuLBVH*) userData;
+
+	const U64 firstNode = jobId * CpuLBVH_chunk;
+	const U64 lastNode = U64_min(firstNode + CpuLBVH_chunk, b->primCount - 1);
+
+	for(I64 i = (I64) firstNode; i < (I64) lastNode; ++i) {
+
+		//Direction of the range and its upper bound
+
+		const I64 d = CpuLBVH_delta(b, i, i + 1) - CpuLBVH_delta(b, i, i - 1) >= 0 ? 1 : -1;
+		const I32 deltaMin = CpuLBVH_delta(b, i, i - d);
+
+		I64 lMax = 2;
+
+		while(CpuLBVH_delta(b, i, i + lMax * d) > deltaMin)
+			lMax *= 2;
+
+		//Find the other end with a binary search
+
+		I64 l = 0;
+
+		for(I64 t = lMax / 2; t >= 1; t /= 2)
+			if(CpuLBVH_delta(b, i, i + (l + t) * d) > deltaMin)
+				l += t;
+
+		const I64 j = i + l * d;
+		const I32 deltaNode = CpuLBVH_delta(b, i, j);
+
+		//Find the split position with a binary search
+
+		I64 s = 0, step = l;
+
+		do {
+
+			step = (step + 1) / 2;
+
+			if(s + step < l && CpuLBVH_delta(b, i, i + (s + step) * d) > deltaNode)
+				s += step;
+
+		} while(step > 1);
+
+		const U32 split = (U32)(i + s * d + (d < 0 ? -1 : 0));
+		const U32 first = (U32)(d < 0 ? j : i), last = (U32)(d < 0 ? i : j);
+
+		b->first[i] = first;
+		b->last[i] = last;
+		AtomicI64_store(&b->visits[i], 0);
+
+		CpuLBVH_setChild(b, (U32) i, split, first == split, 2 + 2 * (U32) i);
+		CpuLBVH_setChild(b, (U32) i, split + 1, last == split + 1, 3 + 2 * (U32) i);
+	}
+}
+
+//Every leaf walks up to the root; the first thread to reach a node stops, the second one fits it
+
+static void CpuLBVH_fit(void *userData, U64 jobId, U64 threadId) {
+
+	(void) threadId;
+	CpuLBVH *b = (CpuLBVH*) userData;
+
+	const U64 firstLeaf = jobId * CpuLBVH_chunk;
+	const U64 lastLeaf = U64_min(firstLeaf + CpuLBVH_chunk, b->primCount);
+
+	for(U64 k = firstLeaf; k < lastLeaf; ++k) {
+
+		const U32 prim = b->ids[0][k];
+		b->primIds[k] = prim;
+
+		CpuBVHNode *leaf = &b->nodes[b->leafSlot[k]];
+
+		for(U8 i = 0; i < 3; ++i) {
+			leaf->min[i] = F32x4_get(b->primMin[prim], i);
+			leaf->max[i] = F32x4_get(b->primMax[prim], i);
+		}
+
+		leaf->leftFirst = (U32) k;
+		leaf->primCount = 1;
+
+		if(b->primCount == 1)
+			continue;
+
+		for(U32 p = b->leafParent[k]; AtomicI64_inc(&b->visits[p]) == 2; p = b->internalParent[p]) {
+
+			const CpuBVHNode *left = &b->nodes[2 + 2 * p], *right = left + 1;
+			CpuBVHNode *node = &b->nodes[b->internalSlot[p]];
+
+			for(U8 i = 0; i < 3; ++i) {
+				node->min[i] = F32_min(left->min[i], right->min[i]);
+				node->max[i] = F32_max(left->max[i], right->max[i]);
+			}
+
+			const U32 count = b->last[p] - b->first[p] + 1;
+
+			node->leftFirst = count <= CpuBVH_lbvhLeafSize ? b->first[p] : 2 + 2 * p;
+			node->primCount = count <= CpuBVH_lbvhLeafSize ? count : 0;
+
+			if(!p)
+				break;
+		}
+	}
+}
+
+Bool CpuBVH_buildLBVHx(const F32x4 *primMin, const F32x4 *primMax, U64 primCount, CpuBVH *bvh, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!bvh || !primMin || !primMax)
+		retError(clean, Error_nullPointer(!bvh ? 3 : 0, "CpuBVH_buildLBVHx()::primMin, primMax and bvh are required"))
+
+	if(!primCount || primCount >> 31)
+		retError(clean, Error_invalidParameter(2, 0, "CpuBVH_buildLBVHx()::primCount should be in [1, 2^31>"))
+
+	const U64 jobs = (primCount + CpuLBVH_chunk - 1) / CpuLBVH_chunk;
+	const U64 sortJobs = U64_min(jobs, CpuLBVH_maxSortJobs);
+
+	const U64 scratchSize =
+		primCount * (sizeof(U64) * 2 + sizeof(AtomicI64) + sizeof(U32) * 8) +
+		sizeof(U32) * CpuLBVH_radixSize * sortJobs;
+
+	//Allocate what's missing, everything if it was built with a different primCount before
+
+	if(bvh->primCount != primCount) {
+		Buffer_freex(&bvh->nodeData);
+		Buffer_freex(&bvh->primIdData);
+		Buffer_freex(&bvh->scratchData);
+	}
+
+	bvh->nodeCount = primCount * 2;
+	bvh->primCount = primCount;
+
+	if(!bvh->nodeData.ptr)
+		gotoIfError2(clean, Buffer_createEmptyBytesx(
+			sizeof(CpuBVHNode) * bvh->nodeCount + CpuBVH_nodeAlignment, &bvh->nodeData
+		))
+
+	if(!bvh->primIdData.ptr)
+		gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(U32) * primCount, &bvh->primIdData))
+
+	if(Buffer_length(bvh->scratchData) != scratchSize) {
+		Buffer_freex(&bvh->scratchData);
+		gotoIfError2(clean, Buffer_createUninitializedBytesx(scratchSize, &bvh->scratchData))
+	}
+
+	CpuLBVH b = (CpuLBVH) {
+		.primMin = primMin,
+		.primMax = primMax,
+		.primCount = primCount,
+		.nodes = (CpuBVHNode*) CpuBVH_getNodes(bvh),
+		.primIds = (U32*) bvh->primIdData.ptrNonConst,
+		.sortJobs = sortJobs,
+		.sortChunk = (primCount + sortJobs - 1) / sortJobs,
+		.mortonBits = primCount <= CpuLBVH_smallMesh ? 30 : 63
+	};
+
+	U8 *scratch = bvh->scratchData.ptrNonConst;
+
+	b.keys[0] = (U64*) scratch;					scratch += sizeof(U64) * primCount;
+	b.keys[1] = (U64*) scratch;					scratch += sizeof(U64) * primCount;
+	b.visits = (AtomicI64*) scratch;			scratch += sizeof(AtomicI64) * primCount;
+	b.ids[0] = (U32*) scratch;					scratch += sizeof(U32) * primCount;
+	b.ids[1] = (U32*) scratch;					scratch += sizeof(U32) * primCount;
+	b.first = (U32*) scratch;					scratch += sizeof(U32) * primCount;
+	b.last = (U32*) scratch;					scratch += sizeof(U32) * primCount;
+	b.internalSlot = (U32*) scratch;			scratch += sizeof(U32) * primCount;
+	b.internalParent = (U32*) scratch;			scratch += sizeof(U32) * primCount;
+	b.leafSlot = (U32*) scratch;				scratch += sizeof(U32) * primCount;
+	b.leafParent = (U32*) scratch;				scratch += sizeof(U32) * primCount;
+	b.histograms = (U32(*)[CpuLBVH_radixSize]) scratch;
+
+	//Quantize centroids to the grid
+
+	for(U64 i = 0; i < Parallel_maxThreads; ++i) {
+		b.centroidMin[i] = F32x4_xxxx4(F32_MAX);
+		b.centroidMax[i] = F32x4_xxxx4(-F32_MAX);
+	}
+
+	gotoIfError3(clean, Parallel_for(jobs, CpuLBVH_boundCentroids, &b, e_rr))
+
+	F32x4 centroidMin = b.centroidMin[0], centroidMax = b.centroidMax[0];
+
+	for(U64 i = 1; i < Parallel_maxThreads; ++i) {
+		centroidMin = F32x4_min(centroidMin, b.centroidMin[i]);
+		centroidMax = F32x4_max(centroidMax, b.centroidMax[i]);
+	}
+
+	const F32 cells = (F32)((1 << (b.mortonBits / 3)) - 1);
+	const F32x4 extent = F32x4_sub(centroidMax, centroidMin);
+
+	b.offset = centroidMin;
+
+	for(U8 i = 0; i < 3; ++i)
+		F32x4_set(&b.scale, i, F32x4_get(extent, i) > 0 ? cells / F32x4_get(extent, i) : 0);
+
+	gotoIfError3(clean, Parallel_for(jobs, CpuLBVH_computeKeys, &b, e_rr))
+	gotoIfError3(clean, CpuLBVH_sort(&b, e_rr))
+
+	//Build the hierarchy and fit it
+
+	b.internalSlot[0] = 0;
+	b.internalParent[0] = U32_MAX;
+	b.leafSlot[0] = 0;					//Only used if it's the root
+
+	gotoIfError3(clean, Parallel_for((primCount - 1 + CpuLBVH_chunk - 1) / CpuLBVH_chunk, CpuLBVH_buildHierarchy, &b, e_rr))
+	gotoIfError3(clean, Parallel_for(jobs, CpuLBVH_fit, &b, e_rr))
+
+clean:
+	return s_uccess;
+}
@@ -0,0 +1,643 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "cpu_as.h"
+#include "types/math/math.h"
+
+//Packet traversal (Wald et al. 2001, "Interactive Rendering with Coherent Ray Tracing" and
+//Reshetov et al. 2005, "Multi-Level Ray Tracing Algorithm").
+//Instead of frustum planes, the packet is bounded by the range of its origins and inverse directions.
+//Interval arithmetic over those gives the earliest entry and latest exit of any ray into a node,
+//which also works for the orthographic rays of the test scene (they don't share an origin).
+//Rays that are done (or padding) have maxT = -F32_MAX, so every test they're in fails.
+
+#define CpuPacket_inactive (-F32_MAX)
+
+//1 / dir is clamped to this for the packet bounds, so 0 * inf can't turn them into NaNs
+
+#define CpuPacket_maxInvDir 1e30f
+
+typedef struct CpuPacketTraversal {
+
+	RayDesc4 rays[CpuRayPacket_maxGroups];		//maxT shrinks as hits are found
+	F32x4 invDirX[CpuRayPacket_maxGroups], invDirY[CpuRayPacket_maxGroups], invDirZ[CpuRayPacket_maxGroups];
+
+	F32x4 originMin, originMax;					//xyz bounds of all rays in the packet
+	F32x4 invDirMin, invDirMax;
+	F32x4 isNegative;							//xyz: 1 if every ray goes in the negative direction
+	F32x4 dirSum;								//Approximate packet direction, to visit the nearest child first
+
+	F32 minT, maxT;								//Over all rays, maxT is updated after leaves that had hits
+	U32 groupCount, rayCount;
+
+} CpuPacketTraversal;
+
+void CpuRayPacket_set(CpuRayPacket *packet, U32 i, RayDesc ray) {
+
+	if(!packet || i >= CpuRayPacket_maxRays)
+		return;
+
+	RayDesc4 *group = &packet->rays[i >> 2];
+	const U8 lane = (U8)(i & 3);
+
+	F32x4_set(&group->originX, lane, F32x4_x(ray.origin));
+	F32x4_set(&group->originY, lane, F32x4_y(ray.origin));
+	F32x4_set(&group->originZ, lane, F32x4_z(ray.origin));
+	F32x4_set(&group->dirX, lane, F32x4_x(ray.dir));
+	F32x4_set(&group->dirY, lane, F32x4_y(ray.dir));
+	F32x4_set(&group->dirZ, lane, F32x4_z(ray.dir));
+	F32x4_set(&group->minT, lane, ray.minT);
+	F32x4_set(&group->maxT, lane, ray.maxT);
+}
+
+RayDesc CpuRayPacket_get(const CpuRayPacket *packet, U32 i) {
+	return RayDesc4_get(&packet->rays[i >> 2], (U8)(i & 3));
+}
+
+static F32 CpuPacket_max4(F32x4 v) {
+	return F32_max(F32_max(F32x4_x(v), F32x4_y(v)), F32_max(F32x4_z(v), F32x4_w(v)));
+}
+
+static F32 CpuPacket_min4(F32x4 v) {
+	return F32_min(F32_min(F32x4_x(v), F32x4_y(v)), F32_min(F32x4_z(v), F32x4_w(v)));
+}
+
+static void CpuPacket_updateMaxT(CpuPacketTraversal *p) {
+
+	F32x4 maxT = p->rays[0].maxT;
+
+	for(U32 g = 1; g < p->groupCount; ++g)
+		maxT = F32x4_max(maxT, p->rays[g].maxT);
+
+	p->maxT = CpuPacket_max4(maxT);
+}
+
+//p->rays and p->rayCount have to be set; lanes past the last ray are padded with inactive copies of ray 0.
+//Returns false if the rays don't go the same way on every axis.
+
+static Bool CpuPacket_init(CpuPacketTraversal *p) {
+
+	p->groupCount = (p->rayCount + 3) >> 2;
+
+	const RayDesc first = RayDesc4_get(&p->rays[0], 0);
+
+	for(U32 i = p->rayCount; i < p->groupCount << 2; ++i) {
+
+		RayDesc4 *group = &p->rays[i >> 2];
+		const U8 lane = (U8)(i & 3);
+
+		F32x4_set(&group->originX, lane, F32x4_x(first.origin));
+		F32x4_set(&group->originY, lane, F32x4_y(first.origin));
+		F32x4_set(&group->originZ, lane, F32x4_z(first.origin));
+		F32x4_set(&group->dirX, lane, F32x4_x(first.dir));
+		F32x4_set(&group->dirY, lane, F32x4_y(first.dir));
+		F32x4_set(&group->dirZ, lane, F32x4_z(first.dir));
+		F32x4_set(&group->minT, lane, 0);
+		F32x4_set(&group->maxT, lane, CpuPacket_inactive);
+	}
+
+	F32x4 oMin[3], oMax[3], iMin[3], iMax[3], dSum[3];
+	F32x4 minT = F32x4_xxxx4(F32_MAX);
+
+	for(U32 g = 0; g < p->groupCount; ++g) {
+
+		const RayDesc4 *r = &p->rays[g];
+
+		p->invDirX[g] = F32x4_div(F32x4_one(), r->dirX);
+		p->invDirY[g] = F32x4_div(F32x4_one(), r->dirY);
+		p->invDirZ[g] = F32x4_div(F32x4_one(), r->dirZ);
+
+		const F32x4 o[3] = { r->originX, r->originY, r->originZ };
+		const F32x4 d[3] = { r->dirX, r->dirY, r->dirZ };
+		const F32x4 inv[3] = { p->invDirX[g], p->invDirY[g], p->invDirZ[g] };
+
+		for(U8 k = 0; k < 3; ++k) {
+			oMin[k] = g ? F32x4_min(oMin[k], o[k]) : o[k];
+			oMax[k] = g ? F32x4_max(oMax[k], o[k]) : o[k];
+			iMin[k] = g ? F32x4_min(iMin[k], inv[k]) : inv[k];
+			iMax[k] = g ? F32x4_max(iMax[k], inv[k]) : inv[k];
+			dSum[k] = g ? F32x4_add(dSum[k], d[k]) : d[k];
+		}
+
+		minT = F32x4_min(minT, r->minT);
+	}
+
+	Bool isCoherent = true;
+
+	for(U8 k = 0; k < 3; ++k) {
+
+		const F32 invMin = CpuPacket_min4(iMin[k]), invMax = CpuPacket_max4(iMax[k]);
+		isCoherent &= invMin > 0 || invMax < 0;
+
+		F32x4_set(&p->originMin, k, CpuPacket_min4(oMin[k]));
+		F32x4_set(&p->originMax, k, CpuPacket_max4(oMax[k]));
+		F32x4_set(&p->invDirMin, k, F32_clamp(invMin, -CpuPacket_maxInvDir, CpuPacket_maxInvDir));
+		F32x4_set(&p->invDirMax, k, F32_clamp(invMax, -CpuPacket_maxInvDir, CpuPacket_maxInvDir));
+		F32x4_set(&p->isNegative, k, invMax < 0 ? 1.f : 0.f);
+		F32x4_set(&p->dirSum, k, F32x4_x(dSum[k]) + F32x4_y(dSum[k]) + F32x4_z(dSum[k]) + F32x4_w(dSum[k]));
+	}
+
+	p->minT = CpuPacket_min4(minT);
+	CpuPacket_updateMaxT(p);
+	return isCoherent;
+}
+
+//Conservative: false only if no ray in the packet can hit the node
+
+static Bool CpuPacket_mayIntersect(const CpuPacketTraversal *p, const CpuBVHNode *node) {
+
+	const F32x4 bMin = F32x4_create3(node->min[0], node->min[1], node->min[2]);
+	const F32x4 bMax = F32x4_create3(node->max[0], node->max[1], node->max[2]);
+
+	//Rays enter through min on positive axes and through max on negative ones
+
+	const F32x4 entry = F32x4_add(bMin, F32x4_mul(F32x4_sub(bMax, bMin), p->isNegative));
+	const F32x4 exit = F32x4_add(bMax, F32x4_mul(F32x4_sub(bMin, bMax), p->isNegative));
+
+	const F32x4 entry0 = F32x4_sub(entry, p->originMax), entry1 = F32x4_sub(entry, p->originMin);
+	const F32x4 exit0 = F32x4_sub(exit, p->originMax), exit1 = F32x4_sub(exit, p->originMin);
+
+	const F32x4 earliestEntry = F32x4_min(
+		F32x4_min(F32x4_mul(entry0, p->invDirMin), F32x4_mul(entry0, p->invDirMax)),
+		F32x4_min(F32x4_mul(entry1, p->invDirMin), F32x4_mul(entry1, p->invDirMax))
+	);
+
+	const F32x4 latestExit = F32x4_max(
+		F32x4_max(F32x4_mul(exit0, p->invDirMin), F32x4_mul(exit0, p->invDirMax)),
+		F32x4_max(F32x4_mul(exit1, p->invDirMin), F32x4_mul(exit1, p->invDirMax))
+	);
+
+	const F32 tEntry = F32_max(
+		F32_max(F32x4_x(earliestEntry), F32x4_y(earliestEntry)), F32_max(F32x4_z(earliestEntry), p->minT)
+	);
+
+	const F32 tExit = F32_min(F32_min(F32x4_x(latestExit), F32x4_y(latestExit)), F32_min(F32x4_z(latestExit), p->maxT));
+
+	return tEntry <= tExit;
+}
+
+//Same as CpuBVHNode_intersect for 4 rays; 1 in the lanes that hit
+
+static F32x4 CpuPacket_intersectNode(const CpuPacketTraversal *p, U32 g, const CpuBVHNode *node) {
+
+	const RayDesc4 *r = &p->rays[g];
+
+	const F32x4 tx0 = F32x4_mul(F32x4_sub(F32x4_xxxx4(node->min[0]), r->originX), p->invDirX[g]);
+	const F32x4 ty0 = F32x4_mul(F32x4_sub(F32x4_xxxx4(node->min[1]), r->originY), p->invDirY[g]);
+	const F32x4 tz0 = F32x4_mul(F32x4_sub(F32x4_xxxx4(node->min[2]), r->originZ), p->invDirZ[g]);
+
+	const F32x4 tx1 = F32x4_mul(F32x4_sub(F32x4_xxxx4(node->max[0]), r->originX), p->invDirX[g]);
+	const F32x4 ty1 = F32x4_mul(F32x4_sub(F32x4_xxxx4(node->max[1]), r->originY), p->invDirY[g]);
+	const F32x4 tz1 = F32x4_mul(F32x4_sub(F32x4_xxxx4(node->max[2]), r->originZ), p->invDirZ[g]);
+
+	const F32x4 entry = F32x4_max(
+		F32x4_max(F32x4_min(tx0, tx1), F32x4_min(ty0, ty1)), F32x4_max(F32x4_min(tz0, tz1), r->minT)
+	);
+
+	const F32x4 exit = F32x4_min(
+		F32x4_min(F32x4_max(tx0, tx1), F32x4_max(ty0, ty1)), F32x4_min(F32x4_max(tz0, tz1), r->maxT)
+	);
+
+	return F32x4_leq(entry, exit);
+}
+
+//First group (at or after first) with a ray that hits the node, groupCount if there's none
+
+static U32 CpuPacket_firstActive(const CpuPacketTraversal *p, const CpuBVHNode *node, U32 first) {
+
+	for(; first < p->groupCount; ++first)
+		if(F32x4_any(CpuPacket_intersectNode(p, first, node)))
+			break;
+
+	return first;
+}
+
+//a.xyz x b.xyz for 4 lanes at once, where every F32x4 is one component and b is the same for every lane
+
+static void CpuPacket_cross3(F32x4 ax, F32x4 ay, F32x4 az, F32x4 b, F32x4 *x, F32x4 *y, F32x4 *z) {
+
+	const F32x4 bx = F32x4_xxxx4(F32x4_x(b)), by = F32x4_xxxx4(F32x4_y(b)), bz = F32x4_xxxx4(F32x4_z(b));
+
+	*x = F32x4_sub(F32x4_mul(ay, bz), F32x4_mul(az, by));
+	*y = F32x4_sub(F32x4_mul(az, bx), F32x4_mul(ax, bz));
+	*z = F32x4_sub(F32x4_mul(ax, by), F32x4_mul(ay, bx));
+}
+
+static F32x4 CpuPacket_dot3(F32x4 ax, F32x4 ay, F32x4 az, F32x4 bx, F32x4 by, F32x4 bz) {
+	return F32x4_add(F32x4_add(F32x4_mul(ax, bx), F32x4_mul(ay, by)), F32x4_mul(az, bz));
+}
+
+//Möller-Trumbore for 4 rays against one triangle, same as CpuTriangle_intersect; returns the lanes that hit
+
+static U8 CpuPacket_intersectTriangle(
+	const CpuTriangle *tri, const RayDesc4 *r, ECpuRayFlags flags, F32x4 *t, F32x4 *u, F32x4 *v
+) {
+
+	if((flags & ECpuRayFlags_CullBackFacingTriangles) && (flags & ECpuRayFlags_CullFrontFacingTriangles))
+		return 0;
+
+	F32x4 px, py, pz;
+	CpuPacket_cross3(r->dirX, r->dirY, r->dirZ, tri->e2, &px, &py, &pz);
+
+	const F32x4 e1x = F32x4_xxxx4(F32x4_x(tri->e1));
+	const F32x4 e1y = F32x4_xxxx4(F32x4_y(tri->e1));
+	const F32x4 e1z = F32x4_xxxx4(F32x4_z(tri->e1));
+
+	const F32x4 det = CpuPacket_dot3(e1x, e1y, e1z, px, py, pz);
+	const F32x4 zero = F32x4_zero();
+
+	F32x4 mask =
+		(flags & ECpuRayFlags_CullBackFacingTriangles) ? F32x4_lt(det, zero) :
+		(flags & ECpuRayFlags_CullFrontFacingTriangles) ? F32x4_gt(det, zero) :
+		F32x4_neq(det, zero);
+
+	if(!F32x4_any(mask))
+		return 0;
+
+	const F32x4 invDet = F32x4_div(F32x4_one(), det);
+
+	const F32x4 tx = F32x4_sub(r->originX, F32x4_xxxx4(F32x4_x(tri->v0)));
+	const F32x4 ty = F32x4_sub(r->originY, F32x4_xxxx4(F32x4_y(tri->v0)));
+	const F32x4 tz = F32x4_sub(r->originZ, F32x4_xxxx4(F32x4_z(tri->v0)));
+
+	const F32x4 baryU = F32x4_mul(CpuPacket_dot3(tx, ty, tz, px, py, pz), invDet);
+	mask = F32x4_mul(mask, F32x4_mul(F32x4_geq(baryU, zero), F32x4_leq(baryU, F32x4_one())));
+
+	if(!F32x4_any(mask))
+		return 0;
+
+	F32x4 qx, qy, qz;
+	CpuPacket_cross3(tx, ty, tz, tri->e1, &qx, &qy, &qz);
+
+	const F32x4 baryV = F32x4_mul(CpuPacket_dot3(r->dirX, r->dirY, r->dirZ, qx, qy, qz), invDet);
+	mask = F32x4_mul(mask, F32x4_mul(F32x4_geq(baryV, zero), F32x4_leq(F32x4_add(baryU, baryV), F32x4_one())));
+
+	if(!F32x4_any(mask))
+		return 0;
+
+	const F32x4 e2x = F32x4_xxxx4(F32x4_x(tri->e2));
+	const F32x4 e2y = F32x4_xxxx4(F32x4_y(tri->e2));
+	const F32x4 e2z = F32x4_xxxx4(F32x4_z(tri->e2));
+
+	const F32x4 hitT = F32x4_mul(CpuPacket_dot3(e2x, e2y, e2z, qx, qy, qz), invDet);
+	mask = F32x4_mul(mask, F32x4_mul(F32x4_geq(hitT, r->minT), F32x4_lt(hitT, r->maxT)));
+
+	*t = hitT;
+	*u = baryU;
+	*v = baryV;
+
+	U8 hits = 0;
+
+	for(U8 i = 0; i < 4; ++i)
+		hits |= (F32x4_get(mask, i) != 0) << i;
+
+	return hits;
+}
+
+//Shrinks the maxT of the rays as closer hits are found.
+//Only the hits and hitMask bits of rays that found a closer hit are touched.
+
+static void CpuBLAS_traversePacket(
+	const CpuBLAS *blas, CpuPacketTraversal *p, ECpuRayFlags flags, CpuHit *hits, U64 *hitMask
+) {
+
+	const CpuBVHNode *nodes = CpuBVH_getNodes(&blas->bvh);
+	const U32 *primIds = CpuBVH_getPrimIds(&blas->bvh);
+	const CpuTriangle *triangles = (const CpuTriangle*) blas->triangleData.ptr;
+
+	//Every node also remembers the first group that could hit its parent, groups before that can be skipped
+
+	U32 stack[CpuBVH_maxStack][2];
+	U64 stackSize = 0;
+
+	stack[stackSize][0] = 0;
+	stack[stackSize++][1] = 0;
+
+	while(stackSize) {
+
+		--stackSize;
+		const CpuBVHNode *node = &nodes[stack[stackSize][0]];
+
+		if(!CpuPacket_mayIntersect(p, node))
+			continue;
+
+		const U32 first = CpuPacket_firstActive(p, node, stack[stackSize][1]);
+
+		if(first == p->groupCount)
+			continue;
+
+		if(node->primCount) {
+
+			Bool anyHit = false;
+
+			for(U32 g = first; g < p->groupCount; ++g) {
+
+				if(g != first && !F32x4_any(CpuPacket_intersectNode(p, g, node)))
+					continue;
+
+				RayDesc4 *r = &p->rays[g];
+
+				for(U32 i = node->leftFirst; i < node->leftFirst + node->primCount; ++i) {
+
+					F32x4 t, u, v;
+					const U8 lanes = CpuPacket_intersectTriangle(&triangles[i], r, flags, &t, &u, &v);
+
+					if(!lanes)
+						continue;
+
+					for(U8 lane = 0; lane < 4; ++lane) {
+
+						if(!((lanes >> lane) & 1))
+							continue;
+
+						const U32 ray = (g << 2) | lane;
+						const F32 hitT = F32x4_get(t, lane);
+
+						hits[ray].t = hitT;
+						hits[ray].baryU = F32x4_get(u, lane);
+						hits[ray].baryV = F32x4_get(v, lane);
+						hits[ray].primitiveId = primIds[i];
+						hits[ray].triangleIndex = i;
+						hitMask[ray >> 6] |= (U64)1 << (ray & 63);
+
+						F32x4_set(
+							&r->maxT, lane,
+							flags & ECpuRayFlags_AcceptFirstHitAndEndSearch ? CpuPacket_inactive : hitT
+						);
+					}
+
+					anyHit = true;
+				}
+			}
+
+			if(anyHit)
+				CpuPacket_updateMaxT(p);
+
+			continue;
+		}
+
+		//Push the far child first, so the near one is visited first and closer hits can cull the far one
+
+		const CpuBVHNode *left = &nodes[node->leftFirst], *right = &nodes[node->leftFirst + 1];
+
+		const F32x4 leftCenter = F32x4_create3(
+			left->min[0] + left->max[0], left->min[1] + left->max[1], left->min[2] + left->max[2]
+		);
+
+		const F32x4 rightCenter = F32x4_create3(
+			right->min[0] + right->max[0], right->min[1] + right->max[1], right->min[2] + right->max[2]
+		);
+
+		const Bool leftIsNearer = F32x4_dot3(p->dirSum, F32x4_sub(rightCenter, leftCenter)) >= 0;
+
+		stack[stackSize][0] = node->leftFirst + leftIsNearer;
+		stack[stackSize++][1] = first;
+
+		stack[stackSize][0] = node->leftFirst + !leftIsNearer;
+		stack[stackSize++][1] = first;
+	}
+}
+
+Bool CpuBLAS_tracePacket(
+	const CpuBLAS *blas,
+	const CpuRayPacket *packet,
+	ECpuRayFlags flags,
+	CpuHit hits[CpuRayPacket_maxRays],
+	U64 hitMask[CpuRayPacket_maxRays / 64]
+) {
+
+	if(!hitMask)
+		return true;
+
+	for(U8 i = 0; i < CpuRayPacket_maxRays / 64; ++i)
+		hitMask[i] = 0;
+
+	if(!blas || !packet || !hits || !blas->triangleCount || (flags & ECpuRayFlags_SkipTriangles))
+		return true;
+
+	const U32 rayCount = U32_min(packet->rayCount, CpuRayPacket_maxRays);
+
+	if(!rayCount)
+		return true;
+
+	CpuPacketTraversal p;
+	p.rayCount = rayCount;
+
+	for(U32 g = 0; g < (rayCount + 3) >> 2; ++g)
+		p.rays[g] = packet->rays[g];
+
+	if(CpuPacket_init(&p)) {
+
+		//Only the BLAS fields are written, the rest stays 0 like CpuBLAS_traceRay
+
+		for(U32 i = 0; i < rayCount; ++i)
+			hits[i] = (CpuHit) { 0 };
+
+		CpuBLAS_traversePacket(blas, &p, flags, hits, hitMask);
+		return true;
+	}
+
+	for(U32 i = 0; i < rayCount; ++i)
+		if(CpuBLAS_traceRay(blas, CpuRayPacket_get(packet, i), flags, &hits[i]))
+			hitMask[i >> 6] |= (U64)1 << (i & 63);
+
+	return false;
+}
+
+//Affine 3x4 applied to 4 points (w = 1) or directions (w = 0)
+
+static void CpuPacket_transform(
+	const F32x4 m[3], F32 w, F32x4 x, F32x4 y, F32x4 z, F32x4 *outX, F32x4 *outY, F32x4 *outZ
+) {
+
+	F32x4 *out[3] = { outX, outY, outZ };
+
+	for(U8 i = 0; i < 3; ++i)
+		*out[i] = F32x4_add(
+			F32x4_add(F32x4_mul(x, F32x4_xxxx4(F32x4_x(m[i]))), F32x4_mul(y, F32x4_xxxx4(F32x4_y(m[i])))),
+			F32x4_add(F32x4_mul(z, F32x4_xxxx4(F32x4_z(m[i]))), F32x4_xxxx4(F32x4_w(m[i]) * w))
+		);
+}
+
+Bool CpuTLAS_tracePacket(
+	const CpuTLAS *tlas,
+	const CpuRayPacket *packet,
+	ECpuRayFlags flags,
+	U8 instanceMask,
+	CpuHit hits[CpuRayPacket_maxRays],
+	U64 hitMask[CpuRayPacket_maxRays / 64]
+) {
+
+	if(!hitMask)
+		return true;
+
+	for(U8 i = 0; i < CpuRayPacket_maxRays / 64; ++i)
+		hitMask[i] = 0;
+
+	if(!tlas || !packet || !hits || !tlas->instanceCount || (flags & ECpuRayFlags_SkipTriangles))
+		return true;
+
+	const U32 rayCount = U32_min(packet->rayCount, CpuRayPacket_maxRays);
+
+	if(!rayCount)
+		return true;
+
+	CpuPacketTraversal traversals[2];
+	CpuPacketTraversal *world = &traversals[0], *local = &traversals[1];		//local = object space of an instance
+
+	world->rayCount = rayCount;
+
+	for(U32 g = 0; g < (rayCount + 3) >> 2; ++g)
+		world->rays[g] = packet->rays[g];
+
+	if(!CpuPacket_init(world)) {
+
+		for(U32 i = 0; i < rayCount; ++i)
+			if(CpuTLAS_traceRay(tlas, CpuRayPacket_get(packet, i), flags, instanceMask, &hits[i]))
+				hitMask[i >> 6] |= (U64)1 << (i & 63);
+
+		return false;
+	}
+
+	const CpuBVHNode *nodes = CpuBVH_getNodes(&tlas->bvh);
+	const U32 *primIds = CpuBVH_getPrimIds(&tlas->bvh);
+	const CpuTLASInstance *instances = (const CpuTLASInstance*) tlas->instanceData.ptr;
+
+	U32 stack[CpuBVH_maxStack][2];
+	U64 stackSize = 0;
+
+	stack[stackSize][0] = 0;
+	stack[stackSize++][1] = 0;
+
+	Bool isCoherent = true;
+
+	while(stackSize) {
+
+		--stackSize;
+		const CpuBVHNode *node = &nodes[stack[stackSize][0]];
+
+		if(!CpuPacket_mayIntersect(world, node))
+			continue;
+
+		const U32 first = CpuPacket_firstActive(world, node, stack[stackSize][1]);
+
+		if(first == world->groupCount)
+			continue;
+
+		if(node->primCount) {
+
+			for(U32 i = node->leftFirst; i < node->leftFirst + node->primCount; ++i) {
+
+				const U32 instanceIndex = primIds[i];
+				const CpuTLASInstance *inst = &instances[instanceIndex];
+
+				if(!((inst->instanceId24_mask8 >> 24) & instanceMask))
+					continue;
+
+				//Object space rays keep the same t, since the direction isn't normalized
+
+				local->rayCount = world->rayCount;
+
+				for(U32 g = 0; g < world->groupCount; ++g) {
+
+					const RayDesc4 *r = &world->rays[g];
+					RayDesc4 *l = &local->rays[g];
+
+					CpuPacket_transform(
+						inst->invTransform, 1, r->originX, r->originY, r->originZ, &l->originX, &l->originY, &l->originZ
+					);
+
+					CpuPacket_transform(inst->invTransform, 0, r->dirX, r->dirY, r->dirZ, &l->dirX, &l->dirY, &l->dirZ);
+
+					l->minT = r->minT;
+					l->maxT = r->maxT;
+				}
+
+				U64 instanceHits[CpuRayPacket_maxRays / 64] = { 0 };
+
+				if(CpuPacket_init(local))
+					CpuBLAS_traversePacket(inst->blas, local, flags, hits, instanceHits);
+
+				//The transform made the rays diverge, so trace this instance per ray
+
+				else {
+
+					isCoherent = false;
+
+					for(U32 j = 0; j < rayCount; ++j) {
+
+						const RayDesc ray = RayDesc4_get(&local->rays[j >> 2], (U8)(j & 3));
+
+						if(!(ray.maxT > ray.minT) || !CpuBLAS_traceRay(inst->blas, ray, flags, &hits[j]))
+							continue;
+
+						instanceHits[j >> 6] |= (U64)1 << (j & 63);
+
+						F32x4_set(
+							&local->rays[j >> 2].maxT, (U8)(j & 3),
+							flags & ECpuRayFlags_AcceptFirstHitAndEndSearch ? CpuPacket_inactive : hits[j].t
+						);
+					}
+				}
+
+				Bool anyHit = false;
+
+				for(U32 j = 0; j < rayCount; ++j) {
+
+					if(!((instanceHits[j >> 6] >> (j & 63)) & 1))
+						continue;
+
+					hits[j].instanceIndex = instanceIndex;
+					hits[j].instanceId = inst->instanceId24_mask8 & ((1 << 24) - 1);
+					hits[j].hitGroup = inst->sbtOffset24_flags8 & ((1 << 24) - 1);
+					hitMask[j >> 6] |= (U64)1 << (j & 63);
+					anyHit = true;
+
+					F32x4_set(&world->rays[j >> 2].maxT, (U8)(j & 3), F32x4_get(local->rays[j >> 2].maxT, (U8)(j & 3)));
+				}
+
+				if(anyHit)
+					CpuPacket_updateMaxT(world);
+			}
+
+			continue;
+		}
+
+		const CpuBVHNode *left = &nodes[node->leftFirst], *right = &nodes[node->leftFirst + 1];
+
+		const F32x4 leftCenter = F32x4_create3(
+			left->min[0] + left->max[0], left->min[1] + left->max[1], left->min[2] + left->max[2]
+		);
+
+		const F32x4 rightCenter = F32x4_create3(
+			right->min[0] + right->max[0], right->min[1] + right->max[1], right->min[2] + right->max[2]
+		);
+
+		const Bool leftIsNearer = F32x4_dot3(world->dirSum, F32x4_sub(rightCenter, leftCenter)) >= 0;
+
+		stack[stackSize][0] = node->leftFirst + leftIsNearer;
+		stack[stackSize++][1] = first;
+
+		stack[stackSize][0] = node->leftFirst + !leftIsNearer;
+		stack[stackSize++][1] = first;
+	}
+
+	return isCoherent;
+}
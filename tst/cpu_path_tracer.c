@@ -0,0 +1,622 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "cpu_path_tracer.h"
+#include "parallel.h"
+#include "platforms/ext/bufferx.h"
+#include "types/base/atomic.h"
+#include "types/base/time.h"
+#include "types/math/math.h"
+
+#define CpuPathTracer_maxT 1e6f
+#define CpuPathTracer_packetSize 64		//Camera rays of consecutive pixels are traced as one packet
+
+//Path state of a wave, structure of arrays
+
+typedef struct CpuPathRays {
+	F32 *originX, *originY, *originZ;
+	F32 *dirX, *dirY, *dirZ;
+	F32 *throughputR, *throughputG, *throughputB;
+	U32 *pixel;
+} CpuPathRays;
+
+typedef struct CpuPathWave {
+
+	CpuPathRays rays[2];				//This bounce and the next
+
+	F32 *hitT;							//Extend results; -1 for misses
+	U32 *material;
+	F32 *normalX, *normalY, *normalZ;
+
+	U32 *keys[2], *order[2];			//Radix sort
+
+	F32 *shadowX, *shadowY, *shadowZ;	//Shadow ray origins (the direction is always sunDir)
+	F32 *lightR, *lightG, *lightB;		//Light that arrives if the shadow ray isn't occluded
+	U32 *shadowPixel;
+
+} CpuPathWave;
+
+#define CpuPathWave_arrayCount (10 * 2 + 5 + 4 + 7)
+
+static void *CpuPathWave_take(U8 **ptr, U64 stride) {
+	void *res = *ptr;
+	*ptr += stride;
+	return res;
+}
+
+static CpuPathWave CpuPathWave_get(const CpuPathTracer *tracer, U64 threadId) {
+
+	U8 *ptr = (U8*) tracer->scratch.ptrNonConst + threadId * tracer->waveBytes;
+	const U64 stride = sizeof(U32) * tracer->waveSize;
+
+	CpuPathWave wave;
+
+	for(U8 i = 0; i < 2; ++i) {
+		CpuPathRays *r = &wave.rays[i];
+		r->originX = CpuPathWave_take(&ptr, stride);
+		r->originY = CpuPathWave_take(&ptr, stride);
+		r->originZ = CpuPathWave_take(&ptr, stride);
+		r->dirX = CpuPathWave_take(&ptr, stride);
+		r->dirY = CpuPathWave_take(&ptr, stride);
+		r->dirZ = CpuPathWave_take(&ptr, stride);
+		r->throughputR = CpuPathWave_take(&ptr, stride);
+		r->throughputG = CpuPathWave_take(&ptr, stride);
+		r->throughputB = CpuPathWave_take(&ptr, stride);
+		r->pixel = CpuPathWave_take(&ptr, stride);
+	}
+
+	wave.hitT = CpuPathWave_take(&ptr, stride);
+	wave.material = CpuPathWave_take(&ptr, stride);
+	wave.normalX = CpuPathWave_take(&ptr, stride);
+	wave.normalY = CpuPathWave_take(&ptr, stride);
+	wave.normalZ = CpuPathWave_take(&ptr, stride);
+
+	for(U8 i = 0; i < 2; ++i) {
+		wave.keys[i] = CpuPathWave_take(&ptr, stride);
+		wave.order[i] = CpuPathWave_take(&ptr, stride);
+	}
+
+	wave.shadowX = CpuPathWave_take(&ptr, stride);
+	wave.shadowY = CpuPathWave_take(&ptr, stride);
+	wave.shadowZ = CpuPathWave_take(&ptr, stride);
+	wave.lightR = CpuPathWave_take(&ptr, stride);
+	wave.lightG = CpuPathWave_take(&ptr, stride);
+	wave.lightB = CpuPathWave_take(&ptr, stride);
+	wave.shadowPixel = CpuPathWave_take(&ptr, stride);
+
+	return wave;
+}
+
+Bool CpuPathTracer_createx(U32 waveSize, CpuPathTracer *tracer, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!tracer)
+		retError(clean, Error_nullPointer(1, "CpuPathTracer_createx()::tracer is required"))
+
+	if(tracer->scratch.ptr)
+		retError(clean, Error_invalidParameter(1, 0, "CpuPathTracer_createx()::tracer wasn't empty, might indicate memleak"))
+
+	if(waveSize < 64 || waveSize > 64 * KIBI)
+		retError(clean, Error_outOfBounds(0, waveSize, 64 * KIBI, "CpuPathTracer_createx()::waveSize should be [64, 65536]"))
+
+	const U64 threadCount = Parallel_getThreadCount();
+	const U32 waveBytes = (U32)(sizeof(U32) * CpuPathWave_arrayCount * waveSize);
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(waveBytes * threadCount, &tracer->scratch))
+
+	tracer->threadCount = threadCount;
+	tracer->waveSize = waveSize;
+	tracer->waveBytes = waveBytes;
+
+clean:
+	return s_uccess;
+}
+
+void CpuPathTracer_freex(CpuPathTracer *tracer) {
+
+	if(!tracer)
+		return;
+
+	Buffer_freex(&tracer->scratch);
+	*tracer = (CpuPathTracer) { 0 };
+}
+
+//Random number in [0, 1) for a dimension of a path vertex (PCG hash), independent of the order paths are traced in
+
+static F32 CpuPathTracer_random(U32 pixel, U32 bounce, U32 dimension, U32 seed) {
+
+	U32 h = (pixel * 0x9E3779B9u) ^ (bounce * 0x85EBCA6Bu + dimension * 0xC2B2AE35u) ^ (seed * 0x27D4EB2Fu);
+
+	h = h * 747796405u + 2891336453u;
+	h = ((h >> ((h >> 28) + 4)) ^ h) * 277803737u;
+	h = (h >> 22) ^ h;
+
+	return (F32)(h >> 8) / (1 << 24);
+}
+
+//Cosine weighted direction around n (Duff et al. 2017, "Building an Orthonormal Basis, Revisited")
+
+static F32x4 CpuPathTracer_sampleCosine(F32x4 n, F32 u1, F32 u2) {
+
+	const F32 nx = F32x4_x(n), ny = F32x4_y(n), nz = F32x4_z(n);
+	const F32 sign = nz >= 0 ? 1.f : -1.f;
+	const F32 a = -1 / (sign + nz), b = nx * ny * a;
+
+	const F32x4 tangent = F32x4_create3(1 + sign * nx * nx * a, sign * b, -sign * nx);
+	const F32x4 bitangent = F32x4_create3(b, sign + ny * ny * a, -ny);
+
+	const F32 r = F32_sqrt(u1), phi = 2 * F32_PI * u2;
+
+	return F32x4_add(
+		F32x4_add(F32x4_mul(tangent, F32x4_xxxx4(r * F32_cos(phi))), F32x4_mul(bitangent, F32x4_xxxx4(r * F32_sin(phi)))),
+		F32x4_mul(n, F32x4_xxxx4(F32_sqrt(F32_max(1 - u1, 0))))
+	);
+}
+
+typedef struct CpuPathShade {
+
+	F32x4 radiance;							//Emitted light that reaches the camera
+	F32x4 shadowOrigin, light;				//Sun light that arrives if the shadow ray isn't occluded
+	F32x4 nextOrigin, nextDir, nextThroughput;
+
+	Bool hasShadowRay, hasNextRay;
+
+} CpuPathShade;
+
+//Shared by both modes, so they render the same image. hitT < 0 is a miss.
+
+static CpuPathShade CpuPathTracer_shade(
+	const CpuPathTracerInput *input,
+	U32 pixel,
+	U32 bounce,
+	F32x4 origin,
+	F32x4 dir,
+	F32x4 throughput,
+	F32 hitT,
+	U32 material,
+	F32x4 normal
+) {
+
+	CpuPathShade res = (CpuPathShade) { 0 };
+
+	if(hitT < 0) {
+		res.radiance = F32x4_mul(throughput, input->skyColor);
+		return res;
+	}
+
+	const CpuPathMaterial *mat = &input->materials[U32_min(material, input->materialCount - 1)];
+	res.radiance = F32x4_mul(throughput, mat->emission);
+
+	if(F32x4_dot3(normal, dir) > 0)
+		normal = F32x4_negate(normal);
+
+	//Offset along the normal to avoid hitting the same triangle again
+
+	const F32x4 pos = F32x4_add(origin, F32x4_mul(dir, F32x4_xxxx4(hitT)));
+	const F32 scale = F32_max(F32_max(F32_abs(F32x4_x(pos)), F32_abs(F32x4_y(pos))), F32_abs(F32x4_z(pos)));
+	const F32x4 offsetPos = F32x4_add(pos, F32x4_mul(normal, F32x4_xxxx4(1e-4f * (1 + scale))));
+
+	const F32 cosSun = F32x4_dot3(normal, input->sunDir);
+
+	if(cosSun > 0) {
+		res.hasShadowRay = true;
+		res.shadowOrigin = offsetPos;
+		res.light = F32x4_mul(F32x4_mul(throughput, mat->albedo), F32x4_mul(input->sunColor, F32x4_xxxx4(cosSun / F32_PI)));
+	}
+
+	if(bounce >= input->maxBounces)
+		return res;
+
+	//Cosine sampling cancels the cosine and 1 / pi of the Lambertian BRDF
+
+	res.nextThroughput = F32x4_mul(throughput, mat->albedo);
+
+	if(F32_max(F32_max(F32x4_x(res.nextThroughput), F32x4_y(res.nextThroughput)), F32x4_z(res.nextThroughput)) <= 0)
+		return res;
+
+	res.hasNextRay = true;
+	res.nextOrigin = offsetPos;
+	res.nextDir = CpuPathTracer_sampleCosine(
+		normal,
+		CpuPathTracer_random(pixel, bounce, 0, input->seed),
+		CpuPathTracer_random(pixel, bounce, 1, input->seed)
+	);
+
+	return res;
+}
+
+typedef struct CpuPathTracerJob {
+
+	const CpuPathTracer *tracer;
+	const CpuPathTracerInput *input;
+
+	CameraMatrices camera;
+	F32x4 *radiance;
+
+	U32 w, h;
+
+	AtomicI64 rays, shadowRays;
+
+} CpuPathTracerJob;
+
+static RayDesc CpuPathTracer_getPrimaryRay(const CpuPathTracerJob *job, U32 pixel) {
+
+	const U32 x = pixel % job->w, y = pixel / job->w;
+	const F32 ndcX = (x + 0.5f) / job->w * 2 - 1;
+	const F32 ndcY = 1 - (y + 0.5f) / job->h * 2;
+
+	const F32x4 eye = job->camera.viewInv[3];
+	const F32x4 origin = F32x4_create3(F32x4_x(eye), F32x4_y(eye), F32x4_z(eye));
+
+	return RayDesc_create(origin, 0, Camera_getDir(&job->camera, ndcX, ndcY), CpuPathTracer_maxT);
+}
+
+static Bool CpuPathTracer_isOccluded(const CpuPathTracerInput *input, F32x4 origin) {
+
+	const RayDesc ray = RayDesc_create(origin, 0, input->sunDir, CpuPathTracer_maxT);
+	const ECpuRayFlags flags = ECpuRayFlags_AcceptFirstHitAndEndSearch;
+
+	CpuHit hit;
+	return CpuTLAS_traceRay(input->tlas, ray, flags, 0xFF, &hit);
+}
+
+//Depth first: every path is finished before the next one starts
+
+static void CpuPathTracer_megakernel(void *userData, U64 waveId, U64 threadId) {
+
+	(void) threadId;
+
+	CpuPathTracerJob *job = (CpuPathTracerJob*) userData;
+	const CpuPathTracerInput *input = job->input;
+
+	const U32 first = (U32)(waveId * job->tracer->waveSize);
+	const U32 last = U32_min(first + job->tracer->waveSize, job->w * job->h);
+
+	U64 rays = 0, shadowRays = 0;
+
+	for(U32 pixel = first; pixel < last; ++pixel) {
+
+		RayDesc ray = CpuPathTracer_getPrimaryRay(job, pixel);
+		F32x4 throughput = F32x4_create3(1, 1, 1);
+		F32x4 radiance = F32x4_zero();
+
+		for(U32 bounce = 0; ; ++bounce) {
+
+			CpuHit hit;
+			const Bool isHit = CpuTLAS_traceRay(input->tlas, ray, ECpuRayFlags_None, 0xFF, &hit);
+			++rays;
+
+			const CpuPathShade shade = CpuPathTracer_shade(
+				input, pixel, bounce, ray.origin, ray.dir, throughput,
+				isHit ? hit.t : -1, isHit ? hit.hitGroup : 0, isHit ? CpuTLAS_getNormal(input->tlas, &hit) : F32x4_zero()
+			);
+
+			radiance = F32x4_add(radiance, shade.radiance);
+
+			if(shade.hasShadowRay) {
+
+				++shadowRays;
+
+				if(!CpuPathTracer_isOccluded(input, shade.shadowOrigin))
+					radiance = F32x4_add(radiance, shade.light);
+			}
+
+			if(!shade.hasNextRay)
+				break;
+
+			ray = RayDesc_create(shade.nextOrigin, 0, shade.nextDir, CpuPathTracer_maxT);
+			throughput = shade.nextThroughput;
+		}
+
+		job->radiance[pixel] = radiance;
+	}
+
+	AtomicI64_add(&job->rays, (I64) rays);
+	AtomicI64_add(&job->shadowRays, (I64) shadowRays);
+}
+
+//7 bit integer to every third bit
+
+static U32 CpuPathTracer_spreadBits(U32 v) {
+	v = (v | (v << 8)) & 0x0300F00F;
+	v = (v | (v << 4)) & 0x030C30C3;
+	v = (v | (v << 2)) & 0x09249249;
+	return v;
+}
+
+//Octant in bits 21-23 and a Morton code of the direction (7 bits per axis) below it
+
+static U32 CpuPathTracer_getDirKey(F32 x, F32 y, F32 z) {
+
+	const U32 octant = (x < 0) | ((y < 0) << 1) | ((z < 0) << 2);
+
+	const U32 qx = (U32) F32_clamp((x * 0.5f + 0.5f) * 128, 0, 127);
+	const U32 qy = (U32) F32_clamp((y * 0.5f + 0.5f) * 128, 0, 127);
+	const U32 qz = (U32) F32_clamp((z * 0.5f + 0.5f) * 128, 0, 127);
+
+	return (octant << 21) | CpuPathTracer_spreadBits(qx) | (CpuPathTracer_spreadBits(qy) << 1) |
+		(CpuPathTracer_spreadBits(qz) << 2);
+}
+
+//Stable LSD radix sort of keys[0] (8 bits per pass). Returns the indices in sorted order (order[0] or order[1]).
+
+static const U32 *CpuPathTracer_sort(U32 *keys[2], U32 *order[2], U32 count, U8 bits) {
+
+	for(U32 i = 0; i < count; ++i)
+		order[0][i] = i;
+
+	U8 src = 0;
+
+	for(U8 shift = 0; shift < bits; shift += 8, src = !src) {
+
+		U32 offsets[256] = { 0 };
+
+		for(U32 i = 0; i < count; ++i)
+			++offsets[(keys[src][i] >> shift) & 0xFF];
+
+		for(U32 i = 0, sum = 0; i < 256; ++i) {
+			const U32 bucket = offsets[i];
+			offsets[i] = sum;
+			sum += bucket;
+		}
+
+		for(U32 i = 0; i < count; ++i) {
+			const U32 j = offsets[(keys[src][i] >> shift) & 0xFF]++;
+			keys[!src][j] = keys[src][i];
+			order[!src][j] = order[src][i];
+		}
+	}
+
+	return order[src];
+}
+
+//Breadth first: every stage runs over the whole wave
+
+static void CpuPathTracer_wavefront(void *userData, U64 waveId, U64 threadId) {
+
+	CpuPathTracerJob *job = (CpuPathTracerJob*) userData;
+	const CpuPathTracerInput *input = job->input;
+	CpuPathWave wave = CpuPathWave_get(job->tracer, threadId);
+
+	const U32 first = (U32)(waveId * job->tracer->waveSize);
+	const U32 last = U32_min(first + job->tracer->waveSize, job->w * job->h);
+
+	U64 rays = 0, shadowRays = 0;
+
+	CpuRayPacket packet;
+	CpuHit hits[CpuRayPacket_maxRays];
+	U64 hitMask[CpuRayPacket_maxRays / 64];
+
+	//Generate
+
+	U32 count = last - first;
+	U8 curr = 0;
+
+	for(U32 i = 0; i < count; ++i) {
+
+		const RayDesc ray = CpuPathTracer_getPrimaryRay(job, first + i);
+		CpuPathRays *r = &wave.rays[curr];
+
+		r->originX[i] = F32x4_x(ray.origin);
+		r->originY[i] = F32x4_y(ray.origin);
+		r->originZ[i] = F32x4_z(ray.origin);
+		r->dirX[i] = F32x4_x(ray.dir);
+		r->dirY[i] = F32x4_y(ray.dir);
+		r->dirZ[i] = F32x4_z(ray.dir);
+		r->throughputR[i] = r->throughputG[i] = r->throughputB[i] = 1;
+		r->pixel[i] = first + i;
+
+		job->radiance[first + i] = F32x4_zero();
+	}
+
+	for(U32 bounce = 0; count; ++bounce, curr = !curr) {
+
+		const CpuPathRays *r = &wave.rays[curr];
+		CpuPathRays *next = &wave.rays[!curr];
+
+		//Extend. Camera rays are coherent, so they're traced as packets; bounces are too divergent for that
+
+		for(U32 k0 = 0; k0 < count; k0 += CpuPathTracer_packetSize) {
+
+			const U32 n = U32_min(CpuPathTracer_packetSize, count - k0);
+			packet.rayCount = n;
+
+			for(U32 j = 0; j < n; ++j) {
+
+				const U32 i = k0 + j;
+
+				CpuRayPacket_set(&packet, j, RayDesc_create(
+					F32x4_create3(r->originX[i], r->originY[i], r->originZ[i]), 0,
+					F32x4_create3(r->dirX[i], r->dirY[i], r->dirZ[i]), CpuPathTracer_maxT
+				));
+			}
+
+			if(!bounce)
+				CpuTLAS_tracePacket(input->tlas, &packet, ECpuRayFlags_None, 0xFF, hits, hitMask);
+
+			else {
+
+				for(U32 j = 0; j < CpuRayPacket_maxRays / 64; ++j)
+					hitMask[j] = 0;
+
+				for(U32 j = 0; j < n; ++j)
+					if(CpuTLAS_traceRay(input->tlas, CpuRayPacket_get(&packet, j), ECpuRayFlags_None, 0xFF, &hits[j]))
+						hitMask[j >> 6] |= (U64)1 << (j & 63);
+			}
+
+			for(U32 j = 0; j < n; ++j) {
+
+				const U32 i = k0 + j;
+
+				if(!((hitMask[j >> 6] >> (j & 63)) & 1)) {
+					wave.hitT[i] = -1;
+					wave.material[i] = 0;
+					wave.normalX[i] = wave.normalY[i] = wave.normalZ[i] = 0;
+					continue;
+				}
+
+				const F32x4 normal = CpuTLAS_getNormal(input->tlas, &hits[j]);
+
+				wave.hitT[i] = hits[j].t;
+				wave.material[i] = hits[j].hitGroup;
+				wave.normalX[i] = F32x4_x(normal);
+				wave.normalY[i] = F32x4_y(normal);
+				wave.normalZ[i] = F32x4_z(normal);
+			}
+		}
+
+		rays += count;
+
+		//Sort by material (misses first), then by direction
+
+		for(U32 i = 0; i < count; ++i) {
+			const U32 material = wave.hitT[i] < 0 ? 0 : U32_min(wave.material[i], input->materialCount - 1) + 1;
+			wave.keys[0][i] = (U32_min(material, 0xFF) << 24) | CpuPathTracer_getDirKey(r->dirX[i], r->dirY[i], r->dirZ[i]);
+		}
+
+		const U32 *shadeOrder = CpuPathTracer_sort(wave.keys, wave.order, count, 32);
+
+		//Shade
+
+		U32 shadowCount = 0, nextCount = 0;
+
+		for(U32 j = 0; j < count; ++j) {
+
+			const U32 i = shadeOrder[j];
+			const U32 pixel = r->pixel[i];
+
+			const CpuPathShade shade = CpuPathTracer_shade(
+				input, pixel, bounce,
+				F32x4_create3(r->originX[i], r->originY[i], r->originZ[i]),
+				F32x4_create3(r->dirX[i], r->dirY[i], r->dirZ[i]),
+				F32x4_create3(r->throughputR[i], r->throughputG[i], r->throughputB[i]),
+				wave.hitT[i], wave.material[i],
+				F32x4_create3(wave.normalX[i], wave.normalY[i], wave.normalZ[i])
+			);
+
+			job->radiance[pixel] = F32x4_add(job->radiance[pixel], shade.radiance);
+
+			if(shade.hasShadowRay) {
+				wave.shadowX[shadowCount] = F32x4_x(shade.shadowOrigin);
+				wave.shadowY[shadowCount] = F32x4_y(shade.shadowOrigin);
+				wave.shadowZ[shadowCount] = F32x4_z(shade.shadowOrigin);
+				wave.lightR[shadowCount] = F32x4_x(shade.light);
+				wave.lightG[shadowCount] = F32x4_y(shade.light);
+				wave.lightB[shadowCount] = F32x4_z(shade.light);
+				wave.shadowPixel[shadowCount++] = pixel;
+			}
+
+			if(shade.hasNextRay) {
+				next->originX[nextCount] = F32x4_x(shade.nextOrigin);
+				next->originY[nextCount] = F32x4_y(shade.nextOrigin);
+				next->originZ[nextCount] = F32x4_z(shade.nextOrigin);
+				next->dirX[nextCount] = F32x4_x(shade.nextDir);
+				next->dirY[nextCount] = F32x4_y(shade.nextDir);
+				next->dirZ[nextCount] = F32x4_z(shade.nextDir);
+				next->throughputR[nextCount] = F32x4_x(shade.nextThroughput);
+				next->throughputG[nextCount] = F32x4_y(shade.nextThroughput);
+				next->throughputB[nextCount] = F32x4_z(shade.nextThroughput);
+				next->pixel[nextCount++] = pixel;
+			}
+		}
+
+		//Connect
+
+		for(U32 j = 0; j < shadowCount; ++j) {
+
+			if(CpuPathTracer_isOccluded(input, F32x4_create3(wave.shadowX[j], wave.shadowY[j], wave.shadowZ[j])))
+				continue;
+
+			F32x4 *radiance = &job->radiance[wave.shadowPixel[j]];
+			*radiance = F32x4_add(*radiance, F32x4_create3(wave.lightR[j], wave.lightG[j], wave.lightB[j]));
+		}
+
+		shadowRays += shadowCount;
+		count = nextCount;
+	}
+
+	AtomicI64_add(&job->rays, (I64) rays);
+	AtomicI64_add(&job->shadowRays, (I64) shadowRays);
+}
+
+Bool CpuPathTracer_render(
+	const CpuPathTracer *tracer,
+	const CpuPathTracerInput *input,
+	U32 w, U32 h,
+	Buffer radiance,
+	CpuPathTracerStats *stats,
+	Error *e_rr
+) {
+
+	Bool s_uccess = true;
+	const Ns start = Time_now();
+
+	if(!tracer || !input)
+		retError(clean, Error_nullPointer(!tracer ? 0 : 1, "CpuPathTracer_render()::tracer and input are required"))
+
+	if(!tracer->scratch.ptr)
+		retError(clean, Error_invalidParameter(0, 0, "CpuPathTracer_render()::tracer should've been created before"))
+
+	if(!input->tlas || !input->materials || !input->materialCount)
+		retError(clean, Error_nullPointer(1, "CpuPathTracer_render()::input->tlas and input->materials are required"))
+
+	if(Parallel_getThreadCount() > tracer->threadCount)
+		retError(clean, Error_invalidState(0, "CpuPathTracer_render() needs more threads than tracer was created for"))
+
+	if(Buffer_length(radiance) < (U64) w * h * sizeof(F32x4))
+		retError(clean, Error_outOfBounds(
+			4, Buffer_length(radiance), (U64) w * h * sizeof(F32x4), "CpuPathTracer_render()::radiance too small"
+		))
+
+	if(!w || !h)
+		goto clean;
+
+	CpuPathTracerJob job = (CpuPathTracerJob) {
+		.tracer = tracer,
+		.input = input,
+		.camera = Camera_getMatrices(&input->camera, (F32) w / h, 0),
+		.radiance = (F32x4*) radiance.ptrNonConst,
+		.w = w,
+		.h = h
+	};
+
+	const U64 waves = ((U64) w * h + tracer->waveSize - 1) / tracer->waveSize;
+
+	gotoIfError3(clean, Parallel_for(
+		waves,
+		input->mode == ECpuPathTracerMode_Wavefront ? CpuPathTracer_wavefront : CpuPathTracer_megakernel,
+		&job,
+		e_rr
+	))
+
+	if(stats) {
+		stats->paths += (U64) w * h;
+		stats->rays += (U64) AtomicI64_load(&job.rays);
+		stats->shadowRays += (U64) AtomicI64_load(&job.shadowRays);
+	}
+
+clean:
+
+	if(stats)
+		stats->time += Time_now() - start;
+
+	return s_uccess;
+}
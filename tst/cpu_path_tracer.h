@@ -0,0 +1,107 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "cpu_as.h"
+#include "camera.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Diffuse path tracer on the CPU TLAS, lit by a sun (next event estimation) and a constant sky.
+//
+//Megakernel traces one path at a time, bounce after bounce (depth first).
+//Wavefront (Laine et al. 2013, "Megakernels Considered Harmful") splits the image into waves of waveSize paths and runs
+//every stage over the whole wave before moving to the next: generate (camera rays), extend (closest hits),
+//shade (emission, spawns the bounce and the shadow ray) and connect (shadow rays).
+//Queues are structure of arrays, so a stage only streams through the state it uses.
+//Camera rays are coherent and traced as packets, bounces and shadow rays are too divergent for that and are traced per ray.
+//Hits are sorted by hit group (material) and then the octant and Morton code of their direction before shading,
+//so paths that do the same work (and spawn similar bounces) are handled together.
+//
+//Both modes use the same random numbers for a path, so they render the same image.
+
+typedef enum ECpuPathTracerMode {
+	ECpuPathTracerMode_Megakernel,
+	ECpuPathTracerMode_Wavefront
+} ECpuPathTracerMode;
+
+typedef struct CpuPathMaterial {
+	F32x4 albedo;					//Lambertian
+	F32x4 emission;
+} CpuPathMaterial;
+
+typedef struct CpuPathTracerInput {
+
+	const CpuTLAS *tlas;
+	const CpuPathMaterial *materials;	//Picked by the instance's hit group (CpuHit::hitGroup), clamped to materialCount
+
+	U32 materialCount;
+	U32 maxBounces;						//0 = direct light only
+
+	Camera camera;
+
+	F32x4 sunDir, sunColor;				//sunColor is the irradiance of the sun (perpendicular to sunDir)
+	F32x4 skyColor;						//Radiance of rays that don't hit anything
+
+	U32 seed;							//E.g. the frame index
+	ECpuPathTracerMode mode;
+
+} CpuPathTracerInput;
+
+typedef struct CpuPathTracerStats {
+	U64 paths;
+	U64 rays, shadowRays;				//Extension rays (including the camera rays) and shadow rays
+	Ns time;
+} CpuPathTracerStats;
+
+#define CpuPathTracer_defaultWaveSize 2048
+
+typedef struct CpuPathTracer {
+
+	Buffer scratch;						//Wave queues for every thread
+	U64 threadCount;
+
+	U32 waveSize;
+	U32 waveBytes;
+
+} CpuPathTracer;
+
+//Scratch is allocated for the current Parallel_getThreadCount()
+
+Bool CpuPathTracer_createx(U32 waveSize, CpuPathTracer *tracer, Error *e_rr);
+void CpuPathTracer_freex(CpuPathTracer *tracer);
+
+//radiance is F32x4[w * h]; it's overwritten with the radiance of one path per pixel.
+//stats is optional and accumulated into (not reset).
+
+Bool CpuPathTracer_render(
+	const CpuPathTracer *tracer,
+	const CpuPathTracerInput *input,
+	U32 w, U32 h,
+	Buffer radiance,
+	CpuPathTracerStats *stats,
+	Error *e_rr
+);
+
+#ifdef __cplusplus
+	}
+#endif
@@ -0,0 +1,475 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "cpu_raytracer.h"
+#include "atmosphere.h"
+#include "parallel.h"
+#include "platforms/ext/bufferx.h"
+#include "types/base/atomic.h"
+#include "types/base/time.h"
+#include "types/math/math.h"
+
+void CpuRaytracer_miss(const CpuRaytracerInput *input, RayDesc ray, CpuRaytracerPayload *payload) {
+
+	ray.minT = 0;
+	ray.maxT = 1e38f;
+
+	const Atmosphere atmos = Atmosphere_earth(input->skyDir);
+
+	if(input->skyCache && input->skyCache->isValid)
+		payload->color = SkyCache_sample(input->skyCache, ray.dir);
+
+	else if(input->atmosphereLut && input->atmosphereLut->data.ptr)
+		payload->color = Atmosphere_getContributionLUT(&atmos, input->atmosphereLut, ray, true);
+
+	else payload->color = Atmosphere_getContribution(&atmos, ray);
+
+	payload->hitT = -1;
+}
+
+void CpuRaytracer_closestHit(const CpuRaytracerInput *input, const CpuHit *hit, CpuRaytracerPayload *payload) {
+
+	const Atmosphere atmos = Atmosphere_earth(input->skyDir);
+
+	const F32x4 bary = F32x4_create3(1 - hit->baryU - hit->baryV, hit->baryU, hit->baryV);
+	const F32x4 diffuse = F32x4_mul(Atmosphere_getSunContribution(&atmos, F32x4_create3(0, 0, 1)), bary);
+	const F32x4 emissive = F32x4_create3(0, 0, 100000);
+
+	payload->color = F32x4_add(diffuse, emissive);
+	payload->hitT = hit->t;
+}
+
+static const F32 CpuRaytracer_exposure = 1.f / (1 << 14);
+
+static const ECpuRayFlags CpuRaytracer_flags =
+	ECpuRayFlags_CullNonOpaque | ECpuRayFlags_SkipProceduralPrimitives | ECpuRayFlags_AcceptFirstHitAndEndSearch;
+
+//x and y are in pixels (centers are at + 0.5), so the sky upsample can trace between pixels too
+
+static RayDesc CpuRaytracer_getPrimaryRayAt(const CpuRaytracerInput *input, F32 x, F32 y, U32 w, U32 h) {
+
+	F32 idX = x, idY = y;
+	U32 dimX = w, dimY = h;
+
+	switch(input->orientation) {
+
+		case 90:
+			dimX = h;	dimY = w;
+			idX = y;	idY = dimY - x;
+			break;
+
+		case 180:
+			idX = w - x;
+			idY = h - y;
+			break;
+
+		case 270:
+			dimX = h;	dimY = w;
+			idX = dimX - y;
+			idY = x;
+			break;
+	}
+
+	//Accumulated frames spread their samples over the pixel
+
+	const F32x2 jitter = input->accumulation ?
+		Accumulation_getJitter(input->accumulation->sampleCount) : F32x2_create2(0, 0);
+
+	const F32 u = (idX + F32x2_x(jitter)) / dimX;
+	const F32 v = 1 - (idY + F32x2_y(jitter)) / dimY;		//Flip to avoid overlap with inline RT
+
+	//Orthographic, like mainRaygen: parallel rays looking down -Z from z = 5 over a 10x10 square centered on the origin
+
+	RayDesc ray = RayDesc_create(F32x4_create3(u * 10 - 5, v * 10 - 5, 5), 0, F32x4_create3(0, 0, -1), 1e6f);
+
+	if(!input->tlas)
+		ray.maxT = 0;		//Deactivate ray
+
+	return ray;
+}
+
+static RayDesc CpuRaytracer_getPrimaryRay(const CpuRaytracerInput *input, U32 x, U32 y, U32 w, U32 h) {
+	return CpuRaytracer_getPrimaryRayAt(input, x + 0.5f, y + 0.5f, w, h);
+}
+
+//hit is NULL for misses
+
+static Bool CpuRaytracer_shade(const CpuRaytracerInput *input, RayDesc ray, const CpuHit *hit, F32x4 *color) {
+
+	CpuRaytracerPayload payload;
+
+	if(hit)
+		CpuRaytracer_closestHit(input, hit, &payload);
+
+	else CpuRaytracer_miss(input, ray, &payload);
+
+	*color = F32x4_mul(payload.color, F32x4_xxxx4(CpuRaytracer_exposure));
+	F32x4_setW(color, 1);
+
+	return payload.hitT >= 0;
+}
+
+Bool CpuRaytracer_raygen(const CpuRaytracerInput *input, U32 x, U32 y, U32 w, U32 h, F32x4 *color, U64 *rays) {
+
+	const RayDesc ray = CpuRaytracer_getPrimaryRay(input, x, y, w, h);
+
+	CpuHit hit;
+	const Bool anyHit = CpuTLAS_traceRay(input->tlas, ray, CpuRaytracer_flags, 0xFF, &hit);
+
+	++*rays;
+	return CpuRaytracer_shade(input, ray, anyHit ? &hit : NULL, color);
+}
+
+typedef struct CpuRaytracerJob {
+
+	const CpuRaytracerInput *input;
+	U8 *target;
+
+	F32 *hitT;						//If the sky is upsampled; misses are resolved after it's composited
+
+	U32 w, h;
+	U32 tilesX;
+	Bool isBGRA;
+
+	AtomicI64 rays, hits;
+	AtomicI64 error;				//Bits of the largest accumulation error (positive floats sort like integers)
+
+} CpuRaytracerJob;
+
+static U32 CpuRaytracer_packUnorm(F32x4 color, Bool isBGRA) {
+
+	const F32x4 c = F32x4_add(F32x4_mul(F32x4_saturate(color), F32x4_xxxx4(255)), F32x4_xxxx4(0.5f));
+
+	const U32 r = (U32) F32x4_x(c), g = (U32) F32x4_y(c), b = (U32) F32x4_z(c), a = (U32) F32x4_w(c);
+	return isBGRA ? (b | (g << 8) | (r << 16) | (a << 24)) : (r | (g << 8) | (b << 16) | (a << 24));
+}
+
+static U32 CpuRaytracer_resolve(const CpuRaytracerJob *job, U32 x, U32 y, Bool hit, F32x4 color, F32 *error) {
+
+	const CpuRaytracerInput *input = job->input;
+
+	if(!hit && !input->writeMiss)
+		color = input->clearColor;
+
+	if(input->accumulation)
+		color = Accumulation_add(input->accumulation, (U64) y * job->w + x, color, error);
+
+	return CpuRaytracer_packUnorm(color, job->isBGRA);
+}
+
+//hit is NULL for misses
+
+static void CpuRaytracer_write(
+	CpuRaytracerJob *job, U32 x, U32 y, RayDesc ray, const CpuHit *hit, U32 *pixel, U64 *hits, F32 *error
+) {
+
+	if(job->hitT) {
+
+		job->hitT[(U64) y * job->w + x] = hit ? hit->t : -1;
+
+		if(!hit)		//Left for the sky upsample
+			return;
+	}
+
+	F32x4 color;
+	const Bool isHit = CpuRaytracer_shade(job->input, ray, hit, &color);
+
+	*hits += isHit;
+	*pixel = CpuRaytracer_resolve(job, x, y, isHit, color, error);
+}
+
+static void CpuRaytracer_getTile(const CpuRaytracerJob *job, U64 tileId, U32 *x0, U32 *y0, U32 *x1, U32 *y1) {
+	*x0 = (U32)(tileId % job->tilesX) * CpuRaytracer_tileSize;
+	*y0 = (U32)(tileId / job->tilesX) * CpuRaytracer_tileSize;
+	*x1 = U32_min(*x0 + CpuRaytracer_tileSize, job->w);
+	*y1 = U32_min(*y0 + CpuRaytracer_tileSize, job->h);
+}
+
+static void CpuRaytracer_maxError(CpuRaytracerJob *job, F32 error) {
+
+	const union { F32 value; U32 bits; } errorBits = { .value = error };
+
+	for(I64 prev = AtomicI64_load(&job->error); (I64) errorBits.bits > prev; )
+		prev = AtomicI64_cmpStore(&job->error, prev, (I64) errorBits.bits);
+}
+
+static void CpuRaytracer_traceTile(void *userData, U64 tileId, U64 threadId) {
+
+	(void) threadId;
+
+	CpuRaytracerJob *job = (CpuRaytracerJob*) userData;
+
+	U32 x0, y0, x1, y1;
+	CpuRaytracer_getTile(job, tileId, &x0, &y0, &x1, &y1);
+
+	U64 rays = 0, hits = 0;
+	F32 error = 0;
+
+	if(job->input->usePackets) {
+
+		//A tile is exactly one packet
+
+		CpuRayPacket packet;
+		packet.rayCount = (x1 - x0) * (y1 - y0);
+
+		for(U32 y = y0; y < y1; ++y)
+			for(U32 x = x0; x < x1; ++x)
+				CpuRayPacket_set(
+					&packet, (y - y0) * (x1 - x0) + (x - x0), CpuRaytracer_getPrimaryRay(job->input, x, y, job->w, job->h)
+				);
+
+		CpuHit packetHits[CpuRayPacket_maxRays];
+		U64 hitMask[CpuRayPacket_maxRays / 64];
+		CpuTLAS_tracePacket(job->input->tlas, &packet, CpuRaytracer_flags, 0xFF, packetHits, hitMask);
+
+		for(U32 y = y0; y < y1; ++y) {
+
+			U32 *row = (U32*) job->target + (U64) y * job->w;
+
+			for(U32 x = x0; x < x1; ++x) {
+
+				const U32 i = (y - y0) * (x1 - x0) + (x - x0);
+				const Bool isHit = (hitMask[i >> 6] >> (i & 63)) & 1;
+
+				CpuRaytracer_write(
+					job, x, y, CpuRayPacket_get(&packet, i), isHit ? &packetHits[i] : NULL, &row[x], &hits, &error
+				);
+			}
+		}
+
+		rays += packet.rayCount;
+	}
+
+	else for(U32 y = y0; y < y1; ++y) {
+
+		U32 *row = (U32*) job->target + (U64) y * job->w;
+
+		for(U32 x = x0; x < x1; ++x) {
+
+			const RayDesc ray = CpuRaytracer_getPrimaryRay(job->input, x, y, job->w, job->h);
+
+			CpuHit hit;
+			const Bool isHit = CpuTLAS_traceRay(job->input->tlas, ray, CpuRaytracer_flags, 0xFF, &hit);
+
+			++rays;
+			CpuRaytracer_write(job, x, y, ray, isHit ? &hit : NULL, &row[x], &hits, &error);
+		}
+	}
+
+	AtomicI64_add(&job->rays, (I64) rays);
+	AtomicI64_add(&job->hits, (I64) hits);
+
+	CpuRaytracer_maxError(job, error);
+}
+
+//Radiance (of the path tracer or the upsampled sky) only has to be exposed, accumulated and packed.
+//With the sky upsample, only the misses are left; the path tracer already shaded its misses with the sky color.
+
+static void CpuRaytracer_resolveRadianceTile(void *userData, U64 tileId, U64 threadId) {
+
+	(void) threadId;
+
+	CpuRaytracerJob *job = (CpuRaytracerJob*) userData;
+	const F32x4 *radiance = (const F32x4*) job->input->radiance.ptr;
+
+	U32 x0, y0, x1, y1;
+	CpuRaytracer_getTile(job, tileId, &x0, &y0, &x1, &y1);
+
+	F32 error = 0;
+
+	for(U32 y = y0; y < y1; ++y) {
+
+		U32 *row = (U32*) job->target + (U64) y * job->w;
+
+		for(U32 x = x0; x < x1; ++x) {
+
+			const U64 i = (U64) y * job->w + x;
+
+			if(job->hitT && job->hitT[i] >= 0)
+				continue;
+
+			F32x4 color = F32x4_mul(radiance[i], F32x4_xxxx4(CpuRaytracer_exposure));
+			F32x4_setW(&color, 1);
+
+			row[x] = CpuRaytracer_resolve(job, x, y, !job->hitT, color, &error);
+		}
+	}
+
+	CpuRaytracer_maxError(job, error);
+}
+
+static F32x4 CpuRaytracer_getSky(const void *userData, F32 x, F32 y) {
+
+	const CpuRaytracerJob *job = (const CpuRaytracerJob*) userData;
+
+	CpuRaytracerPayload payload;
+	CpuRaytracer_miss(job->input, CpuRaytracer_getPrimaryRayAt(job->input, x, y, job->w, job->h), &payload);
+
+	return payload.color;
+}
+
+//Misses are evaluated at 1 / skyFactor of the resolution and then upsampled into radiance
+
+static Bool CpuRaytracer_upsampleSky(const CpuRaytracerJob *job, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Buffer lowRes = Buffer_createNull();
+
+	const SkyUpsampleInput skyInput = (SkyUpsampleInput) {
+		.getSky = CpuRaytracer_getSky,
+		.userData = job,
+		.hitT = job->input->hitT,
+		.w = job->w,
+		.h = job->h,
+		.factor = job->input->skyFactor
+	};
+
+	gotoIfError3(clean, SkyUpsample_renderx(&skyInput, &lowRes, NULL, e_rr))
+	gotoIfError3(clean, SkyUpsample_composite(&skyInput, lowRes, job->input->radiance, e_rr))
+
+clean:
+	Buffer_freex(&lowRes);
+	return s_uccess;
+}
+
+//Same tlas, sun and sky as mainClosestHit and mainMiss, but it's a different renderer, not a reference for them:
+//
+//	- Rays come from input->camera (perspective, through pixel centers), not mainRaygen's orthographic rays.
+//	  Orientation is ignored and there's no jitter; accumulated frames only change the seed of the bounces.
+//	- Surfaces are flat 0.8 grey lambertian with diffuse bounces, without the barycentrics or emission of mainClosestHit.
+//	- The sky is constant (the zenith of the atmosphere, which is Y up), so the sky cache or LUT is sampled only once.
+//	- Every pixel is written and hits aren't counted (stats only get the rays).
+
+static Bool CpuRaytracer_tracePaths(
+	const CpuRaytracerInput *input, U32 w, U32 h, CpuRaytracerStats *stats, Error *e_rr
+) {
+
+	const Atmosphere atmos = Atmosphere_earth(input->skyDir);
+
+	CpuRaytracerPayload sky;
+	CpuRaytracer_miss(input, RayDesc_create(F32x4_zero(), 0, F32x4_create3(0, 1, 0), 1e38f), &sky);
+
+	const CpuPathMaterial material = (CpuPathMaterial) { .albedo = F32x4_create3(0.8f, 0.8f, 0.8f) };
+
+	const CpuPathTracerInput pathInput = (CpuPathTracerInput) {
+		.tlas = input->tlas,
+		.materials = &material,
+		.materialCount = 1,
+		.maxBounces = input->bounces,
+		.camera = input->camera,
+		.sunDir = F32x4_negate(input->skyDir),		//skyDir is the direction the light travels in
+		.sunColor = atmos.sunRadianceLux,
+		.skyColor = sky.color,
+		.seed = input->accumulation ? input->accumulation->sampleCount : input->seed,
+		.mode = ECpuPathTracerMode_Wavefront
+	};
+
+	CpuPathTracerStats pathStats = (CpuPathTracerStats) { 0 };
+
+	const Bool s_uccess = CpuPathTracer_render(input->pathTracer, &pathInput, w, h, input->radiance, &pathStats, e_rr);
+
+	if(stats)
+		stats->rays += pathStats.rays + pathStats.shadowRays;
+
+	return s_uccess;
+}
+
+Bool CpuRaytracer_render(
+	const CpuRaytracerInput *input,
+	U32 w, U32 h, Bool isBGRA,
+	Buffer target,
+	CpuRaytracerStats *stats,
+	Error *e_rr
+) {
+
+	Bool s_uccess = true;
+	const Ns start = Time_now();
+
+	if(!input)
+		retError(clean, Error_nullPointer(0, "CpuRaytracer_render()::input is required"))
+
+	if(Buffer_length(target) < (U64) w * h * sizeof(U32))
+		retError(clean, Error_outOfBounds(4, Buffer_length(target), (U64) w * h * sizeof(U32), "CpuRaytracer_render()::target too small"))
+
+	const Accumulation *acc = input->accumulation;
+
+	if(acc && (acc->width != w || acc->height != h))
+		retError(clean, Error_invalidParameter(0, 0, "CpuRaytracer_render()::input->accumulation should be w * h"))
+
+	//The path tracer writes every pixel, so there's no sky to upsample
+
+	const Bool upsampleSky = !input->pathTracer && input->writeMiss && input->skyFactor > 1;
+
+	if((input->pathTracer || upsampleSky) && Buffer_length(input->radiance) < (U64) w * h * sizeof(F32x4))
+		retError(clean, Error_outOfBounds(
+			0, Buffer_length(input->radiance), (U64) w * h * sizeof(F32x4), "CpuRaytracer_render()::input->radiance too small"
+		))
+
+	if(upsampleSky && Buffer_length(input->hitT) < (U64) w * h * sizeof(F32))
+		retError(clean, Error_outOfBounds(
+			0, Buffer_length(input->hitT), (U64) w * h * sizeof(F32), "CpuRaytracer_render()::input->hitT too small"
+		))
+
+	if(!w || !h)
+		goto clean;
+
+	const U32 tilesX = (w + CpuRaytracer_tileSize - 1) / CpuRaytracer_tileSize;
+	const U32 tilesY = (h + CpuRaytracer_tileSize - 1) / CpuRaytracer_tileSize;
+
+	CpuRaytracerJob job = (CpuRaytracerJob) {
+		.input = input,
+		.target = target.ptrNonConst,
+		.hitT = upsampleSky ? (F32*) input->hitT.ptrNonConst : NULL,
+		.w = w,
+		.h = h,
+		.tilesX = tilesX,
+		.isBGRA = isBGRA
+	};
+
+	const U64 tiles = (U64) tilesX * tilesY;
+
+	if(input->pathTracer)
+		gotoIfError3(clean, CpuRaytracer_tracePaths(input, w, h, stats, e_rr))
+
+	else gotoIfError3(clean, Parallel_for(tiles, CpuRaytracer_traceTile, &job, e_rr))
+
+	if(upsampleSky)
+		gotoIfError3(clean, CpuRaytracer_upsampleSky(&job, e_rr))
+
+	if(input->pathTracer || upsampleSky)
+		gotoIfError3(clean, Parallel_for(tiles, CpuRaytracer_resolveRadianceTile, &job, e_rr))
+
+	if(input->accumulation) {
+		const union { U32 bits; F32 value; } error = { .bits = (U32) AtomicI64_load(&job.error) };
+		Accumulation_end(input->accumulation, error.value);
+	}
+
+	if(stats) {
+		stats->rays += (U64) AtomicI64_load(&job.rays);
+		stats->hits += (U64) AtomicI64_load(&job.hits);
+	}
+
+clean:
+
+	if(stats)
+		stats->time += Time_now() - start;
+
+	return s_uccess;
+}
@@ -0,0 +1,110 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "cpu_as.h"
+#include "cpu_path_tracer.h"
+#include "sky_cache.h"
+#include "sky_upsample.h"
+#include "accumulation.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//CPU port of raytracing_pipeline_test.hlsl (mainRaygen, mainClosestHit and mainMiss).
+//The image is split into tiles that are traced across all cores.
+//With a path tracer, CpuPathTracer renders the image instead and only accumulation and packing are done here.
+//With skyFactor > 1 (and writeMiss), misses are skipped while tracing and then filled in by SkyUpsample.
+
+typedef struct CpuRaytracerPayload {		//ColorPayload
+	F32x4 color;
+	F32 hitT;
+} CpuRaytracerPayload;
+
+typedef struct CpuRaytracerInput {
+
+	const CpuTLAS *tlas;				//NULL = deactivated rays (same as tlasId = 0)
+	const AtmosphereLUT *atmosphereLut;	//NULL = ray march the sky (same as transmittanceLUT = 0)
+	const SkyCache *skyCache;			//If valid, misses sample it instead of evaluating the atmosphere
+	Accumulation *accumulation;			//Optional, w * h; adds a jittered sample and writes the mean instead
+
+	F32x4 camPos;
+	F32x4 skyDir;
+	F32x4 clearColor;					//Written for pixels that aren't hit (EScopes_ClearTarget)
+
+	F32 time;
+	U32 orientation;					//0, 90, 180 or 270
+
+	Bool writeMiss;						//mainRaygen only writes hits (without a sky history), this also writes misses
+	Bool usePackets;					//Trace every tile as one ray packet (CpuTLAS_tracePacket) instead of per pixel
+
+	//> 1 evaluates written misses at 1 / skyFactor of the resolution (SkyUpsample).
+	//The primary rays are orthographic, so the sky is constant and this only changes the cost, not the image.
+
+	U32 skyFactor;
+
+	//Optional; traces diffuse paths through camera (lit by the sun and the sky at the zenith) instead of mainRaygen.
+	//Paths are traced as waves (ECpuPathTracerMode_Wavefront) and ignore orientation, every pixel is written.
+	//This doesn't match mainRaygen's projection or mainClosestHit's shading (see CpuRaytracer_tracePaths).
+	//The tlas is required, since CpuPathTracer can't deactivate rays.
+
+	const CpuPathTracer *pathTracer;
+	Camera camera;
+	U32 bounces;						//0 = direct light only
+	U32 seed;							//E.g. the frame index, accumulated frames use the sample count instead
+
+	//Scratch, so frames don't have to allocate
+
+	Buffer radiance;					//F32x4[w * h], required with pathTracer or the sky upsample
+	Buffer hitT;						//F32[w * h], required with the sky upsample
+
+} CpuRaytracerInput;
+
+typedef struct CpuRaytracerStats {
+	U64 rays;							//With a path tracer; extension and shadow rays
+	U64 hits;							//Not counted by the path tracer
+	Ns time;
+} CpuRaytracerStats;
+
+#define CpuRaytracer_tileSize CpuRayPacket_maxWidth		//One tile is one ray packet
+
+void CpuRaytracer_miss(const CpuRaytracerInput *input, RayDesc ray, CpuRaytracerPayload *payload);
+void CpuRaytracer_closestHit(const CpuRaytracerInput *input, const CpuHit *hit, CpuRaytracerPayload *payload);
+
+//Trace a single pixel (mainRaygen); returns if the ray hit (mainRaygen only writes the color in that case)
+
+Bool CpuRaytracer_raygen(const CpuRaytracerInput *input, U32 x, U32 y, U32 w, U32 h, F32x4 *color, U64 *rays);
+
+//target is w * h RGBA8 (or BGRA8 if isBGRA), with a row pitch of w * 4.
+//stats is optional and accumulated into (not reset).
+//With accumulation, call Accumulation_begin first and skip the render if it returns false.
+
+Bool CpuRaytracer_render(
+	const CpuRaytracerInput *input,
+	U32 w, U32 h, Bool isBGRA,
+	Buffer target,
+	CpuRaytracerStats *stats,
+	Error *e_rr
+);
+
+#ifdef __cplusplus
+	}
+#endif
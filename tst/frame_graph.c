@@ -0,0 +1,327 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "frame_graph.h"
+#include "platforms/log.h"
+
+void FrameGraph_clear(FrameGraph *graph) {
+	if(graph)
+		graph->passCount = graph->accessCount = graph->outputCount = 0;
+}
+
+Bool FrameGraph_addPass(FrameGraph *graph, U32 id, const C8 *name, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!graph)
+		retError(clean, Error_nullPointer(0, "FrameGraph_addPass()::graph is required"))
+
+	if(graph->passCount >= FrameGraph_maxPasses)
+		retError(clean, Error_outOfBounds(0, graph->passCount, FrameGraph_maxPasses, "FrameGraph_addPass() too many passes"))
+
+	if(FrameGraph_getPass(graph, id))
+		retError(clean, Error_invalidParameter(1, 0, "FrameGraph_addPass()::id was already added"))
+
+	graph->passes[graph->passCount++] = (FrameGraphPass) {
+		.name = name, .id = id, .firstAccess = graph->accessCount
+	};
+
+clean:
+	return s_uccess;
+}
+
+Bool FrameGraph_addAccess(
+	FrameGraph *graph, const void *resource, U32 stage, EFrameGraphAccess access, Bool isImplicit, Error *e_rr
+) {
+
+	Bool s_uccess = true;
+
+	if(!graph || !resource)
+		retError(clean, Error_nullPointer(!graph ? 0 : 1, "FrameGraph_addAccess()::graph and resource are required"))
+
+	if(!graph->passCount)
+		retError(clean, Error_invalidState(0, "FrameGraph_addAccess() requires a pass"))
+
+	if(graph->accessCount >= FrameGraph_maxAccesses)
+		retError(clean, Error_outOfBounds(0, graph->accessCount, FrameGraph_maxAccesses, "FrameGraph_addAccess() too many accesses"))
+
+	graph->accesses[graph->accessCount++] = (FrameGraphAccess) {
+		.resource = resource, .stage = stage, .access = access, .isImplicit = isImplicit
+	};
+
+	++graph->passes[graph->passCount - 1].accessCount;
+
+clean:
+	return s_uccess;
+}
+
+Bool FrameGraph_addOutput(FrameGraph *graph, const void *resource, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!graph || !resource)
+		retError(clean, Error_nullPointer(!graph ? 0 : 1, "FrameGraph_addOutput()::graph and resource are required"))
+
+	if(graph->outputCount >= FrameGraph_maxOutputs)
+		retError(clean, Error_outOfBounds(0, graph->outputCount, FrameGraph_maxOutputs, "FrameGraph_addOutput() too many outputs"))
+
+	graph->outputs[graph->outputCount++] = resource;
+
+clean:
+	return s_uccess;
+}
+
+const FrameGraphPass *FrameGraph_getPass(const FrameGraph *graph, U32 id) {
+
+	for(U32 i = 0; graph && i < graph->passCount; ++i)
+		if(graph->passes[i].id == id)
+			return &graph->passes[i];
+
+	return NULL;
+}
+
+//Resources don't have ids, so the state of a resource is stored at the index of its first access
+
+typedef struct FrameGraphState {
+	U32 lastWriter;						//Pass index or U32_MAX
+	U32 readers;						//Passes that read since the last write (mask)
+	U32 stage;
+	Bool isUsed, isWritten, isNeeded;
+} FrameGraphState;
+
+static U32 FrameGraph_getResource(const FrameGraph *graph, U32 access) {
+
+	for(U32 i = 0; i < access; ++i)
+		if(graph->accesses[i].resource == graph->accesses[access].resource)
+			return i;
+
+	return access;
+}
+
+void FrameGraph_compile(FrameGraph *graph) {
+
+	if(!graph)
+		return;
+
+	FrameGraphState states[FrameGraph_maxAccesses];
+	U32 resources[FrameGraph_maxAccesses];
+
+	for(U32 i = 0; i < graph->accessCount; ++i) {
+
+		resources[i] = FrameGraph_getResource(graph, i);
+		states[i] = (FrameGraphState) { .lastWriter = U32_MAX };
+
+		for(U32 j = 0; j < graph->outputCount; ++j)
+			if(graph->outputs[j] == graph->accesses[i].resource)
+				states[resources[i]].isNeeded = true;
+	}
+
+	//Culling; back to front, a pass is alive if it writes anything a later (alive) pass or output needs
+
+	for(U32 i = graph->passCount; i > 0; --i) {
+
+		FrameGraphPass *pass = &graph->passes[i - 1];
+		const U32 end = pass->firstAccess + pass->accessCount;
+
+		pass->isAlive = false;
+
+		for(U32 j = pass->firstAccess; j < end; ++j)
+			if(graph->accesses[j].access != EFrameGraphAccess_Read && states[resources[j]].isNeeded)
+				pass->isAlive = true;
+
+		if(!pass->isAlive)
+			continue;
+
+		for(U32 j = pass->firstAccess; j < end; ++j)
+			if(graph->accesses[j].access == EFrameGraphAccess_Write)
+				states[resources[j]].isNeeded = false;
+
+		for(U32 j = pass->firstAccess; j < end; ++j)
+			if(graph->accesses[j].access != EFrameGraphAccess_Write)
+				states[resources[j]].isNeeded = true;
+	}
+
+	//Dependencies and barriers; front to back through the passes that are left
+
+	U32 reachable[FrameGraph_maxPasses] = { 0 };		//Passes a pass (transitively) depends on (mask)
+
+	for(U32 i = 0; i < graph->passCount; ++i) {
+
+		FrameGraphPass *pass = &graph->passes[i];
+		const U32 end = pass->firstAccess + pass->accessCount;
+
+		pass->dependencyCount = 0;
+		pass->barriers = 0;
+
+		if(!pass->isAlive)
+			continue;
+
+		U32 direct = 0;
+
+		for(U32 j = pass->firstAccess; j < end; ++j) {
+
+			FrameGraphAccess *access = &graph->accesses[j];
+			FrameGraphState *state = &states[resources[j]];
+
+			if(state->lastWriter != U32_MAX && state->lastWriter != i)
+				direct |= 1u << state->lastWriter;
+
+			if(access->access != EFrameGraphAccess_Read)
+				direct |= state->readers & ~(1u << i);
+
+			//The first use is assumed to match the state the previous frame left it in
+
+			access->needsBarrier =
+				state->isUsed && (state->stage != access->stage || state->isWritten || access->access != EFrameGraphAccess_Read);
+
+			pass->barriers += access->needsBarrier;
+		}
+
+		for(U32 j = pass->firstAccess; j < end; ++j) {
+
+			const FrameGraphAccess *access = &graph->accesses[j];
+			FrameGraphState *state = &states[resources[j]];
+
+			state->isUsed = true;
+			state->stage = access->stage;
+			state->isWritten = access->access != EFrameGraphAccess_Read;
+
+			if(state->isWritten) {
+				state->lastWriter = i;
+				state->readers = 0;
+			}
+
+			else state->readers |= 1u << i;
+		}
+
+		//Dependencies that are implied by another dependency are dropped
+
+		for(U32 j = 0; j < i; ++j)
+			if(direct >> j & 1)
+				reachable[i] |= (1u << j) | reachable[j];
+
+		for(U32 j = 0; j < i; ++j) {
+
+			if(!(direct >> j & 1))
+				continue;
+
+			Bool isImplied = false;
+
+			for(U32 k = 0; k < i && !isImplied; ++k)
+				isImplied = k != j && (direct >> k & 1) && (reachable[k] >> j & 1);
+
+			if(!isImplied)
+				pass->dependencies[pass->dependencyCount++] = graph->passes[j].id;
+		}
+	}
+}
+
+static U64 FrameGraph_hash(U64 hash, U32 v) {		//FNV-1a
+	return (hash ^ v) * 0x100000001B3;
+}
+
+U64 FrameGraph_getScheduleHash(const FrameGraph *graph) {
+
+	if(!graph)
+		return 0;
+
+	U64 hash = FrameGraph_hash(0xCBF29CE484222325, graph->passCount);
+
+	for(U32 i = 0; i < graph->passCount; ++i) {
+
+		const FrameGraphPass *pass = &graph->passes[i];
+
+		hash = FrameGraph_hash(hash, pass->id);
+		hash = FrameGraph_hash(hash, pass->isAlive);
+		hash = FrameGraph_hash(hash, pass->barriers);
+		hash = FrameGraph_hash(hash, pass->dependencyCount);
+
+		for(U32 j = 0; j < pass->dependencyCount; ++j)
+			hash = FrameGraph_hash(hash, pass->dependencies[j]);
+
+		for(U32 j = pass->firstAccess; j < pass->firstAccess + pass->accessCount; ++j) {
+			const FrameGraphAccess *access = &graph->accesses[j];
+			hash = FrameGraph_hash(hash, access->stage);
+			hash = FrameGraph_hash(hash, access->access);
+			hash = FrameGraph_hash(hash, (U32) access->isImplicit << 1 | access->needsBarrier);
+		}
+	}
+
+	return hash;
+}
+
+void FrameGraph_printSchedule(const FrameGraph *graph) {
+
+	if(!graph)
+		return;
+
+	U32 alive = 0, barriers = 0, batches = 0, transitions = 0;
+
+	for(U32 i = 0; i < graph->passCount; ++i) {
+
+		const FrameGraphPass *pass = &graph->passes[i];
+
+		if(!pass->isAlive)
+			continue;
+
+		++alive;
+		barriers += pass->barriers;
+		batches += !!pass->barriers;
+
+		for(U32 j = pass->firstAccess; j < pass->firstAccess + pass->accessCount; ++j)
+			transitions += !graph->accesses[j].isImplicit;
+	}
+
+	Log_debugLnx(
+		"Frame graph: %"PRIu32" of %"PRIu32" passes (%"PRIu32" culled), %"PRIu32" transitions, "
+		"~%"PRIu32" barriers in %"PRIu32" batches",
+		alive, graph->passCount, graph->passCount - alive, transitions, barriers, batches
+	);
+
+	for(U32 i = 0; i < graph->passCount; ++i) {
+
+		const FrameGraphPass *pass = &graph->passes[i];
+
+		if(!pass->isAlive) {
+			Log_debugLnx("\t%s: culled", pass->name);
+			continue;
+		}
+
+		//"a, b, c" (truncated if it doesn't fit)
+
+		C8 deps[128];
+		U32 length = 0;
+
+		for(U32 j = 0; j < pass->dependencyCount; ++j) {
+
+			if(j && length + 2 < sizeof(deps)) {
+				deps[length++] = ',';
+				deps[length++] = ' ';
+			}
+
+			for(const C8 *name = FrameGraph_getPass(graph, pass->dependencies[j])->name; *name && length + 1 < sizeof(deps); ++name)
+				deps[length++] = *name;
+		}
+
+		deps[length] = '\0';
+
+		Log_debugLnx("\t%s: ~%"PRIu32" barriers, after {%s}", pass->name, pass->barriers, deps);
+	}
+}
@@ -0,0 +1,108 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "types/base/error.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Declarative layer over command scopes: passes declare what they read and write, the graph derives the rest.
+//Compiling:
+//
+//	- Culls passes whose writes never reach an output (walking back from the outputs; a full write ends the chain).
+//	- Derives scope dependencies from read after write, write after write and write after read hazards,
+//	  minus the ones that are already implied by another dependency (so passes aren't serialized more than needed).
+//	- Estimates barriers: a resource only needs one if its stage changes or it was written since it was last used.
+//	  All barriers of a pass are issued as one batch when the scope starts.
+//
+//Resources are opaque (RefPtr* in practice) and stage is an EPipelineStage; this only has to know if they're equal.
+//Implicit accesses are transitioned by the command itself (render pass attachments, copies), so they participate in
+//culling and dependencies, but shouldn't be passed as a transition to the scope.
+
+typedef enum EFrameGraphAccess {
+	EFrameGraphAccess_Read,
+	EFrameGraphAccess_Write,			//Overwrites everything, previous contents don't matter
+	EFrameGraphAccess_ReadWrite			//Modifies (or partially overwrites) previous contents
+} EFrameGraphAccess;
+
+typedef struct FrameGraphAccess {
+	const void *resource;
+	U32 stage;
+	EFrameGraphAccess access;
+	Bool isImplicit;
+	Bool needsBarrier;					//After compiling
+} FrameGraphAccess;
+
+#define FrameGraph_maxPasses 32
+#define FrameGraph_maxAccesses 128
+#define FrameGraph_maxOutputs 4
+
+typedef struct FrameGraphPass {
+
+	const C8 *name;
+	U32 id;								//Scope id
+
+	U32 firstAccess, accessCount;
+
+	Bool isAlive;						//After compiling
+	U32 barriers;
+
+	U32 dependencyCount;
+	U32 dependencies[FrameGraph_maxPasses];		//Scope ids
+
+} FrameGraphPass;
+
+typedef struct FrameGraph {
+
+	FrameGraphPass passes[FrameGraph_maxPasses];
+	FrameGraphAccess accesses[FrameGraph_maxAccesses];
+	const void *outputs[FrameGraph_maxOutputs];
+
+	U32 passCount, accessCount, outputCount;
+
+} FrameGraph;
+
+void FrameGraph_clear(FrameGraph *graph);
+
+//Passes execute in the order they're added; accesses are added to the last pass
+
+Bool FrameGraph_addPass(FrameGraph *graph, U32 id, const C8 *name, Error *e_rr);
+
+Bool FrameGraph_addAccess(
+	FrameGraph *graph, const void *resource, U32 stage, EFrameGraphAccess access, Bool isImplicit, Error *e_rr
+);
+
+Bool FrameGraph_addOutput(FrameGraph *graph, const void *resource, Error *e_rr);	//e.g. the swapchain
+
+void FrameGraph_compile(FrameGraph *graph);
+
+const FrameGraphPass *FrameGraph_getPass(const FrameGraph *graph, U32 id);		//NULL if it wasn't added
+
+void FrameGraph_printSchedule(const FrameGraph *graph);
+
+//Changes if the compiled passes, dependencies or barriers do (not if only the resources do), to print it only then
+
+U64 FrameGraph_getScheduleHash(const FrameGraph *graph);
+
+#ifdef __cplusplus
+	}
+#endif
@@ -0,0 +1,213 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#include "frame_stats.h"
+#include "platforms/file.h"
+#include "platforms/log.h"
+#include "platforms/ext/bufferx.h"
+#include "platforms/ext/stringx.h"
+#include "types/math/math.h"
+
+Bool FrameStats_createx(U64 timerCount, U64 frameCount, U64 warmupFrames, FrameStats *stats, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Bool ownsStats = false;
+
+	if(!stats)
+		retError(clean, Error_nullPointer(3, "FrameStats_createx()::stats is required"))
+
+	if(stats->samples.ptr)
+		retError(clean, Error_invalidParameter(3, 0, "FrameStats_createx()::stats is already initialized"))
+
+	if(!timerCount || !frameCount)
+		retError(clean, Error_invalidParameter(
+			!timerCount ? 0 : 1, 0, "FrameStats_createx()::timerCount and frameCount are required"
+		))
+
+	ownsStats = true;
+
+	*stats = (FrameStats) {
+		.timerCount = timerCount, .frameCount = frameCount,
+		.warmupFrames = warmupFrames, .warmupLeft = warmupFrames
+	};
+
+	gotoIfError2(clean, Buffer_createEmptyBytesx(sizeof(Ns) * timerCount * frameCount, &stats->samples))
+	gotoIfError2(clean, Buffer_createEmptyBytesx(sizeof(U64) * timerCount, &stats->calls))
+
+clean:
+
+	if(!s_uccess && ownsStats)
+		FrameStats_freex(stats);
+
+	return s_uccess;
+}
+
+void FrameStats_freex(FrameStats *stats) {
+
+	if(!stats)
+		return;
+
+	Buffer_freex(&stats->samples);
+	Buffer_freex(&stats->calls);
+	*stats = (FrameStats) { 0 };
+}
+
+Bool FrameStats_isDone(const FrameStats *stats) {
+	return stats && stats->samples.ptr && stats->frame >= stats->frameCount;
+}
+
+void FrameStats_add(FrameStats *stats, U64 timer, Ns time) {
+
+	if(!stats || !stats->samples.ptr || timer >= stats->timerCount || FrameStats_isDone(stats))
+		return;
+
+	//Warmup frames are timed into the first frame; that's cleared again when the warmup frame ends
+
+	((Ns*) stats->samples.ptrNonConst)[timer * stats->frameCount + stats->frame] += time;
+
+	if(!stats->warmupLeft)
+		++((U64*) stats->calls.ptrNonConst)[timer];
+}
+
+void FrameStats_nextFrame(FrameStats *stats) {
+
+	if(!stats || !stats->samples.ptr || FrameStats_isDone(stats))
+		return;
+
+	if(!stats->warmupLeft) {
+		++stats->frame;
+		return;
+	}
+
+	--stats->warmupLeft;
+
+	for(U64 i = 0; i < stats->timerCount; ++i)
+		((Ns*) stats->samples.ptrNonConst)[i * stats->frameCount] = 0;
+}
+
+//In place heap sort, avoids any allocations at the end of the run
+
+static void FrameStats_siftDown(Ns *arr, U64 i, U64 count) {
+
+	for(U64 child = i * 2 + 1; child < count; i = child, child = i * 2 + 1) {
+
+		if(child + 1 < count && arr[child + 1] > arr[child])
+			++child;
+
+		if(arr[i] >= arr[child])
+			break;
+
+		const Ns tmp = arr[i];
+		arr[i] = arr[child];
+		arr[child] = tmp;
+	}
+}
+
+static void FrameStats_sort(Ns *arr, U64 count) {
+
+	for(U64 i = count / 2; i > 0; --i)
+		FrameStats_siftDown(arr, i - 1, count);
+
+	for(U64 end = count; end > 1; --end) {
+
+		const Ns tmp = arr[0];
+		arr[0] = arr[end - 1];
+		arr[end - 1] = tmp;
+
+		FrameStats_siftDown(arr, 0, end - 1);
+	}
+}
+
+FrameStatsSummary FrameStats_summarize(FrameStats *stats, U64 timer) {
+
+	if(!stats || !stats->samples.ptr || timer >= stats->timerCount || !stats->frame)
+		return (FrameStatsSummary) { 0 };
+
+	const U64 count = stats->frame;
+	Ns *arr = (Ns*) stats->samples.ptrNonConst + timer * stats->frameCount;
+	FrameStats_sort(arr, count);
+
+	F64 total = 0;
+
+	for(U64 i = 0; i < count; ++i)
+		total += (F64) arr[i];
+
+	//Nearest rank percentiles
+
+	return (FrameStatsSummary) {
+		.min = arr[0],
+		.median = arr[(count - 1) / 2],
+		.p99 = arr[U64_min((U64) F64_ceil(count * 0.99), count) - 1],
+		.max = arr[count - 1],
+		.mean = total / (F64) count
+	};
+}
+
+Bool FrameStats_writeReportx(FrameStats *stats, const C8 *const *names, CharString path, Error *e_rr) {
+
+	Bool s_uccess = true;
+	CharString report = CharString_createNull();
+	CharString tmp = CharString_createNull();
+
+	if(!stats || !stats->samples.ptr || !names)
+		retError(clean, Error_nullPointer(!names ? 1 : 0, "FrameStats_writeReportx()::stats and names are required"))
+
+	gotoIfError2(clean, CharString_formatx(
+		&report,
+		"{\n\t\"frames\": %"PRIu64",\n\t\"warmupFrames\": %"PRIu64",\n\t\"unit\": \"ms\",\n\t\"timers\": {",
+		stats->frame, stats->warmupFrames
+	))
+
+	Bool first = true;
+
+	for(U64 i = 0; i < stats->timerCount; ++i) {
+
+		const U64 calls = ((const U64*) stats->calls.ptr)[i];
+
+		if(!calls)
+			continue;
+
+		const FrameStatsSummary summary = FrameStats_summarize(stats, i);
+
+		gotoIfError2(clean, CharString_formatx(
+			&tmp,
+			"%s\n\t\t\"%s\": { \"calls\": %"PRIu64", \"min\": %.4f, \"median\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"mean\": %.4f }",
+			first ? "" : ",", names[i], calls,
+			summary.min / 1e6, summary.median / 1e6, summary.p99 / 1e6, summary.max / 1e6, summary.mean / 1e6
+		))
+
+		gotoIfError2(clean, CharString_appendStringx(&report, tmp))
+		CharString_freex(&tmp);
+
+		Log_debugLnx(
+			"%s: min %.3fms, median %.3fms, p99 %.3fms, max %.3fms",
+			names[i], summary.min / 1e6, summary.median / 1e6, summary.p99 / 1e6, summary.max / 1e6
+		);
+
+		first = false;
+	}
+
+	gotoIfError2(clean, CharString_appendStringx(&report, CharString_createRefCStrConst("\n\t}\n}\n")))
+	gotoIfError3(clean, File_writex(CharString_bufferConst(report), path, 0, 0, U64_MAX, false, e_rr))
+
+clean:
+	CharString_freex(&tmp);
+	CharString_freex(&report);
+	return s_uccess;
+}
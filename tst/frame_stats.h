@@ -0,0 +1,67 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#pragma once
+#include "types/container/buffer.h"
+#include "types/base/error.h"
+#include "types/container/string.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Per frame CPU timings for a fixed number of frames (after warmup), summarized as min/median/p99/max.
+//Every timer accumulates within a frame, so a timer hit by multiple windows reports their total.
+
+typedef struct FrameStatsSummary {
+	Ns min, median, p99, max;
+	F64 mean;
+} FrameStatsSummary;
+
+typedef struct FrameStats {
+
+	Buffer samples;						//Ns[timerCount][frameCount]
+	Buffer calls;						//U64[timerCount], how often a timer was added to (excludes warmup)
+
+	U64 timerCount, frameCount;
+	U64 frame;
+	U64 warmupFrames, warmupLeft;
+
+} FrameStats;
+
+Bool FrameStats_createx(U64 timerCount, U64 frameCount, U64 warmupFrames, FrameStats *stats, Error *e_rr);
+void FrameStats_freex(FrameStats *stats);
+
+void FrameStats_add(FrameStats *stats, U64 timer, Ns time);
+void FrameStats_nextFrame(FrameStats *stats);		//Ends the current frame (or warmup frame)
+
+Bool FrameStats_isDone(const FrameStats *stats);
+
+//Sorts the timer's samples, so this is only valid after the last frame
+
+FrameStatsSummary FrameStats_summarize(FrameStats *stats, U64 timer);
+
+//Writes a json report: { "frames", "warmupFrames", "unit": "ms", "timers": { name: { calls, min, median, p99, max, mean } } }
+//Timers that weren't used are omitted. names has timerCount entries.
+
+Bool FrameStats_writeReportx(FrameStats *stats, const C8 *const *names, CharString path, Error *e_rr);
+
+#ifdef __cplusplus
+	}
+#endif
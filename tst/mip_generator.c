@@ -0,0 +1,363 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "mip_generator.h"
+#include "parallel.h"
+#include "platforms/ext/bufferx.h"
+#include "types/math/vec.h"
+#include "types/math/math.h"
+
+const C8 *EMipFilter_names[EMipFilter_Count] = { "Box", "Kaiser", "Lanczos" };
+
+#define MipGenerator_tileSize 64
+#define MipGenerator_kaiserBeta 4.0
+#define MipGenerator_encodeTable (1 << 16)		//Buckets are smaller than the distance between two sRGB values
+
+static const F64 MipGenerator_radius[EMipFilter_Count] = { 0.5, 3, 3 };
+
+U32 MipGenerator_getLevels(U32 w, U32 h) {
+
+	U32 levels = 1;
+
+	for(U32 size = U32_max(w, h); size > 1; size >>= 1)
+		++levels;
+
+	return levels;
+}
+
+U64 MipGenerator_getOffset(U32 w, U32 h, U32 level) {
+
+	U64 offset = 0;
+
+	for(U32 i = 0; i < level; ++i)
+		offset += (U64) U32_max(w >> i, 1) * U32_max(h >> i, 1) * 4;
+
+	return offset;
+}
+
+//Kernels, t is in destination pixels
+
+static F64 MipGenerator_sinc(F64 t) {
+	return F64_abs(t) < 1e-6 ? 1 : F64_sin(F64_PI * t) / (F64_PI * t);
+}
+
+static F64 MipGenerator_besselI0(F64 x) {
+
+	F64 sum = 1, term = 1;
+
+	for(U32 k = 1; k < 20; ++k) {
+		term *= (x * 0.5 / k) * (x * 0.5 / k);
+		sum += term;
+	}
+
+	return sum;
+}
+
+static F64 MipGenerator_kernel(EMipFilter filter, F64 t) {
+
+	const F64 radius = MipGenerator_radius[filter];
+	const F64 at = F64_abs(t);
+
+	if(at > radius)
+		return 0;
+
+	switch (filter) {
+
+		case EMipFilter_Box:
+			return 1;
+
+		case EMipFilter_Kaiser: {
+			const F64 r = at / radius;
+			return
+				MipGenerator_sinc(t) *
+				MipGenerator_besselI0(MipGenerator_kaiserBeta * F64_sqrt(1 - r * r)) /
+				MipGenerator_besselI0(MipGenerator_kaiserBeta);
+		}
+
+		default:
+			return MipGenerator_sinc(t) * MipGenerator_sinc(t / radius);
+	}
+}
+
+//Weights of one axis; every destination pixel has the same amount of taps (zero padded),
+//starting at first[i] (which can be out of bounds, sampling clamps to the edge)
+
+typedef struct MipAxis {
+	I32 *first;
+	F32 *weights;				//[dst][taps]
+	U32 taps, dst;
+} MipAxis;
+
+static Bool MipAxis_createx(EMipFilter filter, U32 src, U32 dst, Buffer *data, MipAxis *axis, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	const F64 scale = (F64) src / dst;
+	const F64 support = MipGenerator_radius[filter] * F64_max(scale, 1);
+	const U32 taps = (U32) F64_floor(support * 2) + 1;
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx((sizeof(I32) + sizeof(F32) * taps) * dst, data))
+
+	*axis = (MipAxis) {
+		.first = (I32*) data->ptrNonConst,
+		.weights = (F32*) (data->ptrNonConst + sizeof(I32) * dst),
+		.taps = taps, .dst = dst
+	};
+
+	for(U32 i = 0; i < dst; ++i) {
+
+		const F64 center = (i + 0.5) * scale;
+		const I32 first = (I32) F64_ceil(center - support - 0.5);
+
+		F32 *weights = axis->weights + (U64) i * taps;
+		F64 sum = 0;
+
+		for(U32 k = 0; k < taps; ++k) {
+			const F64 w = MipGenerator_kernel(filter, (first + (I32) k + 0.5 - center) / F64_max(scale, 1));
+			weights[k] = (F32) w;
+			sum += w;
+		}
+
+		for(U32 k = 0; k < taps; ++k)
+			weights[k] = (F32) (weights[k] / sum);
+
+		axis->first[i] = first;
+	}
+
+clean:
+	return s_uccess;
+}
+
+//One level; the tile job first filters (and decodes) the source rows the tile needs horizontally,
+//then filters those vertically into the destination.
+
+typedef struct MipLevelJob {
+
+	const U8 *src;
+	U8 *dst;
+
+	U32 srcW, srcH, tilesX;
+
+	MipAxis x, y;
+
+	F32x4 *scratch;
+	U64 scratchStride, lineLength;		//In F32x4; per thread, the first lineLength are the decoded source row
+
+	F32 toLinear[2][256];				//Color, alpha
+	F32 thresholds[256];				//Linear color halfway to the next 8-bit value (the last is never exceeded)
+	U8 toColor[MipGenerator_encodeTable];	//8-bit color at the start of each bucket
+
+
+} MipLevelJob;
+
+//Color channels aren't linear (if sRGB), so they go through a table that's fine enough that the value can only be one too low.
+//Alpha is always linear, so it's simply rounded.
+
+static U8 MipGenerator_encodeColor(F32 v, const MipLevelJob *job) {
+	v = F32_clamp(v, 0, 1);
+	const U8 code = job->toColor[(U32) (v * (MipGenerator_encodeTable - 1))];
+	return (U8) (code + (v > job->thresholds[code]));
+}
+
+static U8 MipGenerator_encodeAlpha(F32 v) {
+	return (U8) (F32_clamp(v, 0, 1) * 255 + 0.5f);
+}
+
+static void MipGenerator_filterTile(void *userData, U64 jobId, U64 threadId) {
+
+	const MipLevelJob *job = (const MipLevelJob*) userData;
+
+	const U32 x0 = (U32) (jobId % job->tilesX) * MipGenerator_tileSize;
+	const U32 y0 = (U32) (jobId / job->tilesX) * MipGenerator_tileSize;
+	const U32 x1 = U32_min(x0 + MipGenerator_tileSize, job->x.dst);
+	const U32 y1 = U32_min(y0 + MipGenerator_tileSize, job->y.dst);
+	const U32 tileW = x1 - x0;
+
+	const I32 rowStart = job->y.first[y0], rowEnd = job->y.first[y1 - 1] + (I32) job->y.taps;
+	const I32 colStart = job->x.first[x0], colEnd = job->x.first[x1 - 1] + (I32) job->x.taps;
+
+	F32x4 *line = job->scratch + threadId * job->scratchStride;
+	F32x4 *rows = line + job->lineLength;
+
+	const F32 *color = job->toLinear[0], *alpha = job->toLinear[1];
+
+	//Horizontal; every source pixel is decoded once per row into the line
+
+	for(I32 r = rowStart; r < rowEnd; ++r) {
+
+		const U8 *srcRow = job->src + (U64) I32_clamp(r, 0, (I32) job->srcH - 1) * job->srcW * 4;
+
+		for(I32 c = colStart; c < colEnd; ++c) {
+			const U8 *p = srcRow + (U64) I32_clamp(c, 0, (I32) job->srcW - 1) * 4;
+			line[c - colStart] = F32x4_create4(color[p[0]], color[p[1]], color[p[2]], alpha[p[3]]);
+		}
+
+		F32x4 *row = rows + (U64) (r - rowStart) * tileW;
+
+		for(U32 x = x0; x < x1; ++x) {
+
+			const F32 *weights = job->x.weights + (U64) x * job->x.taps;
+			const F32x4 *taps = line + (job->x.first[x] - colStart);
+			F32x4 sum = F32x4_zero();
+
+			for(U32 k = 0; k < job->x.taps; ++k)
+				sum = F32x4_add(sum, F32x4_mul(taps[k], F32x4_xxxx4(weights[k])));
+
+			row[x - x0] = sum;
+		}
+	}
+
+	//Vertical and back to 8-bit
+
+	for(U32 y = y0; y < y1; ++y) {
+
+		const F32 *weights = job->y.weights + (U64) y * job->y.taps;
+		const F32x4 *taps = rows + (U64) (job->y.first[y] - rowStart) * tileW;
+		U8 *dst = job->dst + ((U64) y * job->x.dst + x0) * 4;
+
+		for(U32 x = 0; x < tileW; ++x, dst += 4) {
+
+			F32x4 sum = F32x4_zero();
+
+			for(U32 k = 0; k < job->y.taps; ++k)
+				sum = F32x4_add(sum, F32x4_mul(taps[(U64) k * tileW + x], F32x4_xxxx4(weights[k])));
+
+			dst[0] = MipGenerator_encodeColor(F32x4_x(sum), job);
+			dst[1] = MipGenerator_encodeColor(F32x4_y(sum), job);
+			dst[2] = MipGenerator_encodeColor(F32x4_z(sum), job);
+			dst[3] = MipGenerator_encodeAlpha(F32x4_w(sum));
+		}
+	}
+}
+
+static F32 MipGenerator_srgbToLinear(F64 v) {
+	return (F32) (v <= 0.04045 ? v / 12.92 : F64_pow((v + 0.055) / 1.055, 2.4));
+}
+
+Bool MipGenerator_generatex(
+	Buffer src, U32 w, U32 h, U32 levels, EMipFilter filter, Bool isSRGB, Buffer *chain, Error *e_rr
+) {
+
+	Bool s_uccess = true;
+	Buffer axisX = Buffer_createNull(), axisY = Buffer_createNull(), scratch = Buffer_createNull();
+	Buffer jobData = Buffer_createNull();
+
+	if(!chain)
+		retError(clean, Error_nullPointer(7, "MipGenerator_generatex()::chain is required"))
+
+	if(chain->ptr)
+		retError(clean, Error_invalidParameter(7, 0, "MipGenerator_generatex()::chain wasn't empty, might indicate memleak"))
+
+	if(filter >= EMipFilter_Count)
+		retError(clean, Error_invalidParameter(4, 0, "MipGenerator_generatex()::filter is invalid"))
+
+	if(!w || !h || Buffer_length(src) < (U64) w * h * 4)
+		retError(clean, Error_invalidParameter(1, 0, "MipGenerator_generatex()::src should contain w * h RGBA8 pixels"))
+
+	const U32 maxLevels = MipGenerator_getLevels(w, h);
+
+	if(!levels || levels > maxLevels)
+		levels = maxLevels;
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(MipGenerator_getOffset(w, h, levels), chain))
+	gotoIfError2(clean, Buffer_copy(*chain, Buffer_createRefConst(src.ptr, (U64) w * h * 4)))
+
+	//The job is too big for the stack (lookup tables)
+
+	gotoIfError2(clean, Buffer_createEmptyBytesx(sizeof(MipLevelJob), &jobData))
+	MipLevelJob *job = (MipLevelJob*) jobData.ptrNonConst;
+
+	for(U32 i = 0; i < 256; ++i) {
+		job->toLinear[0][i] = isSRGB ? MipGenerator_srgbToLinear(i / 255.0) : i / 255.f;
+		job->toLinear[1][i] = i / 255.f;
+	}
+
+	for(U32 i = 0; i < 255; ++i)
+		job->thresholds[i] = (job->toLinear[0][i] + job->toLinear[0][i + 1]) * 0.5f;
+
+	job->thresholds[255] = F32_MAX;
+
+	for(U32 i = 0, code = 0; i < MipGenerator_encodeTable; ++i) {
+
+		const F32 v = (F32) i / (MipGenerator_encodeTable - 1);
+
+		while(v > job->thresholds[code])
+			++code;
+
+		job->toColor[i] = (U8) code;
+	}
+
+	const U64 threads = Parallel_getThreadCount();
+
+	for(U32 level = 1; level < levels; ++level) {
+
+		const U32 srcW = U32_max(w >> (level - 1), 1), srcH = U32_max(h >> (level - 1), 1);
+		const U32 dstW = U32_max(w >> level, 1), dstH = U32_max(h >> level, 1);
+
+		Buffer_freex(&axisX);
+		Buffer_freex(&axisY);
+		Buffer_freex(&scratch);
+
+		gotoIfError3(clean, MipAxis_createx(filter, srcW, dstW, &axisX, &job->x, e_rr))
+		gotoIfError3(clean, MipAxis_createx(filter, srcH, dstH, &axisY, &job->y, e_rr))
+
+		//Scratch is sized for the tile that needs the most source rows / columns
+
+		U64 lineLength = 0, rowCount = 0;
+
+		for(U32 x = 0; x < dstW; x += MipGenerator_tileSize) {
+			const U32 last = U32_min(x + MipGenerator_tileSize, dstW) - 1;
+			lineLength = U64_max(lineLength, (U64) (job->x.first[last] - job->x.first[x]) + job->x.taps);
+		}
+
+		for(U32 y = 0; y < dstH; y += MipGenerator_tileSize) {
+			const U32 last = U32_min(y + MipGenerator_tileSize, dstH) - 1;
+			rowCount = U64_max(rowCount, (U64) (job->y.first[last] - job->y.first[y]) + job->y.taps);
+		}
+
+		job->lineLength = lineLength;
+		job->scratchStride = lineLength + rowCount * U32_min(dstW, MipGenerator_tileSize);
+
+		gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(F32x4) * job->scratchStride * threads, &scratch))
+
+		job->scratch = (F32x4*) scratch.ptrNonConst;
+		job->src = chain->ptr + MipGenerator_getOffset(w, h, level - 1);
+		job->dst = chain->ptrNonConst + MipGenerator_getOffset(w, h, level);
+		job->srcW = srcW;
+		job->srcH = srcH;
+		job->tilesX = (dstW + MipGenerator_tileSize - 1) / MipGenerator_tileSize;
+
+		const U64 tilesY = (dstH + MipGenerator_tileSize - 1) / MipGenerator_tileSize;
+
+		gotoIfError3(clean, Parallel_for(job->tilesX * tilesY, MipGenerator_filterTile, job, e_rr))
+	}
+
+clean:
+
+	Buffer_freex(&jobData);
+	Buffer_freex(&scratch);
+	Buffer_freex(&axisY);
+	Buffer_freex(&axisX);
+
+	if(!s_uccess && chain)
+		Buffer_freex(chain);
+
+	return s_uccess;
+}
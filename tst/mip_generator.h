@@ -0,0 +1,61 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "types/container/buffer.h"
+#include "types/base/error.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Generates the mip chain of an 8-bit RGBA (or BGRA) image on the CPU, for images that don't come with mips (e.g. BMP).
+//Every level is filtered from the previous one with a separable kernel. Sizes round down (max 1),
+//so odd sizes (such as 2049) are resampled rather than averaged 2x2; the kernel is stretched over the source footprint.
+//
+//Filtering happens in linear space (color channels are decoded from sRGB if isSRGB, alpha is always linear)
+//in F32x4 (one RGBA pixel per vector) and the result is rounded back to the nearest 8-bit value.
+//Levels are generated one by one, but each level is split into tiles that run on all threads (see Parallel_for).
+
+typedef enum EMipFilter {
+	EMipFilter_Box,					//Average of the footprint; fastest, but blurs and aliases the most
+	EMipFilter_Kaiser,				//Kaiser windowed sinc (radius 3, beta 4)
+	EMipFilter_Lanczos,				//Lanczos 3; sharpest, but can ring around hard edges
+	EMipFilter_Count
+} EMipFilter;
+
+extern const C8 *EMipFilter_names[EMipFilter_Count];
+
+U32 MipGenerator_getLevels(U32 w, U32 h);					//Levels down to 1x1, including the source
+
+//Byte offset of a level in the chain; level = MipGenerator_getLevels(w, h) returns the size of the chain
+
+U64 MipGenerator_getOffset(U32 w, U32 h, U32 level);
+
+//src is w * h * 4 bytes; chain is allocated and contains all levels (level 0 is a copy of src), tightly packed.
+//levels = 0 generates all levels.
+
+Bool MipGenerator_generatex(
+	Buffer src, U32 w, U32 h, U32 levels, EMipFilter filter, Bool isSRGB, Buffer *chain, Error *e_rr
+);
+
+#ifdef __cplusplus
+	}
+#endif
@@ -0,0 +1,194 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "parallel.h"
+#include "types/base/atomic.h"
+#include "types/base/time.h"
+#include "platforms/ext/threadx.h"
+#include "types/math/math.h"
+
+typedef struct ParallelContext {
+	ParallelJobFunction func;
+	void *userData;
+	U64 jobCount;
+	AtomicI64 nextJob;
+} ParallelContext;
+
+//Workers are started by the first Parallel_for that needs them and stay around until Parallel_freex.
+//A call is published through state: (call << 8) | workers that may join (worker 0 is the caller).
+//Both are in the same atomic, so a worker can't mix up the workers of one call with the context of another.
+//A worker registers itself in active before it checks the state again, so once the caller closed the call
+//(workers = 0) it only has to wait for the workers that got in; sleeping workers don't hold it up.
+//Only one call can use the pool at a time; calls while it's busy (nested or from other threads) run inline.
+
+#define Parallel_spinTime (50 * MU)		//Ns a worker keeps polling after a call before it starts sleeping
+#define Parallel_sleepTime (50 * MU)
+
+typedef struct ParallelPool {
+
+	Thread *threads[Parallel_maxThreads];
+	U64 threadCount;					//Including the caller, 0 if the workers haven't been started
+
+	ParallelContext *context;			//Only valid for the workers that got into the current call
+	AtomicI64 state;
+	AtomicI64 active;					//Workers that are (or are checking if they're) in the current call
+	AtomicI64 busy, stop;
+
+} ParallelPool;
+
+static U64 Parallel_threadCount = 0;
+static ParallelPool Parallel_pool;
+
+U64 Parallel_getThreadCount() {
+
+	U64 cores = U64_max(Thread_getLogicalCores(), 1);
+
+	if(Parallel_threadCount)
+		cores = U64_min(cores, Parallel_threadCount);
+
+	return U64_min(cores, Parallel_maxThreads);
+}
+
+void Parallel_setThreadCount(U64 threadCount) {
+
+	threadCount = U64_min(threadCount, Parallel_maxThreads);
+
+	if(threadCount != Parallel_threadCount)
+		Parallel_freex();
+
+	Parallel_threadCount = threadCount;
+}
+
+static void Parallel_work(ParallelContext *ctx, U64 threadId) {
+	for(I64 job = AtomicI64_inc(&ctx->nextJob) - 1; (U64) job < ctx->jobCount; job = AtomicI64_inc(&ctx->nextJob) - 1)
+		ctx->func(ctx->userData, (U64) job, threadId);
+}
+
+static void Parallel_worker(void *userData) {
+
+	ParallelPool *pool = &Parallel_pool;
+	const U64 threadId = (U64) userData;
+
+	I64 seen = AtomicI64_load(&pool->state);
+	Ns idleStart = Time_now();
+
+	while(!AtomicI64_load(&pool->stop)) {
+
+		const I64 state = AtomicI64_load(&pool->state);
+
+		if(state == seen) {
+
+			if(Time_now() - idleStart > Parallel_spinTime)
+				Thread_sleep(Parallel_sleepTime);
+
+			continue;
+		}
+
+		seen = state;
+		idleStart = Time_now();
+
+		if(threadId >= (U64)(state & 0xFF))
+			continue;
+
+		AtomicI64_inc(&pool->active);
+
+		if(AtomicI64_load(&pool->state) == state)
+			Parallel_work(pool->context, threadId);
+
+		AtomicI64_dec(&pool->active);
+	}
+}
+
+//Called by the owner of the pool; if not all threads could be created, the pool is just smaller
+
+static void Parallel_start() {
+
+	ParallelPool *pool = &Parallel_pool;
+	const U64 threadCount = Parallel_getThreadCount();
+
+	AtomicI64_store(&pool->stop, 0);
+	pool->threadCount = 1;
+
+	for(U64 i = 1; i < threadCount; ++i) {
+
+		if(Thread_createx(Parallel_worker, (void*) i, &pool->threads[i]).genericError)
+			break;
+
+		pool->threadCount = i + 1;
+	}
+}
+
+void Parallel_freex() {
+
+	ParallelPool *pool = &Parallel_pool;
+
+	AtomicI64_store(&pool->stop, 1);
+
+	for(U64 i = 1; i < pool->threadCount; ++i)
+		Thread_waitAndCleanupx(&pool->threads[i]);
+
+	pool->threadCount = 0;
+}
+
+Bool Parallel_for(U64 jobCount, ParallelJobFunction func, void *userData, Error *e_rr) {
+
+	Bool s_uccess = true;
+	ParallelPool *pool = &Parallel_pool;
+
+	if(!func)
+		retError(clean, Error_nullPointer(1, "Parallel_for()::func is required"))
+
+	if(!jobCount)
+		goto clean;
+
+	ParallelContext ctx = (ParallelContext) { .func = func, .userData = userData, .jobCount = jobCount };
+
+	//A single job, single thread or a pool that's already in use doesn't need to wake anyone
+
+	if(jobCount == 1 || Parallel_getThreadCount() == 1 || AtomicI64_cmpStore(&pool->busy, 0, 1)) {
+		Parallel_work(&ctx, 0);
+		goto clean;
+	}
+
+	if(!pool->threadCount)
+		Parallel_start();
+
+	const U64 threadCount = U64_min(pool->threadCount, jobCount);
+
+	const I64 call = (AtomicI64_load(&pool->state) >> 8) + 1;
+
+	pool->context = &ctx;
+	AtomicI64_store(&pool->state, call << 8 | (I64) threadCount);
+
+	Parallel_work(&ctx, 0);
+
+	//Every job has been picked up; close the call and wait for the workers that are still finishing theirs
+
+	AtomicI64_store(&pool->state, call << 8);
+
+	for(const Ns waitStart = Time_now(); AtomicI64_load(&pool->active); )
+		if(Time_now() - waitStart > Parallel_spinTime)
+			Thread_sleep(Parallel_sleepTime);
+
+	AtomicI64_store(&pool->busy, 0);
+
+clean:
+	return s_uccess;
+}
@@ -0,0 +1,50 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "types/base/error.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Simple fork/join job dispatch; jobs are pulled from a shared counter so uneven jobs balance out.
+//threadId is in [0, Parallel_getThreadCount()) and can be used to index per thread scratch memory.
+//The calling thread is always worker 0, so a single job never wakes a worker.
+//Workers are persistent: they're started by the first call that needs them and are stopped by Parallel_freex.
+//Only one call uses them at a time; calls made while they're busy (e.g. from inside a job or from another thread)
+//run all of their jobs on the calling thread (as worker 0).
+
+typedef void (*ParallelJobFunction)(void *userData, U64 jobId, U64 threadId);
+
+#define Parallel_maxThreads 64
+
+U64 Parallel_getThreadCount();
+void Parallel_setThreadCount(U64 threadCount);		//0 = all logical cores (default), otherwise clamped
+
+Bool Parallel_for(U64 jobCount, ParallelJobFunction func, void *userData, Error *e_rr);
+
+//Stops the workers; can't be called while a Parallel_for is running (setThreadCount calls it if the count changes)
+
+void Parallel_freex();
+
+#ifdef __cplusplus
+	}
+#endif
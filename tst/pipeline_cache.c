@@ -0,0 +1,183 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#include "pipeline_cache.h"
+#include "platforms/file.h"
+#include "platforms/ext/bufferx.h"
+#include "types/math/math.h"
+
+#define PipelineCache_magic 0x48434350		//PCCH
+
+typedef struct PipelineCacheHeader {
+	U32 magic;
+	U32 version;
+	U64 count;
+	Ns lastColdStart, lastWarmStart;
+} PipelineCacheHeader;
+
+U64 PipelineCache_hash(U64 hash, Buffer data) {
+
+	for(U64 i = 0; i < Buffer_length(data); ++i)
+		hash = (hash ^ data.ptr[i]) * 0x100000001B3;
+
+	return hash;
+}
+
+void PipelineCache_freex(PipelineCache *cache) {
+
+	if(!cache)
+		return;
+
+	Buffer_freex(&cache->entries);
+	*cache = (PipelineCache) { 0 };
+}
+
+Bool PipelineCache_loadx(CharString path, PipelineCache *cache, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Buffer file = Buffer_createNull();
+
+	if(!cache)
+		retError(clean, Error_nullPointer(1, "PipelineCache_loadx()::cache is required"))
+
+	if(cache->entries.ptr)
+		retError(clean, Error_invalidParameter(1, 0, "PipelineCache_loadx()::cache wasn't empty, might indicate memleak"))
+
+	*cache = (PipelineCache) { 0 };
+
+	if(!File_readx(path, U64_MAX, 0, 0, &file, NULL))			//Missing cache isn't an error
+		goto clean;
+
+	if(Buffer_length(file) < sizeof(PipelineCacheHeader))
+		goto clean;
+
+	const PipelineCacheHeader header = *(const PipelineCacheHeader*) file.ptr;
+
+	if(
+		header.magic != PipelineCache_magic || header.version != PipelineCache_version ||
+		Buffer_length(file) != sizeof(header) + header.count * sizeof(PipelineCacheEntry)
+	)
+		goto clean;
+
+	cache->lastColdStart = header.lastColdStart;
+	cache->lastWarmStart = header.lastWarmStart;
+
+	if(!header.count)
+		goto clean;
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(header.count * sizeof(PipelineCacheEntry), &cache->entries))
+	gotoIfError2(clean, Buffer_copy(cache->entries, Buffer_createRefConst(file.ptr + sizeof(header), Buffer_length(cache->entries))))
+
+	cache->count = header.count;
+
+clean:
+	Buffer_freex(&file);
+	return s_uccess;
+}
+
+Bool PipelineCache_writex(const PipelineCache *cache, CharString path, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Buffer file = Buffer_createNull();
+
+	if(!cache)
+		retError(clean, Error_nullPointer(0, "PipelineCache_writex()::cache is required"))
+
+	const U64 entriesLength = cache->count * sizeof(PipelineCacheEntry);
+
+	const PipelineCacheHeader header = (PipelineCacheHeader) {
+		.magic = PipelineCache_magic,
+		.version = PipelineCache_version,
+		.count = cache->count,
+		.lastColdStart = cache->lastColdStart,
+		.lastWarmStart = cache->lastWarmStart
+	};
+
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(header) + entriesLength, &file))
+
+	*(PipelineCacheHeader*) file.ptrNonConst = header;
+
+	if(entriesLength)
+		gotoIfError2(clean, Buffer_copy(
+			Buffer_createRef(file.ptrNonConst + sizeof(header), entriesLength),
+			Buffer_createRefConst(cache->entries.ptr, entriesLength)
+		))
+
+	gotoIfError3(clean, File_writex(file, path, 0, 0, U64_MAX, false, e_rr))
+
+clean:
+	Buffer_freex(&file);
+	return s_uccess;
+}
+
+const PipelineCacheEntry *PipelineCache_find(const PipelineCache *cache, U64 key) {
+
+	if(!cache)
+		return NULL;
+
+	const PipelineCacheEntry *entries = (const PipelineCacheEntry*) cache->entries.ptr;
+
+	for(U64 i = 0; i < cache->count; ++i)
+		if(entries[i].key == key)
+			return &entries[i];
+
+	return NULL;
+}
+
+Bool PipelineCache_setx(PipelineCache *cache, PipelineCacheEntry entry, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Buffer resized = Buffer_createNull();
+
+	if(!cache)
+		retError(clean, Error_nullPointer(0, "PipelineCache_setx()::cache is required"))
+
+	PipelineCacheEntry *existing = (PipelineCacheEntry*) PipelineCache_find(cache, entry.key);
+
+	if(existing) {
+		*existing = entry;
+		goto clean;
+	}
+
+	//Grow by doubling; there are only a few pipelines, so a linear search is fine
+
+	const U64 capacity = Buffer_length(cache->entries) / sizeof(PipelineCacheEntry);
+
+	if(cache->count == capacity) {
+
+		gotoIfError2(clean, Buffer_createUninitializedBytesx(
+			U64_max(capacity * 2, 16) * sizeof(PipelineCacheEntry), &resized
+		))
+
+		if(cache->count)
+			gotoIfError2(clean, Buffer_copy(
+				resized, Buffer_createRefConst(cache->entries.ptr, cache->count * sizeof(PipelineCacheEntry))
+			))
+
+		Buffer_freex(&cache->entries);
+		cache->entries = resized;
+		resized = Buffer_createNull();
+	}
+
+	((PipelineCacheEntry*) cache->entries.ptrNonConst)[cache->count++] = entry;
+
+clean:
+	Buffer_freex(&resized);
+	return s_uccess;
+}
@@ -0,0 +1,68 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#pragma once
+#include "types/container/buffer.h"
+#include "types/container/string.h"
+#include "types/base/error.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//On disk cache of what it took to create a pipeline last time, keyed on the shader binaries and pipeline state.
+//The pipeline API doesn't expose driver binaries (drivers keep their own caches for those), so this caches what
+//the app controls: the resolved shader entries (skipping the lookups) and the creation time of each pipeline
+//(so parallel creation can start the slowest pipelines first).
+
+#define PipelineCache_version 1
+#define PipelineCache_maxEntries 4
+#define PipelineCache_hashStart 0xCBF29CE484222325
+
+typedef struct PipelineCacheEntry {
+	U64 key;
+	U32 entries[PipelineCache_maxEntries];		//Entry ids, in the order of the pipeline's stages
+	Ns createTime;
+} PipelineCacheEntry;
+
+typedef struct PipelineCache {
+
+	Buffer entries;								//PipelineCacheEntry[capacity]
+	U64 count;
+
+	Ns lastColdStart, lastWarmStart;			//Total time to create all pipelines, with or without misses
+
+} PipelineCache;
+
+//FNV-1a, start with PipelineCache_hashStart and chain
+
+U64 PipelineCache_hash(U64 hash, Buffer data);
+
+//A missing or outdated file isn't an error; it just results in an empty cache
+
+Bool PipelineCache_loadx(CharString path, PipelineCache *cache, Error *e_rr);
+Bool PipelineCache_writex(const PipelineCache *cache, CharString path, Error *e_rr);
+void PipelineCache_freex(PipelineCache *cache);
+
+const PipelineCacheEntry *PipelineCache_find(const PipelineCache *cache, U64 key);
+Bool PipelineCache_setx(PipelineCache *cache, PipelineCacheEntry entry, Error *e_rr);		//Insert or replace
+
+#ifdef __cplusplus
+	}
+#endif
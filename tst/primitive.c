@@ -0,0 +1,266 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "primitive.h"
+#include "types/math/math.h"
+
+RayDesc RayDesc_create(F32x4 origin, F32 minT, F32x4 dir, F32 maxT) {
+	return (RayDesc) { .origin = origin, .dir = dir, .minT = minT, .maxT = maxT };
+}
+
+F32x4 RayDesc_posOnRay(RayDesc ray, F32 t) {
+	return F32x4_add(ray.origin, F32x4_mul(ray.dir, F32x4_xxxx4(t)));
+}
+
+RayDesc4 RayDesc4_create(const RayDesc rays[4]) {
+
+	RayDesc4 result;
+
+	for(U8 i = 0; i < 4; ++i) {
+		F32x4_set(&result.originX, i, F32x4_x(rays[i].origin));
+		F32x4_set(&result.originY, i, F32x4_y(rays[i].origin));
+		F32x4_set(&result.originZ, i, F32x4_z(rays[i].origin));
+		F32x4_set(&result.dirX, i, F32x4_x(rays[i].dir));
+		F32x4_set(&result.dirY, i, F32x4_y(rays[i].dir));
+		F32x4_set(&result.dirZ, i, F32x4_z(rays[i].dir));
+		F32x4_set(&result.minT, i, rays[i].minT);
+		F32x4_set(&result.maxT, i, rays[i].maxT);
+	}
+
+	return result;
+}
+
+RayDesc RayDesc4_get(const RayDesc4 *rays, U8 lane) {
+	return RayDesc_create(
+		F32x4_create3(F32x4_get(rays->originX, lane), F32x4_get(rays->originY, lane), F32x4_get(rays->originZ, lane)),
+		F32x4_get(rays->minT, lane),
+		F32x4_create3(F32x4_get(rays->dirX, lane), F32x4_get(rays->dirY, lane), F32x4_get(rays->dirZ, lane)),
+		F32x4_get(rays->maxT, lane)
+	);
+}
+
+//a.xyz . b.xyz for 4 lanes at once, where every F32x4 is one component
+
+static F32x4 Primitive_dot3x4(F32x4 ax, F32x4 ay, F32x4 az, F32x4 bx, F32x4 by, F32x4 bz) {
+	return F32x4_add(F32x4_add(F32x4_mul(ax, bx), F32x4_mul(ay, by)), F32x4_mul(az, bz));
+}
+
+Sphere Sphere_create(F32x4 pos, F32 rad) {
+	return (Sphere) { .pos = pos, .rad = rad };
+}
+
+Bool Sphere_intersects(Sphere s, RayDesc ray, F32x4 *outT, Bool *isBackface) {
+
+	//Fix to increase sphere precision.
+	//Check raytracing gems I: Chapter 7 and https://iquilezles.org/articles/intersectors/
+
+	const F32x4 dif = F32x4_sub(ray.origin, s.pos);
+	const F32 b = -F32x4_dot3(dif, ray.dir);
+
+	const F32x4 qc = F32x4_add(dif, F32x4_mul(ray.dir, F32x4_xxxx4(b)));
+
+	const F32 rad2 = s.rad * s.rad;
+	const F32 D = rad2 - F32x4_dot3(qc, qc);
+
+	*outT = F32x4_xxxx4(-1);
+	*isBackface = false;
+
+	if(D < 0)
+		return false;
+
+	//HLSL's sign(0) is 0, which would divide by zero below just like the shader does
+
+	const F32 q = b + (b > 0 ? 1.f : (b < 0 ? -1.f : 0.f)) * F32_sqrt(D);
+	const F32 c = F32x4_dot3(dif, dif) - rad2;
+
+	//c / q and q are both roots, but which is nearest depends on the sign of b
+
+	const F32 hitT1 = F32_min(c / q, q);
+	const F32 hitT2 = F32_max(c / q, q);
+	*isBackface = hitT1 < ray.minT;
+
+	const F32 hitT = *isBackface ? hitT2 : hitT1;
+
+	if(hitT < ray.minT || hitT >= ray.maxT)
+		return false;
+
+	*outT = F32x4_create3(hitT, *isBackface ? ray.minT : hitT1, hitT2);
+	return true;
+}
+
+U8 Sphere_intersects4(Sphere s, const RayDesc4 *rays, F32x4 outT[3], U8 *isBackface) {
+
+	//The math is done for all lanes, only the hit test is per lane
+
+	const F32x4 difX = F32x4_sub(rays->originX, F32x4_xxxx4(F32x4_x(s.pos)));
+	const F32x4 difY = F32x4_sub(rays->originY, F32x4_xxxx4(F32x4_y(s.pos)));
+	const F32x4 difZ = F32x4_sub(rays->originZ, F32x4_xxxx4(F32x4_z(s.pos)));
+
+	const F32x4 b = F32x4_negate(Primitive_dot3x4(difX, difY, difZ, rays->dirX, rays->dirY, rays->dirZ));
+
+	const F32x4 qcX = F32x4_add(difX, F32x4_mul(rays->dirX, b));
+	const F32x4 qcY = F32x4_add(difY, F32x4_mul(rays->dirY, b));
+	const F32x4 qcZ = F32x4_add(difZ, F32x4_mul(rays->dirZ, b));
+
+	const F32x4 rad2 = F32x4_xxxx4(s.rad * s.rad);
+	const F32x4 D = F32x4_sub(rad2, Primitive_dot3x4(qcX, qcY, qcZ, qcX, qcY, qcZ));
+	const F32x4 sqrtD = F32x4_sqrt(F32x4_max(D, F32x4_zero()));
+	const F32x4 c = F32x4_sub(Primitive_dot3x4(difX, difY, difZ, difX, difY, difZ), rad2);
+
+	//sign(b) without branches (|b| < 1e-30 is treated as 0, the shader would divide by 0 there too).
+	//Adding 0 turns -0 into +0, so q has the same sign as Sphere_intersects for b = -0 (and c / q the same infinity).
+
+	const F32x4 signB = F32x4_add(
+		F32x4_clamp(F32x4_mul(b, F32x4_xxxx4(1e30f)), F32x4_xxxx4(-1), F32x4_one()), F32x4_zero()
+	);
+	const F32x4 q = F32x4_add(b, F32x4_mul(signB, sqrtD));
+	const F32x4 r = F32x4_div(c, q);
+
+	const F32x4 hitT1 = F32x4_min(r, q);
+	const F32x4 hitT2 = F32x4_max(r, q);
+
+	U8 mask = 0;
+	*isBackface = 0;
+
+	for(U8 i = 0; i < 3; ++i)
+		outT[i] = F32x4_xxxx4(-1);
+
+	for(U8 i = 0; i < 4; ++i) {
+
+		if(F32x4_get(D, i) < 0)
+			continue;
+
+		const F32 hitT1i = F32x4_get(hitT1, i), hitT2i = F32x4_get(hitT2, i);
+		const F32 minT = F32x4_get(rays->minT, i);
+		const Bool isBack = hitT1i < minT;
+
+		if(isBack)
+			*isBackface |= (U8)(1 << i);
+
+		const F32 hitT = isBack ? hitT2i : hitT1i;
+
+		if(hitT < minT || hitT >= F32x4_get(rays->maxT, i))
+			continue;
+
+		F32x4_set(&outT[0], i, hitT);
+		F32x4_set(&outT[1], i, isBack ? minT : hitT1i);
+		F32x4_set(&outT[2], i, hitT2i);
+		mask |= (U8)(1 << i);
+	}
+
+	return mask;
+}
+
+Quad Quad_create(F32x4 p0, F32x4 right, F32x4 up) {
+	return (Quad) {
+		.p0 = p0,
+		.right = right,
+		.up = up,
+		.N = F32x4_cross3(F32x4_normalize3(up), F32x4_normalize3(right))
+	};
+}
+
+Bool Quad_intersects(Quad q, RayDesc ray, F32 *outT, F32x2 *outUv, F32x4 *planeNormal) {
+
+	//Intersect
+
+	const F32 planeW = -F32x4_dot3(q.N, q.p0);
+	const F32 dif = -F32x4_dot3(ray.dir, q.N);
+
+	if(dif == 0)
+		return false;
+
+	const F32 hitT = (F32x4_dot3(ray.origin, q.N) + planeW) / dif;
+
+	if(hitT < ray.minT || hitT >= ray.maxT)
+		return false;
+
+	const F32x4 pos = RayDesc_posOnRay(ray, hitT);
+
+	const F32 u = F32x4_dot3(pos, q.right) - F32x4_dot3(q.p0, q.right);
+	const F32 v = F32x4_dot3(pos, q.up) - F32x4_dot3(q.p0, q.up);
+
+	if(u >= 1 || u < 0 || v >= 1 || v < 0)
+		return false;
+
+	*outT = hitT;
+	*outUv = F32x2_create2(u, 1 - v);
+	*planeNormal = dif < 0 ? F32x4_negate(q.N) : q.N;
+
+	return true;
+}
+
+U8 Quad_intersects4(Quad q, const RayDesc4 *rays, F32x4 *outT, F32x4 *outU, F32x4 *outV, U8 *isFlipped) {
+
+	const F32x4 Nx = F32x4_xxxx4(F32x4_x(q.N)), Ny = F32x4_xxxx4(F32x4_y(q.N)), Nz = F32x4_xxxx4(F32x4_z(q.N));
+
+	const F32x4 planeW = F32x4_xxxx4(-F32x4_dot3(q.N, q.p0));
+	const F32x4 dif = F32x4_negate(Primitive_dot3x4(rays->dirX, rays->dirY, rays->dirZ, Nx, Ny, Nz));
+
+	const F32x4 hitT = F32x4_div(
+		F32x4_add(Primitive_dot3x4(rays->originX, rays->originY, rays->originZ, Nx, Ny, Nz), planeW), dif
+	);
+
+	const F32x4 posX = F32x4_add(rays->originX, F32x4_mul(rays->dirX, hitT));
+	const F32x4 posY = F32x4_add(rays->originY, F32x4_mul(rays->dirY, hitT));
+	const F32x4 posZ = F32x4_add(rays->originZ, F32x4_mul(rays->dirZ, hitT));
+
+	const F32x4 u = F32x4_sub(
+		Primitive_dot3x4(
+			posX, posY, posZ,
+			F32x4_xxxx4(F32x4_x(q.right)), F32x4_xxxx4(F32x4_y(q.right)), F32x4_xxxx4(F32x4_z(q.right))
+		),
+		F32x4_xxxx4(F32x4_dot3(q.p0, q.right))
+	);
+
+	const F32x4 v = F32x4_sub(
+		Primitive_dot3x4(
+			posX, posY, posZ,
+			F32x4_xxxx4(F32x4_x(q.up)), F32x4_xxxx4(F32x4_y(q.up)), F32x4_xxxx4(F32x4_z(q.up))
+		),
+		F32x4_xxxx4(F32x4_dot3(q.p0, q.up))
+	);
+
+	U8 mask = 0;
+	*isFlipped = 0;
+
+	for(U8 i = 0; i < 4; ++i) {
+
+		const F32 difi = F32x4_get(dif, i), t = F32x4_get(hitT, i);
+		const F32 ui = F32x4_get(u, i), vi = F32x4_get(v, i);
+
+		if(difi == 0 || t < F32x4_get(rays->minT, i) || t >= F32x4_get(rays->maxT, i))
+			continue;
+
+		if(ui >= 1 || ui < 0 || vi >= 1 || vi < 0)
+			continue;
+
+		F32x4_set(outT, i, t);
+		F32x4_set(outU, i, ui);
+		F32x4_set(outV, i, 1 - vi);
+
+		if(difi < 0)
+			*isFlipped |= (U8)(1 << i);
+
+		mask |= (U8)(1 << i);
+	}
+
+	return mask;
+}
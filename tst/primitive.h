@@ -0,0 +1,84 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "types/math/vec.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//CPU port of ray_basics.hlsli and primitive.hlsli
+
+typedef struct RayDesc {
+	F32x4 origin;
+	F32x4 dir;
+	F32 minT, maxT;
+} RayDesc;
+
+RayDesc RayDesc_create(F32x4 origin, F32 minT, F32x4 dir, F32 maxT);
+F32x4 RayDesc_posOnRay(RayDesc ray, F32 t);
+
+//4 rays at once as structure of arrays (lane i of every member belongs to ray i).
+//The *4 functions below are the same as their single ray versions, but return a mask with bit i set if ray i hit.
+
+typedef struct RayDesc4 {
+	F32x4 originX, originY, originZ;
+	F32x4 dirX, dirY, dirZ;
+	F32x4 minT, maxT;
+} RayDesc4;
+
+RayDesc4 RayDesc4_create(const RayDesc rays[4]);
+RayDesc RayDesc4_get(const RayDesc4 *rays, U8 lane);
+
+//Sphere intersection
+
+typedef struct Sphere {
+	F32x4 pos;
+	F32 rad;
+} Sphere;
+
+Sphere Sphere_create(F32x4 pos, F32 rad);
+
+//outT = (hitT, entry, exit)
+
+Bool Sphere_intersects(Sphere s, RayDesc ray, F32x4 *outT, Bool *isBackface);
+
+//outT[0] = hitT, outT[1] = entry, outT[2] = exit (-1 for misses), bit i of isBackface is set if ray i started inside
+
+U8 Sphere_intersects4(Sphere s, const RayDesc4 *rays, F32x4 outT[3], U8 *isBackface);
+
+//Quad intersection
+
+typedef struct Quad {
+	F32x4 p0, right, up;
+	F32x4 N;
+} Quad;
+
+Quad Quad_create(F32x4 p0, F32x4 right, F32x4 up);
+Bool Quad_intersects(Quad q, RayDesc ray, F32 *outT, F32x2 *outUv, F32x4 *planeNormal);
+
+//Lanes that miss are left untouched; bit i of isFlipped is set if ray i's planeNormal would be -N
+
+U8 Quad_intersects4(Quad q, const RayDesc4 *rays, F32x4 *outT, F32x4 *outU, F32x4 *outV, U8 *isFlipped);
+
+#ifdef __cplusplus
+	}
+#endif
@@ -0,0 +1,185 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "render_target_pool.h"
+#include "types/math/math.h"
+
+U16 RenderTargetPool_getBucket(U16 size) {
+	const U32 bucket = (U32_max(size, 1) + RenderTargetPool_bucketSize - 1) / RenderTargetPool_bucketSize;
+	return (U16) U32_min(bucket * RenderTargetPool_bucketSize, U16_MAX);
+}
+
+static U64 RenderTarget_getSize(RenderTargetDesc desc) {
+
+	const U64 samples = desc.samples == EMSAASamples_Off ? 1 : (U64) 1 << desc.samples;
+
+	//Depth formats other than D16 are 32-bit (or padded to it) on most hardware
+
+	if(desc.isDepthStencil)
+		return (U64) desc.width * desc.height * samples * (desc.format == EDepthStencilFormat_D16 ? 2 : 4);
+
+	return ETextureFormat_getSize(ETextureFormatId_unpack[desc.format], desc.width, desc.height, 1) * samples;
+}
+
+static Bool RenderTargetDesc_equals(RenderTargetDesc a, RenderTargetDesc b) {
+	return
+		a.format == b.format && a.width == b.width && a.height == b.height && a.samples == b.samples &&
+		a.flags == b.flags && a.isDepthStencil == b.isDepthStencil && a.isTransient == b.isTransient;
+}
+
+static void RenderTargetPool_evict(RenderTargetPool *pool, U64 i) {
+
+	RenderTarget *target = &pool->targets[i];
+
+	if(target->desc.isDepthStencil)
+		DepthStencilRef_dec(&target->ref);
+
+	else RenderTextureRef_dec(&target->ref);
+
+	++pool->stats.frees;
+	pool->stats.bytes -= target->size;
+
+	pool->targets[i] = pool->targets[--pool->targetCount];
+}
+
+Bool RenderTargetPool_acquire(
+	RenderTargetPool *pool, RenderTargetDesc desc, CharString name, RefPtr **target, Error *e_rr
+) {
+
+	Bool s_uccess = true;
+
+	if(!pool || !pool->device || !target)
+		retError(clean, Error_nullPointer(!target ? 3 : 0, "RenderTargetPool_acquire()::pool and target are required"))
+
+	if(*target)
+		retError(clean, Error_invalidParameter(3, 0, "RenderTargetPool_acquire()::target wasn't released"))
+
+	desc.width = RenderTargetPool_getBucket(desc.width);
+	desc.height = RenderTargetPool_getBucket(desc.height);
+
+	++pool->stats.acquires;
+
+	for(U64 i = 0; i < pool->targetCount; ++i) {
+
+		RenderTarget *pooled = &pool->targets[i];
+
+		if(!RenderTargetDesc_equals(pooled->desc, desc) || (pooled->users && !desc.isTransient))
+			continue;
+
+		++pooled->users;
+		pooled->lastUsed = pool->frame;
+		*target = pooled->ref;
+		goto clean;
+	}
+
+	//Make room by dropping the least recently used target that's not in use
+
+	if(pool->targetCount == RenderTargetPool_maxTargets) {
+
+		U64 lru = U64_MAX;
+
+		for(U64 i = 0; i < pool->targetCount; ++i)
+			if(!pool->targets[i].users && (lru == U64_MAX || pool->targets[i].lastUsed < pool->targets[lru].lastUsed))
+				lru = i;
+
+		if(lru == U64_MAX)
+			retError(clean, Error_outOfMemory(0, "RenderTargetPool_acquire() all targets are in use"))
+
+		RenderTargetPool_evict(pool, lru);
+	}
+
+	RefPtr *ref = NULL;
+
+	if(desc.isDepthStencil)
+		gotoIfError2(clean, GraphicsDeviceRef_createDepthStencil(
+			pool->device,
+			desc.width, desc.height, (EDepthStencilFormat) desc.format, false,
+			desc.samples,
+			NULL,
+			name,
+			&ref
+		))
+
+	else gotoIfError2(clean, GraphicsDeviceRef_createRenderTexture(
+		pool->device,
+		ETextureType_2D, desc.width, desc.height, 1, (ETextureFormatId) desc.format, desc.flags,
+		desc.samples,
+		NULL,
+		name,
+		&ref
+	))
+
+	const U64 size = RenderTarget_getSize(desc);
+
+	pool->targets[pool->targetCount++] = (RenderTarget) {
+		.desc = desc, .ref = ref, .users = 1, .lastUsed = pool->frame, .size = size
+	};
+
+	++pool->stats.allocations;
+	pool->stats.bytes += size;
+	pool->stats.peakBytes = U64_max(pool->stats.peakBytes, pool->stats.bytes);
+
+	*target = ref;
+
+clean:
+	return s_uccess;
+}
+
+void RenderTargetPool_release(RenderTargetPool *pool, RefPtr **target) {
+
+	if(!pool || !target || !*target)
+		return;
+
+	for(U64 i = 0; i < pool->targetCount; ++i)
+		if(pool->targets[i].ref == *target) {
+			--pool->targets[i].users;
+			pool->targets[i].lastUsed = pool->frame;
+			break;
+		}
+
+	*target = NULL;
+}
+
+void RenderTargetPool_nextFrame(RenderTargetPool *pool) {
+
+	if(!pool)
+		return;
+
+	++pool->frame;
+
+	for(U64 i = pool->targetCount; i > 0; --i) {
+
+		const RenderTarget *target = &pool->targets[i - 1];
+
+		if(!target->users && pool->frame - target->lastUsed > RenderTargetPool_maxUnusedFrames)
+			RenderTargetPool_evict(pool, i - 1);
+	}
+}
+
+void RenderTargetPool_free(RenderTargetPool *pool) {
+
+	if(!pool)
+		return;
+
+	while(pool->targetCount)
+		RenderTargetPool_evict(pool, pool->targetCount - 1);
+
+	*pool = (RenderTargetPool) { 0 };
+}
@@ -0,0 +1,97 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "types/base/types.h"
+#include "types/container/string.h"
+#include "graphics/generic/device.h"
+#include "graphics/generic/render_texture.h"
+#include "graphics/generic/depth_stencil.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Reuses render textures and depth stencils, so resizing a window doesn't destroy and recreate its targets every time.
+//Sizes are rounded up to a bucket; a target can be reused by any size in the same bucket, so callers render into
+//the top left (width x height) of a target that can be bigger (see RenderTargetPool_getBucket).
+//
+//Transient targets (cleared on load and discarded after the render pass, e.g. depth or MSAA color that's resolved)
+//are shared by everyone that acquires the same description: their lifetime never extends past a single pass,
+//so they can alias each other. Other targets are only handed out to one user at a time.
+//
+//Released targets stay in the pool until they weren't used for RenderTargetPool_maxUnusedFrames,
+//so going back and forth between sizes (e.g. dragging a window) hits the pool.
+
+typedef struct RenderTargetDesc {
+	U32 format;							//ETextureFormatId or EDepthStencilFormat (if isDepthStencil)
+	U16 width, height;					//Rounded to the bucket in the pool
+	EMSAASamples samples;
+	EGraphicsResourceFlag flags;		//Only for render textures
+	Bool isDepthStencil;
+	Bool isTransient;
+} RenderTargetDesc;
+
+typedef struct RenderTarget {
+	RenderTargetDesc desc;
+	RefPtr *ref;						//RenderTextureRef or DepthStencilRef
+	U64 users;
+	U64 lastUsed;						//Frame it was last acquired or released
+	U64 size;							//Estimated bytes
+} RenderTarget;
+
+typedef struct RenderTargetPoolStats {
+	U64 acquires;						//Every acquire used to be an allocation
+	U64 allocations, frees;
+	U64 bytes, peakBytes;				//Estimated from the format, size and samples
+} RenderTargetPoolStats;
+
+#define RenderTargetPool_maxTargets 32
+#define RenderTargetPool_bucketSize 256
+#define RenderTargetPool_maxUnusedFrames 120
+
+typedef struct RenderTargetPool {
+	GraphicsDeviceRef *device;			//Not owned
+	RenderTarget targets[RenderTargetPool_maxTargets];
+	U64 targetCount;
+	U64 frame;
+	RenderTargetPoolStats stats;
+} RenderTargetPool;
+
+U16 RenderTargetPool_getBucket(U16 size);
+
+//Returns a target that's at least desc.width x desc.height (the actual size is the bucket).
+//target should be empty and has to be released again with RenderTargetPool_release
+
+Bool RenderTargetPool_acquire(
+	RenderTargetPool *pool, RenderTargetDesc desc, CharString name, RefPtr **target, Error *e_rr
+);
+
+void RenderTargetPool_release(RenderTargetPool *pool, RefPtr **target);
+
+//Frees the targets that haven't been used for a while; call once per frame
+
+void RenderTargetPool_nextFrame(RenderTargetPool *pool);
+
+void RenderTargetPool_free(RenderTargetPool *pool);
+
+#ifdef __cplusplus
+	}
+#endif
@@ -0,0 +1,107 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "sky_bake.h"
+#include "parallel.h"
+#include "platforms/ext/bufferx.h"
+#include "types/math/math.h"
+
+F32x4 SkyBake_getEquirectDir(U32 x, U32 y, U32 width, U32 height) {
+
+	const F32 longitude = (x + 0.5f) / width * 2 * F32_PI;
+	const F32 latitude = F32_PI * 0.5f - (y + 0.5f) / height * F32_PI;
+	const F32 cosLatitude = F32_cos(latitude);
+
+	return F32x4_create3(cosLatitude * F32_cos(longitude), F32_sin(latitude), cosLatitude * F32_sin(longitude));
+}
+
+typedef struct SkyBakeJob {
+	const Atmosphere *atmos;
+	F32x4 *texels;
+	U32 width, height;
+	Bool usePackets;
+} SkyBakeJob;
+
+static void SkyBake_renderRow(void *userData, U64 row, U64 threadId) {
+
+	(void) threadId;
+
+	const SkyBakeJob *job = (const SkyBakeJob*) userData;
+	const U32 width = job->width, y = (U32) row;
+	F32x4 *texels = job->texels + row * width;
+
+	U32 x = 0;
+
+	//4 pixels at a time, the remainder (if width isn't a multiple of 4) is traced one by one
+
+	if(job->usePackets)
+		for(; x + 4 <= width; x += 4) {
+
+			RayDesc rays[4];
+
+			for(U32 i = 0; i < 4; ++i)
+				rays[i] = RayDesc_create(F32x4_zero(), 0, SkyBake_getEquirectDir(x + i, y, width, job->height), 1e38f);
+
+			const RayDesc4 packet = RayDesc4_create(rays);
+			Atmosphere_getContribution4(job->atmos, &packet, texels + x);
+		}
+
+	for(; x < width; ++x) {
+		const RayDesc ray = RayDesc_create(F32x4_zero(), 0, SkyBake_getEquirectDir(x, y, width, job->height), 1e38f);
+		texels[x] = Atmosphere_getContribution(job->atmos, ray);
+	}
+}
+
+Bool SkyBake_equirectx(const Atmosphere *atmos, U32 width, U32 height, Bool usePackets, Buffer *result, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Bool ownsResult = false;
+
+	if(!atmos || !result)
+		retError(clean, Error_nullPointer(!atmos ? 0 : 4, "SkyBake_equirectx()::atmos and result are required"))
+
+	if(result->ptr)
+		retError(clean, Error_invalidParameter(4, 0, "SkyBake_equirectx()::result wasn't empty, might indicate memleak"))
+
+	if(!width || !height || width > 16384 || height > 16384)
+		retError(clean, Error_invalidParameter(
+			!width || width > 16384 ? 1 : 2, 0, "SkyBake_equirectx()::width and height should be in [1, 16384]"
+		))
+
+	ownsResult = true;
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(F32x4) * width * height, result))
+
+	SkyBakeJob job = (SkyBakeJob) {
+		.atmos = atmos,
+		.texels = (F32x4*) result->ptrNonConst,
+		.width = width,
+		.height = height,
+		.usePackets = usePackets
+	};
+
+	gotoIfError3(clean, Parallel_for(height, SkyBake_renderRow, &job, e_rr))
+
+clean:
+
+	if(!s_uccess && ownsResult)
+		Buffer_freex(result);
+
+	return s_uccess;
+}
@@ -0,0 +1,45 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "atmosphere.h"
+#include "types/container/buffer.h"
+#include "types/base/error.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Bakes the sky radiance (Atmosphere_getContribution) of every direction into an equirectangular map on the CPU,
+//e.g. for offline tools that can't run atmosphere.hlsli. Rows run on all threads (see Parallel_for).
+//
+//Pixel (x, y) looks at longitude (x + 0.5) / width * 2pi (0 = +X, turning towards +Z)
+//and latitude pi/2 - (y + 0.5) / height * pi, so row 0 is the top (+Y). The output is F32x4[width * height] (w = 0), in the same units as the shader (lux / sr).
+//
+//usePackets traces 4 neighbouring pixels per call (Atmosphere_getContribution4), otherwise it's one ray per pixel.
+//The single ray version is the reference: it's a direct port of the shader's ray march.
+
+Bool SkyBake_equirectx(const Atmosphere *atmos, U32 width, U32 height, Bool usePackets, Buffer *result, Error *e_rr);
+
+F32x4 SkyBake_getEquirectDir(U32 x, U32 y, U32 width, U32 height);
+
+#ifdef __cplusplus
+	}
+#endif
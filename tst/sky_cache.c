@@ -0,0 +1,225 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "sky_cache.h"
+#include "parallel.h"
+#include "platforms/ext/bufferx.h"
+#include "types/base/time.h"
+#include "types/math/flp.h"
+#include "types/math/math.h"
+
+Bool SkyCache_createx(U32 size, F32 thresholdDeg, SkyCache *cache, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Bool ownsCache = false;
+
+	if(!cache)
+		retError(clean, Error_nullPointer(2, "SkyCache_createx()::cache is required"))
+
+	if(cache->faces.ptr)
+		retError(clean, Error_invalidParameter(2, 0, "SkyCache_createx()::cache wasn't empty, might indicate memleak"))
+
+	if(!size || size > 4096)
+		retError(clean, Error_invalidParameter(0, 0, "SkyCache_createx()::size should be in [1, 4096]"))
+
+	if(!(thresholdDeg >= 0 && thresholdDeg <= 180))
+		retError(clean, Error_invalidParameter(1, 0, "SkyCache_createx()::thresholdDeg should be in [0, 180]"))
+
+	ownsCache = true;
+	*cache = (SkyCache) { .size = size, .thresholdCos = F32_cos(thresholdDeg * F32_DEG_TO_RAD) };
+
+	gotoIfError2(clean, Buffer_createEmptyBytesx(sizeof(F32x4) * 6 * size * size, &cache->faces))
+
+clean:
+
+	if(!s_uccess && ownsCache)
+		SkyCache_freex(cache);
+
+	return s_uccess;
+}
+
+void SkyCache_freex(SkyCache *cache) {
+
+	if(!cache)
+		return;
+
+	Buffer_freex(&cache->faces);
+	*cache = (SkyCache) { 0 };
+}
+
+void SkyCache_invalidate(SkyCache *cache) {
+	if(cache)
+		cache->isValid = false;
+}
+
+//uv in [-1, 1] on the face
+
+static F32x4 SkyCache_getDir(U32 face, F32 u, F32 v) {
+
+	switch(face) {
+		case 0:		return F32x4_normalize3(F32x4_create3(1, -v, -u));
+		case 1:		return F32x4_normalize3(F32x4_create3(-1, -v, u));
+		case 2:		return F32x4_normalize3(F32x4_create3(u, 1, v));
+		case 3:		return F32x4_normalize3(F32x4_create3(u, -1, -v));
+		case 4:		return F32x4_normalize3(F32x4_create3(u, -v, 1));
+		default:	return F32x4_normalize3(F32x4_create3(-u, -v, -1));
+	}
+}
+
+static U32 SkyCache_getFace(F32x4 dir, F32 *u, F32 *v) {
+
+	const F32 x = F32x4_x(dir), y = F32x4_y(dir), z = F32x4_z(dir);
+	const F32 ax = F32_abs(x), ay = F32_abs(y), az = F32_abs(z);
+
+	if(ax >= ay && ax >= az) {
+		*u = (x > 0 ? -z : z) / ax;
+		*v = -y / ax;
+		return x > 0 ? 0 : 1;
+	}
+
+	if(ay >= az) {
+		*u = x / ay;
+		*v = (y > 0 ? z : -z) / ay;
+		return y > 0 ? 2 : 3;
+	}
+
+	*u = (z > 0 ? x : -x) / az;
+	*v = -y / az;
+	return z > 0 ? 4 : 5;
+}
+
+typedef struct SkyCacheJob {
+	SkyCache *cache;
+	const AtmosphereLUT *lut;
+	Atmosphere atmos;
+} SkyCacheJob;
+
+static void SkyCache_renderRow(void *userData, U64 row, U64 threadId) {
+
+	(void) threadId;
+
+	SkyCacheJob *job = (SkyCacheJob*) userData;
+	const U32 size = job->cache->size;
+
+	const U32 face = (U32)(row / size), y = (U32)(row % size);
+	F32x4 *texels = (F32x4*) job->cache->faces.ptrNonConst + ((U64) face * size + y) * size;
+
+	const F32 v = (y + 0.5f) / size * 2 - 1;
+
+	for(U32 x = 0; x < size; ++x) {
+
+		const F32 u = (x + 0.5f) / size * 2 - 1;
+		const RayDesc ray = RayDesc_create(F32x4_zero(), 0, SkyCache_getDir(face, u, v), 1e38f);
+
+		texels[x] = job->lut ?
+			Atmosphere_getContributionLUT(&job->atmos, job->lut, ray, true) :
+			Atmosphere_getContribution(&job->atmos, ray);
+	}
+}
+
+Bool SkyCache_update(SkyCache *cache, F32x4 sunDir, const AtmosphereLUT *lut, Bool *updated, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(updated)
+		*updated = false;
+
+	if(!cache || !cache->faces.ptr)
+		retError(clean, Error_nullPointer(0, "SkyCache_update()::cache is required"))
+
+	if(cache->isValid && F32x4_dot3(cache->sunDir, sunDir) >= cache->thresholdCos) {
+		++cache->skips;
+		goto clean;
+	}
+
+	const Ns start = Time_now();
+
+	SkyCacheJob job = (SkyCacheJob) {
+		.cache = cache,
+		.lut = lut && lut->data.ptr ? lut : NULL,
+		.atmos = Atmosphere_earth(sunDir)
+	};
+
+	gotoIfError3(clean, Parallel_for((U64) cache->size * 6, SkyCache_renderRow, &job, e_rr))
+
+	cache->sunDir = sunDir;
+	cache->isValid = true;
+	cache->renderTime += Time_now() - start;
+	++cache->renders;
+
+	if(updated)
+		*updated = true;
+
+clean:
+	return s_uccess;
+}
+
+F32x4 SkyCache_sample(const SkyCache *cache, F32x4 dir) {
+
+	F32 u, v;
+	const U32 face = SkyCache_getFace(dir, &u, &v);
+	const U32 size = cache->size;
+
+	const F32 x = F32_clamp((u * 0.5f + 0.5f) * size - 0.5f, 0, (F32)(size - 1));
+	const F32 y = F32_clamp((v * 0.5f + 0.5f) * size - 0.5f, 0, (F32)(size - 1));
+
+	const U32 x0 = (U32) x, y0 = (U32) y;
+	const U32 x1 = U32_min(x0 + 1, size - 1), y1 = U32_min(y0 + 1, size - 1);
+
+	const F32x4 *texels = (const F32x4*) cache->faces.ptr + (U64) face * size * size;
+
+	const F32x4 top = F32x4_lerp(texels[y0 * size + x0], texels[y0 * size + x1], x - x0);
+	const F32x4 bottom = F32x4_lerp(texels[y1 * size + x0], texels[y1 * size + x1], x - x0);
+
+	return F32x4_lerp(top, bottom, y - y0);
+}
+
+Bool SkyCache_toF16(const SkyCache *cache, Buffer dst, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!cache || !cache->faces.ptr)
+		retError(clean, Error_nullPointer(0, "SkyCache_toF16()::cache is required"))
+
+	const U32 size = cache->size;
+	const U64 texels = (U64) size * size * 6;
+
+	if(Buffer_length(dst) < texels * sizeof(F16) * 4)
+		retError(clean, Error_outOfBounds(1, Buffer_length(dst), texels * sizeof(F16) * 4, "SkyCache_toF16()::dst too small"))
+
+	//Faces are stored after each other, but the strip puts them next to each other
+
+	const F32x4 *src = (const F32x4*) cache->faces.ptr;
+	F16 *dstF16 = (F16*) dst.ptrNonConst;
+
+	for(U32 face = 0; face < 6; ++face)
+		for(U32 y = 0; y < size; ++y)
+			for(U32 x = 0; x < size; ++x) {
+
+				const F32x4 texel = src[((U64) face * size + y) * size + x];
+				F16 *out = dstF16 + ((U64) y * size * 6 + (U64) face * size + x) * 4;
+
+				for(U8 k = 0; k < 4; ++k)
+					out[k] = F32_castF16(F32x4_get(texel, k));
+			}
+
+clean:
+	return s_uccess;
+}
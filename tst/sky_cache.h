@@ -0,0 +1,77 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "atmosphere_lut.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Radiance cache of the sky (Atmosphere_earth), so miss rays don't have to evaluate the atmosphere.
+//The sun moves a fraction of a degree per minute, so the cube is only re-rendered once the sun direction changed by more
+//than the threshold. The camera is assumed to be ~10m above the ground (like the shader), so only direction matters.
+//
+//Faces are +X, -X, +Y, -Y, +Z, -Z (D3D cube convention) stored next to each other: a (6 * size) x size strip.
+//The shader samples the same layout (see atmosphere.hlsli).
+
+#define SkyCache_defaultSize 64
+#define SkyCache_defaultThresholdDeg 0.25f
+
+typedef struct SkyCache {
+
+	Buffer faces;				//F32x4[6 * size * size]
+
+	F32x4 sunDir;				//The sun direction the cache was last rendered with
+
+	U32 size;
+	F32 thresholdCos;			//Re-render once dot(sunDir, newSunDir) < thresholdCos
+
+	U64 renders, skips;			//Update statistics
+	Ns renderTime;
+
+	Bool isValid;
+	U8 padding[7];
+
+} SkyCache;
+
+Bool SkyCache_createx(U32 size, F32 thresholdDeg, SkyCache *cache, Error *e_rr);
+void SkyCache_freex(SkyCache *cache);
+
+//Re-renders the sky if the sun moved too far, updated is set if it did.
+//lut is optional; if it's NULL or empty, the atmosphere is ray marched.
+
+Bool SkyCache_update(SkyCache *cache, F32x4 sunDir, const AtmosphereLUT *lut, Bool *updated, Error *e_rr);
+
+//Force a re-render next update (e.g. when the atmosphere changes)
+
+void SkyCache_invalidate(SkyCache *cache);
+
+//Bilinear sample (clamped within the face)
+
+F32x4 SkyCache_sample(const SkyCache *cache, F32x4 dir);
+
+//Writes the strip as RGBA16f into dst (which should be at least 6 * size * size * 8 bytes)
+
+Bool SkyCache_toF16(const SkyCache *cache, Buffer dst, Error *e_rr);
+
+#ifdef __cplusplus
+	}
+#endif
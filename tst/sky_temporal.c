@@ -0,0 +1,224 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#include "sky_temporal.h"
+#include "parallel.h"
+#include "platforms/ext/bufferx.h"
+#include "types/math/math.h"
+
+Bool SkyTemporal_createx(U32 width, U32 height, F32 minWeight, F32 thresholdDeg, SkyTemporal *temporal, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Bool ownsTemporal = false;
+
+	if(!temporal)
+		retError(clean, Error_nullPointer(4, "SkyTemporal_createx()::temporal is required"))
+
+	if(temporal->history[0].ptr)
+		retError(clean, Error_invalidParameter(4, 0, "SkyTemporal_createx()::temporal wasn't empty, might indicate memleak"))
+
+	if(!width || !height || width > 16384 || height > 16384)
+		retError(clean, Error_invalidParameter(!width ? 0 : 1, 0, "SkyTemporal_createx()::width and height should be in [1, 16384]"))
+
+	if(!(minWeight > 0 && minWeight <= 1))
+		retError(clean, Error_invalidParameter(2, 0, "SkyTemporal_createx()::minWeight should be in <0, 1]"))
+
+	if(!(thresholdDeg >= 0 && thresholdDeg <= 180))
+		retError(clean, Error_invalidParameter(3, 0, "SkyTemporal_createx()::thresholdDeg should be in [0, 180]"))
+
+	ownsTemporal = true;
+
+	*temporal = (SkyTemporal) {
+		.width = width,
+		.height = height,
+		.minWeight = minWeight,
+		.thresholdCos = F32_cos(thresholdDeg * F32_DEG_TO_RAD)
+	};
+
+	for(U8 i = 0; i < 2; ++i)
+		gotoIfError2(clean, Buffer_createEmptyBytesx(sizeof(F32x4) * width * height, &temporal->history[i]))
+
+clean:
+
+	if(!s_uccess && ownsTemporal)
+		SkyTemporal_freex(temporal);
+
+	return s_uccess;
+}
+
+void SkyTemporal_freex(SkyTemporal *temporal) {
+
+	if(!temporal)
+		return;
+
+	for(U8 i = 0; i < 2; ++i)
+		Buffer_freex(&temporal->history[i]);
+
+	*temporal = (SkyTemporal) { 0 };
+}
+
+Buffer SkyTemporal_getResult(const SkyTemporal *temporal) {
+	return !temporal ? Buffer_createNull() : Buffer_createRefConst(
+		temporal->history[temporal->current].ptr, Buffer_length(temporal->history[temporal->current])
+	);
+}
+
+typedef struct SkyTemporalJob {
+	const SkyTemporal *temporal;
+	const Atmosphere *atmos;
+	const AtmosphereLUT *lut;		//NULL = ray march
+	const CameraMatrices *camera;
+	const F32x4 *prev;				//NULL = no usable history
+	F32x4 *next;
+	F32 maxFrames;
+	U32 padding;
+} SkyTemporalJob;
+
+//Bilinear sample of the previous frame in the direction dir; returns false if it was off screen
+
+static Bool SkyTemporal_reproject(const SkyTemporalJob *job, F32x4 dir, F32x4 *history) {
+
+	const SkyTemporal *temporal = job->temporal;
+	const F32x4 *m = temporal->prevCamera.viewProj;
+
+	//w = 0, since the sky doesn't move with the camera
+
+	const F32x4 clip = F32x4_add(
+		F32x4_add(F32x4_mul(F32x4_xxxx4(F32x4_x(dir)), m[0]), F32x4_mul(F32x4_xxxx4(F32x4_y(dir)), m[1])),
+		F32x4_mul(F32x4_xxxx4(F32x4_z(dir)), m[2])
+	);
+
+	if(!(F32x4_w(clip) > 0))
+		return false;
+
+	const F32 ndcX = F32x4_x(clip) / F32x4_w(clip), ndcY = F32x4_y(clip) / F32x4_w(clip);
+
+	if(!(F32_abs(ndcX) <= 1 && F32_abs(ndcY) <= 1))
+		return false;
+
+	//Position in pixels relative to the center of the first one; it's >= -0.5, so truncating it + 1 floors it
+
+	const F32 fx = (ndcX * 0.5f + 0.5f) * temporal->width - 0.5f;
+	const F32 fy = (0.5f - ndcY * 0.5f) * temporal->height - 0.5f;
+
+	const I32 ix = (I32)(fx + 1) - 1, iy = (I32)(fy + 1) - 1;
+	const F32 tx = fx - (F32) ix, ty = fy - (F32) iy;
+
+	const U32 x0 = (U32) I32_clamp(ix, 0, (I32) temporal->width - 1);
+	const U32 x1 = (U32) I32_clamp(ix + 1, 0, (I32) temporal->width - 1);
+	const U32 y0 = (U32) I32_clamp(iy, 0, (I32) temporal->height - 1);
+	const U32 y1 = (U32) I32_clamp(iy + 1, 0, (I32) temporal->height - 1);
+
+	const F32x4 *row0 = job->prev + (U64) y0 * temporal->width;
+	const F32x4 *row1 = job->prev + (U64) y1 * temporal->width;
+
+	*history = F32x4_lerp(F32x4_lerp(row0[x0], row0[x1], tx), F32x4_lerp(row1[x0], row1[x1], tx), ty);
+	return true;
+}
+
+static void SkyTemporal_renderRow(void *userData, U64 row, U64 threadId) {
+
+	(void) threadId;
+
+	const SkyTemporalJob *job = (const SkyTemporalJob*) userData;
+	const SkyTemporal *temporal = job->temporal;
+
+	const U32 y = (U32) row;
+	const F32 ndcY = 1 - (y + 0.5f) / temporal->height * 2;
+
+	F32x4 *next = job->next + (U64) y * temporal->width;
+	Atmosphere atmos = *job->atmos;
+
+	for(U32 x = 0; x < temporal->width; ++x) {
+
+		const F32 ndcX = (x + 0.5f) / temporal->width * 2 - 1;
+		const RayDesc ray = RayDesc_create(F32x4_zero(), 0, Camera_getDir(job->camera, ndcX, ndcY), 1e38f);
+
+		const F32x2 offsets = Atmosphere_getSampleOffsets(x, y, temporal->frameId);
+		atmos.rayOffset = F32x2_x(offsets);
+		atmos.lightOffset = F32x2_y(offsets);
+
+		F32x4 color = job->lut ?
+			Atmosphere_getContributionLUT(&atmos, job->lut, ray, true) :
+			Atmosphere_getContribution(&atmos, ray);
+
+		//Running mean until maxFrames, then an exponential moving average
+
+		F32x4 history;
+		F32 frames = 1;
+
+		if(job->prev && SkyTemporal_reproject(job, ray.dir, &history)) {
+			frames = F32_min(F32x4_w(history) + 1, job->maxFrames);
+			color = F32x4_lerp(history, color, 1 / frames);
+		}
+
+		F32x4_setW(&color, frames);
+		next[x] = color;
+	}
+}
+
+Bool SkyTemporal_render(
+	SkyTemporal *temporal,
+	const Atmosphere *atmos,
+	const AtmosphereLUT *lut,
+	const CameraMatrices *camera,
+	Error *e_rr
+) {
+
+	Bool s_uccess = true;
+
+	if(!temporal || !temporal->history[0].ptr)
+		retError(clean, Error_nullPointer(0, "SkyTemporal_render()::temporal is required"))
+
+	if(!atmos || !camera)
+		retError(clean, Error_nullPointer(!atmos ? 1 : 3, "SkyTemporal_render()::atmos and camera are required"))
+
+	if(!atmos->raySamples || !atmos->lightSamples)
+		retError(clean, Error_invalidParameter(1, 0, "SkyTemporal_render()::atmos needs raySamples and lightSamples"))
+
+	//The first frame and a different sun don't have usable history
+
+	const Bool hasHistory = temporal->frameId && F32x4_dot3(atmos->sunDir, temporal->sunDir) >= temporal->thresholdCos;
+
+	if(temporal->frameId && !hasHistory)
+		++temporal->resets;
+
+	const U32 next = !temporal->current;
+
+	SkyTemporalJob job = (SkyTemporalJob) {
+		.temporal = temporal,
+		.atmos = atmos,
+		.lut = lut && lut->data.ptr ? lut : NULL,
+		.camera = camera,
+		.prev = hasHistory ? (const F32x4*) temporal->history[temporal->current].ptr : NULL,
+		.next = (F32x4*) temporal->history[next].ptrNonConst,
+		.maxFrames = 1 / temporal->minWeight
+	};
+
+	gotoIfError3(clean, Parallel_for(temporal->height, SkyTemporal_renderRow, &job, e_rr))
+
+	temporal->prevCamera = *camera;
+	temporal->sunDir = atmos->sunDir;
+	temporal->current = next;
+	++temporal->frameId;
+
+clean:
+	return s_uccess;
+}
@@ -0,0 +1,83 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+
+#pragma once
+#include "atmosphere_lut.h"
+#include "camera.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//Temporal reuse of a cheap sky: every frame ray marches each pixel with few samples (e.g. 4x2 instead of 16x8),
+//jittered per pixel by Atmosphere_getSampleOffsets, so the error is noise rather than banding.
+//That noise is averaged out over frames: the previous result is reprojected and blended with the new one.
+//
+//The sky is at infinity, so reprojection only needs the direction: it's transformed by the previous viewProj
+//(w = 0, so camera movement doesn't matter, only rotation) and the previous frame is sampled there bilinearly.
+//The blend is a running mean (weight 1 / n for the nth frame) until n reaches 1 / minWeight, after which it's an
+//exponential moving average. So a still view converges like accumulating frames, while a moving one only keeps a short
+//history. Directions that were off screen start over, as does everything once the sun moved more than the threshold.
+
+#define SkyTemporal_defaultMinWeight (1 / 32.f)
+#define SkyTemporal_defaultThresholdDeg 0.25f
+
+typedef struct SkyTemporal {
+
+	Buffer history[2];				//F32x4[width * height] each, w = frames in the mean; swapped every frame
+
+	CameraMatrices prevCamera;
+	F32x4 sunDir;
+
+	U32 width, height;
+
+	U32 frameId;					//Frames rendered, used for the sample offsets
+	F32 minWeight;					//Weight of the new frame once the history is long enough, in <0, 1]
+
+	F32 thresholdCos;				//Reset once dot(sunDir, newSunDir) < thresholdCos
+	U32 current;					//history[current] is the last result
+
+	U64 resets;
+
+} SkyTemporal;
+
+Bool SkyTemporal_createx(U32 width, U32 height, F32 minWeight, F32 thresholdDeg, SkyTemporal *temporal, Error *e_rr);
+void SkyTemporal_freex(SkyTemporal *temporal);
+
+//Renders the next frame of the sky as seen by camera; raySamples and lightSamples come from atmos (its offsets are
+//replaced per pixel). atmos->quadraticSamples should be on, jittered uniform samples are biased (see atmosphere.h).
+//lut is optional, if set the light comes from the LUTs and only the view ray is jittered.
+//The result is written to the history and returned by SkyTemporal_getResult.
+
+Bool SkyTemporal_render(
+	SkyTemporal *temporal,
+	const Atmosphere *atmos,
+	const AtmosphereLUT *lut,
+	const CameraMatrices *camera,
+	Error *e_rr
+);
+
+//F32x4[width * height] result of the last render (w is the number of frames that were averaged)
+
+Buffer SkyTemporal_getResult(const SkyTemporal *temporal);
+
+#ifdef __cplusplus
+	}
+#endif
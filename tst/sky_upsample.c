@@ -0,0 +1,258 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#include "sky_upsample.h"
+#include "parallel.h"
+#include "platforms/ext/bufferx.h"
+#include "types/base/atomic.h"
+#include "types/math/math.h"
+
+U32 SkyUpsample_getLowResSize(U32 size, U32 factor) {
+	return factor ? (size + factor - 1) / factor : 0;
+}
+
+//Shared by render and composite, since they have to agree on the input
+
+static Bool SkyUpsample_validate(const SkyUpsampleInput *input, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	if(!input || (!input->getSky && (!input->atmos || !input->camera)))
+		retError(clean, Error_nullPointer(0, "SkyUpsample_validate()::input and getSky or atmos and camera are required"))
+
+	if(!input->w || !input->h || input->w > 16384 || input->h > 16384)
+		retError(clean, Error_invalidParameter(0, 0, "SkyUpsample_validate()::w and h should be in [1, 16384]"))
+
+	if(!input->factor || input->factor > SkyUpsample_maxFactor)
+		retError(clean, Error_invalidParameter(0, 1, "SkyUpsample_validate()::factor should be in [1, SkyUpsample_maxFactor]"))
+
+	if(Buffer_length(input->hitT) && Buffer_length(input->hitT) < sizeof(F32) * input->w * input->h)
+		retError(clean, Error_outOfBounds(
+			0, Buffer_length(input->hitT), sizeof(F32) * input->w * input->h, "SkyUpsample_validate()::hitT should be w * h"
+		))
+
+clean:
+	return s_uccess;
+}
+
+static Bool SkyUpsample_isMiss(const SkyUpsampleInput *input, U32 x, U32 y) {
+	return !Buffer_length(input->hitT) || ((const F32*) input->hitT.ptr)[(U64) y * input->w + x] < 0;
+}
+
+typedef struct SkyUpsampleJob {
+	const SkyUpsampleInput *input;
+	F32x4 *texels;
+	U32 lowW;
+	AtomicI64 evaluated;
+} SkyUpsampleJob;
+
+static void SkyUpsample_renderRow(void *userData, U64 row, U64 threadId) {
+
+	(void) threadId;
+
+	SkyUpsampleJob *job = (SkyUpsampleJob*) userData;
+	const SkyUpsampleInput *input = job->input;
+
+	const U32 factor = input->factor;
+	const U32 y0 = (U32) row * factor, y1 = U32_min(y0 + factor, input->h);
+	const Bool useLut = input->lut && input->lut->data.ptr;
+
+	F32x4 *texels = job->texels + row * job->lowW;
+	I64 evaluated = 0;
+
+	for(U32 lx = 0; lx < job->lowW; ++lx) {
+
+		const U32 x0 = lx * factor, x1 = U32_min(x0 + factor, input->w);
+
+		//The sky isn't continuous (e.g. the planet below the horizon), so it's evaluated where the footprint sees sky:
+		//at the average of its miss pixels. The upsample still treats it as the center, but the sky is smooth there.
+
+		U32 misses = 0, sumX = 0, sumY = 0;
+
+		for(U32 y = y0; y < y1; ++y)
+			for(U32 x = x0; x < x1; ++x)
+				if(SkyUpsample_isMiss(input, x, y)) {
+					++misses;
+					sumX += x;
+					sumY += y;
+				}
+
+		if(!misses) {
+			texels[lx] = F32x4_zero();
+			continue;
+		}
+
+		const F32 px = (F32) sumX / misses + 0.5f;
+		const F32 py = (F32) sumY / misses + 0.5f;
+
+		F32x4 color;
+
+		if(input->getSky)
+			color = input->getSky(input->userData, px, py);
+
+		else {
+
+			//The camera is ~10m above the ground like the sky cache, so only direction matters
+
+			const F32 ndcX = px / input->w * 2 - 1;
+			const F32 ndcY = 1 - py / input->h * 2;
+
+			const RayDesc ray = RayDesc_create(F32x4_zero(), 0, Camera_getDir(input->camera, ndcX, ndcY), 1e38f);
+
+			color = useLut ?
+				Atmosphere_getContributionLUT(input->atmos, input->lut, ray, true) :
+				Atmosphere_getContribution(input->atmos, ray);
+		}
+
+		F32x4_setW(&color, 1);
+		texels[lx] = color;
+		++evaluated;
+	}
+
+	AtomicI64_add(&job->evaluated, evaluated);
+}
+
+Bool SkyUpsample_renderx(const SkyUpsampleInput *input, Buffer *lowRes, U64 *evaluated, Error *e_rr) {
+
+	Bool s_uccess = true;
+	Bool ownsLowRes = false;
+
+	gotoIfError3(clean, SkyUpsample_validate(input, e_rr))
+
+	if(!lowRes)
+		retError(clean, Error_nullPointer(1, "SkyUpsample_renderx()::lowRes is required"))
+
+	if(lowRes->ptr)
+		retError(clean, Error_invalidParameter(1, 0, "SkyUpsample_renderx()::lowRes wasn't empty, might indicate memleak"))
+
+	const U32 lowW = SkyUpsample_getLowResSize(input->w, input->factor);
+	const U32 lowH = SkyUpsample_getLowResSize(input->h, input->factor);
+
+	ownsLowRes = true;
+	gotoIfError2(clean, Buffer_createUninitializedBytesx(sizeof(F32x4) * lowW * lowH, lowRes))
+
+	SkyUpsampleJob job = (SkyUpsampleJob) {
+		.input = input,
+		.texels = (F32x4*) lowRes->ptrNonConst,
+		.lowW = lowW
+	};
+
+	gotoIfError3(clean, Parallel_for(lowH, SkyUpsample_renderRow, &job, e_rr))
+
+	if(evaluated)
+		*evaluated = (U64) AtomicI64_load(&job.evaluated);
+
+clean:
+
+	if(!s_uccess && ownsLowRes)
+		Buffer_freex(lowRes);
+
+	return s_uccess;
+}
+
+typedef struct SkyUpsampleCompositeJob {
+	const SkyUpsampleInput *input;
+	const F32x4 *texels;
+	F32x4 *target;
+	U32 lowW, lowH;
+} SkyUpsampleCompositeJob;
+
+static void SkyUpsample_compositeRow(void *userData, U64 row, U64 threadId) {
+
+	(void) threadId;
+
+	const SkyUpsampleCompositeJob *job = (const SkyUpsampleCompositeJob*) userData;
+	const SkyUpsampleInput *input = job->input;
+
+	const U32 y = (U32) row;
+	const F32 invFactor = 1.f / input->factor;
+
+	//Position in low res pixels, relative to the center of the first one (clamped at the edges).
+	//It's >= -0.5, so truncating it + 1 floors it.
+
+	const F32 fy = (y + 0.5f) * invFactor - 0.5f;
+	const I32 iy = (I32)(fy + 1) - 1;
+	const F32 ty = fy - (F32) iy;
+
+	const U32 ly0 = (U32) I32_clamp(iy, 0, (I32) job->lowH - 1);
+	const U32 ly1 = (U32) I32_clamp(iy + 1, 0, (I32) job->lowH - 1);
+
+	const F32x4 *rows[2] = { job->texels + (U64) ly0 * job->lowW, job->texels + (U64) ly1 * job->lowW };
+	F32x4 *target = job->target + (U64) y * input->w;
+
+	for(U32 x = 0; x < input->w; ++x) {
+
+		if(!SkyUpsample_isMiss(input, x, y))
+			continue;
+
+		const F32 fx = (x + 0.5f) * invFactor - 0.5f;
+		const I32 ix = (I32)(fx + 1) - 1;
+		const F32 tx = fx - (F32) ix;
+
+		const U32 lx0 = (U32) I32_clamp(ix, 0, (I32) job->lowW - 1);
+		const U32 lx1 = (U32) I32_clamp(ix + 1, 0, (I32) job->lowW - 1);
+
+		const F32x4 taps[4] = { rows[0][lx0], rows[0][lx1], rows[1][lx0], rows[1][lx1] };
+		const F32 weights[4] = { (1 - tx) * (1 - ty), tx * (1 - ty), (1 - tx) * ty, tx * ty };
+
+		//w is the validity of the tap, so the sum of w is the total weight
+
+		F32x4 sum = F32x4_zero();
+
+		for(U8 i = 0; i < 4; ++i)
+			sum = F32x4_add(sum, F32x4_mul(taps[i], F32x4_xxxx4(weights[i] * F32x4_w(taps[i]))));
+
+		F32x4 color = F32x4_div(sum, F32x4_xxxx4(F32x4_w(sum)));
+		F32x4_setW(&color, 0);
+		target[x] = color;
+	}
+}
+
+Bool SkyUpsample_composite(const SkyUpsampleInput *input, Buffer lowRes, Buffer target, Error *e_rr) {
+
+	Bool s_uccess = true;
+
+	gotoIfError3(clean, SkyUpsample_validate(input, e_rr))
+
+	const U32 lowW = SkyUpsample_getLowResSize(input->w, input->factor);
+	const U32 lowH = SkyUpsample_getLowResSize(input->h, input->factor);
+
+	if(Buffer_length(lowRes) < sizeof(F32x4) * lowW * lowH)
+		retError(clean, Error_outOfBounds(
+			1, Buffer_length(lowRes), sizeof(F32x4) * lowW * lowH, "SkyUpsample_composite()::lowRes is too small"
+		))
+
+	if(Buffer_length(target) < sizeof(F32x4) * input->w * input->h)
+		retError(clean, Error_outOfBounds(
+			2, Buffer_length(target), sizeof(F32x4) * input->w * input->h, "SkyUpsample_composite()::target is too small"
+		))
+
+	SkyUpsampleCompositeJob job = (SkyUpsampleCompositeJob) {
+		.input = input,
+		.texels = (const F32x4*) lowRes.ptr,
+		.target = (F32x4*) target.ptrNonConst,
+		.lowW = lowW,
+		.lowH = lowH
+	};
+
+	gotoIfError3(clean, Parallel_for(input->h, SkyUpsample_compositeRow, &job, e_rr))
+
+clean:
+	return s_uccess;
+}
@@ -0,0 +1,76 @@
+/* OxC3/RT Core(Oxsomi core 3/RT Core), a general framework for raytracing applications.
+*  Copyright (C) 2023 - 2024 Oxsomi / Nielsbishere (Niels Brunekreef)
+*
+*  This program is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program. If not, see https://github.com/Oxsomi/core3/blob/main/LICENSE.
+*  Be aware that GPL3 requires closed source products to be GPL3 too if released to the public.
+*  To prevent this a separate license will have to be requested at contact@osomi.net for a premium;
+*  This is called dual licensing.
+*/
+#pragma once
+#include "atmosphere_lut.h"
+#include "camera.h"
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+//The sky is low frequency, so evaluating the atmosphere for every miss pixel (like mainMiss) is mostly wasted.
+//This renders it at 1 / factor of the resolution into its own target and then upsamples it under the geometry.
+//
+//A low res pixel is only evaluated if its footprint contains a miss, the others are marked invalid (w = 0).
+//It's evaluated at the average of those misses, so it never samples directions that are behind geometry.
+//The upsample is bilinear, but weighted by that mask (a bilateral filter on hit / miss), so pixels next to geometry
+//only use low res pixels that saw sky. The low res pixel that contains a miss pixel is always valid, so every miss
+//pixel gets a value. Hit pixels in the target are left alone.
+//
+//factor = 1 evaluates every miss pixel at full resolution, which is the reference.
+//
+//getSky can replace the atmosphere and camera, e.g. to evaluate the miss shader of a raytracer (CpuRaytracer).
+
+#define SkyUpsample_defaultFactor 4
+#define SkyUpsample_maxFactor 16
+
+typedef F32x4 (*SkyUpsampleFunction)(const void *userData, F32 x, F32 y);	//x and y are in pixels, centers are at + 0.5
+
+typedef struct SkyUpsampleInput {
+
+	const Atmosphere *atmos;			//Not needed with getSky
+	const AtmosphereLUT *lut;			//NULL or empty = ray march (Atmosphere_getContribution)
+	const CameraMatrices *camera;		//Not needed with getSky
+
+	SkyUpsampleFunction getSky;			//Optional, color of the sky at a full res pixel position instead of the atmosphere
+	const void *userData;				//Passed to getSky
+
+	Buffer hitT;						//F32[w * h], < 0 is a miss (like CpuRaytracerPayload::hitT); empty = all sky
+
+	U32 w, h;
+	U32 factor;							//[1, SkyUpsample_maxFactor]
+	U32 padding;
+
+} SkyUpsampleInput;
+
+U32 SkyUpsample_getLowResSize(U32 size, U32 factor);
+
+//Renders the sky at low resolution into lowRes (F32x4[lowW * lowH], allocated), w is 1 if valid and 0 if skipped.
+//evaluated is optional and set to the number of low res pixels that were evaluated.
+
+Bool SkyUpsample_renderx(const SkyUpsampleInput *input, Buffer *lowRes, U64 *evaluated, Error *e_rr);
+
+//Writes the upsampled sky to every miss pixel of target (F32x4[w * h])
+
+Bool SkyUpsample_composite(const SkyUpsampleInput *input, Buffer lowRes, Buffer target, Error *e_rr);
+
+#ifdef __cplusplus
+	}
+#endif
@@ -51,10 +51,79 @@
 #include "graphics/generic/blas.h"
 #include "graphics/generic/tlas.h"
 #include "atmos_helper.h"
+#include "cpu_raytracer.h"
+#include "atmosphere_lut.h"
+#include "sky_cache.h"
+#include "camera.h"
+#include "frame_stats.h"
+#include "parallel.h"
+#include "pipeline_cache.h"
+#include "asset_loader.h"
+#include "render_target_pool.h"
+#include "frame_graph.h"
 #include "types/math/math.h"
 
 //Globals
 
+typedef enum EScopes {					//Per window command list
+	EScopes_ClearTarget,
+	EScopes_RaytracingTest,
+	EScopes_RaytracingPipelineTest,
+	EScopes_GraphicsTest,
+	EScopes_GraphicsTestMSAA,
+	EScopes_Copy,
+	EScopes_Copy2,
+	EScopes_Clear,
+	EScopes_Copy3,
+	EScopes_Count
+} EScopes;
+
+//Benchmark mode timers; nested (draw includes record and submit).
+//All of them are CPU time; the scopes are the time it took to record them, not how long the GPU took to run them
+//(the command list API has no timestamp queries).
+
+typedef enum ETestTimer {
+	ETestTimer_Frame,
+	ETestTimer_Update,
+	ETestTimer_Draw,
+	ETestTimer_Record,
+	ETestTimer_Submit,
+	ETestTimer_Scopes,
+	ETestTimer_Count = ETestTimer_Scopes + EScopes_Count
+} ETestTimer;
+
+static const C8 *ETestTimer_names[ETestTimer_Count] = {
+	"frame", "onManagerUpdate", "onManagerDraw", "recordCommands", "submitCommands",
+	"recordScope/ClearTarget", "recordScope/RaytracingTest", "recordScope/RaytracingPipelineTest",
+	"recordScope/GraphicsTest", "recordScope/GraphicsTestMSAA",
+	"recordScope/Copy", "recordScope/Copy2", "recordScope/Clear", "recordScope/Copy3"
+};
+
+#define TestWindowManager_maxViews 16		//Views per window (views=N), all rendered by the same submit
+#define TestWindowManager_maxCameras 64		//Camera slots per frame, one per view of every window
+#define TestWindowManager_maxTargetSize 16384		//Multi-view render targets grow with the view count
+#define TestWindowManager_assetThreads 2
+#define TestWindowManager_assetStagingBudget (64 << 20)
+#define TestWindowManager_mipStreamBudget (4 << 20)		//Bytes of streamed mips uploaded per frame
+
+//Textures are loaded in the background and start out as a placeholder.
+//Asset ids in the loader match this enum; CrabbageCompressed is only queued with BCn support.
+
+typedef enum ETestAsset {
+	ETestAsset_Crabbage,
+	ETestAsset_CrabbageCompressed,
+	ETestAsset_Count
+} ETestAsset;
+
+static const C8 *ETestAsset_names[ETestAsset_Count] = { "Crabbage.bmp 600x", "Crabbage_mips.dds" };
+
+typedef struct TestTextureStream {
+	Asset *asset;					//Not released until the last mip is uploaded
+	ETestAsset id;
+	U64 nextMip;
+	U64 residentMip;				//Finest mip that's on the GPU, U64_MAX if none
+} TestTextureStream;
+
 typedef struct TestWindowManager {
 
 	F32x4 camPos;
@@ -70,14 +139,31 @@ typedef struct TestWindowManager {
 	DeviceBufferRef *indirectDrawBuffer;			//sizeof(DrawCallIndexed) * 2
 	DeviceBufferRef *indirectDispatchBuffer;		//sizeof(Dispatch) * 2
 	DeviceBufferRef *deviceBuffer;					//Constant F32x3 for animating color
-	DeviceBufferRef *viewProjMatrices;				//F32x4x4 (view, proj, viewProj)(normal, inverse)
+	DeviceBufferRef *viewProjMatrices;				//CameraMatrices[2][maxCameras], CPU backed, alternates per frame
+
+	DeviceTextureRef *crabbage2049x, *crabbageCompressed;		//Placeholders until their asset is uploaded
+	DeviceTextureRef *transmittanceLUT, *multiScatteringLUT;		//RGBA16f copies of atmosphereLut
+	DeviceTextureRef *skyCacheTexture;				//RGBA16f copy of skyCache, only updated when it's re-rendered
 
-	DeviceTextureRef *crabbage2049x, *crabbageCompressed;
+	AtmosphereLUT atmosphereLut;					//Sky LUTs for Atmosphere_earth, cached on disk
+	AssetLoader assets;
+	TestTextureStream textureStreams[ETestAsset_Count];
+	RenderTargetPool renderTargets;					//Window render targets, so resizing doesn't reallocate them
+	SkyCache skyCache;								//Sky radiance, re-rendered when the sun moved enough
+	F32x4 skyHistorySunDir;							//Sun of the last frame that went into the windows' sky history
 
 	BLASRef *blas;									//If rt is on, the BLAS of a simple plane
 	BLASRef *blasAABB;								//If rt is on, the BLAS of a few boxes
 	TLASRef *tlas;									//If rt is on, contains the scene's AS
 
+	CpuBLAS cpuBlas;								//If cpu rt is on, CPU version of blas
+	CpuTLAS cpuTlas;								//If cpu rt is on, CPU version of tlas
+	CpuPathTracer cpuPathTracer;					//If cpu rt and pathTracer= are on, traces instead of the CPU raytracer
+	CpuRaytracerStats cpuStatsSinceLastSecond;
+
+	FrameStats frameStats;							//Only if benchmark mode is on
+	Ns lastDrawStart;
+
 	PipelineRef *prepareIndirectPipeline, *indirectCompute, *inlineRaytracingTest;
 	PipelineRef *graphicsTest, *graphicsDepthTest, *graphicsDepthTestMSAA;
 	PipelineRef *raytracingPipelineTest;
@@ -90,10 +176,14 @@ typedef struct TestWindowManager {
 	F64 timeSinceLastSecond, time, timeSinceLastRender, realTime;
 
 	F32 timeStep;
+	U32 viewCount, viewColumns;						//Views are tiled in the render target, viewColumns per row
 	Bool renderVirtual;
 	Bool enableRtPipeline;
 	Bool initialized;
 	Bool enableRtInline;
+	Bool enableRtCpu;
+	Bool benchmark;
+	Bool assetsReported;
 
 	Ns lastTime;
 
@@ -109,8 +199,34 @@ typedef struct TestWindow {
 	CommandListRef *commandList;
 	RefPtr *swapchain;					//Can be either SwapchainRef (non virtual) or RenderTextureRef (virtual)
 
+	//Acquired from the pool; they can be bigger than the window, which only renders into the top left.
+	//With multiple views, renderTexture and depthStencil hold a tile of the window's size per view.
+
 	DepthStencilRef *depthStencil, *depthStencilMSAA;
 	RenderTextureRef *renderTexture, *renderTextureMSAA, *renderTextureMSAATarget;
+	U16 targetWidth, targetHeight;		//Size of all views the targets were acquired for
+
+	//If rt pipeline is on and raySamples= or lightSamples= are set: RGBA16f average of the jittered misses over frames
+	//(w = frames, 0 for hits), same size as renderTexture. Its contents are unknown until the next frame resets it.
+
+	RenderTextureRef *skyHistory;
+	Bool resetSkyHistory;
+
+	FrameGraph frameGraph;				//Passes of the last recording
+	U64 frameGraphSchedule;				//FrameGraph_getScheduleHash of the last printed schedule
+
+	Buffer cpuRenderTarget;				//If cpu rt is on, RGBA8 or BGRA8 output of the CPU raytracer (see writeImage=)
+	Accumulation cpuAccumulation;		//If cpu rt and accumulation are on, mean of the CPU raytracer's samples
+	Buffer cpuRadiance, cpuHitT;		//If cpu rt and pathTracer= or skyFactor= are on, scratch of the CPU raytracer
+
+	//Commands are recorded by onManagerDraw (in parallel with other windows) after onResize requested it
+
+	Bool needsRecording;
+	Bool wasRecorded;					//This frame, so scopeTimes are new
+	Bool recordFailed;
+	Error recordError;
+
+	Ns scopeTimes[EScopes_Count];		//CPU time to record each scope in the last recording, only if benchmark mode is on
 
 } TestWindow;
 
@@ -119,6 +235,8 @@ void onUpdate(Window *w, F64 dt);
 void onButton(Window *w, InputDevice *device, InputHandle handle, Bool isDown);
 void onAxis(Window *w, InputDevice *device, InputHandle handle, F32 axis);
 void onResize(Window *w);
+Bool TestWindow_recordCommands(Window *w, Error *e_rr);
+static void TestWindow_recordJob(void *userData, U64 jobId, U64 threadId);
 void onCreate(Window *w);
 void onDestroy(Window *w);
 void onCursorMove(Window *w);
@@ -298,6 +416,7 @@ void onUpdate(Window *w, F64 dt) {
 void onManagerUpdate(WindowManager *windowManager, F64 dt) {
 
 	TestWindowManager *tw = (TestWindowManager*) windowManager->extendedData.ptr;
+	const Ns start = Time_now();
 
 	const F64 prevTime = tw->realTime;
 	tw->time += (tw->renderVirtual ? 1 / targetFps : dt) * tw->timeStep;		//Time for rendering
@@ -307,6 +426,19 @@ void onManagerUpdate(WindowManager *windowManager, F64 dt) {
 
 		Log_debugLnx("%"PRIu32" fps", (U32)F64_round(tw->framesSinceLastSecond / tw->timeSinceLastSecond));
 
+		const CpuRaytracerStats cpuStats = tw->cpuStatsSinceLastSecond;
+
+		if(tw->enableRtCpu && cpuStats.time)
+			Log_debugLnx(
+				"CPU raytracing: %.2f Mrays/s (%"PRIu64" rays, %"PRIu64" hits in %.2fms)",
+				cpuStats.rays / ((F64)cpuStats.time / SECOND) / 1e6,
+				cpuStats.rays,
+				cpuStats.hits,
+				(F64)cpuStats.time * 1e3 / SECOND
+			);
+
+		tw->cpuStatsSinceLastSecond = (CpuRaytracerStats) { 0 };
+
 		tw->framesSinceLastSecond = 0;
 		tw->timeSinceLastSecond = 0;
 	}
@@ -317,10 +449,331 @@ void onManagerUpdate(WindowManager *windowManager, F64 dt) {
 		tw->lastTime += (Ns)(dt * SECOND * tw->timeStep);
 
 	tw->JD = AtmosHelper_getJulianDate(tw->lastTime);
+
+	if(tw->benchmark)
+		FrameStats_add(&tw->frameStats, ETestTimer_Update, Time_now() - start);
 }
 
 void onDraw(Window *w) { (void)w; }
 
+//Benchmark mode, e.g. rt_core_test benchmark=600 warmup=10 report=rt_core_benchmark.json windows=1 threads=0
+//Forces renderVirtual (so frames advance by 1 / targetFps) and times every frame after warmup.
+//Once enough frames are rendered, the json report is written and the windows are closed.
+//windows creates multiple virtual windows and threads limits the threads recording them (0 = all cores).
+//Commands are only recorded when needed (e.g. resize), so draw and submit are timed like any other frame;
+//recordScopes=1 re-records every frame instead, to time recording (recordCommands and recordScope/*).
+//views=N renders N views per window in the same submit (also outside of benchmarks), to compare against windows=N.
+//packets=0 makes the CPU raytracer trace per pixel instead of tracing every tile as a ray packet.
+//accumulate=N makes the CPU raytracer average up to N samples while nothing moves and then stop tracing
+//(0 = retrace every frame, which is the default for benchmarks).
+//raySamples=N lightSamples=N change the samples of the miss shader's atmosphere ray march (0 = Atmosphere::earth's),
+//which are then jittered per pixel and frame (see sky_temporal.h for the CPU side and its error).
+//mainRaygen then also writes misses, averaged over frames in a sky history; those skip the sky cache (skyCache=1).
+//quadraticSamples=1 spaces them quadratically instead of uniformly, which jittering few samples needs to converge
+//to the right sky (see Atmosphere_getSampleT).
+//forceCpuRaytracing=1 traces on the CPU even if the device supports raytracing.
+//moveCamera=1 makes the raster views (and the CPU path tracer) follow the camera position (camPos, moved by input).
+//skyCache=1 makes misses sample a cubemap of the sky that's only re-rendered when the sun moved (see sky_cache.h),
+//instead of evaluating the atmosphere with the LUTs per miss.
+//writeImage=path writes the CPU raytracer's output (as an RGBA8 or BGRA8 DDS) once the first window closes,
+//so headless runs (like benchmarks) can be checked too.
+//pathTracer=1 replaces the CPU raytracer with the (wavefront) CPU path tracer, which follows bounces=N diffuse bounces
+//(default 4, 0 = direct light only). Its paths are noisy, so it's best combined with accumulate=N.
+//skyFactor=N makes the CPU raytracer write the sky for misses, evaluated at 1 / N of the resolution and upsampled under
+//the geometry (see sky_upsample.h; N <= 16, default 1 = don't write it). Only the CPU raytracer does this; its rays are
+//orthographic like mainRaygen's, so every miss sees the same sky and the result matches N = 1 (it measures the cost).
+
+U64 benchmarkFrames = 0;
+U64 benchmarkWarmup = 10;
+U64 benchmarkWindows = 1;
+Bool benchmarkRecordScopes = false;
+U64 testViews = 1;
+Bool cpuRayPackets = true;
+U64 cpuAccumulation = Accumulation_defaultTargetSamples;
+Bool cpuAccumulationSet = false;
+Bool cpuPathTracing = false;
+U64 cpuPathBounces = 4;
+U64 cpuSkyFactor = 1;
+Bool moveCamera = false;
+Bool useSkyCache = false;
+U64 atmosphereRaySamples = 0;
+U64 atmosphereLightSamples = 0;
+Bool atmosphereQuadraticSamples = false;
+const C8 *benchmarkReport = "rt_core_benchmark.json";
+const C8 *cpuImagePath = NULL;
+Bool cpuImageWritten = false;
+
+static void TestWindowManager_finishBenchmark(WindowManager *windowManager) {
+
+	TestWindowManager *twm = (TestWindowManager*) windowManager->extendedData.ptr;
+
+	if(!FrameStats_isDone(&twm->frameStats))
+		return;
+
+	Error err = Error_none(), *e_rr = &err;
+	Bool s_uccess = true;
+
+	twm->benchmark = false;
+
+	Log_debugLnx("Benchmark finished (%"PRIu64" frames), writing %s", twm->frameStats.frame, benchmarkReport);
+
+	gotoIfError3(clean, FrameStats_writeReportx(
+		&twm->frameStats, ETestTimer_names, CharString_createRefCStrConst(benchmarkReport), e_rr
+	))
+
+	//Cost per view, to see how batching views scales compared to a submit (or window) per view
+
+	const FrameStatsSummary frame = FrameStats_summarize(&twm->frameStats, ETestTimer_Frame);
+	const U64 views = (U64) twm->viewCount * windowManager->windows.length;
+
+	Log_debugLnx(
+		"%"PRIu64" view(s) (%"PRIu32" per window): median frame %.3fms, %.3fms per view",
+		views, twm->viewCount, frame.median / 1e6, frame.median / 1e6 / views
+	);
+
+clean:
+	if(!s_uccess)
+		Error_printx(err, ELogLevel_Error, ELogOptions_Default);
+
+	for(U64 i = 0; i < windowManager->windows.length; ++i)
+		Window_requestClose(windowManager->windows.ptr[i]);
+}
+
+//Replaces one of the test textures; every window has to re-record, since recorded commands still reference the old one
+
+static Bool TestWindowManager_swapTexture(
+	WindowManager *windowManager,
+	ETestAsset id,
+	DeviceTextureRef **texture,
+	Error *e_rr
+) {
+
+	TestWindowManager *twm = (TestWindowManager*) windowManager->extendedData.ptr;
+	Bool s_uccess = true;
+
+	//Oops, DDS (at least BCn compression) is unsupported, let's just pretend our existing crabbage is the big crabbage
+
+	const Bool hasBCn = !!(GraphicsDeviceRef_ptr(twm->device)->info.capabilities.dataTypes & EGraphicsDataTypes_BCn);
+
+	if(id == ETestAsset_Crabbage && !hasBCn) {
+		gotoIfError2(clean, DeviceTextureRef_inc(*texture))
+		DeviceTextureRef_dec(&twm->crabbageCompressed);
+		twm->crabbageCompressed = *texture;
+	}
+
+	DeviceTextureRef **target = id == ETestAsset_Crabbage ? &twm->crabbage2049x : &twm->crabbageCompressed;
+	DeviceTextureRef_dec(target);
+	*target = *texture;
+	*texture = NULL;
+
+	for(U64 handle = 0; handle < windowManager->windows.length; ++handle)
+		((TestWindow*) windowManager->windows.ptr[handle]->extendedData.ptr)->needsRecording = true;
+
+clean:
+	return s_uccess;
+}
+
+//Textures only have a single mip, so a mip chain (from a DDS or generated for a BMP) is streamed as a texture per mip;
+//smallest first.
+//Each frame, a stream uploads only the finest mip that fits what's left of the budget (the coarsest remaining one
+//always goes if nothing was uploaded yet, otherwise big mips never would). The coarser mips it skipped are just freed,
+//so there's at most one texture created (and one re-record) per stream per frame.
+//Only the resident mip is kept on the GPU, so memory is bound by the mips that are still streaming.
+
+static Bool TestWindowManager_streamMips(WindowManager *windowManager, Error *e_rr) {
+
+	TestWindowManager *twm = (TestWindowManager*) windowManager->extendedData.ptr;
+
+	Bool s_uccess = true;
+	DeviceTextureRef *texture = NULL;
+	U64 uploaded = 0;
+
+	//Streams share the budget
+
+	for(U64 i = 0; i < ETestAsset_Count; ++i) {
+
+		TestTextureStream *stream = &twm->textureStreams[i];
+		Asset *asset = stream->asset;
+
+		if(!asset)
+			continue;
+
+		ListSubResourceData *mips = &asset->ddsData;		//2D and a single layer, so subresources are mips
+		U64 mip = stream->nextMip;
+
+		if(uploaded && uploaded + Buffer_length(mips->ptr[mip].data) > TestWindowManager_mipStreamBudget)
+			continue;
+
+		while(mip && uploaded + Buffer_length(mips->ptr[mip - 1].data) <= TestWindowManager_mipStreamBudget)
+			--mip;
+
+		Buffer *data = &mips->ptrNonConst[mip].data;
+		const U16 w = (U16) U64_max(asset->ddsInfo.w >> mip, 1);
+		const U16 h = (U16) U64_max(asset->ddsInfo.h >> mip, 1);
+
+		gotoIfError2(clean, GraphicsDeviceRef_createTexture(
+			twm->device,
+			ETextureType_2D,
+			asset->ddsInfo.textureFormatId,
+			EGraphicsResourceFlag_ShaderReadBindless,
+			w, h, 1,
+			NULL,
+			CharString_createRefCStrConst(ETestAsset_names[stream->id]),
+			data,
+			&texture
+		))
+
+		gotoIfError3(clean, TestWindowManager_swapTexture(windowManager, stream->id, &texture, e_rr))
+
+		uploaded += Buffer_length(*data);
+		AssetLoader_addUploaded(&twm->assets, Buffer_length(*data));
+		stream->residentMip = mip;
+
+		Log_debugLnx(
+			"%s resident mip: %"PRIu64" (%"PRIu16"x%"PRIu16"), skipped %"PRIu64" coarser mip(s)",
+			ETestAsset_names[stream->id], mip, w, h, stream->nextMip - mip
+		);
+
+		for(U64 j = mip; j <= stream->nextMip; ++j)
+			Buffer_freex(&mips->ptrNonConst[j].data);
+
+		if(!mip) {
+			AssetLoader_releasex(&twm->assets, asset);
+			stream->asset = NULL;
+			continue;
+		}
+
+		stream->nextMip = mip - 1;
+	}
+
+clean:
+	DeviceTextureRef_dec(&texture);
+	return s_uccess;
+}
+
+//Swaps a placeholder for the real texture once its asset finished loading (or starts streaming its mips).
+//Only one new asset per frame, so a burst of finished assets doesn't cause a hitch.
+
+static Bool TestWindowManager_uploadAssets(WindowManager *windowManager, Error *e_rr) {
+
+	TestWindowManager *twm = (TestWindowManager*) windowManager->extendedData.ptr;
+	Bool s_uccess = true;
+	DeviceTextureRef *texture = NULL;
+	Asset *asset = AssetLoader_poll(&twm->assets);
+
+	if(!asset)
+		goto stream;
+
+	//Failing to load an asset isn't fatal, the placeholder simply stays
+
+	if(AtomicI64_load(&asset->state) == EAssetState_Failed) {
+		Error_printx(asset->error, ELogLevel_Warn, ELogOptions_Default);
+		goto stream;
+	}
+
+	const ETestAsset id = (ETestAsset) (asset - twm->assets.assets);
+	const CharString name = CharString_createRefCStrConst(ETestAsset_names[id]);
+
+	//BMPs come with generated mips, so everything is uploaded like a DDS
+
+	const DDSInfo info = asset->ddsInfo;
+
+	if(info.type == ETextureType_2D && info.l == 1 && info.mips > 1) {
+
+		//The asset is released once its last mip is uploaded
+
+		twm->textureStreams[id] = (TestTextureStream) {
+			.asset = asset, .id = id, .nextMip = info.mips - 1, .residentMip = U64_MAX
+		};
+
+		asset = NULL;
+		goto stream;
+	}
+
+	gotoIfError2(clean, GraphicsDeviceRef_createTexture(
+		twm->device,
+		info.type,
+		info.textureFormatId,
+		EGraphicsResourceFlag_ShaderReadBindless,
+		(U16)info.w, (U16)info.h, (U16)info.l,
+		NULL,
+		name,
+		&asset->ddsData.ptrNonConst[0].data,
+		&texture
+	))
+
+	AssetLoader_addUploaded(&twm->assets, Buffer_length(asset->ddsData.ptr[0].data));
+
+	gotoIfError3(clean, TestWindowManager_swapTexture(windowManager, id, &texture, e_rr))
+
+	//Mips are streamed once per frame, after the new asset so one that just started streaming can use the budget too
+
+stream:
+	gotoIfError3(clean, TestWindowManager_streamMips(windowManager, e_rr))
+
+clean:
+
+	AssetLoader_releasex(&twm->assets, asset);
+	DeviceTextureRef_dec(&texture);
+
+	//Decoders reference the file where they can, so decode copies should only be what had to be converted
+
+	Bool isStreaming = false;
+
+	for(U64 i = 0; i < ETestAsset_Count; ++i)
+		isStreaming |= !!twm->textureStreams[i].asset;
+
+	if(s_uccess && !twm->assetsReported && AssetLoader_isDone(&twm->assets) && !isStreaming) {
+
+		const AssetLoaderStats stats = AssetLoader_getStats(&twm->assets);
+
+		Log_debugLnx(
+			"Assets loaded; copied %fMiB from files, %fMiB by decoding, %fMiB into staging, peak %fMiB staged",
+			(F64)stats.bytesRead / (1 << 20),
+			(F64)stats.bytesDecoded / (1 << 20),
+			(F64)stats.bytesUploaded / (1 << 20),
+			(F64)stats.peakStaged / (1 << 20)
+		);
+
+		twm->assetsReported = true;
+	}
+
+	return s_uccess;
+}
+
+//Multi-view (views=N) renders every view of a window in the same submit, instead of a submit per view.
+//Views are tiled in a grid of viewColumns x rows of the window's size; view 0 is the top left one (the one presented).
+//Returns the size of the whole grid.
+
+static I32x2 TestWindowManager_getViewGrid(const TestWindowManager *twm, I32x2 viewSize) {
+	const U32 rows = (twm->viewCount + twm->viewColumns - 1) / twm->viewColumns;
+	return I32x2_mul(viewSize, I32x2_create2((I32) twm->viewColumns, (I32) rows));
+}
+
+//Views orbit the origin around the Y axis, view 0 is the camera itself
+
+static Camera TestWindowManager_getViewCamera(const TestWindowManager *twm, const Camera *camera, U32 view) {
+
+	const F32 angle = 2 * F32_PI * view / twm->viewCount;
+	const F32 c = F32_cos(angle), s = F32_sin(angle);
+
+	Camera result = *camera;
+
+	result.pos = F32x4_create3(
+		F32x4_x(camera->pos) * c + F32x4_z(camera->pos) * s,
+		F32x4_y(camera->pos),
+		F32x4_z(camera->pos) * c - F32x4_x(camera->pos) * s
+	);
+
+	result.dir = F32x4_create3(
+		F32x4_x(camera->dir) * c + F32x4_z(camera->dir) * s,
+		F32x4_y(camera->dir),
+		F32x4_z(camera->dir) * c - F32x4_x(camera->dir) * s
+	);
+
+	return result;
+}
+
 void onManagerDraw(WindowManager *windowManager) {
 	
 	TestWindowManager *twm = (TestWindowManager*) windowManager->extendedData.ptr;
@@ -329,6 +782,13 @@ void onManagerDraw(WindowManager *windowManager) {
 	Error err = Error_none(), *e_rr = &err;
 	Bool s_uccess = true;
 
+	const Ns drawStart = Time_now();
+
+	if(twm->benchmark && twm->lastDrawStart)
+		FrameStats_add(&twm->frameStats, ETestTimer_Frame, drawStart - twm->lastDrawStart);
+
+	twm->lastDrawStart = drawStart;
+
 	gotoIfError2(clean, ListCommandListRef_clear(&twm->commandLists))
 	gotoIfError2(clean, ListSwapchainRef_clear(&twm->swapchains))
 	gotoIfError2(clean, ListCommandListRef_reservex(&twm->commandLists, windowManager->windows.length + 1))
@@ -340,10 +800,39 @@ void onManagerDraw(WindowManager *windowManager) {
 	}
 
 	gotoIfError2(clean, ListCommandListRef_pushBackx(&twm->commandLists, twm->prepCommandList))
+	gotoIfError3(clean, TestWindowManager_uploadAssets(windowManager, e_rr))
+	RenderTargetPool_nextFrame(&twm->renderTargets);
 
-	RenderTextureRef *renderTex = NULL;
+	RenderTextureRef *renderTex = NULL, *skyHistory = NULL;
+	Bool resetSkyHistory = false;
+	I32x2 renderSize = I32x2_zero();
 	U32 orientation = 0;
 
+	//Camera matrices are computed once per view here instead of per pixel (raygen) or per frame on the GPU.
+	//The buffer holds two frames of cameras; this frame writes one half while the last frame may still read the other.
+	//Runtime data is shared by all windows, so (like renderTargetWrite) it points shaders at the first window's slots.
+	//A window's views are consecutive, shaders index them by dispatch z (or instance for raster).
+
+	DeviceBufferRef *viewProjMatricesRef = twm->viewProjMatrices;
+	DeviceBuffer *viewProjMatrices = DeviceBufferRef_ptr(viewProjMatricesRef);
+
+	const U64 cameraHalf = GraphicsDeviceRef_ptr(twm->device)->submitId & 1;
+	const U64 cameraStart = cameraHalf * TestWindowManager_maxCameras;
+	CameraMatrices *cameras = (CameraMatrices*) viewProjMatrices->cpuData.ptrNonConst + cameraStart;
+
+	U64 cameraCount = 0, firstCamera = U64_MAX;
+
+	//The camera is fixed (like the original indirect_prepare.hlsl) unless moveCamera=1 lets it follow camPos
+
+	const Camera camera = (Camera) {
+		.pos = F32x4_add(F32x4_create3(0, 0, 2), moveCamera ? twm->camPos : F32x4_zero()),
+		.dir = F32x4_create3(0, 0, -1),
+		.up = F32x4_create3(0, 1, 0),
+		.fovYDeg = 120,
+		.nearPlane = 0.1f,
+		.farPlane = 100
+	};
+
 	for(U64 handle = 0; handle < windowManager->windows.length; ++handle) {
 
 		Window *w = windowManager->windows.ptr[handle];
@@ -355,8 +844,37 @@ void onManagerDraw(WindowManager *windowManager) {
 			CommandListRef *cmd = tw->commandList;
 			RefPtr *swap = tw->swapchain;
 
-			if(!renderTex)
+			if(!renderTex) {
 				renderTex = tw->renderTexture;
+				renderSize = w->size;
+				skyHistory = tw->skyHistory;
+				resetSkyHistory = tw->resetSkyHistory;
+				tw->resetSkyHistory = false;
+			}
+
+			const U64 slot = handle * twm->viewCount;
+
+			if(slot + twm->viewCount <= TestWindowManager_maxCameras) {
+
+				const F32 aspect = (F32) I32x2_x(w->size) / (F32) I32x2_y(w->size);
+				const U32 windowOrientation =
+					swap->typeId == (ETypeId) EGraphicsTypeId_Swapchain ? SwapchainRef_ptr(swap)->orientation : 0;
+
+				for(U32 view = 0; view < twm->viewCount; ++view) {
+					const Camera viewCamera = TestWindowManager_getViewCamera(twm, &camera, view);
+					cameras[slot + view] = Camera_getMatrices(&viewCamera, aspect, windowOrientation);
+				}
+
+				cameraCount = slot + twm->viewCount;
+
+				if(firstCamera == U64_MAX)
+					firstCamera = slot;
+			}
+
+			//Commands are normally only recorded on resize, recordScopes=1 re-records them to time every scope
+
+			if(twm->benchmark && benchmarkRecordScopes)
+				tw->needsRecording = true;
 
 			gotoIfError2(clean, ListCommandListRef_pushBackx(&twm->commandLists, cmd))
 
@@ -370,14 +888,42 @@ void onManagerDraw(WindowManager *windowManager) {
 	if(twm->commandLists.length == 1)		//No windows to update, only root command list (not important without viewports)
 		return;
 
+	//Every window has its own command list, so they can be recorded on worker threads.
+	//The order they're submitted in (after the root command lists) is still decided above.
+
+	const Ns recordStart = Time_now();
+	gotoIfError3(clean, Parallel_for(windowManager->windows.length, TestWindow_recordJob, windowManager, e_rr))
+
+	if(twm->benchmark)
+		FrameStats_add(&twm->frameStats, ETestTimer_Record, Time_now() - recordStart);
+
+	for(U64 handle = 0; handle < windowManager->windows.length; ++handle) {
+
+		TestWindow *tw = (TestWindow*) windowManager->windows.ptr[handle]->extendedData.ptr;
+
+		if(tw->recordFailed) {
+			tw->recordFailed = false;
+			retError(clean, tw->recordError)
+		}
+
+		if(twm->benchmark && tw->wasRecorded)
+			for(U64 i = 0; i < EScopes_Count; ++i)
+				FrameStats_add(&twm->frameStats, ETestTimer_Scopes + i, tw->scopeTimes[i]);
+
+		tw->wasRecorded = false;
+	}
+
 	DeviceBuffer *deviceBuf = DeviceBufferRef_ptr(twm->deviceBuffer);
 
+	//Uploaded as U32s, so every member (or F32 of an array) is a slot of EResourceBinding (resource_bindings.hlsli).
+	//Both have to be kept in sync.
+
 	typedef struct RuntimeData {
 
 		U32 constantColorRead, constantColorWrite;
 		U32 indirectDrawWrite, indirectDispatchWrite;
 
-		U32 viewProjMatricesWrite, viewProjMatricesRead;
+		U32 viewProjMatricesOffset, viewProjMatricesRead;
 		U32 crabbage2049x, crabbageCompressed;
 
 		U32 sampler;
@@ -386,20 +932,60 @@ void onManagerDraw(WindowManager *windowManager) {
 		U32 orientation;
 
 		F32 skyDir[3];
-		U32 padding1;
+		U32 renderTargetSize;			//x | (y << 16), the render target can be bigger (see RenderTargetPool)
 
 		F32 camPos[3];
-		U32 padding2;
+		U32 views;						//viewCount | (viewColumns << 16)
+
+		U32 transmittanceLUT, multiScatteringLUT;
+		U32 skyCache;
+
+		U32 atmosphereSamples;			//raySamples | (quadraticSamples << 15) | (lightSamples << 16)
+		U32 frameId;
+
+		U32 skyHistoryWrite;
+		U32 resetSkyHistory;
 
 	} RuntimeData;
 
-	DeviceBuffer *viewProjMatrices = DeviceBufferRef_ptr(twm->viewProjMatrices);
+	if(cameraCount)
+		gotoIfError2(clean, DeviceBufferRef_markDirty(
+			viewProjMatricesRef, sizeof(CameraMatrices) * cameraStart, sizeof(CameraMatrices) * cameraCount
+		))
+
+	if(firstCamera == U64_MAX)
+		firstCamera = 0;
 
 	F32x2 amsterdam = F32x2_create2(4.897070f, 52.377956f);
 	F32x4 skyDir = F32x4_negate(AtmosHelper_getSunDir(twm->JD, amsterdam));
 
 	F32x4 camPos = twm->camPos;
 
+	//Only re-render the sky when the sun moved enough; the GPU copy is only uploaded if it was
+
+	Bool skyUpdated = false;
+
+	//Like SkyTemporal, the sky history starts over once the sun moved more than the threshold since the last frame
+
+	if(skyHistory) {
+		const F32 thresholdCos = F32_cos(SkyCache_defaultThresholdDeg * F32_DEG_TO_RAD);
+		resetSkyHistory |= F32x4_dot3(skyDir, twm->skyHistorySunDir) < thresholdCos;
+		twm->skyHistorySunDir = skyDir;
+	}
+
+	if(twm->skyCacheTexture)
+		gotoIfError3(clean, SkyCache_update(&twm->skyCache, skyDir, &twm->atmosphereLut, &skyUpdated, e_rr))
+
+	if(skyUpdated) {
+
+		const SkyCache *sky = &twm->skyCache;
+		gotoIfError3(clean, SkyCache_toF16(sky, DeviceTextureRef_ptr(twm->skyCacheTexture)->cpuData, e_rr))
+
+		gotoIfError2(clean, DeviceTextureRef_markDirty(
+			twm->skyCacheTexture, 0, 0, 0, (U16)(sky->size * 6), (U16) sky->size, 1
+		))
+	}
+
 	RuntimeData data = (RuntimeData) {
 
 		.constantColorRead = deviceBuf->readHandle,
@@ -407,7 +993,7 @@ void onManagerDraw(WindowManager *windowManager) {
 		.indirectDrawWrite = DeviceBufferRef_ptr(twm->indirectDrawBuffer)->writeHandle,
 		.indirectDispatchWrite = DeviceBufferRef_ptr(twm->indirectDispatchBuffer)->writeHandle,
 
-		.viewProjMatricesWrite = viewProjMatrices->writeHandle,
+		.viewProjMatricesOffset = (U32)(sizeof(CameraMatrices) * (cameraStart + firstCamera)),
 		.viewProjMatricesRead = viewProjMatrices->readHandle,
 		.crabbage2049x = TextureRef_getCurrReadHandle(twm->crabbage2049x, 0),
 		.crabbageCompressed = TextureRef_getCurrReadHandle(twm->crabbageCompressed, 0),
@@ -417,26 +1003,117 @@ void onManagerDraw(WindowManager *windowManager) {
 		.orientation = orientation,
 
 		.skyDir = { F32x4_x(skyDir), F32x4_y(skyDir), F32x4_z(skyDir) },
-		.camPos = { F32x4_x(camPos), F32x4_y(camPos), F32x4_z(camPos) }
+		.renderTargetSize = (U32) I32x2_x(renderSize) | ((U32) I32x2_y(renderSize) << 16),
+		.camPos = { F32x4_x(camPos), F32x4_y(camPos), F32x4_z(camPos) },
+		.views = twm->viewCount | (twm->viewColumns << 16),
+
+		.transmittanceLUT = TextureRef_getCurrReadHandle(twm->transmittanceLUT, 0),
+		.multiScatteringLUT = TextureRef_getCurrReadHandle(twm->multiScatteringLUT, 0),
+		.skyCache = twm->skyCacheTexture ? TextureRef_getCurrReadHandle(twm->skyCacheTexture, 0) : 0,
+
+		.atmosphereSamples =
+			(U32) U64_min(atmosphereRaySamples, 0x7FFF) | ((U32) atmosphereQuadraticSamples << 15) |
+			((U32) U64_min(atmosphereLightSamples, 0x7FFF) << 16),
+
+		.frameId = (U32) GraphicsDeviceRef_ptr(twm->device)->submitId,
+
+		.skyHistoryWrite = skyHistory ? TextureRef_getCurrWriteHandle(skyHistory, 0) : 0,
+		.resetSkyHistory = resetSkyHistory
 	};
 
 	if (twm->tlas)
 		data.tlasExt = TLASRef_ptr(twm->tlas)->handle;
 
+	//Trace the same scene on the CPU if the device can't (or if it's forced)
+
+	if(twm->enableRtCpu) {
+
+		CpuRaytracerInput cpuInput = (CpuRaytracerInput) {
+			.tlas = twm->cpuTlas.instanceCount ? &twm->cpuTlas : NULL,
+			.atmosphereLut = &twm->atmosphereLut,
+			.skyCache = twm->skyCacheTexture ? &twm->skyCache : NULL,
+			.camPos = camPos,
+			.skyDir = skyDir,
+			.clearColor = F32x4_create4(0.25f, 0.5f, 1, 1),
+			.time = (F32) twm->time,
+			.usePackets = cpuRayPackets,
+			.writeMiss = cpuSkyFactor > 1,
+			.skyFactor = (U32) cpuSkyFactor,
+			.pathTracer = twm->cpuPathTracer.scratch.ptr ? &twm->cpuPathTracer : NULL,
+			.camera = TestWindowManager_getViewCamera(twm, &camera, 0),
+			.bounces = (U32) U64_min(cpuPathBounces, U32_MAX),
+			.seed = (U32) GraphicsDeviceRef_ptr(twm->device)->submitId
+		};
+
+		for(U64 handle = 0; handle < windowManager->windows.length; ++handle) {
+
+			Window *w = windowManager->windows.ptr[handle];
+			TestWindow *tw = (TestWindow*) w->extendedData.ptr;
+
+			if(!I32x2_all(I32x2_gt(w->size, I32x2_zero())) || !tw->cpuRenderTarget.ptr)
+				continue;
+
+			cpuInput.orientation = w->orientation;
+			cpuInput.radiance = tw->cpuRadiance;
+			cpuInput.hitT = tw->cpuHitT;
+			cpuInput.accumulation = NULL;
+			cpuInput.skyDir = skyDir;
+
+			//Converged windows already hold their final image until the camera or sun moves.
+			//All samples are traced with the sun they started with, it's only reset once the sky cache would be.
+
+			if(tw->cpuAccumulation.mean.ptr) {
+
+				Accumulation *acc = &tw->cpuAccumulation;
+
+				if(!Accumulation_begin(acc, camPos, skyDir))
+					continue;
+
+				cpuInput.accumulation = acc;
+				cpuInput.skyDir = acc->sunDir;
+			}
+
+			gotoIfError3(clean, CpuRaytracer_render(
+				&cpuInput,
+				(U32) I32x2_x(w->size), (U32) I32x2_y(w->size), w->format != EWindowFormat_RGBA8,
+				tw->cpuRenderTarget,
+				&twm->cpuStatsSinceLastSecond,
+				e_rr
+			))
+
+			if(tw->cpuAccumulation.isConverged)
+				Log_debugLnx(
+					"CPU accumulation converged after %"PRIu32" samples (error %f)",
+					tw->cpuAccumulation.sampleCount, tw->cpuAccumulation.lastError
+				);
+		}
+	}
+
 	if(GraphicsDeviceRef_ptr(twm->device)->submitId < 8)
 		Log_debugLnx("Logging first 8 frames: %"PRIu64, GraphicsDeviceRef_ptr(twm->device)->submitId);
 
 	Buffer runtimeData = Buffer_createRefConst((const U32*)&data, sizeof(data));
+	const Ns submitStart = Time_now();
+
 	gotoIfError2(clean, GraphicsDeviceRef_submitCommands(
 		twm->device, twm->commandLists, twm->swapchains, runtimeData,
 		(F32)(twm->time - twm->timeSinceLastRender), (F32)twm->time
 	))
 
+	if(twm->benchmark)
+		FrameStats_add(&twm->frameStats, ETestTimer_Submit, Time_now() - submitStart);
+
 	twm->timeSinceLastRender = twm->time;
 
 clean:
 	if(!s_uccess)
 		Error_printx(err, ELogLevel_Error, ELogOptions_Default);
+
+	if(twm->benchmark) {
+		FrameStats_add(&twm->frameStats, ETestTimer_Draw, Time_now() - drawStart);
+		FrameStats_nextFrame(&twm->frameStats);
+		TestWindowManager_finishBenchmark(windowManager);
+	}
 }
 
 void onResize(Window *w) {
@@ -481,98 +1158,342 @@ void onResize(Window *w) {
 	//It's possible we don't, in case our device is rotated for example, we might still receive onResize.
 	//But in that case, only the swapchain has to be recreated, not the render textures.
 
-	U16 width = (U16) I32x2_x(w->size);
-	U16 height = (U16) I32x2_y(w->size);
+	//With multiple views, every view gets a tile of the window's size
 
-	Bool recreate = !tw->depthStencil;
+	const I32x2 gridSize = TestWindowManager_getViewGrid(twm, w->size);
 
-	if(tw->depthStencil) {
-		DepthStencil *ds = DepthStencilRef_ptr(tw->depthStencil);
-		recreate = ds->width != width || ds->height != height;
-		Log_debugLnx("Recreate: %"PRIu16"x%"PRIu16" vs %"PRIu16"x%"PRIu16, ds->width, ds->height, width, height);
-	}
+	if(I32x2_any(I32x2_gt(gridSize, I32x2_xx2(TestWindowManager_maxTargetSize))))
+		retError(clean, Error_outOfBounds(
+			0, U64_max(I32x2_x(gridSize), I32x2_y(gridSize)), TestWindowManager_maxTargetSize, "onResize() views don't fit in a render target"
+		))
+
+	U16 width = (U16) I32x2_x(gridSize);
+	U16 height = (U16) I32x2_y(gridSize);
+
+	Bool recreate = !tw->depthStencil || tw->targetWidth != width || tw->targetHeight != height;
+
+	if(tw->depthStencil)
+		Log_debugLnx("Recreate: %"PRIu16"x%"PRIu16" vs %"PRIu16"x%"PRIu16, tw->targetWidth, tw->targetHeight, width, height);
 
 	if(!recreate)		//Skip everything, including re-recording commands
 		goto generateCommands;
 
-	//Resize depth stencil and render textures
+	//Swap depth stencil and render textures; if the size stays within the same bucket, the pool returns the same ones.
+	//Depth is cleared and discarded every pass, so all windows with a size in the same bucket share it.
 
-	if(tw->depthStencil)
-		DepthStencilRef_dec(&tw->depthStencil);
+	RenderTargetPool *pool = &twm->renderTargets;
 
-	gotoIfError2(clean, GraphicsDeviceRef_createDepthStencil(
-		twm->device,
-		width, height, EDepthStencilFormat_D16, false,
-		EMSAASamples_Off,
-		NULL,
-		CharString_createRefCStrConst("Test depth stencil"),
-		&tw->depthStencil
+	RenderTargetPool_release(pool, &tw->depthStencil);
+	RenderTargetPool_release(pool, &tw->renderTexture);
+	RenderTargetPool_release(pool, &tw->skyHistory);
+
+	RenderTargetDesc depthDesc = (RenderTargetDesc) {
+		.format = EDepthStencilFormat_D16, .width = width, .height = height,
+		.isDepthStencil = true, .isTransient = true
+	};
+
+	gotoIfError3(clean, RenderTargetPool_acquire(
+		pool, depthDesc, CharString_createRefCStrConst("Test depth stencil"), &tw->depthStencil, e_rr
 	))
-	
-	if(tw->renderTexture)
-		RefPtr_dec(&tw->renderTexture);
 
-	gotoIfError2(clean, GraphicsDeviceRef_createRenderTexture(
-		twm->device,
-		ETextureType_2D, width, height, 1, format, EGraphicsResourceFlag_ShaderRWBindless,
-		EMSAASamples_Off,
-		NULL,
-		CharString_createRefCStrConst("Render texture"),
-		&tw->renderTexture
+	RenderTargetDesc colorDesc = (RenderTargetDesc) {
+		.format = format, .width = width, .height = height, .flags = EGraphicsResourceFlag_ShaderRWBindless
+	};
+
+	gotoIfError3(clean, RenderTargetPool_acquire(
+		pool, colorDesc, CharString_createRefCStrConst("Render texture"), &tw->renderTexture, e_rr
 	))
 
-	//Resize MSAA targets
+	if(twm->enableRtPipeline && (atmosphereRaySamples || atmosphereLightSamples)) {
 
-	if(!tw->depthStencilMSAA)
-		gotoIfError2(clean, GraphicsDeviceRef_createDepthStencil(
-			twm->device,
-			256, 256, EDepthStencilFormat_D16, false,
-			EMSAASamples_x4,
-			NULL,
-			CharString_createRefCStrConst("Test depth stencil MSAA 256x"),
-			&tw->depthStencilMSAA
-		))
-	
-	if(!tw->renderTextureMSAA)
-		gotoIfError2(clean, GraphicsDeviceRef_createRenderTexture(
-			twm->device,
-			ETextureType_2D, 256, 256, 1, format, EGraphicsResourceFlag_None,
-			EMSAASamples_x4,
-			NULL,
-			CharString_createRefCStrConst("Render texture MSAA"),
-			&tw->renderTextureMSAA
-		))
-	
-	if(!tw->renderTextureMSAATarget)
-		gotoIfError2(clean, GraphicsDeviceRef_createRenderTexture(
-			twm->device,
-			ETextureType_2D, 256, 256, 1, format, EGraphicsResourceFlag_None,
-			EMSAASamples_Off,
-			NULL,
-			CharString_createRefCStrConst("Render texture MSAA Target"),
-			&tw->renderTextureMSAATarget
+		colorDesc.format = ETextureFormatId_RGBA16f;
+
+		gotoIfError3(clean, RenderTargetPool_acquire(
+			pool, colorDesc, CharString_createRefCStrConst("Sky history"), &tw->skyHistory, e_rr
 		))
 
-	//Record commands
-	
-generateCommands:
+		tw->resetSkyHistory = true;
+	}
 
-	gotoIfError2(clean, CommandListRef_begin(commandList, true, U64_MAX))
+	tw->targetWidth = width;
+	tw->targetHeight = height;
 
-	if(hasSwapchain) {
+	if (twm->enableRtCpu) {		//Only traces view 0
 
-		enum EScopes {
-			EScopes_ClearTarget,
-			EScopes_RaytracingTest,
-			EScopes_RaytracingPipelineTest,
-			EScopes_GraphicsTest,
-			EScopes_GraphicsTestMSAA,
-			EScopes_Copy,
-			EScopes_Copy2,
-			EScopes_Clear,
-			EScopes_Copy3
+		const U64 pixels = (U64) I32x2_x(w->size) * I32x2_y(w->size);
+
+		Buffer_freex(&tw->cpuRenderTarget);
+		gotoIfError2(clean, Buffer_createEmptyBytesx(pixels * sizeof(U32), &tw->cpuRenderTarget))
+
+		Buffer_freex(&tw->cpuRadiance);
+		Buffer_freex(&tw->cpuHitT);
+
+		if(twm->cpuPathTracer.scratch.ptr || cpuSkyFactor > 1)
+			gotoIfError2(clean, Buffer_createEmptyBytesx(pixels * sizeof(F32x4), &tw->cpuRadiance))
+
+		if(cpuSkyFactor > 1)
+			gotoIfError2(clean, Buffer_createEmptyBytesx(pixels * sizeof(F32), &tw->cpuHitT))
+
+		Accumulation_freex(&tw->cpuAccumulation);
+
+		if(cpuAccumulation)
+			gotoIfError3(clean, Accumulation_createx(
+				(U32) I32x2_x(w->size), (U32) I32x2_y(w->size),
+				(U32) U64_min(cpuAccumulation, U32_MAX), Accumulation_defaultMaxError, SkyCache_defaultThresholdDeg,
+				&tw->cpuAccumulation, e_rr
+			))
+	}
+
+	//MSAA targets don't depend on the window size; the MSAA color and depth are resolved or discarded every pass,
+	//so every window shares them. The resolve target is copied afterwards, so that one is per window.
+
+	depthDesc.width = depthDesc.height = 256;
+	depthDesc.samples = EMSAASamples_x4;
+
+	if(!tw->depthStencilMSAA)
+		gotoIfError3(clean, RenderTargetPool_acquire(
+			pool, depthDesc, CharString_createRefCStrConst("Test depth stencil MSAA 256x"), &tw->depthStencilMSAA, e_rr
+		))
+
+	colorDesc = (RenderTargetDesc) {
+		.format = format, .width = 256, .height = 256, .samples = EMSAASamples_x4, .isTransient = true
+	};
+
+	if(!tw->renderTextureMSAA)
+		gotoIfError3(clean, RenderTargetPool_acquire(
+			pool, colorDesc, CharString_createRefCStrConst("Render texture MSAA"), &tw->renderTextureMSAA, e_rr
+		))
+
+	colorDesc.samples = EMSAASamples_Off;
+	colorDesc.isTransient = false;
+
+	if(!tw->renderTextureMSAATarget)
+		gotoIfError3(clean, RenderTargetPool_acquire(
+			pool, colorDesc, CharString_createRefCStrConst("Render texture MSAA Target"), &tw->renderTextureMSAATarget, e_rr
+		))
+
+	//Record commands
+	
+generateCommands:
+	tw->needsRecording = true;
+
+clean:
+	Error_printx(err, ELogLevel_Error, ELogOptions_Default);
+}
+
+//Time since the previous scope, so the transitions and dependencies set up for a scope are included.
+//Stored per window, because windows are recorded on different threads.
+
+static void TestWindow_timeScope(TestWindowManager *twm, TestWindow *tw, EScopes scope, Ns *scopeStart) {
+
+	const Ns now = Time_now();
+
+	if(twm->benchmark)
+		tw->scopeTimes[scope] += now - *scopeStart;
+
+	*scopeStart = now;
+}
+
+//Parallel_for job; one per window (windows that don't need recording are skipped)
+
+static void TestWindow_recordJob(void *userData, U64 jobId, U64 threadId) {
+
+	(void) threadId;
+
+	const WindowManager *windowManager = (const WindowManager*) userData;
+	Window *w = windowManager->windows.ptr[jobId];
+	TestWindow *tw = (TestWindow*) w->extendedData.ptr;
+
+	if(!tw->needsRecording)
+		return;
+
+	Error err = Error_none();
+	tw->recordFailed = !TestWindow_recordCommands(w, &err);
+	tw->recordError = err;
+	tw->needsRecording = false;
+	tw->wasRecorded = true;
+}
+
+//Implicit accesses (attachments and copies) aren't passed to the scope, the command transitions them.
+//So their stage only has to be different from the EPipelineStages for the frame graph's barrier estimate.
+
+typedef enum ETestImplicitStage {
+	ETestImplicitStage_Attachment = 1 << 16,
+	ETestImplicitStage_Copy
+} ETestImplicitStage;
+
+static Bool TestWindow_hasCopy3(Window *w) {
+	const UnifiedTexture tex = TextureRef_getUnifiedTexture(((TestWindow*) w->extendedData.ptr)->renderTextureMSAATarget, NULL);
+	return I32x2_all(I32x2_leq(I32x2_add(I32x2_create2(tex.width, tex.height), I32x2_xx2(256)), w->size));
+}
+
+//Has to match the passes TestWindow_recordCommands records
+
+static Bool TestWindow_declarePasses(Window *w, FrameGraph *graph, Error *e_rr) {
+
+	TestWindowManager *twm = (TestWindowManager*) w->owner->extendedData.ptr;
+	TestWindow *tw = (TestWindow*) w->extendedData.ptr;
+
+	const EFrameGraphAccess read = EFrameGraphAccess_Read;
+	const EFrameGraphAccess write = EFrameGraphAccess_Write;
+	const EFrameGraphAccess readWrite = EFrameGraphAccess_ReadWrite;
+
+	const U32 attachment = ETestImplicitStage_Attachment, copy = ETestImplicitStage_Copy;
+	const Bool hasAnyRaytracing = twm->enableRtPipeline || twm->enableRtInline;
+
+	Bool s_uccess = true;
+
+	FrameGraph_clear(graph);
+	gotoIfError3(clean, FrameGraph_addOutput(graph, tw->swapchain, e_rr))
+
+	if(hasAnyRaytracing) {
+		gotoIfError3(clean, FrameGraph_addPass(graph, EScopes_ClearTarget, "ClearTarget", e_rr))
+		gotoIfError3(clean, FrameGraph_addAccess(graph, tw->renderTexture, copy, write, true, e_rr))
+	}
+
+	//Raytracing only writes the visible part, so the rest of the clear is preserved
+
+	if(twm->enableRtInline) {
+		gotoIfError3(clean, FrameGraph_addPass(graph, EScopes_RaytracingTest, "RaytracingTest", e_rr))
+		gotoIfError3(clean, FrameGraph_addAccess(graph, twm->tlas, EPipelineStage_Compute, read, false, e_rr))
+		gotoIfError3(clean, FrameGraph_addAccess(graph, twm->viewProjMatrices, EPipelineStage_Compute, read, false, e_rr))
+		gotoIfError3(clean, FrameGraph_addAccess(graph, tw->renderTexture, EPipelineStage_Compute, readWrite, false, e_rr))
+	}
+
+	if(twm->enableRtPipeline) {
+
+		gotoIfError3(clean, FrameGraph_addPass(graph, EScopes_RaytracingPipelineTest, "RaytracingPipelineTest", e_rr))
+
+		const void *reads[] = {
+			twm->tlas, twm->viewProjMatrices, twm->transmittanceLUT, twm->multiScatteringLUT, twm->skyCacheTexture
 		};
 
+		for(U64 i = 0; i < sizeof(reads) / sizeof(reads[0]); ++i)
+			if(reads[i])		//The sky cache is optional
+				gotoIfError3(clean, FrameGraph_addAccess(graph, reads[i], EPipelineStage_RtStart, read, false, e_rr))
+
+		gotoIfError3(clean, FrameGraph_addAccess(graph, tw->renderTexture, EPipelineStage_RtStart, readWrite, false, e_rr))
+
+		if(tw->skyHistory)
+			gotoIfError3(clean, FrameGraph_addAccess(graph, tw->skyHistory, EPipelineStage_RtStart, readWrite, false, e_rr))
+
+		gotoIfError3(clean, FrameGraph_addAccess(graph, twm->anisotropic, 0, read, false, e_rr))		//Keep sampler alive
+	}
+
+	//Both graphics tests read the same resources, but render to their own targets
+
+	for(U32 i = 0; i < 2; ++i) {
+
+		const Bool isMSAA = i == 1;
+
+		gotoIfError3(clean, FrameGraph_addPass(
+			graph, isMSAA ? EScopes_GraphicsTestMSAA : EScopes_GraphicsTest, isMSAA ? "GraphicsTestMSAA" : "GraphicsTest", e_rr
+		))
+
+		gotoIfError3(clean, FrameGraph_addAccess(graph, twm->deviceBuffer, EPipelineStage_Pixel, read, false, e_rr))
+		gotoIfError3(clean, FrameGraph_addAccess(graph, twm->viewProjMatrices, EPipelineStage_Vertex, read, false, e_rr))
+		gotoIfError3(clean, FrameGraph_addAccess(graph, twm->crabbageCompressed, EPipelineStage_Pixel, read, false, e_rr))
+		gotoIfError3(clean, FrameGraph_addAccess(graph, twm->crabbage2049x, EPipelineStage_Pixel, read, false, e_rr))
+		gotoIfError3(clean, FrameGraph_addAccess(graph, twm->anisotropic, 0, read, false, e_rr))		//Keep sampler alive
+
+		if(isMSAA) {
+			gotoIfError3(clean, FrameGraph_addAccess(graph, tw->renderTextureMSAA, attachment, write, true, e_rr))
+			gotoIfError3(clean, FrameGraph_addAccess(graph, tw->depthStencilMSAA, attachment, write, true, e_rr))
+			gotoIfError3(clean, FrameGraph_addAccess(graph, tw->renderTextureMSAATarget, attachment, write, true, e_rr))
+		}
+
+		else {
+			gotoIfError3(clean, FrameGraph_addAccess(
+				graph, tw->renderTexture, attachment, hasAnyRaytracing ? readWrite : write, true, e_rr
+			))
+			gotoIfError3(clean, FrameGraph_addAccess(graph, tw->depthStencil, attachment, write, true, e_rr))
+		}
+	}
+
+	gotoIfError3(clean, FrameGraph_addPass(graph, EScopes_Copy, "Copy", e_rr))
+	gotoIfError3(clean, FrameGraph_addAccess(graph, tw->renderTexture, copy, read, true, e_rr))
+	gotoIfError3(clean, FrameGraph_addAccess(graph, tw->swapchain, copy, write, true, e_rr))
+
+	gotoIfError3(clean, FrameGraph_addPass(graph, EScopes_Copy2, "Copy2", e_rr))
+	gotoIfError3(clean, FrameGraph_addAccess(graph, tw->renderTextureMSAATarget, copy, read, true, e_rr))
+	gotoIfError3(clean, FrameGraph_addAccess(graph, tw->swapchain, copy, readWrite, true, e_rr))
+
+	gotoIfError3(clean, FrameGraph_addPass(graph, EScopes_Clear, "Clear", e_rr))
+	gotoIfError3(clean, FrameGraph_addAccess(graph, tw->renderTextureMSAATarget, copy, write, true, e_rr))
+
+	if(TestWindow_hasCopy3(w)) {
+		gotoIfError3(clean, FrameGraph_addPass(graph, EScopes_Copy3, "Copy3", e_rr))
+		gotoIfError3(clean, FrameGraph_addAccess(graph, tw->renderTextureMSAATarget, copy, read, true, e_rr))
+		gotoIfError3(clean, FrameGraph_addAccess(graph, tw->swapchain, copy, readWrite, true, e_rr))
+	}
+
+clean:
+	return s_uccess;
+}
+
+//Starts a scope with the transitions and dependencies the frame graph derived.
+//False if it was culled (or the command list skipped it).
+
+static Bool TestWindow_startScope(const FrameGraph *graph, EScopes scope, CommandListRef *commandList) {
+
+	const FrameGraphPass *pass = FrameGraph_getPass(graph, scope);
+
+	if(!pass || !pass->isAlive)
+		return false;
+
+	Transition transitions[FrameGraph_maxAccesses];
+	CommandScopeDependency deps[FrameGraph_maxPasses];
+	U64 transitionCount = 0;
+
+	for(U32 i = pass->firstAccess; i < pass->firstAccess + pass->accessCount; ++i) {
+
+		const FrameGraphAccess access = graph->accesses[i];
+
+		if(!access.isImplicit)
+			transitions[transitionCount++] = (Transition) {
+				.resource = (RefPtr*) access.resource,
+				.stage = (EPipelineStage) access.stage,
+				.isWrite = access.access != EFrameGraphAccess_Read
+			};
+	}
+
+	for(U32 i = 0; i < pass->dependencyCount; ++i)
+		deps[i] = (CommandScopeDependency) { .id = pass->dependencies[i] };
+
+	ListTransition transitionArr = (ListTransition) { 0 };
+	ListCommandScopeDependency depsArr = (ListCommandScopeDependency) { 0 };
+
+	if(transitionCount && ListTransition_createRefConst(transitions, transitionCount, &transitionArr).genericError)
+		return false;
+
+	if(pass->dependencyCount && ListCommandScopeDependency_createRefConst(deps, pass->dependencyCount, &depsArr).genericError)
+		return false;
+
+	return !CommandListRef_startScope(commandList, transitionArr, scope, depsArr).genericError;
+}
+
+Bool TestWindow_recordCommands(Window *w, Error *e_rr) {
+
+	TestWindowManager *twm = (TestWindowManager*) w->owner->extendedData.ptr;
+	TestWindow *tw = (TestWindow*) w->extendedData.ptr;
+	CommandListRef *commandList = tw->commandList;
+
+	Bool s_uccess = true;
+
+	const Bool hasSwapchain = I32x2_all(I32x2_gt(w->size, I32x2_zero()));
+	const U16 width = (U16) I32x2_x(w->size);
+	const U16 height = (U16) I32x2_y(w->size);
+	const I32x2 gridSize = TestWindowManager_getViewGrid(twm, w->size);
+
+	gotoIfError2(clean, CommandListRef_begin(commandList, true, U64_MAX))
+
+	for(U64 i = 0; i < EScopes_Count; ++i)
+		tw->scopeTimes[i] = 0;
+
+	Ns scopeStart = Time_now();
+
+	if(hasSwapchain) {
+
 		CharString names[] = {
 			CharString_createRefCStrConst("ClearTarget"),
 			CharString_createRefCStrConst("RaytracingTest"),
@@ -585,22 +1506,28 @@ generateCommands:
 			CharString_createRefCStrConst("Copy3")
 		};
 
-		Transition transitions[5] = { 0 };
-		CommandScopeDependency deps[3] = { 0 };
+		//Passes only declare what they access; the frame graph decides which run, their transitions and dependencies
+
+		FrameGraph *graph = &tw->frameGraph;
+		gotoIfError3(clean, TestWindow_declarePasses(w, graph, e_rr))
+		FrameGraph_compile(graph);
 
-		ListTransition transitionArr = (ListTransition) { 0 };
-		ListCommandScopeDependency depsArr = (ListCommandScopeDependency) { 0 };
-		gotoIfError2(clean, ListTransition_createRefConst(transitions, 5, &transitionArr))
-		gotoIfError2(clean, ListCommandScopeDependency_createRefConst(deps, 3, &depsArr))
+		//Commands are re-recorded on every resize, only print the schedule if that changed it
+
+		const U64 schedule = FrameGraph_getScheduleHash(graph);
+
+		if(!twm->benchmark && schedule != tw->frameGraphSchedule) {
+			FrameGraph_printSchedule(graph);
+			tw->frameGraphSchedule = schedule;
+		}
+
+		const Bool hasAnyRaytracing = twm->enableRtPipeline || twm->enableRtInline;
 
 		//Raytracing overwrites render target, so we need to clear it first
 
-		Bool hasAnyRaytracing = twm->enableRtPipeline || twm->enableRtInline;
+		if (hasAnyRaytracing) {
 
-		if (hasAnyRaytracing)
-			if(!CommandListRef_startScope(
-				commandList, (ListTransition) { 0 }, EScopes_ClearTarget, (ListCommandScopeDependency) { 0 }
-			).genericError) {
+			if(TestWindow_startScope(graph, EScopes_ClearTarget, commandList)) {
 
 				gotoIfError2(clean, CommandListRef_startRegionDebugExt(commandList, F32x4_create4(1, 0, 0, 1), names[0]))
 
@@ -612,104 +1539,42 @@ generateCommands:
 				gotoIfError2(clean, CommandListRef_endScope(commandList))
 			}
 
-		//Test raytracing
-
-		if(twm->enableRtInline) {
-
-			//Write using inline RT
-
-			transitions[0] = (Transition) {
-				.resource = twm->tlas,
-				.stage = EPipelineStage_Compute
-			};
-
-			transitions[1] = (Transition) {
-				.resource = twm->viewProjMatrices,
-				.stage = EPipelineStage_Compute
-			};
+			TestWindow_timeScope(twm, tw, EScopes_ClearTarget, &scopeStart);
+		}
 
-			transitions[2] = (Transition) {
-				.resource = tw->renderTexture,
-				.stage = EPipelineStage_Compute,
-				.isWrite = true
-			};
+		//Test raytracing, dispatch z is the view
 
-			deps[0] = (CommandScopeDependency) { .id = EScopes_ClearTarget };
-			depsArr.length = 1;
-			transitionArr.length = 3;
+		if(twm->enableRtInline) {
 
-			if(!CommandListRef_startScope(commandList, transitionArr, EScopes_RaytracingTest, depsArr).genericError) {
+			if(TestWindow_startScope(graph, EScopes_RaytracingTest, commandList)) {
 				gotoIfError2(clean, CommandListRef_startRegionDebugExt(commandList, F32x4_create4(1, 0, 0, 1), names[1]))
 				gotoIfError2(clean, CommandListRef_setComputePipeline(commandList, twm->inlineRaytracingTest))
-				gotoIfError2(clean, CommandListRef_dispatch2D(commandList, (width + 15) >> 4, (height + 7) >> 3))
+				gotoIfError2(clean, CommandListRef_dispatch3D(
+					commandList, (width + 15) >> 4, (height + 7) >> 3, twm->viewCount
+				))
 				gotoIfError2(clean, CommandListRef_endRegionDebugExt(commandList))
 				gotoIfError2(clean, CommandListRef_endScope(commandList))
 			}
+
+			TestWindow_timeScope(twm, tw, EScopes_RaytracingTest, &scopeStart);
 		}
 
 		if(twm->enableRtPipeline) {
 
-			//Write using raytracing pipelines
-
-			transitions[0] = (Transition) {
-				.resource = twm->tlas,
-				.stage = EPipelineStage_RtStart
-			};
-
-			transitions[1] = (Transition) {
-				.resource = twm->viewProjMatrices,
-				.stage = EPipelineStage_RtStart
-			};
-
-			transitions[2] = (Transition) {
-				.resource = tw->renderTexture,
-				.stage = EPipelineStage_RtStart,
-				.isWrite = true
-			};
-
-			deps[0] = (CommandScopeDependency) { .id = EScopes_RaytracingTest };
-			depsArr.length = 1;
-			transitionArr.length = 3;
-
-			if(!CommandListRef_startScope(commandList, transitionArr, EScopes_RaytracingPipelineTest, depsArr).genericError) {
+			if(TestWindow_startScope(graph, EScopes_RaytracingPipelineTest, commandList)) {
 				gotoIfError2(clean, CommandListRef_startRegionDebugExt(commandList, F32x4_create4(0, 1, 0, 1), names[2]))
 				gotoIfError2(clean, CommandListRef_setRaytracingPipeline(commandList, twm->raytracingPipelineTest))
-				gotoIfError2(clean, CommandListRef_dispatch2DRaysExt(commandList, 0, width, height))
+				gotoIfError2(clean, CommandListRef_dispatch3DRaysExt(commandList, 0, width, height, twm->viewCount))
 				gotoIfError2(clean, CommandListRef_endRegionDebugExt(commandList))
 				gotoIfError2(clean, CommandListRef_endScope(commandList))
 			}
+
+			TestWindow_timeScope(twm, tw, EScopes_RaytracingPipelineTest, &scopeStart);
 		}
 
 		//Test graphics pipeline
 
-		transitions[0] = (Transition) {
-			.resource = twm->deviceBuffer,
-			.stage = EPipelineStage_Pixel
-		};
-
-		transitions[1] = (Transition) {
-			.resource = twm->viewProjMatrices,
-			.stage = EPipelineStage_Vertex
-		};
-
-		transitions[2] = (Transition) {
-			.resource = twm->crabbageCompressed,
-			.stage = EPipelineStage_Pixel
-		};
-
-		transitions[3] = (Transition) {
-			.resource = twm->crabbage2049x,
-			.stage = EPipelineStage_Pixel
-		};
-
-		transitions[4] = (Transition) { .resource = twm->anisotropic };		//Keep sampler alive
-
-		deps[0] = (CommandScopeDependency) { .id = EScopes_RaytracingTest };
-		deps[1] = (CommandScopeDependency) { .id = EScopes_RaytracingPipelineTest };
-		depsArr.length = 2;
-		transitionArr.length = 5;
-
-		if(!CommandListRef_startScope(commandList, transitionArr, EScopes_GraphicsTest, depsArr).genericError) {
+		if(TestWindow_startScope(graph, EScopes_GraphicsTest, commandList)) {
 
 			gotoIfError2(clean, CommandListRef_startRegionDebugExt(commandList, F32x4_create4(0, 0, 1, 1), names[3]))
 
@@ -733,12 +1598,12 @@ generateCommands:
 			//Start render
 
 			gotoIfError2(clean, CommandListRef_startRenderExt(
-				commandList, I32x2_zero(), I32x2_zero(), colors, depthStencil
+				commandList, I32x2_zero(), gridSize, colors, depthStencil
 			))
 
-			gotoIfError2(clean, CommandListRef_setViewportAndScissor(commandList, I32x2_zero(), I32x2_zero()))
+			//Draw without depth, the screen space quads only go to view 0
 
-			//Draw without depth
+			gotoIfError2(clean, CommandListRef_setViewportAndScissor(commandList, I32x2_zero(), w->size))
 
 			gotoIfError2(clean, CommandListRef_setGraphicsPipeline(commandList, twm->graphicsTest))
 
@@ -752,47 +1617,23 @@ generateCommands:
 			gotoIfError2(clean, CommandListRef_drawIndexed(commandList, 6, 1))
 			gotoIfError2(clean, CommandListRef_drawIndirect(commandList, twm->indirectDrawBuffer, 0, 2, true))
 
-			//Draw with depth
+			//Draw with depth, 64 cubes per view; the vertex shader places every view's instances in its own tile
 
+			gotoIfError2(clean, CommandListRef_setViewportAndScissor(commandList, I32x2_zero(), gridSize))
 			gotoIfError2(clean, CommandListRef_setGraphicsPipeline(commandList, twm->graphicsDepthTest))
 
-			gotoIfError2(clean, CommandListRef_drawUnindexed(commandList, 36, 64))		//Draw cubes
+			gotoIfError2(clean, CommandListRef_drawUnindexed(commandList, 36, 64 * twm->viewCount))		//Draw cubes
 
 			gotoIfError2(clean, CommandListRef_endRenderExt(commandList))
 			gotoIfError2(clean, CommandListRef_endRegionDebugExt(commandList))
 			gotoIfError2(clean, CommandListRef_endScope(commandList))
 		}
 
-		//Test graphics pipeline MSAA
-
-		transitions[0] = (Transition) {
-			.resource = twm->deviceBuffer,
-			.stage = EPipelineStage_Pixel
-		};
-
-		transitions[1] = (Transition) {
-			.resource = twm->viewProjMatrices,
-			.stage = EPipelineStage_Vertex
-		};
-
-		transitions[2] = (Transition) {
-			.resource = twm->crabbageCompressed,
-			.stage = EPipelineStage_Pixel
-		};
-
-		transitions[3] = (Transition) {
-			.resource = twm->crabbage2049x,
-			.stage = EPipelineStage_Pixel
-		};
-
-		transitions[4] = (Transition) { .resource = twm->anisotropic };		//Keep sampler alive
+		TestWindow_timeScope(twm, tw, EScopes_GraphicsTest, &scopeStart);
 
-		deps[0] = (CommandScopeDependency) { .id = EScopes_RaytracingTest };
-		deps[1] = (CommandScopeDependency) { .id = EScopes_RaytracingPipelineTest };
-		depsArr.length = 2;
-		transitionArr.length = 5;
+		//Test graphics pipeline MSAA
 
-		if(!CommandListRef_startScope(commandList, transitionArr, EScopes_GraphicsTestMSAA, depsArr).genericError) {
+		if(TestWindow_startScope(graph, EScopes_GraphicsTestMSAA, commandList)) {
 
 			gotoIfError2(clean, CommandListRef_startRegionDebugExt(commandList, F32x4_create4(1, 1, 1, 1), names[5]))
 
@@ -823,44 +1664,38 @@ generateCommands:
 
 			gotoIfError2(clean, CommandListRef_setViewportAndScissor(commandList, I32x2_zero(), I32x2_zero()))
 
-			//Draw with depth
+			//Draw with depth, every view in a tile of the 256x target
 
 			gotoIfError2(clean, CommandListRef_setGraphicsPipeline(commandList, twm->graphicsDepthTestMSAA))
 
-			gotoIfError2(clean, CommandListRef_drawUnindexed(commandList, 36, 64))		//Draw cubes
+			gotoIfError2(clean, CommandListRef_drawUnindexed(commandList, 36, 64 * twm->viewCount))		//Draw cubes
 
 			gotoIfError2(clean, CommandListRef_endRenderExt(commandList))
 			gotoIfError2(clean, CommandListRef_endRegionDebugExt(commandList))
 			gotoIfError2(clean, CommandListRef_endScope(commandList))
 		}
 
-		//Copy
+		TestWindow_timeScope(twm, tw, EScopes_GraphicsTestMSAA, &scopeStart);
 
-		deps[0] = (CommandScopeDependency) { .id = EScopes_RaytracingTest };
-		deps[1] = (CommandScopeDependency) { .id = EScopes_RaytracingPipelineTest };
-		depsArr.length = 2;
-		transitionArr.length = 0;
+		//Copy
 
-		if(!CommandListRef_startScope(commandList, transitionArr, EScopes_Copy, depsArr).genericError) {
+		if(TestWindow_startScope(graph, EScopes_Copy, commandList)) {
 
 			gotoIfError2(clean, CommandListRef_startRegionDebugExt(commandList, F32x4_create4(1, 0, 1, 1), names[4]))
 
 			gotoIfError2(clean, CommandListRef_copyImage(
-				commandList, tw->renderTexture, tw->swapchain, (CopyImageRegion) { 0 }
+				commandList, tw->renderTexture, tw->swapchain, (CopyImageRegion) { .width = width, .height = height }
 			))
 
 			gotoIfError2(clean, CommandListRef_endRegionDebugExt(commandList))
 			gotoIfError2(clean, CommandListRef_endScope(commandList))
 		}
 
-		//Copy2 (needs separate scope to handle write hazard)
+		TestWindow_timeScope(twm, tw, EScopes_Copy, &scopeStart);
 
-		deps[0] = (CommandScopeDependency) { .id = EScopes_GraphicsTestMSAA };
-		deps[1] = (CommandScopeDependency) { .id = EScopes_Copy };
-		depsArr.length = 2;
-		transitionArr.length = 0;
+		//Copy2 (needs separate scope to handle write hazard)
 
-		if(!CommandListRef_startScope(commandList, transitionArr, EScopes_Copy2, depsArr).genericError) {
+		if(TestWindow_startScope(graph, EScopes_Copy2, commandList)) {
 
 			gotoIfError2(clean, CommandListRef_startRegionDebugExt(commandList, F32x4_create4(1, 1, 1, 1), names[6]))
 
@@ -872,13 +1707,11 @@ generateCommands:
 			gotoIfError2(clean, CommandListRef_endScope(commandList))
 		}
 
-		//Clear target
+		TestWindow_timeScope(twm, tw, EScopes_Copy2, &scopeStart);
 
-		deps[0] = (CommandScopeDependency) { .id = EScopes_Copy2 };
-		depsArr.length = 1;
-		transitionArr.length = 0;
+		//Clear target (only read by Copy3, so it's culled if the window is too small for that)
 
-		if(!CommandListRef_startScope(commandList, transitionArr, EScopes_Clear, depsArr).genericError) {
+		if(TestWindow_startScope(graph, EScopes_Clear, commandList)) {
 
 			gotoIfError2(clean, CommandListRef_startRegionDebugExt(commandList, F32x4_create4(0, 0, 0, 1), names[7]))
 
@@ -890,17 +1723,13 @@ generateCommands:
 			gotoIfError2(clean, CommandListRef_endScope(commandList))
 		}
 
-		//Copy3 (needs separate scope to handle write hazard)
+		TestWindow_timeScope(twm, tw, EScopes_Clear, &scopeStart);
 
-		UnifiedTexture tex = TextureRef_getUnifiedTexture(tw->renderTextureMSAATarget, NULL);
-
-		if(I32x2_all(I32x2_leq(I32x2_add(I32x2_create2(tex.width, tex.height), I32x2_xx2(256)), w->size))) {
+		//Copy3 (needs separate scope to handle write hazard)
 
-			deps[0] = (CommandScopeDependency) { .id = EScopes_Clear };
-			depsArr.length = 1;
-			transitionArr.length = 0;
+		if(TestWindow_hasCopy3(w)) {
 
-			if(!CommandListRef_startScope(commandList, transitionArr, EScopes_Copy3, depsArr).genericError) {
+			if(TestWindow_startScope(graph, EScopes_Copy3, commandList)) {
 
 				gotoIfError2(clean, CommandListRef_startRegionDebugExt(commandList, F32x4_create4(0.5, 0.5, 0.5, 1), names[8]))
 			
@@ -912,52 +1741,442 @@ generateCommands:
 				gotoIfError2(clean, CommandListRef_endRegionDebugExt(commandList))
 				gotoIfError2(clean, CommandListRef_endScope(commandList))
 			}
+
+			TestWindow_timeScope(twm, tw, EScopes_Copy3, &scopeStart);
 		}
 	}
 
 	gotoIfError2(clean, CommandListRef_end(commandList))
-	
+
+clean:
+	return s_uccess;
+}
+
+void onCreate(Window *w) {
+
+	TestWindowManager *twm = (TestWindowManager*) w->owner->extendedData.ptr;
+	TestWindow *tw = (TestWindow*) w->extendedData.ptr;
+
+	Error err = Error_none(), *e_rr = &err;
+	Bool s_uccess = true;
+
+	gotoIfError2(clean, GraphicsDeviceRef_createCommandList(twm->device, 2 * KIBI, 64, 64, true, &tw->commandList))
+
+clean:
+	if(!s_uccess)
+		Error_printx(err, ELogLevel_Error, ELogOptions_Default);
+}
+
+//Failing to write the image isn't fatal, it's only there to inspect the CPU raytracer's output
+
+static void TestWindow_writeCpuImage(Window *w) {
+
+	TestWindow *tw = (TestWindow*) w->extendedData.ptr;
+
+	const U64 width = (U64) I32x2_x(w->size), height = (U64) I32x2_y(w->size);
+
+	if(!cpuImagePath || cpuImageWritten || Buffer_length(tw->cpuRenderTarget) != width * height * sizeof(U32))
+		return;
+
+	Error err = Error_none(), *e_rr = &err;
+	Bool s_uccess = true;
+	Buffer written = Buffer_createNull();
+
+	cpuImageWritten = true;
+
+	SubResourceData sub = (SubResourceData) { .data = tw->cpuRenderTarget };
+	ListSubResourceData subResources = (ListSubResourceData) { 0 };
+	gotoIfError2(clean, ListSubResourceData_createRefConst(&sub, 1, &subResources))
+
+	const DDSInfo info = (DDSInfo) {
+		.w = (U32) width, .h = (U32) height, .l = 1, .mips = 1,
+		.type = ETextureType_2D,
+		.textureFormatId = w->format == EWindowFormat_RGBA8 ? ETextureFormatId_RGBA8 : ETextureFormatId_BGRA8
+	};
+
+	gotoIfError2(clean, DDS_writex(subResources, info, &written))
+	gotoIfError3(clean, File_writex(written, CharString_createRefCStrConst(cpuImagePath), 0, 0, U64_MAX, false, e_rr))
+
+	Log_debugLnx("Wrote CPU raytracer output (%"PRIu64"x%"PRIu64") to %s", width, height, cpuImagePath);
+
+clean:
+	if(!s_uccess)
+		Error_printx(err, ELogLevel_Warn, ELogOptions_Default);
+
+	Buffer_freex(&written);
+}
+
+void onDestroy(Window *w) {
+	Log_debugLnx("On destroy");
+	TestWindow *tw = (TestWindow*) w->extendedData.ptr;
+	TestWindow_writeCpuImage(w);
+	RenderTargetPool *pool = &((TestWindowManager*) w->owner->extendedData.ptr)->renderTargets;
+	RefPtr_dec(&tw->swapchain);
+	RenderTargetPool_release(pool, &tw->depthStencil);
+	RenderTargetPool_release(pool, &tw->renderTexture);
+	RenderTargetPool_release(pool, &tw->skyHistory);
+	RenderTargetPool_release(pool, &tw->depthStencilMSAA);
+	RenderTargetPool_release(pool, &tw->renderTextureMSAA);
+	RenderTargetPool_release(pool, &tw->renderTextureMSAATarget);
+	Buffer_freex(&tw->cpuRenderTarget);
+	Buffer_freex(&tw->cpuRadiance);
+	Buffer_freex(&tw->cpuHitT);
+	Accumulation_freex(&tw->cpuAccumulation);
+	CommandListRef_dec(&tw->commandList);
+	Log_debugLnx("On destroy finished");
+}
+
+typedef struct VertexPosBuffer {
+	F16 pos[2];
+} VertexPosBuffer;
+
+typedef struct VertexDataBuffer {
+	F16 uv[2];
+} VertexDataBuffer;
+
+Bool renderVirtual = false;		//Whether there's a physical swapchain
+Bool forceCpuRaytracing = false;	//Trace on the CPU even if the device supports raytracing
+Bool writeTestDDS = false;			//Write the decoded DDS back out to test the writer (writeDDS=1)
+
+//Pipelines are created at startup by parallel jobs; first every shader in use is loaded, then each pipeline is created.
+//The pipeline cache remembers the resolved entries and how long each pipeline took last time,
+//so the entry lookups can be skipped and the slowest pipelines are started first.
+
+typedef enum ETestShader {
+	ETestShader_IndirectPrepare,
+	ETestShader_IndirectCompute,
+	ETestShader_RaytracingTest,
+	ETestShader_GraphicsTest,
+	ETestShader_DepthTest,					//Has to follow GraphicsTest, graphics pipelines reference both
+	ETestShader_RaytracingPipelineTest,
+	ETestShader_Count
+} ETestShader;
+
+static const C8 *ETestShader_paths[] = {
+	"//rt_core/shaders/indirect_prepare.oiSH",
+	"//rt_core/shaders/indirect_compute.oiSH",
+	"//rt_core/shaders/raytracing_test.oiSH",
+	"//rt_core/shaders/graphics_test.oiSH",
+	"//rt_core/shaders/depth_test.oiSH",
+	"//rt_core/shaders/raytracing_pipeline_test.oiSH"
+};
+
+typedef enum ETestPipeline {
+	ETestPipeline_PrepareIndirect,
+	ETestPipeline_IndirectCompute,
+	ETestPipeline_InlineRaytracing,
+	ETestPipeline_Graphics,
+	ETestPipeline_GraphicsDepth,
+	ETestPipeline_GraphicsDepthMSAA,
+	ETestPipeline_Raytracing,
+	ETestPipeline_Count
+} ETestPipeline;
+
+typedef struct TestPipelineInfo {
+	const C8 *name;
+	const C8 *entries[PipelineCache_maxEntries];		//Entry per stage, NULL if unused
+	ETestShader shaders[PipelineCache_maxEntries];
+} TestPipelineInfo;
+
+static const TestPipelineInfo TestPipeline_infos[] = {
+
+	{ "Prepare indirect pipeline", { "main" }, { ETestShader_IndirectPrepare } },
+	{ "Indirect compute dispatch", { "main" }, { ETestShader_IndirectCompute } },
+	{ "Inline raytracing test",    { "main" }, { ETestShader_RaytracingTest } },
+
+	{ "Test graphics pipeline",            { "mainVS", "mainPS" }, { ETestShader_GraphicsTest, ETestShader_GraphicsTest } },
+	{ "Test graphics depth pipeline",      { "mainVS", "mainPS" }, { ETestShader_DepthTest,    ETestShader_GraphicsTest } },
+	{ "Test graphics depth pipeline MSAA", { "mainVS", "mainPS" }, { ETestShader_DepthTest,    ETestShader_GraphicsTest } },
+
+	{
+		"Raytracing pipeline test",
+		{ "mainClosestHit", "mainMiss", "mainRaygen" },
+		{ ETestShader_RaytracingPipelineTest, ETestShader_RaytracingPipelineTest, ETestShader_RaytracingPipelineTest }
+	}
+};
+
+typedef struct TestPipelineJobs {
+
+	TestWindowManager *twm;
+	ETextureFormatId nativeFormat;
+
+	Buffer files[ETestShader_Count];
+	SHFile binaries[ETestShader_Count];
+	U64 shaderHashes[ETestShader_Count];
+
+	ETestShader shaders[ETestShader_Count];				//Shaders to load
+	U64 shaderCount;
+
+	ETestPipeline pipelines[ETestPipeline_Count];		//Pipelines to create, slowest first
+	U64 pipelineCount;
+
+	PipelineRef **targets[ETestPipeline_Count];
+	PipelineCacheEntry entries[ETestPipeline_Count];
+	Bool cached[ETestPipeline_Count];
+
+	Bool failed[ETestPipeline_Count];					//Per job of the current stage (there are fewer shaders than pipelines)
+	Error errors[ETestPipeline_Count];
+
+} TestPipelineJobs;
+
+static Bool TestPipeline_isUsed(const TestWindowManager *twm, ETestPipeline pipeline) {
+	switch(pipeline) {
+		case ETestPipeline_InlineRaytracing:	return twm->enableRtInline;
+		case ETestPipeline_Raytracing:			return twm->enableRtPipeline;
+		default:								return true;
+	}
+}
+
+static PipelineGraphicsInfo TestPipeline_getGraphicsInfo(ETestPipeline pipeline, ETextureFormatId nativeFormat) {
+
+	//Pipeline without depth stencil
+
+	if(pipeline == ETestPipeline_Graphics)
+		return (PipelineGraphicsInfo) {
+			.vertexLayout = {
+				.bufferStrides12_isInstance1 = { (U16) sizeof(VertexPosBuffer), (U16) sizeof(VertexDataBuffer) },
+				.attributes = {
+					(VertexAttribute) {
+						.offset11 = 0,
+						.bufferId4 = 0,
+						.format = ETextureFormatId_RG16f,
+					},
+					(VertexAttribute) {
+						.offset11 = 0,
+						.bufferId4 = 1,
+						.format = ETextureFormatId_RG16f,
+					}
+				}
+			},
+			.attachmentCountExt = 1,
+			.attachmentFormatsExt = { (U8) nativeFormat },
+			.depthFormatExt = EDepthStencilFormat_D16,
+			.msaa = EMSAASamples_Off,
+			.msaaMinSampleShading = 0.2f
+		};
+
+	//Pipeline with depth (but still the same pixel shader)
+
+	return (PipelineGraphicsInfo) {
+		.depthStencil = (DepthStencilState) { .flags = EDepthStencilFlags_DepthWrite },
+		.attachmentCountExt = 1,
+		.attachmentFormatsExt = { (U8) nativeFormat },
+		.depthFormatExt = EDepthStencilFormat_D16,
+		.msaa = pipeline == ETestPipeline_GraphicsDepthMSAA ? EMSAASamples_x4 : EMSAASamples_Off,
+		.msaaMinSampleShading = 0.2f
+	};
+}
+
+//Only has to include what the cached entries depend on: shader binaries, entry names, defines and the device.
+//Pipeline state isn't part of it, since nothing that's cached depends on it.
+
+static U64 TestPipelineJobs_getKey(
+	const TestPipelineJobs *jobs,
+	ETestPipeline pipeline,
+	EGraphicsApi api,
+	const GraphicsDeviceCapabilities *capabilities
+) {
+
+	const TestPipelineInfo info = TestPipeline_infos[pipeline];
+
+	U64 key = PipelineCache_hash(PipelineCache_hashStart, Buffer_createRefConst(&api, sizeof(api)));
+	key = PipelineCache_hash(key, Buffer_createRefConst(capabilities, sizeof(*capabilities)));
+	key = PipelineCache_hash(key, CharString_bufferConst(CharString_createRefCStrConst(info.name)));
+
+	if(pipeline == ETestPipeline_InlineRaytracing)
+		key = PipelineCache_hash(key, CharString_bufferConst(CharString_createRefCStrConst("X;Y")));
+
+	for(U64 i = 0; i < PipelineCache_maxEntries && info.entries[i]; ++i) {
+		key = PipelineCache_hash(key, CharString_bufferConst(CharString_createRefCStrConst(info.entries[i])));
+		key = PipelineCache_hash(key, Buffer_createRefConst(&jobs->shaderHashes[info.shaders[i]], sizeof(U64)));
+	}
+
+	return key;
+}
+
+static void TestPipelineJobs_loadShader(void *userData, U64 jobId, U64 threadId) {
+
+	(void) threadId;
+
+	TestPipelineJobs *jobs = (TestPipelineJobs*) userData;
+	const ETestShader shader = jobs->shaders[jobId];
+
+	Error err = Error_none(), *e_rr = &err;
+	Bool s_uccess = true;
+
+	CharString path = CharString_createRefCStrConst(ETestShader_paths[shader]);
+	gotoIfError3(clean, File_readx(path, U64_MAX, 0, 0, &jobs->files[shader], e_rr))
+	gotoIfError3(clean, SHFile_readx(jobs->files[shader], false, &jobs->binaries[shader], e_rr))
+
+	jobs->shaderHashes[shader] = PipelineCache_hash(PipelineCache_hashStart, jobs->files[shader]);
+
+clean:
+	jobs->failed[jobId] = !s_uccess;
+	jobs->errors[jobId] = err;
+}
+
+static void TestPipelineJobs_createPipeline(void *userData, U64 jobId, U64 threadId) {
+
+	(void) threadId;
+
+	TestPipelineJobs *jobs = (TestPipelineJobs*) userData;
+	const ETestPipeline pipeline = jobs->pipelines[jobId];
+	const TestPipelineInfo info = TestPipeline_infos[pipeline];
+	PipelineCacheEntry *entry = &jobs->entries[pipeline];
+	GraphicsDeviceRef *device = jobs->twm->device;
+
+	Error err = Error_none(), *e_rr = &err;
+	Bool s_uccess = true;
+
+	const Ns start = Time_now();
+
+	//TODO: Turn this into uniforms
+
+	CharString definesArr[2];
+	definesArr[0] = CharString_createRefCStrConst("X");
+	definesArr[1] = CharString_createRefCStrConst("Y");
+
+	ListCharString defines = (ListCharString) { 0 };
+
+	if(pipeline == ETestPipeline_InlineRaytracing)
+		gotoIfError2(clean, ListCharString_createRefConst(
+			definesArr, sizeof(definesArr) / sizeof(definesArr[0]), &defines
+		))
+
+	//Resolve entries, unless the cache already knows them
+
+	PipelineStage stageArr[PipelineCache_maxEntries];
+	U64 stageCount = 0;
+
+	for(; stageCount < PipelineCache_maxEntries && info.entries[stageCount]; ++stageCount) {
+
+		const ETestShader shader = info.shaders[stageCount];
+
+		if(!jobs->cached[pipeline])
+			entry->entries[stageCount] = GraphicsDeviceRef_getFirstShaderEntry(
+				device,
+				jobs->binaries[shader],
+				CharString_createRefCStrConst(info.entries[stageCount]),
+				defines,
+				ESHExtension_None,
+				ESHExtension_None
+			);
+
+		stageArr[stageCount] = (PipelineStage) {
+			.binaryId = entry->entries[stageCount],
+			.shFileId = shader == ETestShader_DepthTest ? 1 : 0
+		};
+	}
+
+	CharString name = CharString_createRefCStrConst(info.name);
+	ListPipelineStage stages = (ListPipelineStage) { 0 };
+	ListSHFile binaries = (ListSHFile) { 0 };
+
+	switch (pipeline) {
+
+		case ETestPipeline_PrepareIndirect:
+		case ETestPipeline_IndirectCompute:
+		case ETestPipeline_InlineRaytracing:
+
+			gotoIfError3(clean, GraphicsDeviceRef_createPipelineCompute(
+				device,
+				jobs->binaries[info.shaders[0]],
+				name,
+				entry->entries[0],
+				EPipelineFlags_None,
+				NULL,
+				jobs->targets[pipeline],
+				e_rr
+			))
+
+			break;
+
+		case ETestPipeline_Graphics:
+		case ETestPipeline_GraphicsDepth:
+		case ETestPipeline_GraphicsDepthMSAA:
+
+			gotoIfError2(clean, ListSHFile_createRefConst(&jobs->binaries[ETestShader_GraphicsTest], 2, &binaries))
+			gotoIfError2(clean, ListPipelineStage_createRefConst(stageArr, stageCount, &stages))
+
+			gotoIfError3(clean, GraphicsDeviceRef_createPipelineGraphics(
+				device,
+				binaries,
+				&stages,
+				TestPipeline_getGraphicsInfo(pipeline, jobs->nativeFormat),
+				name,
+				EPipelineFlags_None,
+				NULL,
+				jobs->targets[pipeline],
+				e_rr
+			))
+
+			break;
+
+		default: {
+
+			PipelineRaytracingGroup hitArr[] = {
+				(PipelineRaytracingGroup) { .closestHit = 0, .anyHit = U32_MAX, .intersection = U32_MAX }
+			};
+
+			PipelineRaytracingInfo rtInfo = (PipelineRaytracingInfo) {
+				.flags = (U8) EPipelineRaytracingFlags_DefaultStrict,
+				.maxRecursionDepth = 1
+			};
+
+			ListPipelineRaytracingGroup hitGroups = (ListPipelineRaytracingGroup) { 0 };
+
+			gotoIfError2(clean, ListSHFile_createRefConst(&jobs->binaries[info.shaders[0]], 1, &binaries))
+			gotoIfError2(clean, ListPipelineStage_createRefConst(stageArr, stageCount, &stages))
+
+			gotoIfError2(clean, ListPipelineRaytracingGroup_createRefConst(
+				hitArr, sizeof(hitArr) / sizeof(hitArr[0]), &hitGroups
+			))
+
+			gotoIfError3(clean, GraphicsDeviceRef_createPipelineRaytracingExt(
+				device,
+				&stages,
+				binaries,
+				&hitGroups,
+				rtInfo,
+				name,
+				EPipelineFlags_None,
+				NULL,
+				jobs->targets[pipeline],
+				e_rr
+			))
+
+			break;
+		}
+	}
+
+	entry->createTime = Time_now() - start;
+
 clean:
-	Error_printx(err, ELogLevel_Error, ELogOptions_Default);
+	jobs->failed[jobId] = !s_uccess;
+	jobs->errors[jobId] = err;
 }
 
-void onCreate(Window *w) {
-
-	TestWindowManager *twm = (TestWindowManager*) w->owner->extendedData.ptr;
-	TestWindow *tw = (TestWindow*) w->extendedData.ptr;
+static Bool TestPipelineJobs_checkErrors(TestPipelineJobs *jobs, U64 jobCount, Error *e_rr) {
 
-	Error err = Error_none(), *e_rr = &err;
 	Bool s_uccess = true;
 
-	gotoIfError2(clean, GraphicsDeviceRef_createCommandList(twm->device, 2 * KIBI, 64, 64, true, &tw->commandList))
+	for(U64 i = 0; i < jobCount; ++i)
+		if(jobs->failed[i]) {
+			jobs->failed[i] = false;
+			retError(clean, jobs->errors[i])
+		}
 
 clean:
-	if(!s_uccess)
-		Error_printx(err, ELogLevel_Error, ELogOptions_Default);
-}
-
-void onDestroy(Window *w) {
-	Log_debugLnx("On destroy");
-	TestWindow *tw = (TestWindow*) w->extendedData.ptr;
-	RefPtr_dec(&tw->swapchain);
-	DepthStencilRef_dec(&tw->depthStencil);
-	RenderTextureRef_dec(&tw->renderTexture);
-	DepthStencilRef_dec(&tw->depthStencilMSAA);
-	RenderTextureRef_dec(&tw->renderTextureMSAA);
-	RenderTextureRef_dec(&tw->renderTextureMSAATarget);
-	CommandListRef_dec(&tw->commandList);
-	Log_debugLnx("On destroy finished");
+	return s_uccess;
 }
 
-typedef struct VertexPosBuffer {
-	F16 pos[2];
-} VertexPosBuffer;
-
-typedef struct VertexDataBuffer {
-	F16 uv[2];
-} VertexDataBuffer;
+static void TestPipelineJobs_freex(TestPipelineJobs *jobs) {
 
-Bool renderVirtual = false;		//Whether there's a physical swapchain
+	for(U64 i = 0; i < ETestShader_Count; ++i) {
+		SHFile_freex(&jobs->binaries[i]);
+		Buffer_freex(&jobs->files[i]);
+	}
+}
 
 void onManagerCreate(WindowManager *manager) {
 	
@@ -965,12 +2184,21 @@ void onManagerCreate(WindowManager *manager) {
 	Bool s_uccess = true;
 
 	Buffer tempBuffers[4] = { 0 };
-	SHFile tmpBinaries[2] = { 0 };
-	ListSubResourceData subResource = (ListSubResourceData) { 0 };
+	TestPipelineJobs pipelineJobs = (TestPipelineJobs) { 0 };
+	PipelineCache pipelineCache = (PipelineCache) { 0 };
 
 	TestWindowManager *twm = (TestWindowManager*) manager->extendedData.ptr;
 	twm->timeStep = timeStep;
 	twm->renderVirtual = renderVirtual;
+	twm->benchmark = !!benchmarkFrames;
+	twm->viewCount = (U32) testViews;
+	twm->viewColumns = (U32) F64_ceil(F64_sqrt((F64) testViews));
+
+	if(twm->benchmark)
+		gotoIfError3(clean, FrameStats_createx(
+			ETestTimer_Count, benchmarkFrames, benchmarkWarmup, &twm->frameStats, e_rr
+		))
+
 	twm->lastTime = Time_now();
 	twm->JD = AtmosHelper_getJulianDate(twm->lastTime);
 
@@ -1017,8 +2245,11 @@ void onManagerCreate(WindowManager *manager) {
 		&twm->device
 	))
 
+	twm->renderTargets.device = twm->device;
+
 	twm->enableRtPipeline = !!(deviceInfo.capabilities.features & EGraphicsFeatures_RayPipeline);
 	twm->enableRtInline   = !!(deviceInfo.capabilities.features & EGraphicsFeatures_RayQuery);
+	twm->enableRtCpu      = forceCpuRaytracing || !(twm->enableRtPipeline || twm->enableRtInline);
 
 	//Create samplers
 
@@ -1047,403 +2278,222 @@ void onManagerCreate(WindowManager *manager) {
 	Log_debugLnx("Create images");
 
 	{
-		//Normal crabbage
+		//Decoding and uploading images happens in the background (see TestWindowManager_uploadAssets).
+		//Until then, both crabbages are a grey placeholder.
 
-		CharString path = CharString_createRefCStrConst("//rt_core/images/crabbage.bmp");
-		gotoIfError3(clean, File_readx(path, U64_MAX, 0, 0, &tempBuffers[0], e_rr))
-
-		BMPInfo bmpInfo;
-		gotoIfError2(clean, BMP_readx(tempBuffers[0], &bmpInfo, &tempBuffers[2]))
-
-		if(bmpInfo.w >> 16 || bmpInfo.h >> 16)
-			retError(clean, Error_invalidState(0, "onManagerCreate() bmpInfo resolution out of bounds"))
+		U8 placeholder[4] = { 128, 128, 128, 255 };
+		Buffer placeholderData = Buffer_createRef(placeholder, sizeof(placeholder));
 
 		gotoIfError2(clean, GraphicsDeviceRef_createTexture(
 			twm->device,
 			ETextureType_2D,
-			(ETextureFormatId) bmpInfo.textureFormatId,
+			ETextureFormatId_RGBA8,
 			EGraphicsResourceFlag_ShaderReadBindless,
-			(U16)bmpInfo.w, (U16)bmpInfo.h, 1,
+			1, 1, 1,
 			NULL,
-			CharString_createRefCStrConst("Crabbage.bmp 600x"),
-			&tempBuffers[2],
+			CharString_createRefCStrConst("Crabbage placeholder"),
+			&placeholderData,
 			&twm->crabbage2049x
 		))
 
-		Buffer_freex(&tempBuffers[0]);		//Free the file here, since it might be referenced by BMP_read
-		Buffer_freex(&tempBuffers[2]);
-
-		//DDS crabbage
-
-		if(GraphicsDeviceRef_ptr(twm->device)->info.capabilities.dataTypes & EGraphicsDataTypes_BCn) {
+		gotoIfError2(clean, DeviceTextureRef_inc(twm->crabbage2049x))
+		twm->crabbageCompressed = twm->crabbage2049x;
 
-			path = CharString_createRefCStrConst("//rt_core/images/crabbage_mips.dds");
-			gotoIfError3(clean, File_readx(path, U64_MAX, 0, 0, &tempBuffers[0], e_rr))
+		//With BCn, the BMP is compressed to BC7 on load (cached as crabbage_bc7.<hash>.dds), to save VRAM and bandwidth
 
-			DDSInfo ddsInfo;
-			gotoIfError2(clean, DDS_readx(tempBuffers[0], &ddsInfo, &subResource))
+		const Bool hasBCn = !!(GraphicsDeviceRef_ptr(twm->device)->info.capabilities.dataTypes & EGraphicsDataTypes_BCn);
 
-			path = CharString_createRefCStrConst("test_crabbage_mips.dds");
-			gotoIfError2(clean, DDS_writex(subResource, ddsInfo, &tempBuffers[1]))
-			gotoIfError3(clean, File_writex(tempBuffers[1], path, 0, 0, U64_MAX, false, e_rr))
-			Buffer_freex(&tempBuffers[1]);
+		gotoIfError3(clean, AssetLoader_add(
+			&twm->assets,
+			CharString_createRefCStrConst("//rt_core/images/crabbage.bmp"),
+			hasBCn ? EAssetType_BMPAsBC7 : EAssetType_BMP,
+			hasBCn ? CharString_createRefCStrConst("crabbage_bc7") : CharString_createNull(),
+			NULL,
+			e_rr
+		))
 
-			gotoIfError2(clean, GraphicsDeviceRef_createTexture(
-				twm->device,
-				ddsInfo.type,
-				ddsInfo.textureFormatId,
-				EGraphicsResourceFlag_ShaderReadBindless,
-				(U16)ddsInfo.w, (U16)ddsInfo.h, (U16)ddsInfo.l,
+		if(hasBCn)
+			gotoIfError3(clean, AssetLoader_add(
+				&twm->assets,
+				CharString_createRefCStrConst("//rt_core/images/crabbage_mips.dds"),
+				EAssetType_DDS,
+				writeTestDDS ? CharString_createRefCStrConst("test_crabbage_mips.dds") : CharString_createNull(),
 				NULL,
-				CharString_createRefCStrConst("Crabbage_mips.dds"),
-				&subResource.ptrNonConst[0].data,
-				&twm->crabbageCompressed
+				e_rr
 			))
 
-			ListSubResourceData_freeAllx(&subResource);
-			Buffer_freex(&tempBuffers[0]);
-		}
-
-		//Oops, DDS (at least BCn compression) is unsupported, let's just pretend our existing crabbage is the big crabbage
+		//The BMP doesn't have mips; Kaiser keeps them sharper than a box filter without Lanczos' ringing
 
-		else {
-			gotoIfError2(clean, DeviceTextureRef_inc(twm->crabbage2049x))
-			twm->crabbageCompressed = twm->crabbage2049x;
-		}
-	}
+		twm->assets.mipFilter = EMipFilter_Kaiser;
 
-	//Create pipelines
-	//Compute pipelines
+		gotoIfError3(clean, AssetLoader_startx(
+			&twm->assets, TestWindowManager_assetThreads, TestWindowManager_assetStagingBudget, e_rr
+		))
 
-	Log_debugLnx("Create compute pipelines");
+		//Atmosphere LUTs; only depend on the planet, so the sun direction doesn't matter here
 
-	{
-		//Indirect prepare
+		const Atmosphere earth = Atmosphere_earth(F32x4_create3(0, -1, 0));
 
-		CharString path = CharString_createRefCStrConst("//rt_core/shaders/indirect_prepare.oiSH");
-		gotoIfError3(clean, File_readx(path, U64_MAX, 0, 0, &tempBuffers[0], e_rr))
-		gotoIfError3(clean, SHFile_readx(tempBuffers[0], false, &tmpBinaries[0], e_rr))
+		CharString path = CharString_createRefCStrConst("atmosphere_lut.bin");
+		gotoIfError3(clean, AtmosphereLUT_loadOrCreatex(&earth, path, &twm->atmosphereLut, e_rr))
+		gotoIfError3(clean, AtmosphereLUT_toF16x(&twm->atmosphereLut, &tempBuffers[0], &tempBuffers[1], e_rr))
 
-		U32 main = GraphicsDeviceRef_getFirstShaderEntry(
+		gotoIfError2(clean, GraphicsDeviceRef_createTexture(
 			twm->device,
-			tmpBinaries[0],
-			CharString_createRefCStrConst("main"),
-			(ListCharString) { 0 },
-			ESHExtension_None,
-			ESHExtension_None
-		);
+			ETextureType_2D,
+			ETextureFormatId_RGBA16f,
+			EGraphicsResourceFlag_ShaderReadBindless,
+			AtmosphereLUT_transmittanceW, AtmosphereLUT_transmittanceH, 1,
+			NULL,
+			CharString_createRefCStrConst("Transmittance LUT"),
+			&tempBuffers[0],
+			&twm->transmittanceLUT
+		))
 
-		gotoIfError3(clean, GraphicsDeviceRef_createPipelineCompute(
+		gotoIfError2(clean, GraphicsDeviceRef_createTexture(
 			twm->device,
-			tmpBinaries[0],
-			CharString_createRefCStrConst("Prepare indirect pipeline"),
-			main,
-			EPipelineFlags_None,
+			ETextureType_2D,
+			ETextureFormatId_RGBA16f,
+			EGraphicsResourceFlag_ShaderReadBindless,
+			AtmosphereLUT_multiScatteringW, AtmosphereLUT_multiScatteringH, 1,
 			NULL,
-			&twm->prepareIndirectPipeline,
-			e_rr
+			CharString_createRefCStrConst("Multiple scattering LUT"),
+			&tempBuffers[1],
+			&twm->multiScatteringLUT
 		))
 
-		SHFile_freex(&tmpBinaries[0]);
 		Buffer_freex(&tempBuffers[0]);
+		Buffer_freex(&tempBuffers[1]);
+	}
 
-		//Indirect compute
+	//Sky cache (opt in, it replaces the LUTs for misses); rendered on the first draw.
+	//The texture is CPU backed, so it can be updated when the sun moves.
 
-		path = CharString_createRefCStrConst("//rt_core/shaders/indirect_compute.oiSH");
-		gotoIfError3(clean, File_readx(path, U64_MAX, 0, 0, &tempBuffers[0], e_rr))
-		gotoIfError3(clean, SHFile_readx(tempBuffers[0], false, &tmpBinaries[0], e_rr))
+	if(useSkyCache) {
 
-		main = GraphicsDeviceRef_getFirstShaderEntry(
-			twm->device,
-			tmpBinaries[0],
-			CharString_createRefCStrConst("main"),
-			(ListCharString) { 0 },
-			ESHExtension_None,
-			ESHExtension_None
-		);
+		gotoIfError3(clean, SkyCache_createx(SkyCache_defaultSize, SkyCache_defaultThresholdDeg, &twm->skyCache, e_rr))
 
-		gotoIfError3(clean, GraphicsDeviceRef_createPipelineCompute(
+		const U16 skySize = (U16) twm->skyCache.size;
+		gotoIfError2(clean, Buffer_createEmptyBytesx(sizeof(F16) * 4 * 6 * skySize * skySize, &tempBuffers[0]))
+
+		gotoIfError2(clean, GraphicsDeviceRef_createTexture(
 			twm->device,
-			tmpBinaries[0],
-			CharString_createRefCStrConst("Indirect compute dispatch"),
-			main,
-			EPipelineFlags_None,
+			ETextureType_2D,
+			ETextureFormatId_RGBA16f,
+			EGraphicsResourceFlag_ShaderReadBindless | EGraphicsResourceFlag_CPUBacked,
+			skySize * 6, skySize, 1,
 			NULL,
-			&twm->indirectCompute,
-			e_rr
+			CharString_createRefCStrConst("Sky cache"),
+			&tempBuffers[0],
+			&twm->skyCacheTexture
 		))
 
-		SHFile_freex(&tmpBinaries[0]);
 		Buffer_freex(&tempBuffers[0]);
-
-		//Inline raytracing test
-
-		if (twm->enableRtInline) {
-			
-			path = CharString_createRefCStrConst("//rt_core/shaders/raytracing_test.oiSH");
-			gotoIfError3(clean, File_readx(path, U64_MAX, 0, 0, &tempBuffers[0], e_rr))
-			gotoIfError3(clean, SHFile_readx(tempBuffers[0], false, &tmpBinaries[0], e_rr))
-
-			//TODO: Turn this into uniforms
-
-			CharString definesArr[2];
-			definesArr[0] = CharString_createRefCStrConst("X");
-			definesArr[1] = CharString_createRefCStrConst("Y");
-
-			ListCharString defines = (ListCharString) { 0 };
-			gotoIfError2(clean, ListCharString_createRefConst(
-				definesArr, sizeof(definesArr) / sizeof(definesArr[0]), &defines
-			))
-
-			main = GraphicsDeviceRef_getFirstShaderEntry(
-				twm->device,
-				tmpBinaries[0],
-				CharString_createRefCStrConst("main"),
-				defines,
-				ESHExtension_None,
-				ESHExtension_None
-			);
-
-			gotoIfError3(clean, GraphicsDeviceRef_createPipelineCompute(
-				twm->device,
-				tmpBinaries[0],
-				CharString_createRefCStrConst("Inline raytracing test"),
-				main,
-				EPipelineFlags_None,
-				NULL,
-				&twm->inlineRaytracingTest,
-				e_rr
-			))
-
-			SHFile_freex(&tmpBinaries[0]);
-			Buffer_freex(&tempBuffers[0]);
-		}
 	}
 
-	//Graphics pipelines
+	//Create pipelines
 
-	Log_debugLnx("Create graphics pipelines");
+	Log_debugLnx("Create pipelines");
 
 	{
-		CharString path = CharString_createRefCStrConst("//rt_core/shaders/graphics_test.oiSH");
-		gotoIfError3(clean, File_readx(path, U64_MAX, 0, 0, &tempBuffers[0], e_rr))
-		gotoIfError3(clean, SHFile_readx(tempBuffers[0], false, &tmpBinaries[0], e_rr))
-
-		path = CharString_createRefCStrConst("//rt_core/shaders/depth_test.oiSH");
-		gotoIfError3(clean, File_readx(path, U64_MAX, 0, 0, &tempBuffers[1], e_rr))
-		gotoIfError3(clean, SHFile_readx(tempBuffers[1], false, &tmpBinaries[1], e_rr))
+		const Ns pipelineStart = Time_now();
 
-		ListSHFile binaries = (ListSHFile) { 0 };
-		gotoIfError2(clean, ListSHFile_createRefConst(tmpBinaries, 2, &binaries))
-
-		U32 mainVS = GraphicsDeviceRef_getFirstShaderEntry(
-			twm->device,
-			tmpBinaries[0],
-			CharString_createRefCStrConst("mainVS"),
-			(ListCharString) { 0 },
-			ESHExtension_None,
-			ESHExtension_None
-		);
-
-		U32 mainPS = GraphicsDeviceRef_getFirstShaderEntry(
-			twm->device,
-			tmpBinaries[0],
-			CharString_createRefCStrConst("mainPS"),
-			(ListCharString) { 0 },
-			ESHExtension_None,
-			ESHExtension_None
-		);
-
-		U32 mainVSDepth = GraphicsDeviceRef_getFirstShaderEntry(
-			twm->device,
-			tmpBinaries[1],
-			CharString_createRefCStrConst("mainVS"),
-			(ListCharString) { 0 },
-			ESHExtension_None,
-			ESHExtension_None
-		);
+		pipelineJobs.twm = twm;
+		pipelineJobs.nativeFormat = _PLATFORM_TYPE == PLATFORM_ANDROID ? ETextureFormatId_RGBA8 : ETextureFormatId_BGRA8;
 
-		//Pipeline without depth stencil
+		pipelineJobs.targets[ETestPipeline_PrepareIndirect] = &twm->prepareIndirectPipeline;
+		pipelineJobs.targets[ETestPipeline_IndirectCompute] = &twm->indirectCompute;
+		pipelineJobs.targets[ETestPipeline_InlineRaytracing] = &twm->inlineRaytracingTest;
+		pipelineJobs.targets[ETestPipeline_Graphics] = &twm->graphicsTest;
+		pipelineJobs.targets[ETestPipeline_GraphicsDepth] = &twm->graphicsDepthTest;
+		pipelineJobs.targets[ETestPipeline_GraphicsDepthMSAA] = &twm->graphicsDepthTestMSAA;
+		pipelineJobs.targets[ETestPipeline_Raytracing] = &twm->raytracingPipelineTest;
 
-		ListPipelineStage stages = (ListPipelineStage) { 0 };
+		CharString cachePath = CharString_createRefCStrConst("pipeline_cache.bin");
+		gotoIfError3(clean, PipelineCache_loadx(cachePath, &pipelineCache, e_rr))
 
-		PipelineStage stageArr[2] = {
-			(PipelineStage) { .binaryId = mainVS, .shFileId = 0 },
-			(PipelineStage) { .binaryId = mainPS, .shFileId = 0 }
-		};
+		//Load every shader that's used by at least one pipeline
 
-		gotoIfError2(clean, ListPipelineStage_createRefConst(stageArr, 2, &stages))
+		Bool shaderUsed[ETestShader_Count] = { 0 };
 
-		ETextureFormatId nativeFormat = _PLATFORM_TYPE == PLATFORM_ANDROID ? ETextureFormatId_RGBA8 : ETextureFormatId_BGRA8;
+		for(U64 i = 0; i < ETestPipeline_Count; ++i) {
 
-		PipelineGraphicsInfo info = (PipelineGraphicsInfo) {
-			.vertexLayout = {
-				.bufferStrides12_isInstance1 = { (U16) sizeof(VertexPosBuffer), (U16) sizeof(VertexDataBuffer) },
-				.attributes = {
-					(VertexAttribute) {
-						.offset11 = 0,
-						.bufferId4 = 0,
-						.format = ETextureFormatId_RG16f,
-					},
-					(VertexAttribute) {
-						.offset11 = 0,
-						.bufferId4 = 1,
-						.format = ETextureFormatId_RG16f,
-					}
-				}
-			},
-			.attachmentCountExt = 1,
-			.attachmentFormatsExt = { (U8) nativeFormat },
-			.depthFormatExt = EDepthStencilFormat_D16,
-			.msaa = EMSAASamples_Off,
-			.msaaMinSampleShading = 0.2f
-		};
+			if(!TestPipeline_isUsed(twm, (ETestPipeline) i))
+				continue;
 
-		gotoIfError3(clean, GraphicsDeviceRef_createPipelineGraphics(
-			twm->device,
-			binaries,
-			&stages,
-			info,
-			CharString_createRefCStrConst("Test graphics pipeline"),
-			EPipelineFlags_None,
-			NULL,
-			&twm->graphicsTest,
-			e_rr
-		))
+			pipelineJobs.pipelines[pipelineJobs.pipelineCount++] = (ETestPipeline) i;
 
-		//Pipeline with depth (but still the same pixel shader)
+			for(U64 j = 0; j < PipelineCache_maxEntries && TestPipeline_infos[i].entries[j]; ++j)
+				shaderUsed[TestPipeline_infos[i].shaders[j]] = true;
+		}
 
-		stageArr[0] = (PipelineStage) { .binaryId = mainVSDepth, .shFileId = 1 };
-		stageArr[1] = (PipelineStage) { .binaryId = mainPS,		 .shFileId = 0 };
+		for(U64 i = 0; i < ETestShader_Count; ++i)
+			if(shaderUsed[i])
+				pipelineJobs.shaders[pipelineJobs.shaderCount++] = (ETestShader) i;
 
-		gotoIfError2(clean, ListPipelineStage_createRefConst(stageArr, 2, &stages))
+		gotoIfError3(clean, Parallel_for(pipelineJobs.shaderCount, TestPipelineJobs_loadShader, &pipelineJobs, e_rr))
+		gotoIfError3(clean, TestPipelineJobs_checkErrors(&pipelineJobs, pipelineJobs.shaderCount, e_rr))
 
-		info = (PipelineGraphicsInfo) {
-			.depthStencil = (DepthStencilState) { .flags = EDepthStencilFlags_DepthWrite },
-			.attachmentCountExt = 1,
-			.attachmentFormatsExt = { (U8) nativeFormat },
-			.depthFormatExt = EDepthStencilFormat_D16,
-			.msaa = EMSAASamples_Off,
-			.msaaMinSampleShading = 0.2f
-		};
+		//Find cached entries; pipelines that aren't cached are assumed to be the slowest
 
-		gotoIfError3(clean, GraphicsDeviceRef_createPipelineGraphics(
-			twm->device,
-			binaries,
-			&stages,
-			info,
-			CharString_createRefCStrConst("Test graphics depth pipeline"),
-			EPipelineFlags_None,
-			NULL,
-			&twm->graphicsDepthTest,
-			e_rr
-		))
+		Bool isWarm = true;
 
-		gotoIfError2(clean, ListPipelineStage_createRefConst(stageArr, 2, &stages))
+		for(U64 i = 0; i < pipelineJobs.pipelineCount; ++i) {
 
-		info = (PipelineGraphicsInfo) {
-			.depthStencil = (DepthStencilState) { .flags = EDepthStencilFlags_DepthWrite },
-			.attachmentCountExt = 1,
-			.attachmentFormatsExt = { (U8) nativeFormat },
-			.depthFormatExt = EDepthStencilFormat_D16,
-			.msaa = EMSAASamples_x4,
-			.msaaMinSampleShading = 0.2f
-		};
+			const ETestPipeline pipeline = pipelineJobs.pipelines[i];
 
-		gotoIfError3(clean, GraphicsDeviceRef_createPipelineGraphics(
-			twm->device,
-			binaries,
-			&stages,
-			info,
-			CharString_createRefCStrConst("Test graphics depth pipeline MSAA"),
-			EPipelineFlags_None,
-			NULL,
-			&twm->graphicsDepthTestMSAA,
-			e_rr
-		))
+			const U64 key = TestPipelineJobs_getKey(
+				&pipelineJobs, pipeline, GraphicsInstanceRef_ptr(twm->instance)->api, &deviceInfo.capabilities
+			);
 
-		SHFile_freex(&tmpBinaries[0]);
-		SHFile_freex(&tmpBinaries[1]);
-		Buffer_freex(&tempBuffers[0]);
-		Buffer_freex(&tempBuffers[1]);
-	}
+			const PipelineCacheEntry *cached = PipelineCache_find(&pipelineCache, key);
+			pipelineJobs.cached[pipeline] = !!cached;
+			pipelineJobs.entries[pipeline] = cached ? *cached : (PipelineCacheEntry) { .key = key, .createTime = U64_MAX };
 
-	//Raytracing pipelines
+			if(!cached)
+				isWarm = false;
+		}
 
-	Log_debugLnx("Create raytracing pipelines");
+		//Slowest first, so they don't end up last on a single thread (there are only a few, so insertion sort)
 
-	if (twm->enableRtPipeline) {
+		for(U64 i = 1; i < pipelineJobs.pipelineCount; ++i) {
 
-		CharString path = CharString_createRefCStrConst("//rt_core/shaders/raytracing_pipeline_test.oiSH");
-		gotoIfError3(clean, File_readx(path, U64_MAX, 0, 0, &tempBuffers[0], e_rr))
-		gotoIfError3(clean, SHFile_readx(tempBuffers[0], false, &tmpBinaries[0], e_rr))
+			const ETestPipeline pipeline = pipelineJobs.pipelines[i];
+			const Ns createTime = pipelineJobs.entries[pipeline].createTime;
 
-		U32 mainMiss = GraphicsDeviceRef_getFirstShaderEntry(
-			twm->device,
-			tmpBinaries[0],
-			CharString_createRefCStrConst("mainMiss"),
-			(ListCharString) { 0 },
-			ESHExtension_None,
-			ESHExtension_None
-		);
+			U64 j = i;
 
-		U32 mainClosestHit = GraphicsDeviceRef_getFirstShaderEntry(
-			twm->device,
-			tmpBinaries[0],
-			CharString_createRefCStrConst("mainClosestHit"),
-			(ListCharString) { 0 },
-			ESHExtension_None,
-			ESHExtension_None
-		);
+			for(; j && pipelineJobs.entries[pipelineJobs.pipelines[j - 1]].createTime < createTime; --j)
+				pipelineJobs.pipelines[j] = pipelineJobs.pipelines[j - 1];
 
-		U32 mainRaygen = GraphicsDeviceRef_getFirstShaderEntry(
-			twm->device,
-			tmpBinaries[0],
-			CharString_createRefCStrConst("mainRaygen"),
-			(ListCharString) { 0 },
-			ESHExtension_None,
-			ESHExtension_None
-		);
+			pipelineJobs.pipelines[j] = pipeline;
+		}
 
-		PipelineStage stageArr[] = {
-			(PipelineStage) { .binaryId = mainClosestHit,	.shFileId = 0 },
-			(PipelineStage) { .binaryId = mainMiss,			.shFileId = 0 },
-			(PipelineStage) { .binaryId = mainRaygen,		.shFileId = 0 }
-		};
+		gotoIfError3(clean, Parallel_for(pipelineJobs.pipelineCount, TestPipelineJobs_createPipeline, &pipelineJobs, e_rr))
+		gotoIfError3(clean, TestPipelineJobs_checkErrors(&pipelineJobs, pipelineJobs.pipelineCount, e_rr))
 
-		PipelineRaytracingGroup hitArr[] = {
-			(PipelineRaytracingGroup) { .closestHit = 0, .anyHit = U32_MAX, .intersection = U32_MAX }
-		};
+		//Store new entries and timings; failing to write the cache only means the next start is cold
 
-		PipelineRaytracingInfo info = (PipelineRaytracingInfo) {
-			.flags = (U8) EPipelineRaytracingFlags_DefaultStrict,
-			.maxRecursionDepth = 1
-		};
+		for(U64 i = 0; i < pipelineJobs.pipelineCount; ++i)
+			gotoIfError3(clean, PipelineCache_setx(&pipelineCache, pipelineJobs.entries[pipelineJobs.pipelines[i]], e_rr))
 
-		ListSHFile binaries = (ListSHFile) { 0 };
-		ListPipelineStage stages = (ListPipelineStage) { 0 };
-		ListPipelineRaytracingGroup hitGroups = (ListPipelineRaytracingGroup) { 0 };
+		const Ns pipelineTime = Time_now() - pipelineStart;
 
-		gotoIfError2(clean, ListSHFile_createRefConst(&tmpBinaries[0], 1, &binaries))
-		gotoIfError2(clean, ListPipelineStage_createRefConst(stageArr, sizeof(stageArr) / sizeof(stageArr[0]), &stages))
+		if(isWarm)
+			pipelineCache.lastWarmStart = pipelineTime;
 
-		gotoIfError2(clean, ListPipelineRaytracingGroup_createRefConst(hitArr, sizeof(hitArr) / sizeof(hitArr[0]), &hitGroups))
+		else pipelineCache.lastColdStart = pipelineTime;
 
-		gotoIfError3(clean, GraphicsDeviceRef_createPipelineRaytracingExt(
-			twm->device,
-			&stages,
-			binaries,
-			&hitGroups,
-			info,
-			CharString_createRefCStrConst("Raytracing pipeline test"),
-			EPipelineFlags_None,
-			NULL,
-			&twm->raytracingPipelineTest,
-			e_rr
-		))
+		PipelineCache_writex(&pipelineCache, cachePath, NULL);
 
-		SHFile_freex(&tmpBinaries[0]);
-		Buffer_freex(&tempBuffers[0]);
+		Log_debugLnx(
+			"Created %"PRIu64" pipelines in %fms (%s start, last cold start %fms, last warm start %fms)",
+			pipelineJobs.pipelineCount,
+			(F64)pipelineTime * 1e3 / SECOND,
+			isWarm ? "warm" : "cold",
+			(F64)pipelineCache.lastColdStart * 1e3 / SECOND,
+			(F64)pipelineCache.lastWarmStart * 1e3 / SECOND
+		);
 	}
 
 	//Mesh data
@@ -1543,6 +2593,25 @@ void onManagerCreate(WindowManager *manager) {
 	
 	Log_debugLnx("Create BLAS/TLAS");
 
+	TLASInstanceStatic instances[1] = {
+		(TLASInstanceStatic) {
+			.transform = {
+				{ 10, 0, 0, 0 },
+				{ 0, 10, 0, 0 },
+				{ 0, 0, 10, 0 }
+			},
+			.data = (TLASInstanceData) {
+				.instanceId24_mask8 = ((U32)0xFF << 24),
+				.sbtOffset24_flags8 = (ETLASInstanceFlag_Default << 24)
+			}
+		}
+	};
+
+	ListTLASInstanceStatic instanceList = (ListTLASInstanceStatic) { 0 };
+	gotoIfError2(clean, ListTLASInstanceStatic_createRefConst(
+		instances, sizeof(instances) / sizeof(instances[0]), &instanceList
+	))
+
 	if(twm->enableRtPipeline || twm->enableRtInline) {
 
 		//Build BLAS around first quad
@@ -1592,25 +2661,7 @@ void onManagerCreate(WindowManager *manager) {
 
 		//Build TLAS around BLAS
 
-		TLASInstanceStatic instances[1] = {
-			(TLASInstanceStatic) {
-				.transform = {
-					{ 10, 0, 0, 0 },
-					{ 0, 10, 0, 0 },
-					{ 0, 0, 10, 0 }
-				},
-				.data = (TLASInstanceData) {
-					.blasCpu = twm->blas,
-					.instanceId24_mask8 = ((U32)0xFF << 24),
-					.sbtOffset24_flags8 = (ETLASInstanceFlag_Default << 24)
-				}
-			}
-		};
-
-		ListTLASInstanceStatic instanceList = (ListTLASInstanceStatic) { 0 };
-		gotoIfError2(clean, ListTLASInstanceStatic_createRefConst(
-			instances, sizeof(instances) / sizeof(instances[0]), &instanceList
-		))
+		instances[0].data.blasCpu = twm->blas;
 
 		gotoIfError2(clean, GraphicsDeviceRef_createTLASExt(
 			twm->device,
@@ -1624,6 +2675,27 @@ void onManagerCreate(WindowManager *manager) {
 		))
 	}
 
+	//Same BLAS & TLAS for the CPU raytracer
+
+	if(twm->enableRtCpu) {
+
+		gotoIfError3(clean, CpuBLAS_createx(
+			ECpuBVHPolicy_SAH,
+			ETextureFormatId_RG16f, 0, (U16) sizeof(vertexPos[0]),
+			ETextureFormatId_R16u,
+			Buffer_createRefConst(vertexPos, sizeof(vertexPos)),
+			Buffer_createRefConst(indexDat, sizeof(U16) * 6),
+			&twm->cpuBlas,
+			e_rr
+		))
+
+		const CpuBLAS *cpuBlases[] = { &twm->cpuBlas };
+		gotoIfError3(clean, CpuTLAS_createx(instanceList, cpuBlases, &twm->cpuTlas, e_rr))
+
+		if(cpuPathTracing)
+			gotoIfError3(clean, CpuPathTracer_createx(CpuPathTracer_defaultWaveSize, &twm->cpuPathTracer, e_rr))
+	}
+
 	//Other shader buffers
 	
 	Log_debugLnx("Create shader buffers");
@@ -1636,7 +2708,11 @@ void onManagerCreate(WindowManager *manager) {
 	name = CharString_createRefCStrConst("View proj matrices buffer");
 	gotoIfError2(clean, GraphicsDeviceRef_createBuffer(
 		twm->device,
-		EDeviceBufferUsage_None, EGraphicsResourceFlag_ShaderRWBindless, NULL, name, sizeof(F32x4) * 4 * 3 * 2,
+		EDeviceBufferUsage_None,
+		EGraphicsResourceFlag_ShaderReadBindless | EGraphicsResourceFlag_CPUBacked,
+		NULL,
+		name,
+		sizeof(CameraMatrices) * TestWindowManager_maxCameras * 2,
 		&twm->viewProjMatrices
 	))
 
@@ -1705,16 +2781,16 @@ void onManagerCreate(WindowManager *manager) {
 
 	gotoIfError2(clean, CommandListRef_begin(commandList, true, U64_MAX))
 
-	typedef enum EScopes {
+	typedef enum EPrepareScopes {
 		EScopes_PrepareIndirect,
 		EScopes_IndirectCalcConstant
-	} EScopes;
+	} EPrepareScopes;
 
-	EScopes scopes; (void)scopes;
+	EPrepareScopes scopes; (void)scopes;
 
 	//Prepare 2 indirect draw calls and update constant color
 
-	Transition transitions[3] = {
+	Transition transitions[2] = {
 		(Transition) {
 			.resource = twm->indirectDrawBuffer,
 			.range = { .buffer = (BufferRange) { 0 } },
@@ -1726,16 +2802,10 @@ void onManagerCreate(WindowManager *manager) {
 			.range = { .buffer = (BufferRange) { 0 } },
 			.stage = EPipelineStage_Compute,
 			.isWrite = true
-		},
-		(Transition) {
-			.resource = twm->viewProjMatrices,
-			.range = { .buffer = (BufferRange) { 0 } },
-			.stage = EPipelineStage_Compute,
-			.isWrite = true
 		}
 	};
 
-	gotoIfError2(clean, ListTransition_createRefConst(transitions, 3, &transitionArr))
+	gotoIfError2(clean, ListTransition_createRefConst(transitions, 2, &transitionArr))
 	depsArr.length = 0;
 
 	if(!CommandListRef_startScope(commandList, transitionArr, EScopes_PrepareIndirect, depsArr).genericError) {
@@ -1774,13 +2844,11 @@ void onManagerCreate(WindowManager *manager) {
 
 clean:
 
-	ListSubResourceData_freeAllx(&subResource);
-
 	for(U64 i = 0; i < sizeof(tempBuffers) / sizeof(tempBuffers[0]); ++i)
 		Buffer_freex(&tempBuffers[i]);
 
-	for(U64 i = 0; i < sizeof(tmpBinaries) / sizeof(tmpBinaries[0]); ++i)
-		SHFile_freex(&tmpBinaries[i]);
+	TestPipelineJobs_freex(&pipelineJobs);
+	PipelineCache_freex(&pipelineCache);
 
 	if(!s_uccess)
 		Error_printx(err, ELogLevel_Error, ELogOptions_Default);
@@ -1792,6 +2860,16 @@ void onManagerDestroy(WindowManager *manager) {
 
 	//Delete objects
 
+	AssetLoader_freex(&twm->assets);			//Waits for the workers
+
+	const RenderTargetPoolStats targetStats = twm->renderTargets.stats;
+
+	Log_debugLnx(
+		"Render targets: %"PRIu64" acquired, %"PRIu64" allocated, %"PRIu64" freed, peak %fMiB",
+		targetStats.acquires, targetStats.allocations, targetStats.frees, (F64)targetStats.peakBytes / (1 << 20)
+	);
+
+	RenderTargetPool_free(&twm->renderTargets);
 	DeviceBufferRef_dec(&twm->aabbs);
 	DeviceBufferRef_dec(&twm->vertexBuffers[0]);
 	DeviceBufferRef_dec(&twm->vertexBuffers[1]);
@@ -1803,6 +2881,11 @@ void onManagerDestroy(WindowManager *manager) {
 
 	DeviceTextureRef_dec(&twm->crabbage2049x);
 	DeviceTextureRef_dec(&twm->crabbageCompressed);
+	DeviceTextureRef_dec(&twm->transmittanceLUT);
+	DeviceTextureRef_dec(&twm->multiScatteringLUT);
+	DeviceTextureRef_dec(&twm->skyCacheTexture);
+	AtmosphereLUT_freex(&twm->atmosphereLut);
+	SkyCache_freex(&twm->skyCache);
 
 	PipelineRef_dec(&twm->graphicsTest);
 	PipelineRef_dec(&twm->graphicsDepthTest);
@@ -1821,6 +2904,11 @@ void onManagerDestroy(WindowManager *manager) {
 	BLASRef_dec(&twm->blas);
 	BLASRef_dec(&twm->blasAABB);
 
+	CpuPathTracer_freex(&twm->cpuPathTracer);
+	CpuTLAS_freex(&twm->cpuTlas);
+	FrameStats_freex(&twm->frameStats);
+	CpuBLAS_freex(&twm->cpuBlas);
+
 	SamplerRef_dec(&twm->nearest);
 	SamplerRef_dec(&twm->linear);
 	SamplerRef_dec(&twm->anisotropic);
@@ -1832,6 +2920,28 @@ void onManagerDestroy(WindowManager *manager) {
 	GraphicsInstanceRef_dec(&twm->instance);
 }
 
+//key=value arguments
+
+static const C8 *TestArgs_match(const C8 *arg, const C8 *key) {
+
+	U64 i = 0;
+
+	for(; key[i] && arg[i] == key[i]; ++i)
+		;
+
+	return !key[i] && arg[i] == '=' ? arg + i + 1 : NULL;
+}
+
+static void TestArgs_parseU64(const C8 *value, U64 *result) {
+
+	U64 parsed = 0;
+
+	if(CharString_parseU64(CharString_createRefCStrConst(value), &parsed))
+		*result = parsed;
+
+	else Log_warnLnx("Couldn't parse \"%s\" as an unsigned integer, ignoring it", value);
+}
+
 Platform_defineEntrypoint() {
 
 	Error err = Platform_create(Platform_argc, Platform_argv, Platform_getData(), NULL, true);
@@ -1844,6 +2954,123 @@ Platform_defineEntrypoint() {
 	Error *e_rr = &err;
 	Bool s_uccess = true;
 	(void) s_uccess;
+
+	//Benchmark mode renders a fixed number of frames without a physical window
+
+	for(I32 i = 1; i < (I32) Platform_argc; ++i) {
+
+		const C8 *arg = Platform_argv[i];
+		const C8 *value = NULL;
+
+		if((value = TestArgs_match(arg, "benchmark")) != NULL)
+			TestArgs_parseU64(value, &benchmarkFrames);
+
+		else if((value = TestArgs_match(arg, "warmup")) != NULL)
+			TestArgs_parseU64(value, &benchmarkWarmup);
+
+		else if((value = TestArgs_match(arg, "report")) != NULL)
+			benchmarkReport = value;
+
+		else if((value = TestArgs_match(arg, "windows")) != NULL)
+			TestArgs_parseU64(value, &benchmarkWindows);
+
+		else if((value = TestArgs_match(arg, "recordScopes")) != NULL) {
+			U64 record = 0;
+			TestArgs_parseU64(value, &record);
+			benchmarkRecordScopes = !!record;
+		}
+
+		else if((value = TestArgs_match(arg, "views")) != NULL)
+			TestArgs_parseU64(value, &testViews);
+
+		else if((value = TestArgs_match(arg, "packets")) != NULL) {
+			U64 packets = 1;
+			TestArgs_parseU64(value, &packets);
+			cpuRayPackets = !!packets;
+		}
+
+		else if((value = TestArgs_match(arg, "accumulate")) != NULL) {
+			TestArgs_parseU64(value, &cpuAccumulation);
+			cpuAccumulationSet = true;
+		}
+
+		else if((value = TestArgs_match(arg, "pathTracer")) != NULL) {
+			U64 pathTracer = 0;
+			TestArgs_parseU64(value, &pathTracer);
+			cpuPathTracing = !!pathTracer;
+		}
+
+		else if((value = TestArgs_match(arg, "bounces")) != NULL)
+			TestArgs_parseU64(value, &cpuPathBounces);
+
+		else if((value = TestArgs_match(arg, "skyFactor")) != NULL)
+			TestArgs_parseU64(value, &cpuSkyFactor);
+
+		else if((value = TestArgs_match(arg, "raySamples")) != NULL)
+			TestArgs_parseU64(value, &atmosphereRaySamples);
+
+		else if((value = TestArgs_match(arg, "lightSamples")) != NULL)
+			TestArgs_parseU64(value, &atmosphereLightSamples);
+
+		else if((value = TestArgs_match(arg, "quadraticSamples")) != NULL) {
+			U64 quadratic = 0;
+			TestArgs_parseU64(value, &quadratic);
+			atmosphereQuadraticSamples = !!quadratic;
+		}
+
+		else if((value = TestArgs_match(arg, "forceCpuRaytracing")) != NULL) {
+			U64 force = 0;
+			TestArgs_parseU64(value, &force);
+			forceCpuRaytracing = !!force;
+		}
+
+		else if((value = TestArgs_match(arg, "moveCamera")) != NULL) {
+			U64 move = 0;
+			TestArgs_parseU64(value, &move);
+			moveCamera = !!move;
+		}
+
+		else if((value = TestArgs_match(arg, "skyCache")) != NULL) {
+			U64 skyCache = 0;
+			TestArgs_parseU64(value, &skyCache);
+			useSkyCache = !!skyCache;
+		}
+
+		else if((value = TestArgs_match(arg, "writeImage")) != NULL)
+			cpuImagePath = value;
+
+		else if((value = TestArgs_match(arg, "writeDDS")) != NULL) {
+			U64 write = 0;
+			TestArgs_parseU64(value, &write);
+			writeTestDDS = !!write;
+		}
+
+		else if((value = TestArgs_match(arg, "threads")) != NULL) {
+			U64 threads = 0;
+			TestArgs_parseU64(value, &threads);
+			Parallel_setThreadCount(threads);
+		}
+	}
+
+	testViews = U64_min(U64_max(testViews, 1), TestWindowManager_maxViews);
+	cpuSkyFactor = U64_min(U64_max(cpuSkyFactor, 1), SkyUpsample_maxFactor);
+
+	if(benchmarkFrames) {
+
+		renderVirtual = true;
+
+		if(!cpuAccumulationSet)		//Benchmarks should time tracing every frame
+			cpuAccumulation = 0;
+
+		benchmarkWindows = U64_min(U64_max(benchmarkWindows, 1), TestWindowManager_maxCameras / testViews);
+
+		Log_debugLnx(
+			"Benchmark: %"PRIu64" frames after %"PRIu64" warmup frames, "
+			"%"PRIu64" window(s) of %"PRIu64" view(s) recorded on %"PRIu64" thread(s)",
+			benchmarkFrames, benchmarkWarmup, benchmarkWindows, testViews,
+			U64_min(Parallel_getThreadCount(), benchmarkWindows)
+		);
+	}
 	
 	WindowManagerCallbacks callbacks;
 	callbacks.onDraw = onManagerDraw;
@@ -1854,24 +3081,28 @@ Platform_defineEntrypoint() {
 	WindowManager manager = (WindowManager) { 0 };
 	gotoIfError3(clean, WindowManager_create(callbacks, sizeof(TestWindowManager), &manager, e_rr))
 
-	Window *wind = NULL;
-	gotoIfError3(clean, WindowManager_createWindow(
-		&manager, renderVirtual ? EWindowType_Virtual : EWindowType_Physical,
-		I32x2_zero(), EResolution_get(EResolution_FHD),
-		I32x2_zero(), I32x2_zero(),
-		EWindowHint_Default,
-		CharString_createRefCStrConst("Rt core test"),
-		TestWindow_getCallbacks(),
-		EWindowFormat_AutoRGBA8,
-		sizeof(TestWindow),
-		&wind,
-		e_rr
-	))
+	for(U64 i = 0; i < (benchmarkFrames ? benchmarkWindows : 1); ++i) {
+
+		Window *wind = NULL;
+		gotoIfError3(clean, WindowManager_createWindow(
+			&manager, renderVirtual ? EWindowType_Virtual : EWindowType_Physical,
+			I32x2_zero(), EResolution_get(EResolution_FHD),
+			I32x2_zero(), I32x2_zero(),
+			EWindowHint_Default,
+			CharString_createRefCStrConst("Rt core test"),
+			TestWindow_getCallbacks(),
+			EWindowFormat_AutoRGBA8,
+			sizeof(TestWindow),
+			&wind,
+			e_rr
+		))
+	}
 
 	gotoIfError3(clean, WindowManager_wait(&manager, e_rr))		//Wait til all windows are closed and process their events
 
 clean:
 	WindowManager_free(&manager);
+	Parallel_freex();
 	Error_printx(err, ELogLevel_Error, ELogOptions_Default);
 	Platform_cleanup();
 	Platform_return(s_uccess ? 1 : -1);